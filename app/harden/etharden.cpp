@@ -2,6 +2,8 @@
 #include <functional>
 #include <string>
 #include <cstring>  // for std::strcmp
+#include <cstdlib>  // for std::strtoul
+#include <climits>  // for INT_MAX
 #include "etharden.h"
 #include "pass/chunkpass.h"
 #include "pass/stackxor.h"
@@ -10,6 +12,7 @@
 #include "pass/shadowstack.h"
 #include "pass/permutedata.h"
 #include "pass/profileinstrument.h"
+#include "pass/profileedge.h"
 #include "pass/profilesave.h"
 #include "pass/condwatchpoint.h"
 #include "pass/retpoline.h"
@@ -22,6 +25,7 @@
 
 void HardenApp::parse(const std::string &filename, bool oneToOne) {
     egalito = new EgalitoInterface(!quiet, true);
+    unionOutput = !oneToOne;
 
     std::cout << "Transforming file [" << filename << "]\n";
 
@@ -70,7 +74,11 @@ void HardenApp::doShadowStack(bool gsMode) {
     std::cout << "Adding shadow stack...\n";
     ShadowStackPass shadowStack(gsMode
         ? ShadowStackPass::MODE_GS : ShadowStackPass::MODE_CONST);
+    shadowStack.setElide(elideShadowStack);
     program->accept(&shadowStack);
+    std::cout << "Instrumented " << shadowStack.getInstrumentedCount()
+        << " functions, " << shadowStack.getElidedCount()
+        << " proven safe without a shadow stack\n";
 }
 
 void HardenApp::doPermuteData() {
@@ -82,10 +90,22 @@ void HardenApp::doPermuteData() {
 void HardenApp::doProfiling() {
     std::cout << "Adding function profiling...\n";
     auto program = getProgram();
-    RUN_PASS(ProfileInstrumentPass(), program);
+    ProfileInstrumentPass profileInstrument(profilePerThread
+        ? ProfileInstrumentPass::MODE_PER_THREAD
+        : ProfileInstrumentPass::MODE_GLOBAL);
+    profileInstrument.setAtomic(profileAtomic);
+    profileInstrument.setSamplePeriod(profileSamplePeriod);
+    RUN_PASS(profileInstrument, program);
     RUN_PASS(ProfileSavePass(), program);
 }
 
+void HardenApp::doEdgeProfiling() {
+    std::cout << "Adding edge profiling...\n";
+    auto program = getProgram();
+    RUN_PASS(ProfileEdgePass(), program);
+    RUN_PASS(ProfileSavePass(ProfileSavePass::SAVE_EDGES), program);
+}
+
 void HardenApp::doWatching() {
     std::cout << "Adding conditional watchpoint...\n";
     auto program = getProgram();
@@ -93,12 +113,24 @@ void HardenApp::doWatching() {
     //RUN_PASS(ProfileSavePass(), program);
 }
 
-void HardenApp::doRetpolines() {
+void HardenApp::doRetpolines(bool shared) {
     std::cout << "Adding retpolines...\n";
     auto program = getProgram();
-    for(auto module : CIter::children(program)) {
-        RUN_PASS(RetpolinePass(), module);
+    RetpolinePass retpoline(shared ? RetpolinePass::MODE_SHARED
+        : RetpolinePass::MODE_PER_OPERAND);
+    retpoline.setMakeDirect(shared);
+    if(shared && unionOutput) {
+        // one set of thunks for the whole output
+        program->accept(&retpoline);
     }
+    else {
+        for(auto module : CIter::children(program)) {
+            module->accept(&retpoline);
+        }
+    }
+    std::cout << "Added " << retpoline.getThunkCount() << " thunks of "
+        << retpoline.getThunkSize() << " bytes, "
+        << retpoline.getDirectCount() << " branches made direct\n";
 }
 
 void HardenApp::doGadgetReduction() {
@@ -137,16 +169,24 @@ static void printUsage(const char *program) {
         "Modes:\n"
         "    --nop          No transformation (default)\n"
         "    --retpolines   Add inline retpolines, SPECTRE mitigation\n"
+        "        --retpolines-shared  One thunk per register, shared program-wide\n"
         "    --cfi          Intel CET endbr-based Control-Flow Integrity\n"
         "    --ss           default shadow stack\n"
         "        --ss-xor        XOR-based shadowstack\n"
         "        --ss-gs         GS-Shadowstack with no endbr\n"
         "        --ss-const      Constant offset shadowstack\n"
+        "        --ss-elide      Skip functions that can't overwrite their return address\n"
         "    --cet          default Control-Flow Enforcement (Intel CET)\n"
         "        --cet-gs        GS shadow stack implementation\n"
         "        --cet-const     Constant offset shadow stack implementation\n"
         "    --permute-data Randomize order of global variables in .data\n"
         "    --profile      Add profiling counters to each function\n"
+        "        --profile-atomic    Use lock-prefixed counter increments\n"
+        "        --profile-thread    Per-thread counter blocks, merged by etprofile\n"
+        "                            (may be combined with --profile-atomic;\n"
+        "                            not for static executables or the loader)\n"
+        "        --profile-sample=N  Only count every Nth function entry\n"
+        "    --profile-edges     Count block and edge executions, see etprofile --edges\n"
         "    --cond-watchpoint   Add conditional watchpoints for GDB\n"
         "    --gadget-reduction   Transform code to eliminate code reuse gadgets.\n"
         "    --gadget-poisoning   Transform code to poison code reuse gadgets, reducing their quality.\n"
@@ -171,16 +211,21 @@ void HardenApp::run(int argc, char **argv) {
 
         {"--nop",           [&ops] () { }},
         {"--retpolines",    [&ops] () { ops.push_back("retpolines"); }},
+        {"--retpolines-shared", [&ops] () { ops.push_back("retpolines-shared"); }},
         {"--cfi",           [&ops] () { ops.push_back("cfi"); }},
         {"--ss",            [&ops] () { ops.push_back("ss-const"); }},
         {"--ss-xor",        [&ops] () { ops.push_back("ss-xor"); }},
         {"--ss-gs",         [&ops] () { ops.push_back("ss-gs"); }},
         {"--ss-const",      [&ops] () { ops.push_back("ss-const"); }},
+        {"--ss-elide",      [this] () { elideShadowStack = true; }},
         {"--cet",           [&ops] () { ops.push_back("cet-const"); }},
         {"--cet-gs",        [&ops] () { ops.push_back("cet-gs"); }},
         {"--cet-const",     [&ops] () { ops.push_back("cet-const"); }},
         {"--permute-data",  [&ops] () { ops.push_back("permute-data"); }},
         {"--profile",       [&ops] () { ops.push_back("profile"); }},
+        {"--profile-atomic", [this] () { profileAtomic = true; }},
+        {"--profile-thread", [this] () { profilePerThread = true; }},
+        {"--profile-edges", [&ops] () { ops.push_back("profile-edges"); }},
         {"--cond-watchpoint", [&ops] () { ops.push_back("cond-watchpoint"); }},
 	    {"--gadget-reduction", [&ops] () { ops.push_back("gadget-reduction"); }},
         {"--gadget-poisoning", [&ops] () { ops.push_back("gadget-poisoning"); }},
@@ -195,8 +240,10 @@ void HardenApp::run(int argc, char **argv) {
         {"cet-const",       [this] () { doShadowStack(false); doCFI(); }},
         {"permute-data",    [this] () { doPermuteData(); }},
         {"profile",         [this] () { doProfiling(); }},
+        {"profile-edges",   [this] () { doEdgeProfiling(); }},
         {"cond-watchpoint", [this] () { doWatching(); }},
-        {"retpolines",      [this] () { doRetpolines(); }},
+        {"retpolines",      [this] () { doRetpolines(false); }},
+        {"retpolines-shared", [this] () { doRetpolines(true); }},
 	    {"gadget-reduction",[this] () { doGadgetReduction(); }},
         {"gadget-poisoning",[this] () { doGadgetPoisoning(); }},
     };
@@ -205,6 +252,20 @@ void HardenApp::run(int argc, char **argv) {
         const char *arg = argv[a];
         if(arg[0] == '-') {
             bool found = false;
+            const char *samplePrefix = "--profile-sample=";
+            if(std::strncmp(arg, samplePrefix, std::strlen(samplePrefix)) == 0) {
+                // the period is encoded as a sign-extended imm32
+                const char *value = arg + std::strlen(samplePrefix);
+                char *end;
+                unsigned long period = std::strtoul(value, &end, 0);
+                if(!*value || *end || period == 0 || period > INT_MAX) {
+                    std::cout << "Error: --profile-sample must be between 1 and "
+                        << INT_MAX << "\n";
+                    break;
+                }
+                profileSamplePeriod = period;
+                continue;
+            }
             for(auto action : actions) {
                 if(std::strcmp(arg, action.str) == 0) {
                     action.action();
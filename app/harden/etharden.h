@@ -8,6 +8,11 @@ private:
     bool quiet;
     EgalitoInterface *egalito;
     bool eliminateGadgetsDuringGeneration = false;
+    size_t profileSamplePeriod = 1;
+    bool profileAtomic = false;
+    bool profilePerThread = false;
+    bool elideShadowStack = false;
+    bool unionOutput = false;
 public:
     HardenApp() : quiet(true) {}
     void run(int argc, char **argv);
@@ -19,8 +24,9 @@ private:
     void doShadowStack(bool gsMode);
     void doPermuteData();
     void doProfiling();
+    void doEdgeProfiling();
     void doWatching();
-    void doRetpolines();
+    void doRetpolines(bool shared);
     void doGadgetReduction();
     void doGadgetPoisoning();
 };
@@ -8,10 +8,15 @@
 #include <cmath>
 #include <functional>
 #include <cstring>  // for std::strcmp
+#include <set>
 #include "etorder.h"
 #include "conductor/interface.h"
 #include "chunk/function.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "analysis/callchain.h"
 #include "operation/find2.h"
+#include "pass/hotcoldsplit.h"
 
 #undef DEBUG_GROUP
 #define DEBUG_GROUP load
@@ -81,8 +86,127 @@ static std::vector<Function *> parseOrder(Conductor *conductor, Module *module,
     return order;
 }
 
+typedef HotColdSplitPass::BlockCounts BlockCounts;
+
+// Reads the output of etprofile --edges. Lines with unknown (?) counts and
+// edge lines are skipped; returns false if there are no function records.
+static bool parseEdgeProfile(const std::string &orderFile,
+    std::map<std::string, BlockCounts> &profiles) {
+
+    std::ifstream file(orderFile.c_str());
+    std::string line;
+    BlockCounts *current = nullptr;
+    while(std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if(keyword == "function") {
+            std::string name;
+            if(stream >> name) current = &profiles[name];
+        }
+        else if(keyword == "block" && current) {
+            address_t address;
+            unsigned long count;
+            if(stream >> std::hex >> address >> std::dec >> count) {
+                (*current)[address] = count;
+            }
+        }
+    }
+    return !profiles.empty();
+}
+
+static Function *getTargetFunction(Link *link) {
+    if(!link) return nullptr;
+    for(Chunk *c = &*link->getTarget(); c; c = c->getParent()) {
+        if(auto function = dynamic_cast<Function *>(c)) return function;
+    }
+    return nullptr;
+}
+
+// Profile-guided layout: optionally splits cold blocks out of hot
+// functions, then orders hot functions with call-chain clustering, weighting
+// each direct call (or tail jump) by the execution count of its block.
+// Functions without samples follow in their original order, and the cold
+// parts come last.
+static std::vector<Function *> layoutFromProfile(Conductor *conductor,
+    Module *module, const std::map<std::string, BlockCounts> &profiles,
+    bool splitCold) {
+
+    std::map<Function *, BlockCounts> counts;
+    for(const auto &pair : profiles) {
+        auto f = ChunkFind2(conductor).findFunctionInModule(
+            pair.first.c_str(), module);
+        if(f) counts[f] = pair.second;
+    }
+
+    // measure before splitting, which moves blocks around
+    std::map<Function *, unsigned long> samples;
+    std::map<std::pair<Function *, Function *>, unsigned long> calls;
+    for(const auto &pair : counts) {
+        auto function = pair.first;
+        for(auto block : CIter::children(function)) {
+            auto it = pair.second.find(block->getAddress());
+            if(it == pair.second.end() || !(*it).second) continue;
+            auto count = (*it).second;
+
+            samples[function] += count * block->getSize();
+            for(auto instr : CIter::children(block)) {
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(!cfi) continue;
+                auto target = getTargetFunction(cfi->getLink());
+                if(target && target != function) {
+                    calls[std::make_pair(function, target)] += count;
+                }
+            }
+        }
+    }
+
+    std::vector<Function *> coldFunctions;
+    if(splitCold) {
+        HotColdSplitPass hotColdSplit(counts);
+        module->accept(&hotColdSplit);
+        coldFunctions = hotColdSplit.getColdFunctions();
+    }
+
+    CallChainClustering c3;
+    std::vector<Function *> hotFunctions;
+    std::map<Function *, CallChainClustering::id_t> ids;
+    for(auto func : CIter::functions(module)) {
+        auto it = samples.find(func);
+        if(it == samples.end() || !(*it).second) continue;
+        ids[func] = c3.addFunction(func->getSize(), (*it).second);
+        hotFunctions.push_back(func);
+    }
+    for(const auto &call : calls) {
+        auto caller = ids.find(call.first.first);
+        auto callee = ids.find(call.first.second);
+        if(caller != ids.end() && callee != ids.end()) {
+            c3.addCall((*caller).second, (*callee).second, call.second);
+        }
+    }
+
+    std::vector<Function *> order;
+    for(auto id : c3.computeOrder()) {
+        order.push_back(hotFunctions[id]);
+        LOG(1, "    hot [" << hotFunctions[id]->getName() << "] samples "
+            << std::dec << samples[hotFunctions[id]]);
+    }
+
+    std::set<Function *> placed(order.begin(), order.end());
+    placed.insert(coldFunctions.begin(), coldFunctions.end());
+    for(auto func : CIter::functions(module)) {
+        if(!placed.count(func)) order.push_back(func);
+    }
+    order.insert(order.end(), coldFunctions.begin(), coldFunctions.end());
+
+    LOG(0, "layout: " << hotFunctions.size() << " hot functions, "
+        << coldFunctions.size() << " cold parts");
+    return order;
+}
+
 static void parse(const std::string &filename, const std::string &orderFile,
-    const std::string &output, bool oneToOne, bool quiet) {
+    const std::string &output, bool oneToOne, bool quiet, bool splitCold) {
 
     std::cout << "Transforming file [" << filename << "]\n";
 
@@ -110,7 +234,16 @@ static void parse(const std::string &filename, const std::string &orderFile,
         std::cout << "Performing code generation into [" << output << "]...\n";
         assert(oneToOne);
 
-        auto order = parseOrder(egalito.getConductor(), module, orderFile);
+        std::map<std::string, BlockCounts> profiles;
+        std::vector<Function *> order;
+        if(parseEdgeProfile(orderFile, profiles)) {
+            std::cout << "Computing profile-guided layout...\n";
+            order = layoutFromProfile(egalito.getConductor(), module,
+                profiles, splitCold);
+        }
+        else {
+            order = parseOrder(egalito.getConductor(), module, orderFile);
+        }
 
         egalito.generate(output, order);
 
@@ -122,9 +255,13 @@ static void parse(const std::string &filename, const std::string &orderFile,
 
 static void printUsage(const char *program) {
     std::cout << "Usage: " << program << " [options] input-file function-ordering output-file\n"
-        "    Transforms an executable to a new ELF file.\n"
+        "    Transforms an executable to a new ELF file, reordering functions\n"
+        "    by the counts in function-ordering: either etprofile output, or\n"
+        "    etprofile --edges output for profile-guided (C3) layout.\n"
         "\n"
         "Options:\n"
+        "    -s     Split never-executed blocks into .cold functions placed\n"
+        "           after all other code (needs an edge profile)\n"
         "    -m     Perform mirror elf generation (1-1 output)\n"
         "    -u     Perform union elf generation (merged output)\n"
         "    -v     Verbose mode, print logging messages\n"
@@ -140,6 +277,7 @@ int main(int argc, char *argv[]) {
 
     bool oneToOne = true;
     bool quiet = true;
+    bool splitCold = false;
 
     struct {
         const char *str;
@@ -152,6 +290,9 @@ int main(int argc, char *argv[]) {
         // should we show debugging log messages?
         {"-v", [&quiet] () { quiet = false; }},
         {"-q", [&quiet] () { quiet = true; }},
+
+        // move cold blocks out of hot functions?
+        {"-s", [&splitCold] () { splitCold = true; }},
     };
 
     for(int a = 1; a < argc; a ++) {
@@ -171,7 +312,8 @@ int main(int argc, char *argv[]) {
             }
         }
         else if(argv[a] && argv[a + 1] && argv[a + 2]) {
-            parse(argv[a], argv[a + 1], argv[a + 2], oneToOne, quiet);
+            parse(argv[a], argv[a + 1], argv[a + 2], oneToOne, quiet,
+                splitCold);
             break;
         }
         else {
@@ -1,42 +1,251 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <cstring>  // for std::strlen
+#include <vector>
+#include <cstring>  // for std::strlen, std::strcmp
 #include <cstdio>
 #include "elf/elfmap.h"
+#include "pass/profileedge.h"
 
 static void printUsage(const char *program) {
     std::cout << "Usage: " << program << " [options] executable\n"
         "    Summarizes profiling information from profile.data, like gprof.\n"
         "\n"
+        "Options:\n"
+        "    --edges    Print block and edge counts from edgeprofile.data\n"
+        "               (from etharden --profile-edges), one record per line:\n"
+        "                   function <name> <calls>\n"
+        "                   block 0x<address> <count>\n"
+        "                   edge 0x<source> 0x<target>|exit <count>\n"
+        "               Counts that can't be determined are printed as ?\n"
+        "\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
+class MapReader {
+private:
+    const char *p;
+    const char *end;
+public:
+    MapReader(const char *p, const char *end) : p(p), end(end) {}
+
+    bool ok() const { return p <= end; }
+
+    template <typename ValueType>
+    ValueType read() {
+        ValueType value = 0;
+        if(p + sizeof(value) <= end) std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+    std::string readString(size_t length) {
+        std::string str;
+        if(p + length <= end) str.assign(p, length);
+        p += length;
+        return str;
+    }
+};
+
+struct EdgeRecord {
+    uint32_t source;
+    uint32_t target;
+    bool known;
+    unsigned long count;
+};
+
+// Fills in the counts of spanning tree edges: at every node, the flow in
+// equals the flow out, so a node with one unknown edge determines it.
+static void solveFlow(uint32_t nodeCount, std::vector<EdgeRecord> &edges) {
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(uint32_t node = 0; node <= nodeCount; node ++) {
+            long balance = 0;  // in minus out
+            EdgeRecord *unknown = nullptr;
+            size_t unknownCount = 0;
+            for(auto &edge : edges) {
+                if(edge.source == edge.target) continue;
+                if(edge.source != node && edge.target != node) continue;
+
+                if(!edge.known) {
+                    unknown = &edge;
+                    unknownCount ++;
+                }
+                else if(edge.target == node) balance += edge.count;
+                else balance -= edge.count;
+            }
+            if(unknownCount != 1) continue;
+
+            long count = (unknown->target == node) ? -balance : balance;
+            unknown->count = (count < 0) ? 0 : count;
+            unknown->known = true;
+            changed = true;
+        }
+    }
+}
+
+static int printEdgeProfile(ElfMap *elf) {
+    auto section = elf->findSection(".profiling.edges");
+    auto mapSection = elf->findSection(".profiling.edgemap");
+    if(!section || !mapSection) {
+        std::cerr << "Error: no edge profiling sections, use etharden"
+            " --profile-edges\n";
+        return 1;
+    }
+
+    const char *mapData = reinterpret_cast<const char *>(
+        mapSection->getReadAddress());
+    MapReader map(mapData, mapData + mapSection->getSize());
+    if(map.read<uint32_t>() != ProfileEdgePass::MAP_MAGIC
+        || map.read<uint32_t>() != ProfileEdgePass::FORMAT_VERSION) {
+
+        std::cerr << "Error: unsupported .profiling.edgemap format\n";
+        return 1;
+    }
+    uint32_t functionCount = map.read<uint32_t>();
+
+    // each run appends a copy of the whole section, header included
+    size_t size = section->getSize();
+    size_t headerSize = ProfileEdgePass::COUNTER_HEADER_SIZE;
+    std::vector<unsigned long> counters(
+        (size - headerSize) / sizeof(unsigned long));
+    std::vector<char> data(size);
+    std::ifstream file("edgeprofile.data", std::ios::binary);
+    while(file.read(data.data(), size)) {
+        MapReader header(data.data(), data.data() + size);
+        if(header.read<uint32_t>() != ProfileEdgePass::COUNTER_MAGIC
+            || header.read<uint32_t>() != ProfileEdgePass::FORMAT_VERSION
+            || header.read<uint64_t>() != counters.size()) {
+
+            std::cerr << "Error: edgeprofile.data does not match executable\n";
+            return 1;
+        }
+        for(size_t i = 0; i < counters.size(); i ++) {
+            counters[i] += header.read<uint64_t>();
+        }
+    }
+
+    for(uint32_t f = 0; f < functionCount && map.ok(); f ++) {
+        std::string name = map.readString(map.read<uint32_t>());
+        uint32_t nodeCount = map.read<uint32_t>();
+        std::vector<uint64_t> addresses;
+        for(uint32_t n = 0; n < nodeCount; n ++) {
+            addresses.push_back(map.read<uint64_t>());
+        }
+
+        std::vector<EdgeRecord> edges(map.read<uint32_t>());
+        for(auto &edge : edges) {
+            edge.source = map.read<uint32_t>();
+            edge.target = map.read<uint32_t>();
+            int32_t counter = map.read<int32_t>();
+            edge.known = (counter >= 0
+                && static_cast<size_t>(counter) < counters.size());
+            edge.count = edge.known ? counters[counter] : 0;
+            if(edge.source > nodeCount || edge.target > nodeCount) {
+                std::cerr << "Error: corrupt .profiling.edgemap\n";
+                return 1;
+            }
+        }
+        solveFlow(nodeCount, edges);
+
+        auto printCount = [] (bool known, unsigned long count) {
+            if(known) std::printf(" %lu\n", count);
+            else std::printf(" ?\n");
+        };
+
+        std::printf("function %s", name.c_str());
+        bool found = false;
+        for(const auto &edge : edges) {
+            if(edge.source == nodeCount) {
+                printCount(edge.known, edge.count);
+                found = true;
+                break;
+            }
+        }
+        if(!found) printCount(false, 0);
+
+        for(uint32_t n = 0; n < nodeCount; n ++) {
+            bool known = true;
+            unsigned long count = 0;
+            for(const auto &edge : edges) {
+                if(edge.target != n) continue;
+                known = known && edge.known;
+                count += edge.count;
+            }
+            std::printf("block 0x%lx", static_cast<unsigned long>(addresses[n]));
+            printCount(known, count);
+        }
+
+        for(const auto &edge : edges) {
+            if(edge.source == nodeCount) continue;
+            std::printf("edge 0x%lx ",
+                static_cast<unsigned long>(addresses[edge.source]));
+            if(edge.target == nodeCount) std::printf("exit");
+            else std::printf("0x%lx",
+                static_cast<unsigned long>(addresses[edge.target]));
+            printCount(edge.known, edge.count);
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     if(argc < 2) {
         printUsage(argv[0] ? argv[0] : "etprofile");
         return 0;
     }
 
-    ElfMap *elf = new ElfMap(argv[1]);
+    bool edges = false;
+    int a = 1;
+    if(!std::strcmp(argv[a], "--edges")) {
+        edges = true;
+        a ++;
+    }
+    if(a >= argc) {
+        printUsage(argv[0]);
+        return 0;
+    }
+
+    ElfMap *elf = new ElfMap(argv[a]);
+    if(edges) return printEdgeProfile(elf);
+
     auto section = elf->findSection(".profiling");
     auto nameSection = elf->findSection(".profiling.names");
 
+    // ProfileSavePass appends the output file name after the function names
+    std::vector<const char *> names;
+    char *p = reinterpret_cast<char *>(nameSection->getReadAddress());
+    char *end = p + nameSection->getSize();
+    while(p < end) {
+        names.push_back(p);
+        p += std::strlen(p) + 1;
+    }
+    if(!names.empty() && !std::strcmp(names.back(), "profile.data")) {
+        names.pop_back();
+    }
+
+    // Per-thread profiling stores several cache-line-aligned counter
+    // blocks in .profiling; fold them all onto the first block.
     size_t size = section->getSize();
+    size_t stride = names.size() * sizeof(unsigned long);
+    if(size != stride) stride = (stride + 63) & ~63;
+    if(stride == 0) return 0;
+
     char *data = new char [size];
-    std::vector<unsigned long> count(size / sizeof(unsigned long));
+    std::vector<unsigned long> count(names.size());
     std::ifstream file("profile.data");
     while(file.read(data, size)) {
         unsigned long *uldata = reinterpret_cast<unsigned long *>(data);
         for(size_t i = 0; i < size / sizeof(unsigned long); i ++) {
-            count[i] += uldata[i];
+            size_t index = (i * sizeof(unsigned long) % stride)
+                / sizeof(unsigned long);
+            if(index < count.size()) count[index] += uldata[i];
         }
     }
 
-    char *p = reinterpret_cast<char *>(nameSection->getReadAddress());
     for(size_t i = 0; i < count.size(); i ++) {
-        std::printf("%5ld [%s]\n", count[i], p);
-        p += std::strlen(p) + 1;
+        std::printf("%5ld [%s]\n", count[i], names[i]);
     }
 
     return 0;
@@ -15,7 +15,8 @@
 #include "log/registry.h"
 #include "log/temp.h"
 
-static void parse(const std::string& filename, const std::string& output, bool quiet) {
+static bool parse(const std::string& filename, const std::string& output, bool quiet,
+    bool filter) {
     ConductorSetup setup;
     std::cout << "Sandboxing file [" << filename << "]\n";
 
@@ -23,6 +24,8 @@ static void parse(const std::string& filename, const std::string& output, bool q
         GroupRegistry::getInstance()->muteAllSettings();
     }
 
+    setup.setKeepUnwindInfo(true);  // regenerate .eh_frame
+
     try {
         if(ElfMap::isElf(filename.c_str())) {
             std::cout << "Parsing ELF file and all shared library dependencies...\n";
@@ -44,9 +47,22 @@ static void parse(const std::string& filename, const std::string& output, bool q
         EndbrEnforcePass endbrEnforce;
         program->accept(&endbrEnforce);
 
-        std::cout << "Adding syscall sandbox...\n";
-        SyscallSandbox syscallSandbox(program);
-        program->accept(&syscallSandbox);
+        if(filter) {
+            std::cout << "Compiling seccomp filter...\n";
+            SyscallSandbox syscallSandbox(program, SyscallSandbox::MODE_FILTER);
+            program->accept(&syscallSandbox);
+            std::cout << "Allowed " << syscallSandbox.getFilter().getCount()
+                << " system calls";
+            if(auto unknown = syscallSandbox.getUnknownCount()) {
+                std::cout << ", " << unknown << " call sites are unresolved";
+            }
+            std::cout << "\n";
+        }
+        else {
+            std::cout << "Adding syscall sandbox...\n";
+            SyscallSandbox syscallSandbox(program);
+            program->accept(&syscallSandbox);
+        }
 
         std::cout << "Preparing for codegen...\n";
         CollapsePLTPass collapsePLT(setup.getConductor());
@@ -68,7 +84,9 @@ static void parse(const std::string& filename, const std::string& output, bool q
     }
     catch(const char *message) {
         std::cout << "Exception: " << message << std::endl;
+        return false;
     }
+    return true;
 }
 
 static void printUsage(const char *program) {
@@ -78,6 +96,8 @@ static void printUsage(const char *program) {
         "Options:\n"
         "    -v     Verbose mode, print logging messages\n"
         "    -q     Quiet mode (default), suppress logging messages\n"
+        "    --filter   Install a seccomp filter allowing the system calls found\n"
+        "               in the program, instead of instrumenting each call\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
@@ -93,6 +113,7 @@ int main(int argc, char *argv[]) {
     }
 
     bool quiet = true;
+    bool filter = false;
 
     struct {
         const char *str;
@@ -101,6 +122,7 @@ int main(int argc, char *argv[]) {
         // should we show debugging log messages?
         {"-v", [&quiet] () { quiet = false; }},
         {"-q", [&quiet] () { quiet = true; }},
+        {"--filter", [&filter] () { filter = true; }},
     };
 
     for(int a = 1; a < argc; a ++) {
@@ -119,7 +141,7 @@ int main(int argc, char *argv[]) {
             }
         }
         else if(argv[a] && argv[a + 1]) {
-            parse(argv[a], argv[a + 1], quiet);
+            if(!parse(argv[a], argv[a + 1], quiet, filter)) return 1;
             break;
         }
         else {
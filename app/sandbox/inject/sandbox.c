@@ -4,6 +4,8 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
 
 #define PERM_SIZE 119221
 unsigned char perm[PERM_SIZE];
@@ -17,6 +19,27 @@ void allocate_perm(void) {
     arch_prctl(ARCH_SET_GS, memory);
 }
 
+// filled in by etsandbox --filter; kept in .data so that it has contents
+struct egalito_sandbox_filter {
+    unsigned int length;
+    struct sock_filter code[BPF_MAXINSNS];
+} egalito_sandbox_filter __attribute__ (( section(".data") )) = { 0 };
+
+__attribute__ (( __constructor__ ))
+void install_filter(void) {
+    if(!egalito_sandbox_filter.length) return;
+
+    struct sock_fprog program = {
+        .len = (unsigned short)egalito_sandbox_filter.length,
+        .filter = egalito_sandbox_filter.code
+    };
+    if(prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)
+        || syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, &program)) {
+
+        syscall(60, 10);  // exit
+    }
+}
+
 static unsigned char *get_perm() {
     unsigned long p;
     arch_prctl(ARCH_GET_GS, &p);
@@ -0,0 +1,148 @@
+#include <queue>
+#include <functional>
+#include "bitflow.h"
+#include "graph.h"
+#include "walker.h"
+
+#include "log/log.h"
+
+void BitVector::setAll() {
+    for(auto &w : words) w = ~uint64_t(0);
+    if(size % 64) {
+        words.back() = (uint64_t(1) << (size % 64)) - 1;
+    }
+}
+
+void BitVector::clear() {
+    for(auto &w : words) w = 0;
+}
+
+bool BitVector::any() const {
+    for(auto w : words) {
+        if(w) return true;
+    }
+    return false;
+}
+
+size_t BitVector::count() const {
+    size_t total = 0;
+    for(auto w : words) total += __builtin_popcountll(w);
+    return total;
+}
+
+bool BitVector::unionWith(const BitVector &other) {
+    uint64_t changed = 0;
+    for(size_t w = 0; w < words.size(); w ++) {
+        uint64_t merged = words[w] | other.words[w];
+        changed |= merged ^ words[w];
+        words[w] = merged;
+    }
+    return changed != 0;
+}
+
+void BitVector::intersectWith(const BitVector &other) {
+    for(size_t w = 0; w < words.size(); w ++) {
+        words[w] &= other.words[w];
+    }
+}
+
+void BitVector::subtract(const BitVector &other) {
+    for(size_t w = 0; w < words.size(); w ++) {
+        words[w] &= ~other.words[w];
+    }
+}
+
+void BitVector::transfer(const BitVector &gen, const BitVector &kill) {
+    for(size_t w = 0; w < words.size(); w ++) {
+        words[w] = gen.words[w] | (words[w] & ~kill.words[w]);
+    }
+}
+
+BitDataFlow::BitDataFlow(GraphBase *graph, size_t bits, Direction direction)
+    : graph(graph), direction(direction), bits(bits),
+    gen(graph->getCount(), BitVector(bits)),
+    kill(graph->getCount(), BitVector(bits)),
+    in(graph->getCount(), BitVector(bits)),
+    out(graph->getCount(), BitVector(bits)),
+    boundary(bits), visits(0) {
+
+}
+
+void BitDataFlow::solve() {
+    if(graph->getCount() == 0) return;
+
+    auto order = getOrder();
+    std::vector<size_t> rank(graph->getCount());
+    for(size_t i = 0; i < order.size(); i ++) {
+        rank[order[i]] = i;
+    }
+
+    // facts flowing into a node are joined into `entry`, transferred and
+    // stored in `exit`; for backward problems these are out and in
+    auto &entry = (direction == FORWARD) ? in : out;
+    auto &exit = (direction == FORWARD) ? out : in;
+
+    std::priority_queue<size_t, std::vector<size_t>,
+        std::greater<size_t>> worklist;
+    std::vector<bool> pending(graph->getCount(), true);
+    for(size_t i = 0; i < order.size(); i ++) worklist.push(i);
+
+    BitVector result(bits);
+    while(!worklist.empty()) {
+        int id = order[worklist.top()];
+        worklist.pop();
+        pending[id] = false;
+        visits ++;
+
+        auto node = graph->get(id);
+        auto &join = entry[id];
+        join.clear();
+        if(isBoundary(id)) join.unionWith(boundary);
+        for(auto link : node->getLinks(-direction)) {
+            join.unionWith(exit[link->getTargetID()]);
+        }
+
+        result = join;
+        result.transfer(gen[id], kill[id]);
+        if(result == exit[id]) continue;
+
+        exit[id] = result;
+        for(auto link : node->getLinks(direction)) {
+            auto next = link->getTargetID();
+            if(!pending[next]) {
+                pending[next] = true;
+                worklist.push(rank[next]);
+            }
+        }
+    }
+
+    LOG(10, "bit-vector dataflow over " << std::dec << graph->getCount()
+        << " nodes took " << visits << " visits");
+}
+
+std::vector<int> BitDataFlow::getOrder() {
+    std::vector<std::vector<int>> lists;
+    if(direction == FORWARD) {
+        ReversePostorder rpo(graph);
+        rpo.genFull(0);
+        lists = rpo.get();
+    }
+    else {
+        Postorder po(graph);
+        po.genFull(0);
+        lists = po.get();
+    }
+
+    std::vector<int> order;
+    for(const auto &list : lists) {
+        order.insert(order.end(), list.begin(), list.end());
+    }
+    return order;
+}
+
+bool BitDataFlow::isBoundary(int id) {
+    if(direction == FORWARD) return id == 0;
+
+    auto links = graph->get(id)->getLinks(1);
+    return links.begin() == links.end();
+}
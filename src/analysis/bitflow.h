@@ -0,0 +1,90 @@
+#ifndef EGALITO_ANALYSIS_BIT_FLOW_H
+#define EGALITO_ANALYSIS_BIT_FLOW_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class GraphBase;
+
+/** A fixed-size set of small integers, stored as machine words. */
+class BitVector {
+private:
+    std::vector<uint64_t> words;
+    size_t size;
+public:
+    BitVector(size_t size = 0) : words((size + 63) / 64), size(size) {}
+
+    size_t getSize() const { return size; }
+    size_t getWordCount() const { return words.size(); }
+    uint64_t getWord(size_t w) const { return words[w]; }
+    void setWord(size_t w, uint64_t value) { words[w] = value; }
+
+    bool get(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    void setAll();
+    void clear();
+    bool any() const;
+    size_t count() const;
+
+    /** Adds every element of other; returns true if this changed. */
+    bool unionWith(const BitVector &other);
+    void intersectWith(const BitVector &other);
+    void subtract(const BitVector &other);
+    /** Replaces this with gen | (this & ~kill). */
+    void transfer(const BitVector &gen, const BitVector &kill);
+
+    bool operator == (const BitVector &other) const
+        { return words == other.words; }
+    bool operator != (const BitVector &other) const
+        { return words != other.words; }
+};
+
+/** Classic iterative may-dataflow over a graph, with one gen and kill set
+    per node. Facts flow along forward links (FORWARD) or against them
+    (BACKWARD) and are joined by union. The solver keeps a worklist ordered
+    by reverse postorder (postorder for backward problems), so acyclic
+    regions settle in a single pass.
+*/
+class BitDataFlow {
+public:
+    enum Direction {
+        FORWARD = 1,
+        BACKWARD = -1
+    };
+private:
+    GraphBase *graph;
+    Direction direction;
+    size_t bits;
+    std::vector<BitVector> gen;
+    std::vector<BitVector> kill;
+    std::vector<BitVector> in;
+    std::vector<BitVector> out;
+    BitVector boundary;
+    size_t visits;
+public:
+    BitDataFlow(GraphBase *graph, size_t bits, Direction direction);
+
+    size_t getBits() const { return bits; }
+    BitVector &getGen(int id) { return gen[id]; }
+    BitVector &getKill(int id) { return kill[id]; }
+
+    /** Facts entering the graph: at node 0 for forward problems, and
+        after every node without successors for backward ones.
+    */
+    void setBoundary(const BitVector &boundary)
+        { this->boundary = boundary; }
+
+    void solve();
+
+    /** Facts before and after each node, in program order. */
+    const BitVector &getIn(int id) const { return in[id]; }
+    const BitVector &getOut(int id) const { return out[id]; }
+    size_t getVisitCount() const { return visits; }
+private:
+    std::vector<int> getOrder();
+    bool isBoundary(int id);
+};
+
+#endif
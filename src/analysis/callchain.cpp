@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <numeric>
+#include "callchain.h"
+#include "log/log.h"
+
+CallChainClustering::id_t CallChainClustering::addFunction(size_t size,
+    unsigned long samples) {
+
+    nodes.push_back(Node{size ? size : 1, samples});
+    return nodes.size() - 1;
+}
+
+void CallChainClustering::addCall(id_t caller, id_t callee,
+    unsigned long weight) {
+
+    if(caller == callee || weight == 0) return;
+    callWeights[std::make_pair(caller, callee)] += weight;
+}
+
+std::vector<CallChainClustering::id_t> CallChainClustering::computeOrder() {
+    // heaviest caller of each function
+    std::vector<std::pair<id_t, unsigned long>> bestCaller(nodes.size(),
+        std::make_pair(nodes.size(), 0ul));
+    for(const auto &call : callWeights) {
+        auto caller = call.first.first;
+        auto callee = call.first.second;
+        if(call.second > bestCaller[callee].second) {
+            bestCaller[callee] = std::make_pair(caller, call.second);
+        }
+    }
+
+    std::vector<Cluster> clusters;
+    std::vector<size_t> clusterOf(nodes.size());
+    for(id_t id = 0; id < nodes.size(); id ++) {
+        clusters.push_back(Cluster{{id}, nodes[id].size, nodes[id].samples});
+        clusterOf[id] = id;
+    }
+
+    std::vector<id_t> byHotness(nodes.size());
+    std::iota(byHotness.begin(), byHotness.end(), 0);
+    std::stable_sort(byHotness.begin(), byHotness.end(),
+        [this] (id_t a, id_t b) {
+            return nodes[a].samples > nodes[b].samples;
+        });
+
+    for(auto id : byHotness) {
+        if(nodes[id].samples == 0) break;
+
+        auto caller = bestCaller[id].first;
+        if(caller == nodes.size()) continue;
+
+        auto &into = clusters[clusterOf[caller]];
+        auto &from = clusters[clusterOf[id]];
+        if(&into == &from) continue;
+        if(into.size + from.size > mergeLimit) continue;
+
+        LOG(10, "C3: merging cluster of " << id << " after " << caller);
+        into.members.insert(into.members.end(),
+            from.members.begin(), from.members.end());
+        into.size += from.size;
+        into.samples += from.samples;
+        for(auto member : from.members) {
+            clusterOf[member] = clusterOf[caller];
+        }
+        from.members.clear();
+        from.size = 0;
+        from.samples = 0;
+    }
+
+    std::vector<Cluster *> sorted;
+    for(auto &cluster : clusters) {
+        if(!cluster.members.empty()) sorted.push_back(&cluster);
+    }
+    // compare samples/size without dividing
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [] (Cluster *a, Cluster *b) {
+            return static_cast<long double>(a->samples) * b->size
+                > static_cast<long double>(b->samples) * a->size;
+        });
+
+    std::vector<id_t> order;
+    for(auto cluster : sorted) {
+        order.insert(order.end(),
+            cluster->members.begin(), cluster->members.end());
+    }
+    return order;
+}
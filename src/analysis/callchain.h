@@ -0,0 +1,46 @@
+#ifndef EGALITO_ANALYSIS_CALL_CHAIN_H
+#define EGALITO_ANALYSIS_CALL_CHAIN_H
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstddef>
+
+/** Orders functions by call-chain clustering (C3, Ottoni and Maher).
+
+    Functions are visited from hottest to coldest; each one's cluster is
+    appended to the cluster of its heaviest caller, unless the result would
+    grow beyond the merge limit. Clusters are then emitted by decreasing
+    density (samples per byte), so that hot callees end up right after
+    their callers and the hottest code shares as few pages as possible.
+*/
+class CallChainClustering {
+public:
+    typedef size_t id_t;
+private:
+    struct Node {
+        size_t size;
+        unsigned long samples;
+    };
+    struct Cluster {
+        std::vector<id_t> members;
+        size_t size;
+        unsigned long samples;
+    };
+    std::vector<Node> nodes;
+    std::map<std::pair<id_t, id_t>, unsigned long> callWeights;
+    size_t mergeLimit;
+public:
+    CallChainClustering(size_t mergeLimit = 1 << 20)
+        : mergeLimit(mergeLimit) {}
+
+    /** Adds a function of the given code size; samples is its hotness. */
+    id_t addFunction(size_t size, unsigned long samples);
+    /** Records that caller calls callee weight times (accumulates). */
+    void addCall(id_t caller, id_t callee, unsigned long weight);
+
+    /** Returns all function ids in layout order. */
+    std::vector<id_t> computeOrder();
+};
+
+#endif
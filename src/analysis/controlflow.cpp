@@ -3,6 +3,8 @@
 #include <regex>
 #include <set>
 #include "controlflow.h"
+#include "analysis/dominance.h"
+#include "analysis/walker.h"
 #include "analysis/jumptable.h"
 #include "chunk/concrete.h"
 #include "elf/symbol.h"
@@ -27,12 +29,19 @@ std::string ControlFlowNode::getDescription() {
     return stream.str();
 }
 
-ControlFlowGraph::ControlFlowGraph(Function *function) {
+ControlFlowGraph::ControlFlowGraph(Function *function)
+    : dominatorTree(nullptr), postDominatorTree(nullptr),
+    loopNesting(nullptr) {
+
     // do a breadth-first pass over the function
     construct(function);
 }
 
 ControlFlowGraph::~ControlFlowGraph() {
+    delete loopNesting;
+    delete postDominatorTree;
+    delete dominatorTree;
+
     // link should not be deleted everytime node is deleted because node
     // can be copied
     for(auto& node : graph) {
@@ -45,6 +54,39 @@ ControlFlowGraph::~ControlFlowGraph() {
     }
 }
 
+const std::vector<std::vector<int>> &ControlFlowGraph::getSccOrder() {
+    if(sccOrder.empty() && !graph.empty()) {
+        SccOrder order(this);
+        order.genFull(0);
+        sccOrder = order.get();
+    }
+    return sccOrder;
+}
+
+const std::vector<int> &ControlFlowGraph::getReversePostorder() {
+    if(reversePostorder.empty() && !graph.empty()) {
+        ReversePostorder order(this);
+        order.gen(0);
+        reversePostorder = order.get()[0];
+    }
+    return reversePostorder;
+}
+
+DominatorTree *ControlFlowGraph::getDominatorTree() {
+    if(!dominatorTree) dominatorTree = new DominatorTree(this, false);
+    return dominatorTree;
+}
+
+DominatorTree *ControlFlowGraph::getPostDominatorTree() {
+    if(!postDominatorTree) postDominatorTree = new DominatorTree(this, true);
+    return postDominatorTree;
+}
+
+LoopNesting *ControlFlowGraph::getLoopNesting() {
+    if(!loopNesting) loopNesting = new LoopNesting(this);
+    return loopNesting;
+}
+
 void ControlFlowGraph::construct(Function *function) {
     ControlFlowNode::id_t count = 0;
     for(auto b : function->getChildren()->getIterable()->iterable()) {
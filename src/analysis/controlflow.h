@@ -9,6 +9,8 @@
 class Function;
 class Block;
 class PLTTrampoline;
+class DominatorTree;
+class LoopNesting;
 
 namespace ControlFlow {
     typedef int id_t;
@@ -67,14 +69,35 @@ public:
 private:
     std::vector<ControlFlowNode> graph;
     std::map<Block *, id_t> blockMapping;
+
+    // computed on first use, and released with the graph
+    std::vector<std::vector<int>> sccOrder;
+    std::vector<int> reversePostorder;
+    DominatorTree *dominatorTree;
+    DominatorTree *postDominatorTree;
+    LoopNesting *loopNesting;
 public:
     ControlFlowGraph(Function *function);
     virtual ~ControlFlowGraph();
+    ControlFlowGraph(const ControlFlowGraph &) = delete;
+    ControlFlowGraph &operator = (const ControlFlowGraph &) = delete;
 
     virtual ControlFlowNode *get(id_t id) { return &graph[id]; }
     virtual size_t getCount() const { return graph.size(); }
 
     id_t getIDFor(Block *block) { return blockMapping[block]; }
+    bool hasIDFor(Block *block) const
+        { return blockMapping.find(block) != blockMapping.end(); }
+
+    /** SCCs of all nodes in reverse topological order, as from
+        SccOrder::genFull(0); this is the order UseDef::analyze expects.
+    */
+    const std::vector<std::vector<int>> &getSccOrder();
+    /** Reverse postorder of the nodes reachable from the entry. */
+    const std::vector<int> &getReversePostorder();
+    DominatorTree *getDominatorTree();
+    DominatorTree *getPostDominatorTree();
+    LoopNesting *getLoopNesting();
 
     void dump();
     void dumpDot();
@@ -7,6 +7,7 @@
 #include "instr/semantic.h"
 #include "instr/linked-aarch64.h"
 #include "operation/find2.h"
+#include "util/parallel.h"
 
 #include "log/log.h"
 
@@ -16,9 +17,7 @@ void DataFlow::addUseDefFor(Function *function) {
     auto working = new UDRegMemWorkingSet(function, graph);
     auto usedef = new UseDef(config, working);
 
-    SccOrder order(graph);
-    order.genFull(0);
-    usedef->analyze(order.get());
+    usedef->analyze(graph->getSccOrder());
 
     flowList[function] = usedef;
     workingList.push_back(working);
@@ -26,6 +25,32 @@ void DataFlow::addUseDefFor(Function *function) {
     graphList.push_back(graph);
 }
 
+void DataFlow::addUseDefFor(const std::vector<Function *> &functionList) {
+    struct Analysis {
+        ControlFlowGraph *graph;
+        UDConfiguration *config;
+        UDRegMemWorkingSet *working;
+        UseDef *usedef;
+    };
+
+    // each function's trees live in its own working set
+    parallelAnalyze<Analysis>(functionList.size(),
+        [&] (size_t i, Analysis &a) {
+            a.graph = new ControlFlowGraph(functionList[i]);
+            a.config = new UDConfiguration(a.graph);
+            a.working = new UDRegMemWorkingSet(functionList[i], a.graph);
+            a.usedef = new UseDef(a.config, a.working);
+
+            a.usedef->analyze(a.graph->getSccOrder());
+        },
+        [&] (size_t i, Analysis &a) {
+            flowList[functionList[i]] = a.usedef;
+            workingList.push_back(a.working);
+            configList.push_back(a.config);
+            graphList.push_back(a.graph);
+        });
+}
+
 UDRegMemWorkingSet *DataFlow::getWorkingSet(Function *function) {
     auto it = flowList.find(function);
     if(it == flowList.end()) {
@@ -17,6 +17,8 @@ private:
 public:
     ~DataFlow();
     void addUseDefFor(Function *function);
+    /** Analyzes the functions in parallel. */
+    void addUseDefFor(const std::vector<Function *> &functionList);
     void adjustCallUse(LiveRegister *live, Function *function, Module *module);
     void adjustPLTCallUse(LiveRegister *live, Function *function,
         Program *program);
@@ -1,160 +1,234 @@
 #include <iomanip>
+#include <algorithm>
 #include "dominance.h"
-#include "walker.h"
 
 #include "log/log.h"
 
-Dominance::Dominance(ControlFlowGraph *cfg)
-    : cfg(cfg), idoms(cfg->getCount(), -1), idMap(cfg->getCount(), -1) {
+DominatorTree::DominatorTree(ControlFlowGraph *cfg, bool post)
+    : post(post), idoms(cfg->getCount(), -1), children(cfg->getCount()),
+    enter(cfg->getCount(), -1), leave(cfg->getCount(), -1) {
 
-    SccOrder scc(cfg);
-    scc.gen(0);
-    LOG(10, "SCC");
-    for(auto sub : scc.get()) {
-        for(auto n : sub) {
-            LOG0(10, " " << std::setw(3) << n);
-        }
-        LOG(10, "");
-    }
+    const id_t count = cfg->getCount();
+    if(count == 0) return;
 
-    ReversePostorder rpo(cfg);
-    rpo.gen(0);
-    auto order = rpo.get()[0];
-    for(size_t i = 0; i < order.size(); i++) {
-        idMap[order[i]] = i;
+    // post-dominators are dominators of the reversed graph, rooted at a
+    // virtual exit node numbered count
+    const id_t size = post ? count + 1 : count;
+    const id_t root = post ? count : 0;
+    std::vector<std::vector<id_t>> succs(size), preds(size);
+    for(id_t id = 0; id < count; id ++) {
+        bool isExit = true;
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            auto target = link->getTargetID();
+            isExit = false;
+            if(post) {
+                succs[target].push_back(id);
+                preds[id].push_back(target);
+            }
+            else {
+                succs[id].push_back(target);
+                preds[target].push_back(id);
+            }
+        }
+        if(post && isExit) {
+            succs[root].push_back(id);
+            preds[id].push_back(root);
+        }
     }
 
-    LOG(10, "RPO");
-    for(auto n : order) {
-        LOG0(10, " " << std::setw(3) << n);
+    // reverse postorder from the root
+    std::vector<id_t> order;
+    std::vector<int> rank(size, -1);
+    std::vector<std::pair<id_t, size_t>> stack;
+    std::vector<bool> visited(size, false);
+    stack.emplace_back(root, 0);
+    visited[root] = true;
+    while(!stack.empty()) {
+        auto &top = stack.back();
+        if(top.second < succs[top.first].size()) {
+            auto next = succs[top.first][top.second ++];
+            if(!visited[next]) {
+                visited[next] = true;
+                stack.emplace_back(next, 0);
+            }
+        }
+        else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
     }
-    LOG(10, "");
+    std::reverse(order.begin(), order.end());
+    for(size_t i = 0; i < order.size(); i ++) rank[order[i]] = i;
+
+    std::vector<id_t> idom(size, -1);
+    idom[root] = root;
+    auto intersect = [&] (id_t a, id_t b) {
+        while(a != b) {
+            while(rank[a] > rank[b]) a = idom[a];
+            while(rank[b] > rank[a]) b = idom[b];
+        }
+        return a;
+    };
 
     bool changed = true;
     while(changed) {
         changed = false;
         for(auto id : order) {
-            LOG(10, "id = " << id);
-            if(id == 0) {
-                idoms[0] = 0;
-                continue;
-            }
-            auto node = cfg->get(id);
-            bool first = true;
-            ControlFlow::id_t idom = -1;
-            for(auto link : node->backwardLinks()) {
-                auto pred = link->getTargetID();
-                if(idoms[pred] != -1) {
-                    if(first) {
-                        idom = pred;
-                        first = false;
-                    }
-                    else {
-                        idom = intersect(pred, idom);
-                    }
-                }
-            }
+            if(id == root) continue;
 
-            if(idoms[id] != idom) {
-                idoms[id] = idom;
+            id_t newIdom = -1;
+            for(auto pred : preds[id]) {
+                if(idom[pred] == -1) continue;
+                newIdom = (newIdom == -1) ? pred : intersect(pred, newIdom);
+            }
+            if(idom[id] != newIdom) {
+                idom[id] = newIdom;
                 changed = true;
-                IF_LOG(10) dump();
             }
         }
     }
 
+    for(id_t id = 0; id < count; id ++) {
+        if(rank[id] < 0) continue;
+        if(id == root) {
+            roots.push_back(id);
+        }
+        else if(idom[id] == root && post) {
+            roots.push_back(id);
+        }
+        else {
+            idoms[id] = idom[id];
+            children[idom[id]].push_back(id);
+        }
+    }
+
+    number();
     IF_LOG(10) dump();
 }
 
-ControlFlow::id_t Dominance::intersect(ControlFlow::id_t i1,
-    ControlFlow::id_t i2) {
-
-    auto finger1 = i1;
-    auto finger2 = i2;
+void DominatorTree::number() {
+    int clock = 0;
+    std::vector<std::pair<id_t, size_t>> stack;
+    for(auto root : roots) {
+        enter[root] = clock ++;
+        stack.emplace_back(root, 0);
+        while(!stack.empty()) {
+            auto &top = stack.back();
+            if(top.second < children[top.first].size()) {
+                auto child = children[top.first][top.second ++];
+                enter[child] = clock ++;
+                stack.emplace_back(child, 0);
+            }
+            else {
+                leave[top.first] = clock ++;
+                stack.pop_back();
+            }
+        }
+    }
+}
 
-    LOG(10, "intersect " << i1 << " " << i2);
+void DominatorTree::dump() const {
+    LOG(1, (post ? "post-dominator" : "dominator") << " tree idoms");
+    for(auto i : idoms) {
+        LOG0(1, " " << std::setw(3) << i);
+    }
+    LOG(1, "");
+}
 
-    while(finger1 != finger2) {
-        if(idoms[finger1] == -1) return finger2;
-        if(idoms[finger2] == -1) return finger1;
+bool LoopNesting::Loop::contains(id_t id) const {
+    return std::binary_search(nodes.begin(), nodes.end(), id);
+}
 
-        while(idoms[finger1] != -1 && idMap[finger1] > idMap[finger2]) {
-            finger1 = idoms[finger1];
+LoopNesting::LoopNesting(ControlFlowGraph *cfg)
+    : innermost(cfg->getCount(), -1) {
+
+    auto dom = cfg->getDominatorTree();
+
+    // collect the body of each header from its back edges
+    std::map<id_t, std::set<id_t>> bodies;
+    for(id_t id = 0; id < static_cast<id_t>(cfg->getCount()); id ++) {
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            auto header = link->getTargetID();
+            if(!dom->dominates(header, id)) continue;
+
+            auto &body = bodies[header];
+            body.insert(header);
+            std::vector<id_t> worklist;
+            if(body.insert(id).second) worklist.push_back(id);
+            while(!worklist.empty()) {
+                auto n = worklist.back();
+                worklist.pop_back();
+                for(auto pred : cfg->get(n)->backwardLinks()) {
+                    auto p = pred->getTargetID();
+                    if(dom->isReachable(p) && body.insert(p).second) {
+                        worklist.push_back(p);
+                    }
+                }
+            }
         }
-        while(idoms[finger2] != -1 && idMap[finger2] > idMap[finger1]) {
-            finger2 = idoms[finger2];
+    }
+
+    // outer loops are larger than the loops they contain
+    for(const auto &body : bodies) {
+        loops.emplace_back(body.first,
+            std::vector<id_t>(body.second.begin(), body.second.end()));
+    }
+    std::stable_sort(loops.begin(), loops.end(),
+        [] (const Loop &a, const Loop &b) {
+            return a.getNodes().size() > b.getNodes().size();
+        });
+
+    for(size_t i = 0; i < loops.size(); i ++) {
+        int parent = innermost[loops[i].getHeader()];
+        loops[i].setParent(parent,
+            parent < 0 ? 1 : loops[parent].getDepth() + 1);
+        for(auto id : loops[i].getNodes()) {
+            innermost[id] = i;
         }
     }
-    return finger1;
 }
 
 std::vector<ControlFlow::id_t> Dominance::getDominators(ControlFlow::id_t id) {
+    auto tree = cfg->getDominatorTree();
     std::vector<ControlFlow::id_t> doms;
+    if(!tree->isReachable(id)) return doms;
 
-    while(id != 0) {
+    for( ; id != -1; id = tree->getImmediateDominator(id)) {
         doms.push_back(id);
-        id = idoms[id];
     }
-    doms.push_back(0);
     return doms;
 }
 
 std::vector<ControlFlow::id_t> Dominance::getPostDominators(
     ControlFlow::id_t id) {
 
-    Preorder po(cfg);
-    po.gen(0);
-    auto order = po.get()[0];
-    for(size_t i = 0; i < order.size(); i++) {
-        idMap[order[i]] = i;
-    }
+    // the nodes that lie on every path from the entry to an exit
+    auto tree = cfg->getDominatorTree();
+    std::vector<ControlFlow::id_t> exits;
+    for(ControlFlow::id_t n = 0; n < static_cast<ControlFlow::id_t>(
+        cfg->getCount()); n ++) {
 
-    std::vector<ControlFlowNode *> exitNodes;
-    for(auto nid : order) {
-        auto node = cfg->get(nid);
-        bool isExit = true;
-        for(auto link : node->forwardLinks()) {
-            (void)link;
-            isExit = false;
-            break;
-        }
-        if(isExit) {
-            exitNodes.push_back(node);
+        auto links = cfg->get(n)->forwardLinks();
+        if(tree->isReachable(n) && links.begin() == links.end()) {
+            exits.push_back(n);
         }
     }
-    if(exitNodes.empty()) { // due to not knowing non-returing call yet
+    if(exits.empty()) { // due to not knowing non-returing call yet
         return {};
     }
 
-    auto cap = [](std::vector<ControlFlow::id_t> v1,
-        std::vector<ControlFlow::id_t> v2) {
+    std::vector<ControlFlow::id_t> pdom;
+    for(ControlFlow::id_t n = 0; n < static_cast<ControlFlow::id_t>(
+        cfg->getCount()); n ++) {
 
-        std::vector<ControlFlow::id_t> v;
-        std::set_intersection(v1.begin(), v1.end(), v2.begin(), v2.end(),
-            std::back_inserter(v));
-
-        return v;
-    };
-
-    auto pdom = getDominators(exitNodes[0]->getID());
-    //pdom.erase(std::remove(pdom.begin(), pdom.end(), 0), pdom.end());
-
-    for(size_t i = 1; i <exitNodes.size(); i++) {
-        auto pdom2 = getDominators(exitNodes[i]->getID());
-        std::sort(pdom2.begin(), pdom2.end());
-        pdom = cap(pdom, pdom2);
-        if(pdom.empty()) break;
+        bool all = true;
+        for(auto exit : exits) {
+            if(!tree->dominates(n, exit)) {
+                all = false;
+                break;
+            }
+        }
+        if(all) pdom.push_back(n);
     }
-
     return pdom;
 }
-
-
-void Dominance::dump() {
-    LOG(1, "idoms");
-    for(auto i : idoms) {
-        LOG0(1, " " << i);
-    }
-    LOG(1, "");
-}
-
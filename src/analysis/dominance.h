@@ -5,23 +5,101 @@
 #include <set>
 #include "controlflow.h"
 
+/** Immediate (post-)dominators of a ControlFlowGraph, computed with the
+    Cooper-Harvey-Kennedy algorithm. The tree is numbered by a DFS so that
+    dominance queries are constant time interval checks. Post-dominators
+    are rooted at a virtual exit that follows every node without
+    successors. Get these from ControlFlowGraph, which caches them.
+*/
+class DominatorTree {
+public:
+    using id_t = ControlFlow::id_t;
+private:
+    bool post;
+    std::vector<id_t> idoms;    // -1 for the root and unreachable nodes
+    std::vector<std::vector<id_t>> children;
+    std::vector<id_t> roots;    // children of the (virtual) root
+    std::vector<int> enter;     // DFS interval over the tree
+    std::vector<int> leave;
+public:
+    DominatorTree(ControlFlowGraph *cfg, bool post);
+
+    bool isPostDominatorTree() const { return post; }
+    bool isReachable(id_t id) const { return enter[id] >= 0; }
+    /** Returns -1 for the entry (or any exit) and unreachable nodes. */
+    id_t getImmediateDominator(id_t id) const { return idoms[id]; }
+    const std::vector<id_t> &getChildren(id_t id) const
+        { return children[id]; }
+    const std::vector<id_t> &getRoots() const { return roots; }
+
+    /** Whether every path from the entry to b (from b to an exit, for
+        post-dominators) goes through a. Nodes dominate themselves.
+    */
+    bool dominates(id_t a, id_t b) const
+        { return isReachable(a) && isReachable(b)
+            && enter[a] <= enter[b] && leave[b] <= leave[a]; }
+    bool strictlyDominates(id_t a, id_t b) const
+        { return a != b && dominates(a, b); }
+
+    void dump() const;
+private:
+    void number();
+};
+
+/** Natural loops of a ControlFlowGraph, found from back edges to nodes
+    that dominate their source. Loops sharing a header are merged.
+    Irreducible cycles have no such header and are not reported.
+*/
+class LoopNesting {
+public:
+    using id_t = ControlFlow::id_t;
+
+    class Loop {
+    private:
+        id_t header;
+        std::vector<id_t> nodes;    // sorted, header included
+        int parent;                 // index of enclosing loop, or -1
+        int depth;                  // 1 for outermost loops
+    public:
+        Loop(id_t header, const std::vector<id_t> &nodes)
+            : header(header), nodes(nodes), parent(-1), depth(1) {}
+        id_t getHeader() const { return header; }
+        const std::vector<id_t> &getNodes() const { return nodes; }
+        bool contains(id_t id) const;
+        int getParent() const { return parent; }
+        int getDepth() const { return depth; }
+        void setParent(int parent, int depth)
+            { this->parent = parent; this->depth = depth; }
+    };
+private:
+    std::vector<Loop> loops;    // outer loops before the loops they contain
+    std::vector<int> innermost; // per node, or -1
+public:
+    LoopNesting(ControlFlowGraph *cfg);
+
+    size_t getLoopCount() const { return loops.size(); }
+    const Loop &getLoop(int index) const { return loops[index]; }
+    /** Index of the innermost loop containing id, or -1. */
+    int getInnermostLoop(id_t id) const { return innermost[id]; }
+    /** How many loops contain id; 0 if it is not in a loop. */
+    int getDepth(id_t id) const
+        { return innermost[id] < 0 ? 0 : loops[innermost[id]].getDepth(); }
+    bool isLoopHeader(id_t id) const
+        { return innermost[id] >= 0
+            && loops[innermost[id]].getHeader() == id; }
+};
+
+/** Older interface, now answered from the DominatorTree of the CFG. */
 class Dominance {
 public:
     using id_t = ControlFlow::id_t;
 
 private:
     ControlFlowGraph *cfg;
-    std::vector<id_t> idoms;    // immediate dominator
-    std::vector<id_t> idMap;    // id_t => order ID
 
 public:
-    Dominance(ControlFlowGraph *cfg);
+    Dominance(ControlFlowGraph *cfg) : cfg(cfg) {}
     std::vector<id_t> getDominators(id_t id);
     std::vector<id_t> getPostDominators(id_t id);
-
-private:
-    id_t intersect(id_t i1, id_t i2);
-
-    void dump();
 };
 #endif
@@ -7,20 +7,54 @@
 #include "elf/elfspace.h"
 #include "instr/concrete.h"
 #include "operation/find.h"
+#include "util/parallel.h"
 
 #include "log/log.h"
 #include "log/temp.h"
 
 void JumptableDetection::detect(Module *module) {
     //TemporaryLogLevel tll("analysis", 11);
+    std::vector<Function *> functionList;
     for(auto f : CIter::functions(module)) {
-        //TemporaryLogLevel tll2("analysis", 11, f->hasName("vfprintf"));
-        detect(f);
-        //IF_LOG(11) std::cout.flush();
+        if(containsIndirectJump(f)) functionList.push_back(f);
     }
+    detect(functionList);
+}
+
+void JumptableDetection::detect(const std::vector<Function *> &functionList) {
+    // Each function is analyzed by its own detector, which sees the index
+    // tables known so far but records new ones locally. Descriptors refer
+    // to links and markers in the module, so they are made afterwards on
+    // this thread, in function order.
+    parallelAnalyze<FunctionResult>(functionList.size(),
+        [&] (size_t i, FunctionResult &result) {
+            //TemporaryLogLevel tll2("analysis", 11, functionList[i]->hasName("vfprintf"));
+            JumptableDetection worker(module);
+            worker.knownIndexTables = &indexTables;
+            worker.analyze(functionList[i]);
+            result.found = std::move(worker.found);
+            result.indexTables = std::move(worker.indexTables);
+        },
+        [&] (size_t i, FunctionResult &result) {
+            found.insert(found.end(), result.found.begin(), result.found.end());
+            indexTables.insert(result.indexTables.begin(),
+                result.indexTables.end());
+        });
+
+    makeDescriptors();
 }
 
 void JumptableDetection::detect(Function *function) {
+    analyze(function);
+    makeDescriptors();
+}
+
+void JumptableDetection::detect(UDRegMemWorkingSet *working) {
+    search(working);
+    makeDescriptors();
+}
+
+void JumptableDetection::analyze(Function *function) {
     if(containsIndirectJump(function)) {
         ControlFlowGraph cfg(function);
         UDConfiguration config(&cfg);
@@ -30,15 +64,20 @@ void JumptableDetection::detect(Function *function) {
         IF_LOG(10) cfg.dump();
         IF_LOG(10) cfg.dumpDot();
 
-        SccOrder order(&cfg);
-        order.genFull(0);
-        usedef.analyze(order.get());
+        usedef.analyze(cfg.getSccOrder());
 
-        detect(&working);
+        search(&working);
     }
 }
 
-void JumptableDetection::detect(UDRegMemWorkingSet *working) {
+void JumptableDetection::makeDescriptors() {
+    for(const auto &table : found) {
+        makeDescriptor(table);
+    }
+    found.clear();
+}
+
+void JumptableDetection::search(UDRegMemWorkingSet *working) {
 #ifdef ARCH_X86_64
     typedef TreePatternBinary<TreeNodeAddition,
         TreePatternCapture<TreePatternTerminal<TreeNodePhysicalRegister>>,
@@ -75,14 +114,14 @@ void JumptableDetection::detect(UDRegMemWorkingSet *working) {
             LOG(10, "trying MakeJumpTargetForm1");
             FlowUtil::searchUpDef<MakeJumpTargetForm1>(state, reg, parser);
             if(info.valid) {
-                makeDescriptor(instr, &info);
+                recordTable(instr, &info);
                 continue;
             }
 
             LOG(10, "trying MakeJumpTargetForm2");
             FlowUtil::searchUpDef<MakeJumpTargetForm2>(state, reg, parser2);
             if(info.valid) {
-                makeDescriptor(instr, &info);
+                recordTable(instr, &info);
                 continue;
             }
 
@@ -124,14 +163,14 @@ void JumptableDetection::detect(UDRegMemWorkingSet *working) {
             int reg = AARCH64GPRegister::convertToPhysical(op0);
             FlowUtil::searchUpDef<MakeJumpTargetForm1>(state, reg, parser);
             if(info.valid) {
-                makeDescriptor(instr, &info);
+                recordTable(instr, &info);
                 continue;
             }
 
             LOG(10, "trying MakeJumpTargetForm2");
             FlowUtil::searchUpDef<MakeJumpTargetForm2>(state, reg, parser);
             if(info.valid) {
-                makeDescriptor(instr, &info);
+                recordTable(instr, &info);
                 continue;
             }
         }
@@ -201,7 +240,7 @@ void JumptableDetection::detect(UDRegMemWorkingSet *working) {
 
             if(info.valid) {
                 LOG(10, "valid jump table descriptor!");
-                makeDescriptor(instr, &info);
+                recordTable(instr, &info);
                 continue;
             }
             
@@ -216,14 +255,7 @@ void JumptableDetection::detect(UDRegMemWorkingSet *working) {
 }
 
 bool JumptableDetection::containsIndirectJump(Function *function) const {
-    for(auto block : CIter::children(function)) {
-        auto instr = block->getChildren()->getIterable()->getLast();
-        auto s = instr->getSemantic();
-        if(dynamic_cast<IndirectJumpInstruction *>(s)) {
-            return true;
-        }
-    }
-    return false;
+    return function->getFeatures().has(FunctionFeatures::FEATURE_INDIRECT_JUMP);
 }
 
 bool JumptableDetection::parseJumptable(UDState *state, TreeCapture& cap,
@@ -317,7 +349,7 @@ void JumptableDetection::parseOldCJumptable(UDState *state, int reg,
                         LOG(10, "    targetBase found! "
                             << std::hex << targetBase);
                         info->targetBase = targetBase;
-                        makeDescriptor(state->getInstruction(), info);
+                        recordTable(state->getInstruction(), info);
 
                         // there can be more than one
                         info->valid = false;
@@ -392,20 +424,34 @@ bool JumptableDetection::parseJumptableWithIndexTable(UDState *state,
 }
 #endif
 
-void JumptableDetection::makeDescriptor(Instruction *instruction,
+void JumptableDetection::recordTable(Instruction *instruction,
     const JumptableInfo *info) {
 
-    auto working = info->working;
+    LOG(10, "jump table jump at "
+        << std::hex << info->jumpState->getInstruction()->getAddress());
+
+    FoundTable table;
+    table.function = info->working->getFunction();
+    table.instruction = instruction;
+    table.targetBase = info->targetBase;
+    table.tableBase = info->tableBase;
+    table.scale = info->scale;
+    table.entries = info->entries;
+    found.push_back(table);
+}
+
+void JumptableDetection::makeDescriptor(const FoundTable &table) {
+    auto instruction = table.instruction;
     auto it = tableMap.find(instruction);
     if(it != tableMap.end()) {
         bool exists = false;
         for(auto d : it->second) {
             if(d->getInstruction() == instruction
-                && d->getAddress() == info->tableBase
+                && d->getAddress() == table.tableBase
                 && d->getTargetBaseLink()->getTargetAddress()
-                    == info->targetBase
-                && d->getScale() == static_cast<int>(info->scale)
-                //&& d->getEntries() == info->entries
+                    == table.targetBase
+                && d->getScale() == static_cast<int>(table.scale)
+                //&& d->getEntries() == table.entries
                 ) {
                 exists = true;
                 break;
@@ -414,18 +460,18 @@ void JumptableDetection::makeDescriptor(Instruction *instruction,
         if(exists) return;
     }
 
-    auto jtd = new JumpTableDescriptor(working->getFunction(), instruction);
-    jtd->setAddress(info->tableBase);
+    auto jtd = new JumpTableDescriptor(table.function, instruction);
+    jtd->setAddress(table.tableBase);
     Link *link = nullptr;
-    if(info->tableBase == info->targetBase) {
-        link = LinkFactory::makeDataLink(module, info->targetBase, true);
+    if(table.tableBase == table.targetBase) {
+        link = LinkFactory::makeDataLink(module, table.targetBase, true);
     }
     else {
         // even for X86_64, jump table base != target base for hand-written
         // jump tables
         auto function
             = dynamic_cast<Function *>(instruction->getParent()->getParent());
-        auto target = ChunkFind().findInnermostAt(function, info->targetBase);
+        auto target = ChunkFind().findInnermostAt(function, table.targetBase);
         if(target) {
             link = LinkFactory::makeNormalLink(target, true, false);
         }
@@ -436,22 +482,20 @@ void JumptableDetection::makeDescriptor(Instruction *instruction,
     }
     assert(link);
     jtd->setTargetBaseLink(link);
-    jtd->setScale(info->scale);
-    jtd->setEntries(info->entries);
+    jtd->setScale(table.scale);
+    jtd->setEntries(table.entries);
 
     auto contentSection =
-        module->getDataRegionList()->findDataSectionContaining(info->tableBase);
+        module->getDataRegionList()->findDataSectionContaining(table.tableBase);
     assert(contentSection);
     jtd->setContentSection(contentSection);
     tableList.push_back(jtd);
 
-    LOG(10, "jump table jump at "
-        << std::hex << info->jumpState->getInstruction()->getAddress());
     LOG(10, "descriptor:" << jtd);
-    LOG(10, "baseAddress = " << std::hex << info->tableBase);
-    LOG(10, "targetBaseAddress = " << std::hex << info->targetBase);
-    LOG(10, "scale = " << std::dec << info->scale);
-    LOG(10, "entries = " << std::dec << info->entries);
+    LOG(10, "baseAddress = " << std::hex << table.tableBase);
+    LOG(10, "targetBaseAddress = " << std::hex << table.targetBase);
+    LOG(10, "scale = " << std::dec << table.scale);
+    LOG(10, "entries = " << std::dec << table.entries);
 
     tableMap[instruction].push_back(jtd);
 }
@@ -1890,11 +1934,10 @@ bool JumptableDetection::getBoundFromIndexTable(UDState *state, int reg,
         std::tie(found, indexTableBase)
             = parseBaseAddress(state, regTree1->getRegister());
         if(found) {
-            auto it = indexTables.find(indexTableBase);
-            if(it != indexTables.end()) {
+            if(auto known = findIndexTable(indexTableBase)) {
                 LOG(10, "index table for this base is already known");
-                indexTableScale = it->second.scale;
-                indexTableEntries = it->second.entries;
+                indexTableScale = known->scale;
+                indexTableEntries = known->entries;
             }
             else {
                 JumptableInfo indexInfo = *info;
@@ -1990,6 +2033,18 @@ bool JumptableDetection::getBoundFromIndexTable(UDState *state, int reg,
 #endif
 }
 
+auto JumptableDetection::findIndexTable(address_t base) const
+    -> const IndextableInfo * {
+
+    auto it = indexTables.find(base);
+    if(it != indexTables.end()) return &it->second;
+    if(knownIndexTables) {
+        auto it2 = knownIndexTables->find(base);
+        if(it2 != knownIndexTables->end()) return &it2->second;
+    }
+    return nullptr;
+}
+
 bool JumptableDetection::getBoundFromArgument(UDState *state, int reg,
     JumptableInfo *info) {
 
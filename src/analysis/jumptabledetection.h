@@ -41,29 +41,61 @@ private:
             : scale(scale), entries(entries) {}
     };
 
+    // a table found by analysis, before it becomes a descriptor
+    struct FoundTable {
+        Function *function;
+        Instruction *instruction;
+        address_t targetBase;
+        address_t tableBase;
+        size_t scale;
+        long entries;
+    };
+
+    typedef std::map<address_t /* index table base */, IndextableInfo>
+        IndextableMap;
+
+    // what one function's analysis produces when run in parallel
+    struct FunctionResult {
+        std::vector<FoundTable> found;
+        IndextableMap indexTables;
+    };
+
     Module *module;
     std::vector<JumpTableDescriptor *> tableList;
     std::map<Instruction *, std::vector<JumpTableDescriptor *>> tableMap;
+    std::vector<FoundTable> found;
 
     // keeps track of index table for performance and correct analysis
     // because the non-first use of index table requires complex analysis
-    std::map<address_t /* index table base */, IndextableInfo> indexTables;
+    IndextableMap indexTables;
+    // index tables known before a parallel round started; read only
+    const IndextableMap *knownIndexTables;
 
 public:
-    JumptableDetection(Module *module) : module(module) {}
+    JumptableDetection(Module *module)
+        : module(module), knownIndexTables(nullptr) {}
     void detect(Module *module);
+    /** Analyzes the functions in parallel; results do not depend on the
+        number of threads.
+    */
+    void detect(const std::vector<Function *> &functionList);
     void detect(Function *function);
     void detect(UDRegMemWorkingSet *working);
     const std::vector<JumpTableDescriptor *> &getTableList() const
         { return tableList; }
 
 private:
+    void analyze(Function *function);
+    void search(UDRegMemWorkingSet *working);
+    void makeDescriptors();
     bool containsIndirectJump(Function *function) const;
     bool parseJumptable(UDState *state, TreeCapture& cap, JumptableInfo *info);
     void parseOldCJumptable(UDState *state, int reg, JumptableInfo *info);
     bool parseJumptableWithIndexTable(UDState *state, int reg,
         JumptableInfo *info);
-    void makeDescriptor(Instruction *instruction, const JumptableInfo *info);
+    void recordTable(Instruction *instruction, const JumptableInfo *info);
+    void makeDescriptor(const FoundTable &table);
+    const IndextableInfo *findIndexTable(address_t base) const;
 
     bool parseTableAccess(UDState *state, int reg, JumptableInfo *info);
     std::tuple<bool, address_t> parseBaseAddress(UDState *state, int reg);
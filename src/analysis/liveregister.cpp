@@ -3,9 +3,11 @@
 #include "analysis/walker.h"
 #include "analysis/controlflow.h"
 #include "analysis/savedregister.h"
+#include "analysis/regflow.h"
 #include "chunk/concrete.h"
 #include "instr/register.h"
 #include "instr/isolated.h"
+#include "instr/concrete.h"
 
 #include "log/log.h"
 
@@ -26,16 +28,50 @@ LiveInfo LiveRegister::getInfo(UDRegMemWorkingSet *working) {
     return list[function];
 }
 
+#ifdef ARCH_X86_64
+/** Whether instr leaves the function like a tail call does. */
+static bool isTailJump(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        return cfi->getLink() && cfi->getLink()->isExternalJump();
+    }
+    if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+        semantic)) {
+
+        return !dlcfi->isCall();
+    }
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        return !ij->isForJumpTable();
+    }
+    return false;
+}
+#endif
+
 void LiveRegister::detect(Function *function) {
+#ifdef ARCH_X86_64
+    // registers the function may write, calls and tail calls included, are
+    // not preserved; this needs only per-instruction effects, not use-def
+    // trees
+    LiveInfo &info = list[function];
+    RegisterEffectModel model;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto def = model.getEffect(instr).getDef();
+            if(isTailJump(instr)) def |= RegisterEffectModel::getCallerSaved();
+            for(int r = 0; r < RegisterEffectModel::REGISTERS; r ++) {
+                if(def & RegisterEffect::bit(r)) info.kill(r);
+            }
+        }
+    }
+#else
     ControlFlowGraph cfg(function);
     UDConfiguration config(&cfg);
     UDRegMemWorkingSet working(function, &cfg);
     UseDef usedef(&config, &working);
 
-    SccOrder order(&cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
+    usedef.analyze(cfg.getSccOrder());
     detect(&working);
+#endif
 }
 
 void LiveRegister::detect(UDRegMemWorkingSet *working) {
@@ -53,19 +89,28 @@ void LiveRegister::detect(UDRegMemWorkingSet *working) {
     // if this function contains a function call or a jump to another
     // function, we assume all caller-saved or temporary registers are killed
     auto module = dynamic_cast<Module *>(function->getParent()->getParent());
-    for(const auto& s : working->getStateList()) {
-        if(StateGroup::isCall(&s) || StateGroup::isExternalJump(&s, module)) {
-            for(size_t i = 0; i < 19; i++) {
-                info.kill(i);
+    const auto &features = function->getFeatures();
+    if(features.hasCall() || features.has(FunctionFeatures::FEATURE_DIRECT_JUMP
+        | FunctionFeatures::FEATURE_INDIRECT_JUMP)) {
+
+        for(const auto& s : working->getStateList()) {
+            if(StateGroup::isCall(&s)
+                || StateGroup::isExternalJump(&s, module)) {
+
+                for(size_t i = 0; i < 19; i++) {
+                    info.kill(i);
+                }
+                break;
             }
-            break;
         }
     }
 
-    // resurrect actually saved registers
-    SavedRegister saved;
-    for(auto r : saved.getList(function)) {
-        info.live(r);
+    // resurrect actually saved registers, reusing this working set
+    if(features.has(FunctionFeatures::FEATURE_STACK_POINTER)) {
+        SavedRegister saved;
+        for(auto r : saved.getList(working)) {
+            info.live(r);
+        }
     }
 
     LOG0(10, "live registers:");
@@ -8,6 +8,7 @@
 #include "instr/isolated.h"
 #include "instr/linked-aarch64.h"
 #include "disasm/riscv-disas.h"
+#include "util/parallel.h"
 
 #include "log/log.h"
 #include "log/temp.h"
@@ -21,9 +22,7 @@ void PointerDetection::detect(Function *function, ControlFlowGraph *cfg) {
     IF_LOG(10) cfg->dump();
     IF_LOG(10) cfg->dumpDot();
 
-    SccOrder order(cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
+    usedef.analyze(cfg->getSccOrder());
 
     detect(&working);
 }
@@ -69,6 +68,22 @@ void PointerDetection::detect(UDRegMemWorkingSet *working) {
     }
 }
 
+void PointerDetection::detect(
+    const std::vector<UDRegMemWorkingSet *> &workingList) {
+
+    typedef std::vector<std::pair<Instruction *, address_t>> PointerList;
+    parallelAnalyze<PointerList>(workingList.size(),
+        [&] (size_t i, PointerList &result) {
+            PointerDetection worker;
+            worker.detect(workingList[i]);
+            result = std::move(worker.pointerList);
+        },
+        [&] (size_t i, PointerList &result) {
+            pointerList.insert(pointerList.end(),
+                result.begin(), result.end());
+        });
+}
+
 #ifdef ARCH_AARCH64
 void PointerDetection::detectAtLDR(UDState *state) {
     for(auto& def : state->getRegDefList()) {
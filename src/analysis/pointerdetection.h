@@ -20,6 +20,10 @@ public:
     PointerDetection() {}
     void detect(Function *function, ControlFlowGraph *cfg);
     void detect(UDRegMemWorkingSet *working);
+    /** Searches the working sets in parallel; the list is in the same
+        order as if they were searched one at a time.
+    */
+    void detect(const std::vector<UDRegMemWorkingSet *> &workingList);
 
     const std::vector<std::pair<Instruction *, address_t>> getList() const
         { return pointerList; }
@@ -0,0 +1,407 @@
+#include <initializer_list>
+#include "regflow.h"
+#include "controlflow.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "instr/concrete.h"
+
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+static RegisterSet makeSet(std::initializer_list<int> regs) {
+    RegisterSet set = 0;
+    for(auto r : regs) set |= RegisterEffect::bit(r);
+    return set;
+}
+
+RegisterSet RegisterEffectModel::getArguments() {
+    return makeSet({X86Register::R7, X86Register::R6, X86Register::R2,
+        X86Register::R1, X86Register::R8, X86Register::R9,
+        X86Register::R0});  // %al holds the vector count for varargs
+}
+
+RegisterSet RegisterEffectModel::getCallerSaved() {
+    return makeSet({X86Register::R0, X86Register::R1, X86Register::R2,
+        X86Register::R6, X86Register::R7, X86Register::R8, X86Register::R9,
+        X86Register::R10, X86Register::R11, X86Register::FLAGS});
+}
+
+RegisterSet RegisterEffectModel::getCalleeSaved() {
+    return makeSet({X86Register::R3, X86Register::BP, X86Register::SP,
+        X86Register::R12, X86Register::R13, X86Register::R14,
+        X86Register::R15});
+}
+
+static int getPhysical(int id) {
+    if(id == X86_REG_EFLAGS) return X86Register::FLAGS;
+    return X86Register::convertToPhysical(id);
+}
+
+RegisterEffect RegisterEffectModel::getEffect(Instruction *instruction) {
+    auto semantic = instruction->getSemantic();
+    if(dynamic_cast<ReturnInstruction *>(semantic)) {
+        return RegisterEffect(RegisterEffect::bit(X86Register::SP), 0, 0);
+    }
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        auto mnemonic = cfi->getMnemonic();
+        if(mnemonic == "callq") return getCallEffect(instruction);
+
+        RegisterEffect effect;
+        if(cfi->getLink() && cfi->getLink()->isExternalJump()) {
+            // a tail call passes on the arguments
+            effect = RegisterEffect(getArguments()
+                | RegisterEffect::bit(X86Register::SP), 0, 0);
+        }
+        if(mnemonic == "jmp") return effect;
+
+        effect.addUse(X86Register::FLAGS);
+        if(mnemonic.find("cxz") != std::string::npos) {
+            effect.addUse(X86Register::R1);
+        }
+        else if(mnemonic.compare(0, 4, "loop") == 0) {
+            effect.addUse(X86Register::R1);
+            effect.addDef(X86Register::R1);
+        }
+        return effect;
+    }
+    if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+        semantic)) {
+
+        // call or jump through a %rip-relative pointer
+        if(dlcfi->isCall()) return getCallEffect(instruction);
+        return RegisterEffect(getAll(), 0, 0);
+    }
+    if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+        return getIndirectCallEffect(instruction);
+    }
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        // other jumps leave the function, e.g. indirect tail calls
+        if(!ij->isForJumpTable()) return RegisterEffect(getAll(), 0, 0);
+
+        RegisterEffect effect;
+        effect.addUse(getPhysical(ij->getRegister()));
+        effect.addUse(getPhysical(ij->getIndexRegister()));
+        return effect;
+    }
+
+    auto assembly = semantic->getAssembly();
+    if(!assembly) return RegisterEffect(getAll(), getAll(), 0);
+
+    RegisterEffect effect;
+    addOperands(effect, instruction);
+    for(size_t i = 0; i < assembly->getImplicitRegsReadCount(); i ++) {
+        effect.addUse(getPhysical(assembly->getImplicitRegsRead()[i]));
+    }
+    for(size_t i = 0; i < assembly->getImplicitRegsWriteCount(); i ++) {
+        effect.addDef(getPhysical(assembly->getImplicitRegsWrite()[i]));
+    }
+
+    // capstone does not always list these implicit operands
+    switch(assembly->getId()) {
+    case X86_INS_SYSCALL:
+        effect = RegisterEffect(effect.getUse() | getArguments()
+            | RegisterEffect::bit(X86Register::R10), effect.getDef()
+            | makeSet({X86Register::R0, X86Register::R1, X86Register::R11}),
+            0);
+        break;
+    case X86_INS_MOVSB: case X86_INS_MOVSW: case X86_INS_MOVSD:
+    case X86_INS_MOVSQ: case X86_INS_STOSB: case X86_INS_STOSW:
+    case X86_INS_STOSD: case X86_INS_STOSQ: case X86_INS_LODSB:
+    case X86_INS_LODSW: case X86_INS_LODSD: case X86_INS_LODSQ:
+    case X86_INS_CMPSB: case X86_INS_CMPSW: case X86_INS_CMPSD:
+    case X86_INS_CMPSQ: case X86_INS_SCASB: case X86_INS_SCASW:
+    case X86_INS_SCASD: case X86_INS_SCASQ: {
+        auto string = makeSet({X86Register::R0, X86Register::R1,
+            X86Register::R6, X86Register::R7, X86Register::FLAGS});
+        effect = RegisterEffect(effect.getUse() | string,
+            effect.getDef() | string, effect.getKill());
+        break;
+    }
+    default:
+        break;
+    }
+    return effect;
+}
+
+RegisterEffect RegisterEffectModel::getCallEffect(Instruction *instruction) {
+    return RegisterEffect(getArguments()
+        | RegisterEffect::bit(X86Register::SP), getCallerSaved(), 0);
+}
+
+RegisterEffect RegisterEffectModel::getIndirectCallEffect(
+    Instruction *instruction) {
+
+    auto ic = static_cast<IndirectCallInstruction *>(
+        instruction->getSemantic());
+    auto effect = getCallEffect(instruction);
+    effect.addUse(getPhysical(ic->getRegister()));
+    effect.addUse(getPhysical(ic->getIndexRegister()));
+    return effect;
+}
+
+void RegisterEffectModel::addOperands(RegisterEffect &effect,
+    Instruction *instruction) {
+
+    auto assembly = instruction->getSemantic()->getAssembly();
+    auto id = assembly->getId();
+    auto asmOps = assembly->getAsmOperands();
+    auto count = asmOps->getOpCount();
+    auto operands = asmOps->getOperands();
+
+    // AT&T operand order: the destination is the last operand
+    bool writesLast = true;
+    bool overwritesLast = false;
+    bool writesAll = false;
+    switch(id) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+    case X86_INS_PUSH:
+    case X86_INS_NOP:
+        writesLast = false;
+        break;
+    case X86_INS_MOV:
+    case X86_INS_MOVABS:
+    case X86_INS_MOVZX:
+    case X86_INS_MOVSX:
+    case X86_INS_MOVSXD:
+    case X86_INS_LEA:
+    case X86_INS_POP:
+        overwritesLast = true;
+        break;
+    case X86_INS_XOR:
+    case X86_INS_SUB:
+        // zeroing idiom, e.g. xor %ecx, %ecx, reads nothing
+        if(count == 2 && operands[0].type == X86_OP_REG
+            && operands[1].type == X86_OP_REG
+            && operands[0].reg == operands[1].reg) {
+
+            int reg = getPhysical(operands[1].reg);
+            if(reg != X86Register::INVALID
+                && X86Register::getWidth(reg, operands[1].reg) >= 4) {
+
+                effect.addKill(reg);
+                effect.addKill(X86Register::FLAGS);
+                return;
+            }
+        }
+        break;
+    case X86_INS_XCHG:
+    case X86_INS_XADD:
+        writesAll = true;
+        break;
+    default:
+        break;
+    }
+
+    for(size_t i = 0; i < count; i ++) {
+        const auto &op = operands[i];
+        if(op.type == X86_OP_MEM) {
+            effect.addUse(getPhysical(op.mem.base));
+            effect.addUse(getPhysical(op.mem.index));
+            continue;
+        }
+        if(op.type != X86_OP_REG) continue;
+
+        int reg = getPhysical(op.reg);
+        if(reg == X86Register::INVALID) continue;
+        bool last = (i + 1 == count);
+        if(last && overwritesLast
+            && X86Register::getWidth(reg, op.reg) >= 4) {
+
+            // 32-bit writes zero the upper half
+            effect.addKill(reg);
+            continue;
+        }
+        effect.addUse(reg);
+        if((last && writesLast) || writesAll) effect.addDef(reg);
+    }
+}
+
+static void collectEffects(ControlFlowGraph *cfg, RegisterEffectModel *model,
+    std::vector<RegisterEffectList> &effects) {
+
+    RegisterEffectModel defaultModel;
+    if(!model) model = &defaultModel;
+
+    effects.resize(cfg->getCount());
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        auto block = cfg->get(id)->getBlock();
+        for(auto instr : CIter::children(block)) {
+            effects[id].emplace_back(instr, model->getEffect(instr));
+        }
+    }
+}
+
+static RegisterSet toSet(const BitVector &vector) {
+    return vector.getWord(0);
+}
+
+RegisterLiveness::RegisterLiveness(ControlFlowGraph *cfg,
+    RegisterEffectModel *model, RegisterSet liveAtExit)
+    : cfg(cfg), flow(cfg, RegisterEffectModel::REGISTERS,
+    BitDataFlow::BACKWARD) {
+
+    collectEffects(cfg, model, effects);
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        // compose the block backwards: live = gen | (live & ~kill)
+        RegisterSet gen = 0, kill = 0;
+        for(auto it = effects[id].rbegin(); it != effects[id].rend(); ++it) {
+            const auto &effect = it->second;
+            gen = effect.getUse() | (gen & ~effect.getKill());
+            kill |= effect.getKill();
+        }
+        flow.getGen(id).setWord(0, gen);
+        flow.getKill(id).setWord(0, kill);
+    }
+
+    BitVector boundary(RegisterEffectModel::REGISTERS);
+    boundary.setWord(0, liveAtExit);
+    flow.setBoundary(boundary);
+    flow.solve();
+}
+
+RegisterSet RegisterLiveness::getLiveIn(Block *block) {
+    return toSet(flow.getIn(cfg->getIDFor(block)));
+}
+
+RegisterSet RegisterLiveness::getLiveOut(Block *block) {
+    return toSet(flow.getOut(cfg->getIDFor(block)));
+}
+
+RegisterSet RegisterLiveness::getLiveBefore(Instruction *instruction) {
+    return walkBack(instruction, true);
+}
+
+RegisterSet RegisterLiveness::getLiveAfter(Instruction *instruction) {
+    return walkBack(instruction, false);
+}
+
+bool RegisterLiveness::isAnalyzed(Instruction *instruction) {
+    auto block = dynamic_cast<Block *>(instruction->getParent());
+    if(!block || !cfg->hasIDFor(block)) return false;
+
+    for(const auto &pair : effects[cfg->getIDFor(block)]) {
+        if(pair.first == instruction) return true;
+    }
+    return false;
+}
+
+RegisterSet RegisterLiveness::walkBack(Instruction *instruction,
+    bool inclusive) {
+
+    auto id = cfg->getIDFor(static_cast<Block *>(instruction->getParent()));
+    RegisterSet live = toSet(flow.getOut(id));
+    for(auto it = effects[id].rbegin(); it != effects[id].rend(); ++it) {
+        if(it->first == instruction && !inclusive) break;
+
+        const auto &effect = it->second;
+        live = effect.getUse() | (live & ~effect.getKill());
+        if(it->first == instruction) break;
+    }
+    return live;
+}
+
+RegisterReachingDefs::RegisterReachingDefs(ControlFlowGraph *cfg,
+    RegisterEffectModel *model)
+    : cfg(cfg), flow(cfg, collectSites(model), BitDataFlow::FORWARD) {
+
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        for(const auto &pair : effects[id]) {
+            apply(flow.getGen(id), flow.getKill(id), pair.first, pair.second);
+        }
+    }
+
+    BitVector boundary(flow.getBits());
+    for(size_t r = 0; r < RegisterEffectModel::REGISTERS; r ++) {
+        boundary.set(r);
+    }
+    flow.setBoundary(boundary);
+    flow.solve();
+}
+
+size_t RegisterReachingDefs::collectSites(RegisterEffectModel *model) {
+    collectEffects(cfg, model, effects);
+    for(const auto &list : effects) {
+        for(const auto &pair : list) {
+            auto def = pair.second.getDef();
+            if(!def) continue;
+
+            firstSite[pair.first] = sites.size();
+            for(int r = 0; r < RegisterEffectModel::REGISTERS; r ++) {
+                if(def & RegisterEffect::bit(r)) {
+                    sites.emplace_back(pair.first, r);
+                }
+            }
+        }
+    }
+
+    size_t bits = RegisterEffectModel::REGISTERS + sites.size();
+    sitesOf.assign(RegisterEffectModel::REGISTERS, BitVector(bits));
+    for(size_t r = 0; r < RegisterEffectModel::REGISTERS; r ++) {
+        sitesOf[r].set(r);
+    }
+    for(size_t i = 0; i < sites.size(); i ++) {
+        sitesOf[sites[i].second].set(RegisterEffectModel::REGISTERS + i);
+    }
+    return bits;
+}
+
+void RegisterReachingDefs::apply(BitVector &facts, Instruction *instruction,
+    const RegisterEffect &effect) {
+
+    BitVector unused(facts.getSize());
+    apply(facts, unused, instruction, effect);
+}
+
+void RegisterReachingDefs::apply(BitVector &gen, BitVector &kill,
+    Instruction *instruction, const RegisterEffect &effect) {
+
+    if(!effect.getDef()) return;
+
+    size_t site = RegisterEffectModel::REGISTERS + firstSite[instruction];
+    for(int r = 0; r < RegisterEffectModel::REGISTERS; r ++) {
+        if(!(effect.getDef() & RegisterEffect::bit(r))) continue;
+
+        if(effect.getKill() & RegisterEffect::bit(r)) {
+            gen.subtract(sitesOf[r]);
+            kill.unionWith(sitesOf[r]);
+        }
+        gen.set(site ++);
+    }
+}
+
+BitVector RegisterReachingDefs::getReachingBefore(Instruction *instruction) {
+    auto id = cfg->getIDFor(static_cast<Block *>(instruction->getParent()));
+    BitVector facts = flow.getIn(id);
+    for(const auto &pair : effects[id]) {
+        if(pair.first == instruction) break;
+        apply(facts, pair.first, pair.second);
+    }
+    return facts;
+}
+
+std::vector<Instruction *> RegisterReachingDefs::getReachingDefs(
+    Instruction *instruction, int reg) {
+
+    std::vector<Instruction *> list;
+    auto facts = getReachingBefore(instruction);
+    facts.intersectWith(sitesOf[reg]);
+    if(facts.get(reg)) list.push_back(nullptr);
+    for(size_t i = 0; i < sites.size(); i ++) {
+        if(facts.get(RegisterEffectModel::REGISTERS + i)) {
+            list.push_back(sites[i].first);
+        }
+    }
+    return list;
+}
+
+bool RegisterReachingDefs::mayBeClobberedBefore(Instruction *instruction,
+    int reg) {
+
+    auto facts = getReachingBefore(instruction);
+    facts.intersectWith(sitesOf[reg]);
+    facts.reset(reg);
+    return facts.any();
+}
+#endif
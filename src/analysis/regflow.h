@@ -0,0 +1,137 @@
+#ifndef EGALITO_ANALYSIS_REG_FLOW_H
+#define EGALITO_ANALYSIS_REG_FLOW_H
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "bitflow.h"
+#include "instr/register.h"
+
+class ControlFlowGraph;
+class Block;
+class Instruction;
+
+#ifdef ARCH_X86_64
+/** Integer registers and flags, one bit per X86Register id. */
+typedef uint64_t RegisterSet;
+
+/** The registers an instruction may read (use) or may write (def), and
+    those it always overwrites entirely (kill). use and def over-approximate
+    and kill under-approximates, so liveness computed from them never
+    reports a register dead when it might still be read.
+*/
+class RegisterEffect {
+private:
+    RegisterSet use;
+    RegisterSet def;
+    RegisterSet kill;
+public:
+    RegisterEffect() : use(0), def(0), kill(0) {}
+    RegisterEffect(RegisterSet use, RegisterSet def, RegisterSet kill)
+        : use(use), def(def | kill), kill(kill) {}
+
+    RegisterSet getUse() const { return use; }
+    RegisterSet getDef() const { return def; }
+    RegisterSet getKill() const { return kill; }
+
+    void addUse(int reg) { use |= bit(reg); }
+    void addDef(int reg) { def |= bit(reg); }
+    void addKill(int reg) { def |= bit(reg); kill |= bit(reg); }
+
+    static RegisterSet bit(int reg)
+        { return (reg >= 0) ? (RegisterSet(1) << reg) : 0; }
+};
+
+typedef std::vector<std::pair<Instruction *, RegisterEffect>>
+    RegisterEffectList;
+
+/** Computes register effects from instruction semantics, without building
+    use-def trees. Anything not understood uses and may define every
+    register. Calls are modelled by the SysV ABI, except that they kill
+    nothing: GCC's interprocedural register allocation keeps values in
+    caller-saved registers across calls to functions that do not touch
+    them. Subclasses may refine call effects with callee knowledge.
+*/
+class RegisterEffectModel {
+public:
+    enum {
+        REGISTERS = X86Register::REGISTER_NUMBER + 1  // with FLAGS
+    };
+public:
+    virtual ~RegisterEffectModel() {}
+
+    RegisterEffect getEffect(Instruction *instruction);
+
+    static RegisterSet getAll() { return (RegisterSet(1) << REGISTERS) - 1; }
+    static RegisterSet getArguments();
+    static RegisterSet getCallerSaved();
+    static RegisterSet getCalleeSaved();
+protected:
+    virtual RegisterEffect getCallEffect(Instruction *instruction);
+    virtual RegisterEffect getIndirectCallEffect(Instruction *instruction);
+private:
+    void addOperands(RegisterEffect &effect, Instruction *instruction);
+};
+
+/** Register liveness over a function's ControlFlowGraph. Registers listed
+    in liveAtExit are assumed read after every return or tail jump.
+*/
+class RegisterLiveness {
+private:
+    ControlFlowGraph *cfg;
+    BitDataFlow flow;
+    std::vector<RegisterEffectList> effects;  // per node
+public:
+    RegisterLiveness(ControlFlowGraph *cfg,
+        RegisterEffectModel *model = nullptr,
+        RegisterSet liveAtExit = RegisterEffectModel::getAll());
+
+    RegisterSet getLiveIn(Block *block);
+    RegisterSet getLiveOut(Block *block);
+    RegisterSet getLiveBefore(Instruction *instruction);
+    RegisterSet getLiveAfter(Instruction *instruction);
+    bool isDeadBefore(Instruction *instruction, int reg)
+        { return !(getLiveBefore(instruction) & RegisterEffect::bit(reg)); }
+
+    /** Whether instruction was in the function when this was computed;
+        instructions inserted later cannot be queried.
+    */
+    bool isAnalyzed(Instruction *instruction);
+private:
+    RegisterSet walkBack(Instruction *instruction, bool inclusive);
+};
+
+/** Reaching definitions of registers over a ControlFlowGraph. Each register
+    also has an entry definition, standing for its value on function entry.
+*/
+class RegisterReachingDefs {
+private:
+    ControlFlowGraph *cfg;
+    std::vector<RegisterEffectList> effects;  // per node
+    // definition sites after the entry ones, in program order
+    std::vector<std::pair<Instruction *, int>> sites;
+    std::map<Instruction *, size_t> firstSite;
+    std::vector<BitVector> sitesOf;  // per register
+    BitDataFlow flow;  // must follow the above, see collectSites()
+public:
+    RegisterReachingDefs(ControlFlowGraph *cfg,
+        RegisterEffectModel *model = nullptr);
+
+    /** Instructions whose write to reg may reach the start of instruction;
+        nullptr stands for the value on function entry.
+    */
+    std::vector<Instruction *> getReachingDefs(Instruction *instruction,
+        int reg);
+    /** Whether reg may hold a value other than its entry value here. */
+    bool mayBeClobberedBefore(Instruction *instruction, int reg);
+private:
+    size_t collectSites(RegisterEffectModel *model);
+    BitVector getReachingBefore(Instruction *instruction);
+    void apply(BitVector &facts, Instruction *instruction,
+        const RegisterEffect &effect);
+    void apply(BitVector &gen, BitVector &kill, Instruction *instruction,
+        const RegisterEffect &effect);
+};
+#endif
+
+#endif
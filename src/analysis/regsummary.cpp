@@ -0,0 +1,178 @@
+#include <deque>
+#include <set>
+#include "regsummary.h"
+#include "controlflow.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "instr/concrete.h"
+
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+RegisterEffect SummaryEffectModel::getCallEffect(Instruction *instruction) {
+    RegisterSet use = getArguments() | RegisterEffect::bit(X86Register::SP);
+    auto target = RegisterSummary::getCallTarget(instruction);
+    if(target && summary->isSummarized(target)) {
+        // registers the callee leaves alone keep their values
+        return RegisterEffect(use, summary->getClobbered(target)
+            | RegisterEffect::bit(X86Register::FLAGS),
+            RegisterEffect::bit(X86Register::FLAGS));
+    }
+
+    // the caller cannot rely on any caller-saved register afterwards
+    return RegisterEffect(use, getCallerSaved(), getCallerSaved());
+}
+
+RegisterSummary::RegisterSummary(Module *module) : model(this) {
+    for(auto function : CIter::functions(module)) {
+        summaries[function];
+    }
+    for(auto &pair : summaries) {
+        collect(pair.first, pair.second);
+    }
+
+    computeClobbered();
+    computeLiveAtReturn();
+}
+
+RegisterSummary::~RegisterSummary() {
+    for(auto &pair : summaries) {
+        delete pair.second.liveness;
+        delete pair.second.cfg;
+    }
+}
+
+RegisterSet RegisterSummary::getClobbered(Function *function) {
+    auto it = summaries.find(function);
+    if(it == summaries.end()) return RegisterEffectModel::getCallerSaved();
+    return it->second.clobbered;
+}
+
+RegisterSet RegisterSummary::getLiveAtReturn(Function *function) {
+    auto it = summaries.find(function);
+    if(it == summaries.end()) return RegisterEffectModel::getAll();
+    return it->second.liveAtReturn;
+}
+
+RegisterLiveness *RegisterSummary::getLiveness(Function *function) {
+    auto it = summaries.find(function);
+    return (it != summaries.end()) ? it->second.liveness : nullptr;
+}
+
+Function *RegisterSummary::getCallTarget(Instruction *instruction) {
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    if(!cfi || !cfi->getLink() || !cfi->getLink()->isExternalJump()) {
+        return nullptr;
+    }
+    return dynamic_cast<Function *>(cfi->getLink()->getTarget());
+}
+
+RegisterSet RegisterSummary::getLiveAtReturnByABI() {
+    return RegisterEffectModel::getCalleeSaved()
+        | RegisterEffect::bit(X86Register::R0)
+        | RegisterEffect::bit(X86Register::R2);
+}
+
+void RegisterSummary::collect(Function *function, FunctionSummary &summary) {
+    summary.cfg = new ControlFlowGraph(function);
+    summary.liveness = nullptr;
+    summary.localClobbered = 0;
+    summary.clobbered = 0;
+    summary.liveAtReturn = getLiveAtReturnByABI();
+
+    RegisterEffectModel base;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto target = getCallTarget(instr);
+            if(target && isSummarized(target)) {
+                auto cfi = static_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(cfi->getMnemonic() == "callq") {
+                    summary.calls.emplace_back(instr, target);
+                }
+                else {
+                    summary.tailCalls.push_back(target);
+                }
+                summaries[target].callers.push_back(function);
+                continue;
+            }
+
+            // other calls clobber every caller-saved register
+            summary.localClobbered |= base.getEffect(instr).getDef();
+        }
+    }
+    summary.localClobbered &= RegisterEffectModel::getCallerSaved();
+}
+
+void RegisterSummary::computeClobbered() {
+    std::deque<Function *> worklist;
+    std::set<Function *> pending;
+    for(auto &pair : summaries) {
+        worklist.push_back(pair.first);
+        pending.insert(pair.first);
+    }
+
+    while(!worklist.empty()) {
+        auto function = worklist.front();
+        worklist.pop_front();
+        pending.erase(function);
+
+        auto &summary = summaries[function];
+        RegisterSet clobbered = summary.localClobbered;
+        for(const auto &call : summary.calls) {
+            clobbered |= summaries[call.second].clobbered;
+        }
+        for(auto target : summary.tailCalls) {
+            clobbered |= summaries[target].clobbered;
+        }
+        if(clobbered == summary.clobbered) continue;
+
+        summary.clobbered = clobbered;
+        for(auto caller : summary.callers) {
+            if(pending.insert(caller).second) worklist.push_back(caller);
+        }
+    }
+}
+
+void RegisterSummary::computeLiveAtReturn() {
+    std::deque<Function *> worklist;
+    std::set<Function *> pending;
+    for(auto &pair : summaries) {
+        worklist.push_back(pair.first);
+        pending.insert(pair.first);
+    }
+
+    auto merge = [&] (Function *target, RegisterSet live) {
+        auto &summary = summaries[target];
+        live &= ~RegisterEffect::bit(X86Register::FLAGS);
+        if((summary.liveAtReturn | live) == summary.liveAtReturn) return;
+
+        summary.liveAtReturn |= live;
+        if(pending.insert(target).second) worklist.push_back(target);
+    };
+
+    size_t visits = 0;
+    while(!worklist.empty()) {
+        auto function = worklist.front();
+        worklist.pop_front();
+        pending.erase(function);
+        visits ++;
+
+        auto &summary = summaries[function];
+        delete summary.liveness;
+        summary.liveness = new RegisterLiveness(summary.cfg, &model,
+            summary.liveAtReturn);
+
+        for(const auto &call : summary.calls) {
+            merge(call.second, summary.liveness->getLiveAfter(call.first));
+        }
+        for(auto target : summary.tailCalls) {
+            merge(target, summary.liveAtReturn);
+        }
+    }
+
+    LOG(10, "register summaries for " << std::dec << summaries.size()
+        << " functions took " << visits << " liveness passes");
+}
+#endif
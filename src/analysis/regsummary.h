@@ -0,0 +1,73 @@
+#ifndef EGALITO_ANALYSIS_REG_SUMMARY_H
+#define EGALITO_ANALYSIS_REG_SUMMARY_H
+
+#include <vector>
+#include <map>
+#include "regflow.h"
+
+class Module;
+class Function;
+class Instruction;
+
+#ifdef ARCH_X86_64
+class RegisterSummary;
+
+/** Models direct calls within the module by their callee's summary. */
+class SummaryEffectModel : public RegisterEffectModel {
+private:
+    RegisterSummary *summary;
+public:
+    SummaryEffectModel(RegisterSummary *summary) : summary(summary) {}
+protected:
+    virtual RegisterEffect getCallEffect(Instruction *instruction);
+};
+
+/** Interprocedural register summaries for the functions of a module.
+
+    Bottom-up, each function gets the caller-saved registers it or any of
+    its callees may clobber. Top-down, each function gets the registers
+    that may be read after it returns: those the ABI guarantees to any
+    caller, plus whatever its direct callers in this module keep live
+    across the call, as GCC does with -fipa-ra. Both are iterated to a
+    fixpoint, so recursion and mutual recursion are handled.
+
+    Calls that leave the module, or go through pointers, follow the ABI.
+    The flags are never live across calls.
+*/
+class RegisterSummary {
+private:
+    class FunctionSummary {
+    public:
+        ControlFlowGraph *cfg;
+        RegisterLiveness *liveness;
+        RegisterSet localClobbered;
+        RegisterSet clobbered;
+        RegisterSet liveAtReturn;
+        std::vector<std::pair<Instruction *, Function *>> calls;
+        std::vector<Function *> tailCalls;
+        std::vector<Function *> callers;
+    };
+    std::map<Function *, FunctionSummary> summaries;
+    SummaryEffectModel model;
+public:
+    RegisterSummary(Module *module);
+    ~RegisterSummary();
+
+    RegisterSet getClobbered(Function *function);
+    RegisterSet getLiveAtReturn(Function *function);
+    RegisterLiveness *getLiveness(Function *function);
+
+    bool isSummarized(Function *function) const
+        { return summaries.count(function) != 0; }
+
+    /** The function a direct call or jump leaves for, if any. */
+    static Function *getCallTarget(Instruction *instruction);
+    static RegisterSet getLiveAtReturnByABI();
+private:
+    void collect(Function *function, FunctionSummary &summary);
+    void computeClobbered();
+    void computeLiveAtReturn();
+};
+#endif
+
+#endif
@@ -14,14 +14,17 @@
 #ifdef ARCH_AARCH64
 
 std::vector<int> SavedRegister::getList(Function *function) {
+    // registers are saved relative to the stack pointer
+    if(!function->getFeatures().has(FunctionFeatures::FEATURE_STACK_POINTER)) {
+        return {};
+    }
+
     ControlFlowGraph cfg(function);
     UDConfiguration config(&cfg);
     UDRegMemWorkingSet working(function, &cfg);
     UseDef usedef(&config, &working);
 
-    SccOrder order(&cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
+    usedef.analyze(cfg.getSccOrder());
 
     return getList(&working);
 }
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <cstddef>
 #include "slicingtree.h"
 #include "disasm/dump.h"
 
@@ -44,6 +45,7 @@ void TreeNodeUnary::print(const TreePrinter &p) const {
 }
 
 bool TreeNodeUnary::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeUnary *>(tree);
     return t && !strcmp(name, t->getName()) &&
         getChild()->equal(t->getChild());
@@ -69,6 +71,7 @@ void TreeNodeBinary::print(const TreePrinter &p) const {
 }
 
 bool TreeNodeBinary::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeBinary *>(tree);
     return t && !strcmp(op, t->getOperator()) && (
         (getLeft()->equal(t->getLeft()) &&
@@ -126,6 +129,7 @@ void TreeNodeMultipleParents::addParentIfNotPresent(TreeNode *parent) {
 }
 
 bool TreeNodeMultipleParents::equal(TreeNode *tree) {
+    if(tree == this) return true;
     auto t = dynamic_cast<TreeNodeMultipleParents *>(tree);
     if(t) {
         auto p1 = t->getParents();
@@ -144,44 +148,49 @@ bool TreeNodeMultipleParents::equal(TreeNode *tree) {
     return false;
 }
 
-TreeFactory& TreeFactory::instance() {
-    static TreeFactory factory;
-    return factory;
+bool TreeArena::Key::operator == (const Key &other) const {
+    if(*type != *other.type || count != other.count) return false;
+    for(size_t i = 0; i < count; i ++) {
+        if(words[i] != other.words[i]) return false;
+    }
+    return true;
 }
 
-TreeNodeRegister *TreeFactory::makeTreeNodeRegister(int reg) {
-    auto i = regTrees.find(reg);
-    if(i != regTrees.end()) {
-        return i->second;
+size_t TreeArena::KeyHash::operator () (const Key &key) const {
+    size_t hash = key.type->hash_code();
+    for(size_t i = 0; i < key.count; i ++) {
+        hash ^= std::hash<uint64_t>()(key.words[i])
+            + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
     }
-
-    TreeNodeRegister *n = new TreeNodeRegister(reg);
-    regTrees.emplace(reg, n);
-    return n;
+    return hash;
 }
 
-TreeNodePhysicalRegister *TreeFactory::makeTreeNodePhysicalRegister(
-    Register reg, int width) {
-
-    auto i = regPhysicalTrees.find(reg);
-    if(i != regPhysicalTrees.end()) {
-        return i->second;
+void *TreeArena::allocate(size_t size) {
+    const size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    if(blockUsed + size > BLOCK_SIZE) {
+        blocks.push_back(new char[BLOCK_SIZE]);
+        blockUsed = 0;
     }
-
-    TreeNodePhysicalRegister *n = new TreeNodePhysicalRegister(reg, width);
-    regPhysicalTrees.emplace(reg, n);
-    return n;
+    void *p = blocks.back() + blockUsed;
+    blockUsed += size;
+    return p;
 }
 
-void TreeFactory::clean() {
-    for(auto t : trees) { delete t; }
+void TreeArena::reset() {
+    for(auto t : trees) t->~TreeNode();
     trees.clear();
+    table.clear();
+    for(auto block : blocks) delete[] block;
+    blocks.clear();
+    blockUsed = BLOCK_SIZE;
+}
+
+TreeFactory& TreeFactory::instance() {
+    static thread_local TreeFactory factory;
+    return factory;
 }
 
-void TreeFactory::cleanAll() {
-    clean();
-    for(auto t : regTrees) { delete t.second; }
-    regTrees.clear();
-    for(auto t : regPhysicalTrees) { delete t.second; }
-    regPhysicalTrees.clear();
+void TreeFactory::clean() {
+    defaultArena.reset();
 }
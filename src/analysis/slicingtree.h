@@ -2,8 +2,12 @@
 #define EGALITO_ANALYSIS_SLICING_TREE_H
 
 #include <iosfwd>
+#include <new>
 #include <vector>
-#include <map>
+#include <unordered_map>
+#include <typeinfo>
+#include <type_traits>
+#include <cstdint>
 #include "instr/register.h"
 #include "types.h"
 
@@ -21,6 +25,9 @@ public:
     bool shouldSplit() const { return _splits > 0; }
 };
 
+/** Nodes are immutable and owned by a TreeArena; structurally identical
+    nodes made by the same arena are the same object.
+*/
 class TreeNode {
 public:
     virtual ~TreeNode() {}
@@ -34,9 +41,9 @@ private:
 public:
     TreeNodeConstant(long value) : value(value) {}
     long int getValue() const { return value; }
-    void setValue(long int value) { this->value = value; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeConstant *>(tree);
         return t && getValue() == t->getValue();
     }
@@ -48,9 +55,9 @@ private:
 public:
     TreeNodeAddress(address_t address) : address(address) {}
     address_t getValue() const { return address; }
-    void setValue(address_t address) { this->address = address; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeAddress *>(tree);
         return t && getValue() == t->getValue();
     }
@@ -64,6 +71,7 @@ public:
     int getRegister() const { return reg; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeRegister *>(tree);
         return t && getRegister() == t->getRegister();
     }
@@ -77,6 +85,7 @@ public:
     address_t getValue() const { return value; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeRegisterRIP *>(tree);
         return t && getValue() == t->getValue();
     }
@@ -92,6 +101,7 @@ public:
     size_t getWidth() const { return width; }
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodePhysicalRegister *>(tree);
         return t && getRegister() == t->getRegister();
     }
@@ -104,7 +114,6 @@ private:
 public:
     TreeNodeUnary(TreeNode *node, const char *name)
         : node(node), name(name) {}
-    ~TreeNodeUnary() { if(node) delete node; }
     TreeNode *getChild() const { return node; }
     const char *getName() const { return name; }
     virtual void print(const TreePrinter &p) const;
@@ -158,7 +167,6 @@ private:
 public:
     TreeNodeBinary(TreeNode *left, TreeNode *right, const char *op)
         : left(left), right(right), op(op) {}
-    ~TreeNodeBinary() { if(left) delete left; if(right) delete right; }
     TreeNode *getLeft() const { return left; }
     TreeNode *getRight() const { return right; }
     const char *getOperator() const { return op; }
@@ -233,12 +241,12 @@ private:
 public:
     TreeNodeComparison(TreeNode *left, TreeNode *right)
         : left(left), right(right) {}
-    ~TreeNodeComparison() { if(left) delete left; if(right) delete right; }
     TreeNode *getLeft() const { return left; }
     TreeNode *getRight() const { return right; }
 
     virtual void print(const TreePrinter &p) const;
     virtual bool equal(TreeNode *tree) {
+        if(tree == this) return true;
         auto t = dynamic_cast<TreeNodeComparison *>(tree);
         return t && (
             (getLeft()->equal(t->getLeft()) &&
@@ -262,44 +270,131 @@ public:
     virtual bool equal(TreeNode *tree);
 };
 
-class TreeFactory {
+/** Whether a node type may be shared between identical expressions.
+    Nodes that are modified after creation must not be.
+*/
+template <typename TreeNodeType>
+struct TreeNodeIsShared : std::true_type {};
+template <>
+struct TreeNodeIsShared<TreeNodeMultipleParents> : std::false_type {};
+
+/** Owns tree nodes, bump-allocated from large blocks, together with the
+    hash-consing table used to share structurally identical nodes. Since
+    children are shared too, a node is identified by its type and its
+    constructor arguments (child pointers and values). Everything is
+    released at once when the arena is reset or destroyed.
+*/
+class TreeArena {
 private:
+    struct Key {
+        const std::type_info *type;
+        size_t count;
+        uint64_t words[3];
+
+        bool operator == (const Key &other) const;
+    };
+    struct KeyHash {
+        size_t operator () (const Key &key) const;
+    };
+    enum { BLOCK_SIZE = 64 * 1024 };
+
+    std::vector<char *> blocks;
+    size_t blockUsed;
     std::vector<TreeNode *> trees;
-    std::map<int, TreeNodeRegister *> regTrees;
-    std::map<Register, TreeNodePhysicalRegister *> regPhysicalTrees;
+    std::unordered_map<Key, TreeNode *, KeyHash> table;
+public:
+    TreeArena() : blockUsed(BLOCK_SIZE) {}
+    ~TreeArena() { reset(); }
+    TreeArena(const TreeArena &) = delete;
+    TreeArena &operator = (const TreeArena &) = delete;
+
+    template <typename TreeNodeType, typename... Args>
+    TreeNodeType *make(Args... args) {
+        return TreeNodeIsShared<TreeNodeType>::value
+            ? makeShared<TreeNodeType>(args...)
+            : makeNew<TreeNodeType>(args...);
+    }
+
+    /** Destroys every node made so far. */
+    void reset();
+    size_t getCount() const { return trees.size(); }
+private:
+    template <typename TreeNodeType, typename... Args>
+    TreeNodeType *makeNew(Args... args) {
+        auto node = new (allocate(sizeof(TreeNodeType))) TreeNodeType(args...);
+        trees.push_back(node);
+        return node;
+    }
+    template <typename TreeNodeType, typename... Args>
+    TreeNodeType *makeShared(Args... args) {
+        static_assert(sizeof...(Args) <= 3, "too many node arguments");
+        Key key = {&typeid(TreeNodeType), 0, {}};
+        addToKey(key, args...);
+
+        auto it = table.find(key);
+        if(it != table.end()) return static_cast<TreeNodeType *>(it->second);
+
+        auto node = makeNew<TreeNodeType>(args...);
+        table.emplace(key, node);
+        return node;
+    }
+
+    static void addToKey(Key &key) {}
+    template <typename Arg, typename... Args>
+    static void addToKey(Key &key, Arg arg, Args... args) {
+        key.words[key.count ++] = keyWord(arg, std::is_pointer<Arg>());
+        addToKey(key, args...);
+    }
+    template <typename Arg>
+    static uint64_t keyWord(Arg arg, std::true_type)
+        { return reinterpret_cast<uintptr_t>(arg); }
+    template <typename Arg>
+    static uint64_t keyWord(Arg arg, std::false_type)
+        { return static_cast<uint64_t>(arg); }
+
+    void *allocate(size_t size);
+};
+
+/** Makes tree nodes in the current arena of the calling thread. Each
+    thread has its own factory, so analyses can run in parallel; by
+    default nodes go to a per-thread arena which clean() releases.
+*/
+class TreeFactory {
+private:
+    TreeArena defaultArena;
+    TreeArena *arena;
 
 public:
     static TreeFactory& instance();
 
     template <typename TreeNodeType, typename... Args>
     TreeNodeType *make(Args... args) {
-        TreeNodeType *n = new TreeNodeType(args...);
-        trees.push_back(n);
-        return n;
+        return arena->make<TreeNodeType>(args...);
     }
 
+    TreeArena *getArena() const { return arena; }
+    /** Directs new nodes to the given arena (or the default one). */
+    void setArena(TreeArena *arena)
+        { this->arena = arena ? arena : &defaultArena; }
+
     void clean();
-    void cleanAll();
 
 private:
-    TreeFactory() {}
+    TreeFactory() : arena(&defaultArena) {}
     ~TreeFactory() {}
     TreeFactory& operator=(const TreeFactory&);
     TreeFactory(const TreeFactory&);
-
-    TreeNodeRegister *makeTreeNodeRegister(int reg);
-    TreeNodePhysicalRegister *makeTreeNodePhysicalRegister(
-        Register reg, int width);
-};
-
-template <>
-inline TreeNodeRegister *TreeFactory::make(int reg) {
-    return makeTreeNodeRegister(reg);
 };
 
-template <>
-inline TreeNodePhysicalRegister *TreeFactory::make(Register reg, int width) {
-    return makeTreeNodePhysicalRegister(reg, width);
+/** Directs this thread's new tree nodes into an arena for a scope. */
+class TreeArenaScope {
+private:
+    TreeArena *previous;
+public:
+    TreeArenaScope(TreeArena *arena)
+        : previous(TreeFactory::instance().getArena())
+        { if(arena) TreeFactory::instance().setArena(arena); }
+    ~TreeArenaScope() { TreeFactory::instance().setArena(previous); }
 };
 
 #endif
@@ -11,10 +11,6 @@
 #include "chunk/dump.h"
 #include "log/log.h"
 
-DefList::~DefList() {
-    for(auto tn : list) delete tn.second;
-}
-
 void DefList::set(int reg, TreeNode *tree) {
     list[reg] = tree;
 }
@@ -261,6 +257,10 @@ UDConfiguration::UDConfiguration(ControlFlowGraph *cfg,
     else {
         allEnabled = false;
         for(auto id : idList) {
+            if(id < 0) continue;
+            if(static_cast<size_t>(id) >= enabled.size()) {
+                enabled.resize(id + 1);
+            }
             enabled[id] = true;
         }
     }
@@ -269,11 +269,8 @@ UDConfiguration::UDConfiguration(ControlFlowGraph *cfg,
 bool UDConfiguration::isEnabled(int id) const {
     if(allEnabled) return true;
 
-    auto it = enabled.find(id);
-    if(it != enabled.end()) {
-        return true;
-    }
-    return false;
+    return id >= 0 && static_cast<size_t>(id) < enabled.size()
+        && enabled[id];
 }
 
 void UDWorkingSet::transitionTo(ControlFlowNode *node) {
@@ -474,6 +471,9 @@ const std::map<int, UseDef::HandlerType> UseDef::handlers = {
 };
 
 void UseDef::analyze(const std::vector<std::vector<int>>& order) {
+    // trees built for this function live as long as its working set
+    TreeArenaScope arenaScope(working->getArena());
+
     LOG(10, "full order:");
     for(auto o : order) {
         LOG0(10, "{");
@@ -526,6 +526,23 @@ void UseDef::analyzeGraph(const std::vector<int>& order) {
     }
 }
 
+UseDef::HandlerType UseDef::getHandler(int id) {
+    // dense table indexed by instruction id, built once from handlers
+    static const std::vector<HandlerType> table = [] () {
+        std::vector<HandlerType> table;
+        if(!handlers.empty()) {
+            table.resize(handlers.rbegin()->first + 1, nullptr);
+        }
+        for(const auto &handler : handlers) {
+            table[handler.first] = handler.second;
+        }
+        return table;
+    }();
+
+    if(id < 0 || static_cast<size_t>(id) >= table.size()) return nullptr;
+    return table[id];
+}
+
 bool UseDef::callIfEnabled(UDState *state, Instruction *instruction) {
 #ifdef ARCH_X86_64
     #define INVALID_ID  X86_INS_INVALID
@@ -534,7 +551,8 @@ bool UseDef::callIfEnabled(UDState *state, Instruction *instruction) {
 #elif defined(ARCH_RISCV)
     #define INVALID_ID rv_op_illegal
 #endif
-    AssemblyPtr assembly = instruction->getSemantic()->getAssembly();
+    // the semantic keeps its assembly alive; avoid holding another reference
+    const Assembly *assembly = instruction->getSemantic()->getAssembly().get();
     int id = INVALID_ID;
     if(assembly) {
         id = assembly->getId();
@@ -551,9 +569,7 @@ bool UseDef::callIfEnabled(UDState *state, Instruction *instruction) {
 
     bool handled = false;
     if(config->isEnabled(id)) {
-        auto it = handlers.find(id);
-        if(it != handlers.end()) {
-            auto f = it->second;
+        if(auto f = getHandler(id)) {
             (this->*f)(state, assembly);
             handled = true;
         }
@@ -612,7 +628,8 @@ void UseDef::useReg(UDState *state, int reg) {
     if(working->getRegSet(reg).empty()
         && working->shouldTrackPartialUDChains()) {
 
-        defReg(state, reg, new TreeNodeRegister(reg));
+        defReg(state, reg,
+            TreeFactory::instance().make<TreeNodeRegister>(reg));
     }
     else {
         for(auto o : working->getRegSet(reg)) {
@@ -688,11 +705,11 @@ TreeNode *UseDef::shiftExtend(TreeNode *tree, arm64_shifter type,
     return tree;
 }
 
-void UseDef::fillImm(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillImm(UDState *state, const Assembly *assembly) {
     throw "NYI: fillImm";
 }
 
-void UseDef::fillReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
@@ -700,7 +717,7 @@ void UseDef::fillReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_X86_64
     int reg0, reg1;
     size_t width0, width1;
@@ -815,7 +832,7 @@ void UseDef::fillRegToReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
+void UseDef::fillMemToReg(UDState *state, const Assembly *assembly, size_t width) {
 #ifdef ARCH_X86_64
     auto mem = assembly->getAsmOperands()->getOperands()[0].mem;
     int reg1;
@@ -950,7 +967,7 @@ void UseDef::fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width) {
 #endif
 }
 
-void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillImmToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_X86_64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].imm;
     auto op1 = assembly->getAsmOperands()->getOperands()[1].reg;
@@ -1042,7 +1059,7 @@ void UseDef::fillImmToReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegRegToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
@@ -1141,7 +1158,7 @@ void UseDef::fillRegRegToReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillMemImmToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMemImmToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     assert(assembly->isPostIndex());
 
@@ -1177,7 +1194,7 @@ void UseDef::fillMemImmToReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
+void UseDef::fillRegToMem(UDState *state, const Assembly *assembly, size_t width) {
 #ifdef ARCH_X86_64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0;
@@ -1292,7 +1309,7 @@ void UseDef::fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width) {
 #endif
 }
 
-void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegImmToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
@@ -1355,7 +1372,6 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
                 reg1tree, immtree);
         }
         else {
-            delete reg1tree;
             tree = immtree;
         }
         break;
@@ -1368,7 +1384,6 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
                 reg1tree, immtree);
         }
         else {
-            delete reg1tree;
             tree = immtree;
         }
         break;
@@ -1410,7 +1425,7 @@ void UseDef::fillRegImmToReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillMemToRegReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMemToRegReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     assert(!assembly->isPostIndex());
 
@@ -1455,7 +1470,7 @@ void UseDef::fillMemToRegReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegRegToMem(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegRegToMem(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     assert(!assembly->isPostIndex());
 
@@ -1495,7 +1510,7 @@ void UseDef::fillRegRegToMem(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegRegImmToMem(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegRegImmToMem(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     assert(assembly->isPostIndex());
 
@@ -1535,7 +1550,7 @@ void UseDef::fillRegRegImmToMem(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillMemImmToRegReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMemImmToRegReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     assert(assembly->isPostIndex());
 
@@ -1580,7 +1595,7 @@ void UseDef::fillMemImmToRegReg(UDState *state, AssemblyPtr assembly) {
 #endif
 }
 
-void UseDef::fillRegRegRegToReg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRegRegRegToReg(UDState *state, const Assembly *assembly) {
 #ifdef ARCH_AARCH64
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
@@ -1692,7 +1707,7 @@ TreeNode *UseDef::makeMemTree(UDState *state, const x86_op_mem& mem) {
     }
     return memTree;
 }
-void UseDef::fillAddOrSubOrShift(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAddOrSubOrShift(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_IMM_REG) {
         fillImmToReg(state, assembly);
@@ -1709,7 +1724,7 @@ void UseDef::fillAddOrSubOrShift(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillAnd(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAnd(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_IMM_REG) {
         fillImmToReg(state, assembly);
@@ -1718,7 +1733,7 @@ void UseDef::fillAnd(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillBsf(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillBsf(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         int reg0, reg1;
@@ -1733,7 +1748,7 @@ void UseDef::fillBsf(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillBt(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillBt(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         int reg0, reg1;
@@ -1764,7 +1779,7 @@ void UseDef::fillBt(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillCall(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCall(UDState *state, const Assembly *assembly) {
     for(int i = 0; i < 3; i++) {
         useReg(state, i);
         defReg(state, i, nullptr);
@@ -1774,7 +1789,7 @@ void UseDef::fillCall(UDState *state, AssemblyPtr assembly) {
         defReg(state, i, nullptr);
     }
 }
-void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCmp(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         int reg0, reg1;
@@ -1823,7 +1838,7 @@ void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillInc(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillInc(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG) {
         int reg0;
@@ -1843,47 +1858,47 @@ void UseDef::fillInc(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillJa(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJa(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJae(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJae(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJb(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJb(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJbe(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJbe(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJe(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJe(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJne(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJne(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJg(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJg(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJge(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJge(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJl(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJl(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJle(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJle(UDState *state, const Assembly *assembly) {
     useReg(state, X86Register::FLAGS);
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillJmp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJmp(UDState *state, const Assembly *assembly) {
     auto semantic = state->getInstruction()->getSemantic();
     if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
         if(ij->getRegister() != X86_REG_RIP) {
@@ -1911,7 +1926,7 @@ void UseDef::fillJmp(UDState *state, AssemblyPtr assembly) {
 #endif
     //LOG(1, "does this instruction use/def any other registers?");
 }
-void UseDef::fillLea(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLea(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_MEM_REG) {
         size_t width = inferAccessWidth(
@@ -1922,7 +1937,7 @@ void UseDef::fillLea(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillMov(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMov(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         size_t width = inferAccessWidth(
@@ -1944,7 +1959,7 @@ void UseDef::fillMov(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillMovabs(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMovabs(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     assert(mode == AssemblyOperands::MODE_IMM_REG);
     if(mode == AssemblyOperands::MODE_IMM_REG) {
@@ -1954,13 +1969,13 @@ void UseDef::fillMovabs(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillMovsxd(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMovsxd(UDState *state, const Assembly *assembly) {
     fillMov(state, assembly);
 }
-void UseDef::fillMovzx(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMovzx(UDState *state, const Assembly *assembly) {
     fillMov(state, assembly);
 }
-void UseDef::fillSyscall(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillSyscall(UDState *state, const Assembly *assembly) {
     // On Linux, syscall uses rax as the syscall number, and then rdi, rsi,
     // rdx, r10, r8, r9 as the arguments.
     useReg(state, X86Register::convertToPhysical(X86_REG_RAX));
@@ -1977,11 +1992,11 @@ void UseDef::fillSyscall(UDState *state, AssemblyPtr assembly) {
     defReg(state, X86Register::convertToPhysical(X86_REG_RCX), nullptr);
     defReg(state, X86Register::convertToPhysical(X86_REG_R11), nullptr);
 }
-void UseDef::fillTest(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillTest(UDState *state, const Assembly *assembly) {
     defReg(state, X86Register::FLAGS, nullptr);
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
-void UseDef::fillPush(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillPush(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG) {
         size_t width = inferAccessWidth(
@@ -1992,7 +2007,7 @@ void UseDef::fillPush(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillXor(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillXor(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
@@ -2010,7 +2025,7 @@ void UseDef::fillXor(UDState *state, AssemblyPtr assembly) {
 #endif
 
 #ifdef ARCH_AARCH64
-void UseDef::fillAddOrSub(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAddOrSub(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_IMM) {
         fillRegImmToReg(state, assembly);
@@ -2022,13 +2037,13 @@ void UseDef::fillAddOrSub(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillAdr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAdr(UDState *state, const Assembly *assembly) {
     fillImmToReg(state, assembly);
 }
-void UseDef::fillAdrp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAdrp(UDState *state, const Assembly *assembly) {
     fillImmToReg(state, assembly);
 }
-void UseDef::fillAnd(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillAnd(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_IMM) {
         fillRegImmToReg(state, assembly);
@@ -2040,12 +2055,12 @@ void UseDef::fillAnd(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillB(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillB(UDState *state, const Assembly *assembly) {
     if(assembly->getMnemonic() != "b") {
         useReg(state, AARCH64GPRegister::NZCV);
     }
 }
-void UseDef::fillBl(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillBl(UDState *state, const Assembly *assembly) {
     for(int i = 0; i < 19; i++) {
         useReg(state, i);
         defReg(state, i, nullptr);
@@ -2057,7 +2072,7 @@ void UseDef::fillBl(UDState *state, AssemblyPtr assembly) {
         defReg(state, 17, nullptr);
     }
 }
-void UseDef::fillBlr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillBlr(UDState *state, const Assembly *assembly) {
     fillReg(state, assembly);
 
     for(int i = 0; i < 9; i++) {
@@ -2069,7 +2084,7 @@ void UseDef::fillBlr(UDState *state, AssemblyPtr assembly) {
     }
     defReg(state, 30, nullptr);
 }
-void UseDef::fillBr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillBr(UDState *state, const Assembly *assembly) {
     fillReg(state, assembly);
 
     auto instr = state->getInstruction();
@@ -2084,7 +2099,7 @@ void UseDef::fillBr(UDState *state, AssemblyPtr assembly) {
         }
     }
 }
-void UseDef::fillCbz(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCbz(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2095,7 +2110,7 @@ void UseDef::fillCbz(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodeConstant>(0));
     defReg(state, AARCH64GPRegister::ONETIME_NZCV, tree);
 }
-void UseDef::fillCbnz(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCbnz(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2106,7 +2121,7 @@ void UseDef::fillCbnz(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodeConstant>(0));
     defReg(state, AARCH64GPRegister::ONETIME_NZCV, tree);
 }
-void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCmp(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2118,7 +2133,7 @@ void UseDef::fillCmp(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodeConstant>(imm));
     defReg(state, AARCH64GPRegister::NZCV, tree);
 }
-void UseDef::fillCsel(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCsel(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2127,7 +2142,7 @@ void UseDef::fillCsel(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI: " << assembly->getMnemonic());
 }
-void UseDef::fillCset(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillCset(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2136,7 +2151,7 @@ void UseDef::fillCset(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI: " << assembly->getMnemonic());
 }
-void UseDef::fillEor(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillEor(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2145,13 +2160,13 @@ void UseDef::fillEor(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
-void UseDef::fillFmov(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillFmov(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     defReg(state, reg0, nullptr);
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
-void UseDef::fillLdaxr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdaxr(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         size_t width = (assembly->getBytes()[3] & 0b01000000) ? 8 : 4;
@@ -2161,7 +2176,7 @@ void UseDef::fillLdaxr(UDState *state, AssemblyPtr assembly) {
         throw "unknown mode for LDAXR";
     }
 }
-void UseDef::fillLdp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdp(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_MEM) {
         fillMemToRegReg(state, assembly);
@@ -2173,7 +2188,7 @@ void UseDef::fillLdp(UDState *state, AssemblyPtr assembly) {
         throw "unknown mode for LDP";
     }
 }
-void UseDef::fillLdr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdr(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         size_t width = (assembly->getBytes()[3] & 0b01000000) ? 8 : 4;
@@ -2189,7 +2204,7 @@ void UseDef::fillLdr(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdrh(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdrh(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillMemToReg(state, assembly, 2);
@@ -2198,7 +2213,7 @@ void UseDef::fillLdrh(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdrb(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdrb(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillMemToReg(state, assembly, 1);
@@ -2207,7 +2222,7 @@ void UseDef::fillLdrb(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdrsw(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdrsw(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillMemToReg(state, assembly, 4);
@@ -2216,7 +2231,7 @@ void UseDef::fillLdrsw(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdrsh(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdrsh(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillMemToReg(state, assembly, 2);
@@ -2225,7 +2240,7 @@ void UseDef::fillLdrsh(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdrsb(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdrsb(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillMemToReg(state, assembly, 1);
@@ -2234,7 +2249,7 @@ void UseDef::fillLdrsb(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLdur(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLdur(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         size_t width = (assembly->getBytes()[3] & 0b01000000) ? 8 : 4;
@@ -2244,7 +2259,7 @@ void UseDef::fillLdur(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillLsl(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLsl(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_IMM) {
         fillRegImmToReg(state, assembly);
@@ -2256,7 +2271,7 @@ void UseDef::fillLsl(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillMadd(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMadd(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_REG_REG) {
         fillRegRegRegToReg(state, assembly);
@@ -2265,10 +2280,10 @@ void UseDef::fillMadd(UDState *state, AssemblyPtr assembly) {
         throw "unknown mode for Madd";
     }
 }
-void UseDef::fillNop(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillNop(UDState *state, const Assembly *assembly) {
     /* Nothing to do */
 }
-void UseDef::fillOrr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillOrr(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2277,7 +2292,7 @@ void UseDef::fillOrr(UDState *state, AssemblyPtr assembly) {
         TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
     LOG(10, "NYI (fully): " << assembly->getMnemonic());
 }
-void UseDef::fillMov(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMov(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         fillRegToReg(state, assembly);
@@ -2289,7 +2304,7 @@ void UseDef::fillMov(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillMrs(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillMrs(UDState *state, const Assembly *assembly) {
     auto op0 = assembly->getAsmOperands()->getOperands()[0].reg;
     int reg0 = AARCH64GPRegister::convertToPhysical(op0);
     size_t width0 = AARCH64GPRegister::getWidth(reg0, op0);
@@ -2297,12 +2312,12 @@ void UseDef::fillMrs(UDState *state, AssemblyPtr assembly) {
         reg0,
         TreeFactory::instance().make<TreeNodePhysicalRegister>(reg0, width0));
 }
-void UseDef::fillRet(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRet(UDState *state, const Assembly *assembly) {
     for(int i = 0; i < 8; i++) {
         useReg(state, i);
     }
 }
-void UseDef::fillStp(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillStp(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_MEM) {
         fillRegRegToMem(state, assembly);
@@ -2314,7 +2329,7 @@ void UseDef::fillStp(UDState *state, AssemblyPtr assembly) {
         throw "unknown mode for STP";
     }
 }
-void UseDef::fillStr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillStr(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         size_t width = (assembly->getBytes()[3] & 0b01000000) ? 8 : 4;
@@ -2324,7 +2339,7 @@ void UseDef::fillStr(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillStrb(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillStrb(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillRegToMem(state, assembly, 1);
@@ -2333,7 +2348,7 @@ void UseDef::fillStrb(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillStrh(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillStrh(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_MEM) {
         fillRegToMem(state, assembly, 2);
@@ -2342,7 +2357,7 @@ void UseDef::fillStrh(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillSxtw(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillSxtw(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG) {
         LOG(10, "NYI fully: " << assembly->getMnemonic());
@@ -2352,7 +2367,7 @@ void UseDef::fillSxtw(UDState *state, AssemblyPtr assembly) {
         LOG(10, "skipping mode " << mode);
     }
 }
-void UseDef::fillUbfiz(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillUbfiz(UDState *state, const Assembly *assembly) {
     auto mode = assembly->getAsmOperands()->getMode();
     if(mode == AssemblyOperands::MODE_REG_REG_IMM_IMM) {
         LOG(10, "NYI fully: " << assembly->getMnemonic());
@@ -2368,7 +2383,7 @@ void UseDef::fillUbfiz(UDState *state, AssemblyPtr assembly) {
 #endif
 
 #ifdef ARCH_RISCV
-void UseDef::fillB(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillB(UDState *state, const Assembly *assembly) {
     // mark relevant registers as used
     size_t count = assembly->getAsmOperands()->getOpCount();
     const rv_oper *opers = assembly->getAsmOperands()->getOperands();
@@ -2379,7 +2394,7 @@ void UseDef::fillB(UDState *state, AssemblyPtr assembly) {
     }
 }
 
-void UseDef::fillEins(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillEins(UDState *state, const Assembly *assembly) {
     if(assembly->getId() == rv_op_ecall) {
         // system call
         // syscall number in a7
@@ -2402,19 +2417,19 @@ void UseDef::fillEins(UDState *state, AssemblyPtr assembly) {
     }
 }
 
-void UseDef::fillFence(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillFence(UDState *state, const Assembly *assembly) {
     // nothing to do
 }
 
-void UseDef::fillJ(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJ(UDState *state, const Assembly *assembly) {
     // nothing to do
 }
 
-void UseDef::fillJal(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJal(UDState *state, const Assembly *assembly) {
     useReg(state, assembly->getAsmOperands()->getOperands()[0].value.reg);
 }
 
-void UseDef::fillJalr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJalr(UDState *state, const Assembly *assembly) {
     useReg(state, assembly->getAsmOperands()->getOperands()[1].value.reg);
     defReg(state, assembly->getAsmOperands()->getOperands()[0].value.reg,
         TreeFactory::instance().make<TreeNodeAddress>(
@@ -2422,15 +2437,15 @@ void UseDef::fillJalr(UDState *state, AssemblyPtr assembly) {
         ));
 }
 
-void UseDef::fillJr(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillJr(UDState *state, const Assembly *assembly) {
     useReg(state, assembly->getAsmOperands()->getOperands()[0].value.reg);
 }
 
-void UseDef::fillLoad(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillLoad(UDState *state, const Assembly *assembly) {
     fillMemToReg(state, assembly, -1);
 }
 
-void UseDef::fillRet(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillRet(UDState *state, const Assembly *assembly) {
     // return registers are {f,}a0/a1
     useReg(state, rv_ireg_a0);
     useReg(state, rv_ireg_a1);
@@ -2438,7 +2453,7 @@ void UseDef::fillRet(UDState *state, AssemblyPtr assembly) {
     useReg(state, rv_freg_fa1);
 }
 
-void UseDef::fillStore(UDState *state, AssemblyPtr assembly) {
+void UseDef::fillStore(UDState *state, const Assembly *assembly) {
     fillRegToMem(state, assembly, -1);
 }
 
@@ -5,6 +5,7 @@
 #include <map>
 #include "controlflow.h"
 #include "slicingmatch.h"
+#include "slicingtree.h"
 #include "instr/register.h"
 #include "instr/assembly.h"
 
@@ -15,14 +16,62 @@ class TreeNode;
 
 class UDState;
 
+/** Map from register number to a value, stored as a vector sorted by
+    register. Each state only touches a handful of registers, so this
+    avoids std::map's per-node allocations and pointer chasing while
+    keeping the same (ordered) iteration.
+*/
+template <typename ValueType>
+class RegisterMap {
+public:
+    typedef std::pair<int, ValueType> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+private:
+    std::vector<value_type> list;
+public:
+    iterator find(int reg) {
+        auto it = lowerBound(reg);
+        return (it != list.end() && it->first == reg) ? it : list.end();
+    }
+    const_iterator find(int reg) const {
+        auto it = const_cast<RegisterMap *>(this)->lowerBound(reg);
+        return (it != list.end() && it->first == reg) ? it : list.cend();
+    }
+    ValueType &operator [] (int reg) {
+        auto it = lowerBound(reg);
+        if(it == list.end() || it->first != reg) {
+            it = list.insert(it, value_type(reg, ValueType()));
+        }
+        return it->second;
+    }
+    void erase(int reg) {
+        auto it = find(reg);
+        if(it != list.end()) list.erase(it);
+    }
+    void clear() { list.clear(); }
+    size_t size() const { return list.size(); }
+
+    iterator begin() { return list.begin(); }
+    iterator end() { return list.end(); }
+    const_iterator begin() const { return list.cbegin(); }
+    const_iterator end() const { return list.cend(); }
+    const_iterator cbegin() const { return list.cbegin(); }
+    const_iterator cend() const { return list.cend(); }
+private:
+    iterator lowerBound(int reg) {
+        auto it = list.begin();
+        while(it != list.end() && it->first < reg) ++it;
+        return it;
+    }
+};
 
 // Must
 class DefList {
 private:
-    typedef std::map<int, TreeNode *> ListType;
+    typedef RegisterMap<TreeNode *> ListType;
     ListType list;
 public:
-    ~DefList();
     void set(int reg, TreeNode *tree);
     void del(int reg);
     TreeNode *get(int reg) const;
@@ -40,7 +89,7 @@ public:
 // May: evaluation must be delayed until all use-defs are determined
 class RefList {
 private:
-    typedef std::map<int, std::vector<UDState *>> ListType;
+    typedef RegisterMap<std::vector<UDState *>> ListType;
     ListType list;
 public:
     void set(int reg, UDState *origin);
@@ -63,7 +112,7 @@ public:
 // May
 class UseList {
 private:
-    typedef std::map<int, std::vector<UDState *>> ListType;
+    typedef RegisterMap<std::vector<UDState *>> ListType;
     ListType list;
 public:
     void add(int reg, UDState *state);
@@ -246,7 +295,7 @@ class UDConfiguration {
 private:
     ControlFlowGraph *cfg;
     bool allEnabled;
-    std::map<int, bool> enabled;
+    std::vector<bool> enabled;  // indexed by instruction id
     bool trackPartialUDChains;
 
 public:
@@ -297,10 +346,13 @@ public:
 
     virtual UDState *getState(Instruction *instruction)
         { return nullptr; }
+    /** Where trees made during analysis are kept, if not the default. */
+    virtual TreeArena *getArena() { return nullptr; }
 };
 
 class UDRegMemWorkingSet : public UDWorkingSet {
 private:
+    TreeArena arena;  // owns every tree in stateList
     Function *function;
     ControlFlowGraph *cfg;
     std::map<Instruction *, size_t> stateListIndex;
@@ -312,6 +364,7 @@ public:
     virtual ~UDRegMemWorkingSet() {}
 
     virtual UDState *getState(Instruction *instruction);
+    virtual TreeArena *getArena() { return &arena; }
     const StateListType &getStateList() const { return stateList; }
     Function *getFunction() const { return function; }
     ControlFlowGraph *getCFG() const { return cfg; }
@@ -319,13 +372,14 @@ public:
 
 class UseDef {
 public:
-    typedef void (UseDef::*HandlerType)(UDState *state, AssemblyPtr assembly);
+    typedef void (UseDef::*HandlerType)(UDState *state, const Assembly *assembly);
 
 private:
     UDConfiguration *config;
     UDWorkingSet *working;
 
     const static std::map<int, HandlerType> handlers;
+    static HandlerType getHandler(int id);
 
 public:
     UseDef(UDConfiguration *config, UDWorkingSet *working)
@@ -344,20 +398,20 @@ private:
     void fillState(UDState *state);
     bool callIfEnabled(UDState *state, Instruction *instruction);
 
-    void fillImm(UDState *state, AssemblyPtr assembly);
-    void fillReg(UDState *state, AssemblyPtr assembly);
-    void fillRegToReg(UDState *state, AssemblyPtr assembly);
-    void fillMemToReg(UDState *state, AssemblyPtr assembly, size_t width);
-    void fillImmToReg(UDState *state, AssemblyPtr assembly);
-    void fillRegRegToReg(UDState *state, AssemblyPtr assembly);
-    void fillMemImmToReg(UDState *state, AssemblyPtr assembly);
-    void fillRegToMem(UDState *state, AssemblyPtr assembly, size_t width);
-    void fillRegImmToReg(UDState *state, AssemblyPtr assembly);
-    void fillRegRegToMem(UDState *state, AssemblyPtr assembly);
-    void fillMemToRegReg(UDState *state, AssemblyPtr assembly);
-    void fillRegRegImmToMem(UDState *state, AssemblyPtr assembly);
-    void fillRegRegRegToReg(UDState *state, AssemblyPtr assembly);
-    void fillMemImmToRegReg(UDState *state, AssemblyPtr assembly);
+    void fillImm(UDState *state, const Assembly *assembly);
+    void fillReg(UDState *state, const Assembly *assembly);
+    void fillRegToReg(UDState *state, const Assembly *assembly);
+    void fillMemToReg(UDState *state, const Assembly *assembly, size_t width);
+    void fillImmToReg(UDState *state, const Assembly *assembly);
+    void fillRegRegToReg(UDState *state, const Assembly *assembly);
+    void fillMemImmToReg(UDState *state, const Assembly *assembly);
+    void fillRegToMem(UDState *state, const Assembly *assembly, size_t width);
+    void fillRegImmToReg(UDState *state, const Assembly *assembly);
+    void fillRegRegToMem(UDState *state, const Assembly *assembly);
+    void fillMemToRegReg(UDState *state, const Assembly *assembly);
+    void fillRegRegImmToMem(UDState *state, const Assembly *assembly);
+    void fillRegRegRegToReg(UDState *state, const Assembly *assembly);
+    void fillMemImmToRegReg(UDState *state, const Assembly *assembly);
 
     void defReg(UDState *state, int reg, TreeNode *tree);
     void useReg(UDState *state, int reg);
@@ -371,87 +425,87 @@ private:
     size_t inferAccessWidth(const cs_x86_op *op);
     std::tuple<int, size_t> getPhysicalRegister(int reg);
     TreeNode *makeMemTree(UDState *state, const x86_op_mem& mem);
-    void fillAddOrSubOrShift(UDState *state, AssemblyPtr assembly);
-    void fillAnd(UDState *state, AssemblyPtr assembly);
-    void fillBsf(UDState *state, AssemblyPtr assembly);
-    void fillBt(UDState *state, AssemblyPtr assembly);
-    void fillCall(UDState *state, AssemblyPtr assembly);
-    void fillCmp(UDState *state, AssemblyPtr assembly);
-    void fillInc(UDState *state, AssemblyPtr assembly);
-    void fillJa(UDState *state, AssemblyPtr assembly);
-    void fillJae(UDState *state, AssemblyPtr assembly);
-    void fillJb(UDState *state, AssemblyPtr assembly);
-    void fillJbe(UDState *state, AssemblyPtr assembly);
-    void fillJe(UDState *state, AssemblyPtr assembly);
-    void fillJne(UDState *state, AssemblyPtr assembly);
-    void fillJg(UDState *state, AssemblyPtr assembly);
-    void fillJge(UDState *state, AssemblyPtr assembly);
-    void fillJl(UDState *state, AssemblyPtr assembly);
-    void fillJle(UDState *state, AssemblyPtr assembly);
-    void fillJmp(UDState *state, AssemblyPtr assembly);
-    void fillLea(UDState *state, AssemblyPtr assembly);
-    void fillMov(UDState *state, AssemblyPtr assembly);
-    void fillMovabs(UDState *state, AssemblyPtr assembly);
-    void fillMovsxd(UDState *state, AssemblyPtr assembly);
-    void fillMovzx(UDState *state, AssemblyPtr assembly);
-    void fillSyscall(UDState *state, AssemblyPtr assembly);
-    void fillTest(UDState *state, AssemblyPtr assembly);
-    void fillPush(UDState *state, AssemblyPtr assembly);
-    void fillXor(UDState *state, AssemblyPtr assembly);
+    void fillAddOrSubOrShift(UDState *state, const Assembly *assembly);
+    void fillAnd(UDState *state, const Assembly *assembly);
+    void fillBsf(UDState *state, const Assembly *assembly);
+    void fillBt(UDState *state, const Assembly *assembly);
+    void fillCall(UDState *state, const Assembly *assembly);
+    void fillCmp(UDState *state, const Assembly *assembly);
+    void fillInc(UDState *state, const Assembly *assembly);
+    void fillJa(UDState *state, const Assembly *assembly);
+    void fillJae(UDState *state, const Assembly *assembly);
+    void fillJb(UDState *state, const Assembly *assembly);
+    void fillJbe(UDState *state, const Assembly *assembly);
+    void fillJe(UDState *state, const Assembly *assembly);
+    void fillJne(UDState *state, const Assembly *assembly);
+    void fillJg(UDState *state, const Assembly *assembly);
+    void fillJge(UDState *state, const Assembly *assembly);
+    void fillJl(UDState *state, const Assembly *assembly);
+    void fillJle(UDState *state, const Assembly *assembly);
+    void fillJmp(UDState *state, const Assembly *assembly);
+    void fillLea(UDState *state, const Assembly *assembly);
+    void fillMov(UDState *state, const Assembly *assembly);
+    void fillMovabs(UDState *state, const Assembly *assembly);
+    void fillMovsxd(UDState *state, const Assembly *assembly);
+    void fillMovzx(UDState *state, const Assembly *assembly);
+    void fillSyscall(UDState *state, const Assembly *assembly);
+    void fillTest(UDState *state, const Assembly *assembly);
+    void fillPush(UDState *state, const Assembly *assembly);
+    void fillXor(UDState *state, const Assembly *assembly);
 #endif
 
 #ifdef ARCH_AARCH64
-    void fillAddOrSub(UDState *state, AssemblyPtr assembly);
-    void fillAdr(UDState *state, AssemblyPtr assembly);
-    void fillAdrp(UDState *state, AssemblyPtr assembly);
-    void fillAnd(UDState *state, AssemblyPtr assembly);
-    void fillBl(UDState *state, AssemblyPtr assembly);
-    void fillBlr(UDState *state, AssemblyPtr assembly);
-    void fillB(UDState *state, AssemblyPtr assembly);
-    void fillBr(UDState *state, AssemblyPtr assembly);
-    void fillCbz(UDState *state, AssemblyPtr assembly);
-    void fillCbnz(UDState *state, AssemblyPtr assembly);
-    void fillCmp(UDState *state, AssemblyPtr assembly);
-    void fillCsel(UDState *state, AssemblyPtr assembly);
-    void fillCset(UDState *state, AssemblyPtr assembly);
-    void fillEor(UDState *state, AssemblyPtr assembly);
-    void fillFmov(UDState *state, AssemblyPtr assembly);
-    void fillLdaxr(UDState *state, AssemblyPtr assembly);
-    void fillLdp(UDState *state, AssemblyPtr assembly);
-    void fillLdr(UDState *state, AssemblyPtr assembly);
-    void fillLdrh(UDState *state, AssemblyPtr assembly);
-    void fillLdrb(UDState *state, AssemblyPtr assembly);
-    void fillLdrsw(UDState *state, AssemblyPtr assembly);
-    void fillLdrsh(UDState *state, AssemblyPtr assembly);
-    void fillLdrsb(UDState *state, AssemblyPtr assembly);
-    void fillLdur(UDState *state, AssemblyPtr assembly);
-    void fillLsl(UDState *state, AssemblyPtr assembly);
-    void fillMadd(UDState *state, AssemblyPtr assembly);
-    void fillMov(UDState *state, AssemblyPtr assembly);
-    void fillMrs(UDState *state, AssemblyPtr assembly);
-    void fillNop(UDState *state, AssemblyPtr assembly);
-    void fillOrr(UDState *state, AssemblyPtr assembly);
-    void fillRet(UDState *state, AssemblyPtr assembly);
-    void fillStp(UDState *state, AssemblyPtr assembly);
-    void fillStr(UDState *state, AssemblyPtr assembly);
-    void fillStrb(UDState *state, AssemblyPtr assembly);
-    void fillStrh(UDState *state, AssemblyPtr assembly);
-    void fillSxtw(UDState *state, AssemblyPtr assembly);
-    void fillUbfiz(UDState *state, AssemblyPtr assembly);
+    void fillAddOrSub(UDState *state, const Assembly *assembly);
+    void fillAdr(UDState *state, const Assembly *assembly);
+    void fillAdrp(UDState *state, const Assembly *assembly);
+    void fillAnd(UDState *state, const Assembly *assembly);
+    void fillBl(UDState *state, const Assembly *assembly);
+    void fillBlr(UDState *state, const Assembly *assembly);
+    void fillB(UDState *state, const Assembly *assembly);
+    void fillBr(UDState *state, const Assembly *assembly);
+    void fillCbz(UDState *state, const Assembly *assembly);
+    void fillCbnz(UDState *state, const Assembly *assembly);
+    void fillCmp(UDState *state, const Assembly *assembly);
+    void fillCsel(UDState *state, const Assembly *assembly);
+    void fillCset(UDState *state, const Assembly *assembly);
+    void fillEor(UDState *state, const Assembly *assembly);
+    void fillFmov(UDState *state, const Assembly *assembly);
+    void fillLdaxr(UDState *state, const Assembly *assembly);
+    void fillLdp(UDState *state, const Assembly *assembly);
+    void fillLdr(UDState *state, const Assembly *assembly);
+    void fillLdrh(UDState *state, const Assembly *assembly);
+    void fillLdrb(UDState *state, const Assembly *assembly);
+    void fillLdrsw(UDState *state, const Assembly *assembly);
+    void fillLdrsh(UDState *state, const Assembly *assembly);
+    void fillLdrsb(UDState *state, const Assembly *assembly);
+    void fillLdur(UDState *state, const Assembly *assembly);
+    void fillLsl(UDState *state, const Assembly *assembly);
+    void fillMadd(UDState *state, const Assembly *assembly);
+    void fillMov(UDState *state, const Assembly *assembly);
+    void fillMrs(UDState *state, const Assembly *assembly);
+    void fillNop(UDState *state, const Assembly *assembly);
+    void fillOrr(UDState *state, const Assembly *assembly);
+    void fillRet(UDState *state, const Assembly *assembly);
+    void fillStp(UDState *state, const Assembly *assembly);
+    void fillStr(UDState *state, const Assembly *assembly);
+    void fillStrb(UDState *state, const Assembly *assembly);
+    void fillStrh(UDState *state, const Assembly *assembly);
+    void fillSxtw(UDState *state, const Assembly *assembly);
+    void fillUbfiz(UDState *state, const Assembly *assembly);
 #endif
 
 #ifdef ARCH_RISCV
-    void fillB(UDState *state, AssemblyPtr assembly);
-    void fillConditionalStore(UDState *state, AssemblyPtr assembly);
-    void fillEins(UDState *state, AssemblyPtr assembly);
-    void fillFence(UDState *state, AssemblyPtr assembly);
-    void fillJ(UDState *state, AssemblyPtr assembly);
-    void fillJal(UDState *state, AssemblyPtr assembly);
-    void fillJalr(UDState *state, AssemblyPtr assembly);
-    void fillJr(UDState *state, AssemblyPtr assembly);
-    void fillLoad(UDState *state, AssemblyPtr assembly);
-    void fillRet(UDState *state, AssemblyPtr assembly);
-    void fillStore(UDState *state, AssemblyPtr assembly);
+    void fillB(UDState *state, const Assembly *assembly);
+    void fillConditionalStore(UDState *state, const Assembly *assembly);
+    void fillEins(UDState *state, const Assembly *assembly);
+    void fillFence(UDState *state, const Assembly *assembly);
+    void fillJ(UDState *state, const Assembly *assembly);
+    void fillJal(UDState *state, const Assembly *assembly);
+    void fillJalr(UDState *state, const Assembly *assembly);
+    void fillJr(UDState *state, const Assembly *assembly);
+    void fillLoad(UDState *state, const Assembly *assembly);
+    void fillRet(UDState *state, const Assembly *assembly);
+    void fillStore(UDState *state, const Assembly *assembly);
 #endif
 };
 
@@ -9,6 +9,13 @@
 #include "log/temp.h"
 #include "chunk/dump.h"
 
+static bool isWithin(Chunk *chunk, ChunkRef target) {
+    for(Chunk *c = target; c; c = c->getParent()) {
+        if(c == chunk) return true;
+    }
+    return false;
+}
+
 void ChunkCache::make(Chunk *chunk) {
     //TemporaryLogLevel tll("chunk", 10);
     //TemporaryLogLevel tll2("disasm", 10);
@@ -16,36 +23,116 @@ void ChunkCache::make(Chunk *chunk) {
     LOG(10, "fixups for ChunkCache::make " << chunk->getName());
 #ifdef ARCH_X86_64
     this->address = chunk->getAddress();
+    data.reserve(chunk->getSize());
     InstrWriterCppString writer(data);
     for(auto b : chunk->getChildren()->genericIterable()) {
         auto block = dynamic_cast<Block *>(b);
         for(auto i : CIter::children(block)) {
             auto semantic = i->getSemantic();
             semantic->accept(&writer);
-            if(auto link = semantic->getLink()) {
-                if(dynamic_cast<DataOffsetLink *>(link)) {
-                    auto v = dynamic_cast<LinkedInstruction *>(semantic);
-                    assert(v);
-
-                    fixups.push_back(i->getAddress() + v->getDispOffset()
-                        - chunk->getAddress());
-                    IF_LOG(10) {
-                        ChunkDumper d;
-                        i->accept(&d);
-                    }
-                }
+
+            auto link = semantic->getLink();
+            if(!link) continue;
+
+            if(auto v = dynamic_cast<LinkedInstructionBase *>(semantic)) {
+                makeFixup(chunk, i, link, v->getDispOffset(),
+                    v->getDispSize());
+            }
+            else if(auto v = dynamic_cast<ControlFlowInstruction *>(
+                semantic)) {
+
+                makeFixup(chunk, i, link, v->getDispOffset(),
+                    v->getDisplacementSize());
+            }
+            else {
+                LOG(1, "ChunkCache: unknown linked semantic in "
+                    << chunk->getName());
+                usable = false;
             }
         }
     }
+#else
+    usable = false;
 #endif
 }
 
+void ChunkCache::makeFixup(Chunk *chunk, Instruction *instr, Link *link,
+    size_t dispOffset, size_t dispSize) {
+
+    if(dynamic_cast<ImmAndDispLink *>(link)) {
+        LOG(1, "ChunkCache: can't cache ImmAndDispLink in "
+            << chunk->getName());
+        usable = false;
+        return;
+    }
+
+    Fixup fixup;
+    fixup.offset = instr->getAddress() + dispOffset - chunk->getAddress();
+    fixup.end = instr->getAddress() + instr->getSize() - chunk->getAddress();
+    fixup.size = dispSize;
+    fixup.link = link;
+
+    bool isData = (dynamic_cast<DataOffsetLinkBase *>(link) != nullptr);
+    if(link->isRIPRelative()) {
+        // code that moves along with this chunk keeps the same displacement
+        if(isWithin(chunk, link->getTarget())) return;
+
+        if(isData && dispSize == 4) {
+            fixups.push_back(fixup.offset);
+            IF_LOG(10) {
+                ChunkDumper d;
+                instr->accept(&d);
+            }
+            return;
+        }
+        fixup.type = FIXUP_RELATIVE;
+    }
+    else if(link->isAbsolute()) {
+        if(isData) return;  // absolute data addresses never change
+        fixup.type = FIXUP_ABSOLUTE;
+    }
+    else {
+        return;  // e.g. GS table offsets, independent of position
+    }
+
+    linkFixups.push_back(fixup);
+}
+
 void ChunkCache::copyAndFix(char *output) {
     std::memcpy(output, data.c_str(), data.size());
+    fix(output, reinterpret_cast<address_t>(output));
+}
+
+void ChunkCache::copyAndFix(char *output, address_t newAddress) {
+    std::memcpy(output, data.c_str(), data.size());
+    fix(output, newAddress);
+}
+
+void ChunkCache::fix(char *output, address_t newAddress) {
+    const char *original = data.c_str();
+    int32_t delta = address - newAddress;
     for(auto offset : fixups) {
-        uint32_t *point = reinterpret_cast<uint32_t *>(output + offset);
-        int32_t delta = address - reinterpret_cast<address_t>(output);
-        *point = *reinterpret_cast<const uint32_t *>(data.c_str() + offset)
-            + delta;
+        uint32_t value;
+        std::memcpy(&value, original + offset, sizeof(value));
+        value += delta;
+        std::memcpy(output + offset, &value, sizeof(value));
+    }
+
+    for(const auto &fixup : linkFixups) {
+        address_t disp = fixup.link->getTargetAddress();
+        if(fixup.type == FIXUP_RELATIVE) {
+            disp -= newAddress + fixup.end;
+            if(fixup.size < sizeof(int32_t)) {
+                diff_t limit = diff_t(1) << (8*fixup.size - 1);
+                diff_t value = static_cast<diff_t>(disp);
+                if(value < -limit || value >= limit) {
+                    LOG(1, "ChunkCache: displacement at offset 0x" << std::hex
+                        << fixup.offset << " does not fit in "
+                        << std::dec << fixup.size << " byte(s)");
+                    throw "ChunkCache: displacement out of range";
+                }
+            }
+        }
+        std::memcpy(output + fixup.offset, &disp, fixup.size);
     }
 }
@@ -3,21 +3,70 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 #include "instr/instr.h"
 
 class Chunk;
+class Link;
 
+/** A relocatable copy of the machine code of a Function or PLTTrampoline.
+
+    The chunk is serialized once; every displacement that depends on the
+    chunk's position (or on the position of its link target) is recorded
+    as a typed fixup. The cached bytes can then be written out to any
+    address with a memcpy followed by a loop over the fixups, instead of
+    re-encoding every instruction.
+
+    Links that stay within the chunk are position-independent and need no
+    fixup. Links that cannot be re-encoded from the cache (e.g.
+    ImmAndDispLink) make the cache unusable; check isUsable().
+
+    A cache only stays valid while its chunk is unchanged. Functions drop
+    theirs whenever a ChunkMutator is made for them or their children.
+*/
 class ChunkCache {
+public:
+    enum FixupType {
+        FIXUP_RELATIVE,         // RIP-relative, target recomputed from link
+        FIXUP_ABSOLUTE,         // target address encoded directly
+    };
+
+    struct Fixup {
+        FixupType type;
+        uint32_t offset;        // displacement offset within the chunk
+        uint32_t end;           // end of instruction within the chunk
+        uint32_t size;          // displacement size in bytes
+        Link *link;
+    };
 private:
     address_t address;
     std::string data;
-    std::vector<address_t> fixups;
+    // 32-bit RIP-relative data references are kept apart (as offsets),
+    // since their targets never move: the common case is a tight add-delta
+    // loop
+    std::vector<uint32_t> fixups;
+    std::vector<Fixup> linkFixups;
+    bool usable;
 public:
-    ChunkCache(Chunk *chunk) { make(chunk); }
+    ChunkCache(Chunk *chunk) : address(0), usable(true) { make(chunk); }
+
+    bool isUsable() const { return usable; }
+    size_t getSize() const { return data.size(); }
+    size_t getFixupCount() const
+        { return fixups.size() + linkFixups.size(); }
+
+    /** Copies the cached code to output, which is also its new address.
+        Throws if a displacement no longer fits in its field.
+    */
     void copyAndFix(char *output);
+    /** Copies the cached code to output, to be placed at newAddress. */
+    void copyAndFix(char *output, address_t newAddress);
 private:
     void make(Chunk *chunk);
+    void makeFixup(Chunk *chunk, Instruction *instr, Link *link,
+        size_t dispOffset, size_t dispSize);
+    void fix(char *output, address_t newAddress);
 };
 
 #endif
@@ -0,0 +1,115 @@
+#include "features.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "log/log.h"
+
+static bool isCallMnemonic(const std::string &mnemonic) {
+#ifdef ARCH_X86_64
+    return mnemonic == "callq";
+#elif defined(ARCH_AARCH64) || defined(ARCH_ARM)
+    return mnemonic == "bl" || mnemonic == "blr";
+#elif defined(ARCH_RISCV)
+    return mnemonic == "jal" || mnemonic == "jalr"
+        || mnemonic == "c.jal" || mnemonic == "c.jalr";
+#else
+    return false;
+#endif
+}
+
+static bool isSyscall(Assembly *assembly) {
+#ifdef ARCH_X86_64
+    return assembly->getId() == X86_INS_SYSCALL;
+#elif defined(ARCH_AARCH64)
+    return assembly->getId() == ARM64_INS_SVC;
+#else
+    return false;
+#endif
+}
+
+static bool usesStackPointer(Assembly *assembly) {
+    auto asmOps = assembly->getAsmOperands();
+#ifdef ARCH_X86_64
+    for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+        const auto &op = asmOps->getOperands()[i];
+        if(op.type == X86_OP_REG && op.reg == X86_REG_RSP) return true;
+        if(op.type == X86_OP_MEM && op.mem.base == X86_REG_RSP) return true;
+    }
+    return false;
+#elif defined(ARCH_AARCH64)
+    for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+        const auto &op = asmOps->getOperands()[i];
+        if(op.type == ARM64_OP_REG
+            && (op.reg == ARM64_REG_SP || op.reg == ARM64_REG_WSP)) {
+
+            return true;
+        }
+        if(op.type == ARM64_OP_MEM && op.mem.base == ARM64_REG_SP) {
+            return true;
+        }
+    }
+    return false;
+#else
+    return true;  // not modelled; assume it does
+#endif
+}
+
+FunctionFeatures::FunctionFeatures(Function *function)
+    : flags(0), known(true) {
+
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto semantic = instr->getSemantic();
+            if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+                flags |= isCallMnemonic(cfi->getMnemonic())
+                    ? FEATURE_DIRECT_CALL : FEATURE_DIRECT_JUMP;
+                continue;
+            }
+            if(dynamic_cast<ReturnInstruction *>(semantic)) {
+                flags |= FEATURE_RETURN;
+                continue;
+            }
+            if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+                // indirect calls are disassembled as indirect jumps too
+                flags |= isCallMnemonic(ij->getMnemonic())
+                    ? FEATURE_INDIRECT_CALL : FEATURE_INDIRECT_JUMP;
+            }
+            else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+                flags |= FEATURE_INDIRECT_CALL;
+            }
+#ifdef ARCH_X86_64
+            else if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+                semantic)) {
+
+                flags |= dlcfi->isCall()
+                    ? FEATURE_INDIRECT_CALL : FEATURE_INDIRECT_JUMP;
+            }
+#endif
+            else if(dynamic_cast<StackFrameInstruction *>(semantic)) {
+                flags |= FEATURE_STACK_POINTER;
+                continue;
+            }
+
+            // literals are data, not code
+            if(dynamic_cast<LiteralInstruction *>(semantic)) continue;
+            if(dynamic_cast<LinkedLiteralInstruction *>(semantic)) continue;
+            if(auto assembly = semantic->getAssembly()) {
+#ifdef ARCH_X86_64
+                // e.g. call *0x10(%rip), before relocations are handled
+                if(assembly->getId() == X86_INS_CALL) {
+                    flags |= FEATURE_INDIRECT_CALL;
+                }
+                else if(assembly->getId() == X86_INS_JMP) {
+                    flags |= FEATURE_INDIRECT_JUMP;
+                }
+#endif
+                if(isSyscall(assembly.get())) flags |= FEATURE_SYSCALL;
+                if(usesStackPointer(assembly.get())) {
+                    flags |= FEATURE_STACK_POINTER;
+                }
+            }
+        }
+    }
+
+    LOG(12, "features of [" << function->getName() << "] = 0x"
+        << std::hex << flags);
+}
@@ -0,0 +1,44 @@
+#ifndef EGALITO_CHUNK_FEATURES_H
+#define EGALITO_CHUNK_FEATURES_H
+
+#include <cstdint>
+
+class Function;
+
+/** Cheap facts about the instructions of a Function, found by one linear
+    scan. Analyses consult them to skip functions that cannot matter to
+    them, before building a ControlFlowGraph or use-def state.
+
+    Only instruction kinds are recorded, not link targets, so the facts
+    hold from disassembly on until instructions are added or removed.
+*/
+class FunctionFeatures {
+public:
+    enum Feature {
+        FEATURE_DIRECT_CALL     = 1 << 0,
+        FEATURE_INDIRECT_CALL   = 1 << 1,
+        FEATURE_DIRECT_JUMP     = 1 << 2,   // conditional jumps included
+        FEATURE_INDIRECT_JUMP   = 1 << 3,
+        FEATURE_RETURN          = 1 << 4,
+        FEATURE_SYSCALL         = 1 << 5,
+        FEATURE_STACK_POINTER   = 1 << 6,   // explicit stack pointer operand
+    };
+private:
+    uint32_t flags;
+    bool known;
+public:
+    FunctionFeatures() : flags(0), known(false) {}
+
+    /** Scans the instructions of function. */
+    FunctionFeatures(Function *function);
+
+    bool isKnown() const { return known; }
+    uint32_t getFlags() const { return flags; }
+
+    /** Whether any of the given features are present. */
+    bool has(uint32_t features) const { return (flags & features) != 0; }
+    bool hasCall() const
+        { return has(FEATURE_DIRECT_CALL | FEATURE_INDIRECT_CALL); }
+};
+
+#endif
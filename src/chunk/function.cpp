@@ -19,12 +19,23 @@
 #include "log/temp.h"
 
 void Function::makeCache() {
+    delete cache;
     this->cache = new ChunkCache(this);
 }
 
+void Function::clearCache() {
+    delete cache;
+    this->cache = nullptr;
+}
+
+const FunctionFeatures &Function::getFeatures() {
+    if(!features.isKnown()) features = FunctionFeatures(this);
+    return features;
+}
+
 Function::Function(address_t originalAddress)
     : symbol(nullptr), dynamicSymbol(nullptr), nonreturn(false),
-    ifunc(false), cache(nullptr) {
+    ifunc(false), cache(nullptr), alignment(0), unwind(nullptr) {
 
     std::ostringstream stream;
     stream << "fuzzyfunc-0x" << std::hex << originalAddress;
@@ -32,7 +43,8 @@ Function::Function(address_t originalAddress)
 }
 
 Function::Function(Symbol *symbol)
-    : symbol(symbol), dynamicSymbol(nullptr), nonreturn(false), cache(nullptr) {
+    : symbol(symbol), dynamicSymbol(nullptr), nonreturn(false), cache(nullptr),
+    alignment(0), unwind(nullptr) {
 
     name = symbol->getName();
     ifunc = (symbol->getType() == Symbol::TYPE_IFUNC);
@@ -4,11 +4,13 @@
 #include "chunk.h"
 #include "chunklist.h"
 #include "block.h"
+#include "features.h"
 #include "archive/chunktypes.h"
 
 class Symbol;
 class Function;
 class ChunkCache;
+class FunctionUnwind;
 
 class Function : public ChunkSerializerImpl<TYPE_Function,
     AssignableCompositeChunkImpl<Block>> {
@@ -19,9 +21,12 @@ private:
     bool nonreturn;
     bool ifunc;
     ChunkCache *cache;
+    FunctionFeatures features;  // !!! not serialized, recomputed on demand
+    size_t alignment;  // !!! not serialized
+    FunctionUnwind *unwind;  // !!! not serialized
 public:
     Function() : symbol(nullptr), dynamicSymbol(nullptr), nonreturn(false),
-        ifunc(false), cache(nullptr) {}
+        ifunc(false), cache(nullptr), alignment(0), unwind(nullptr) {}
 
     /** Create a fuzzy function named according to the original address. */
     Function(address_t originalAddress);
@@ -50,8 +55,27 @@ public:
     bool isIFunc() const { return ifunc; }
     void setIsIFunc(bool yes) { ifunc = yes; }
 
+    /** The cache is dropped by any change through a ChunkMutator. */
     void makeCache();
     ChunkCache *getCache() const { return cache; }
+    void clearCache();
+
+    /** Scans the instructions, unless they were scanned since the last
+        change through a ChunkMutator.
+    */
+    const FunctionFeatures &getFeatures();
+    void invalidateFeatures() { features = FunctionFeatures(); }
+
+    /** Alignment the Generator gives this function's address, if any. The
+        function's slot is also padded to a multiple of it, so nothing else
+        shares its last aligned unit.
+    */
+    size_t getAlignment() const { return alignment; }
+    void setAlignment(size_t alignment) { this->alignment = alignment; }
+
+    /** Call frame information from .eh_frame, if there was any. */
+    FunctionUnwind *getUnwind() const { return unwind; }
+    void setUnwind(FunctionUnwind *unwind) { this->unwind = unwind; }
 };
 
 class FunctionList : public ChunkSerializerImpl<TYPE_FunctionList,
@@ -188,6 +188,7 @@ void PLTTrampoline::accept(ChunkVisitor *visitor) {
 }
 
 void PLTTrampoline::makeCache() {
+    delete cache;
     this->cache = new ChunkCache(this);
 }
 
@@ -2,6 +2,7 @@
 #include "resolver.h"
 #include "chunk/concrete.h"
 #include "chunk/aliasmap.h"
+#include "chunk/symbolindex.h"
 #include "conductor/conductor.h"
 #include "conductor/bridge.h"
 #include "disasm/disassemble.h"
@@ -415,18 +416,22 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
         return link;
     }
 
-    auto dependencies = module->getLibrary()->getDependencies();
-    for(auto m : CIter::modules(conductor->getProgram())) {
+    // candidate definitions in every module, in search order
+    std::vector<SymbolIndex::Match> matches;
+    conductor->getSymbolIndex()->find(name, version, matches);
+
+    const auto &dependencies = module->getLibrary()->getDependencies();
+    for(const auto &match : matches) {
+        auto m = match.module;
+        if(m == module) continue;
         if(dependencies.find(m->getLibrary()) == dependencies.end()) {
             continue;
         }
-        
-        if(m != module) {
-            if(auto link = resolveNameAsLinkHelper(name, version,
-                m, weak, relative, afterMapping)) {
 
-                return link;
-            }
+        if(auto link = resolveNameAsLinkHelper(match.symbol, match.name,
+            m, weak, relative, afterMapping)) {
+
+            return link;
         }
     }
 
@@ -438,19 +443,24 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
     }
 
     // weak definition
-    if(auto link = resolveNameAsLinkHelper(name, version,
-        module, weak, relative, afterMapping)) {
+    for(const auto &match : matches) {
+        if(match.module != module) continue;
 
-        LOG(10, "    link to weak definition in " << module->getName());
-        return link;
+        if(auto link = resolveNameAsLinkHelper(match.symbol, match.name,
+            module, weak, relative, afterMapping)) {
+
+            LOG(10, "    link to weak definition in " << module->getName());
+            return link;
+        }
     }
 
     // weak reference
-    for(auto m : CIter::modules(conductor->getProgram())) {
-        if(auto link = resolveNameAsLinkHelper(name, version,
-            m, weak, relative, afterMapping)) {
+    for(const auto &match : matches) {
+        if(auto link = resolveNameAsLinkHelper(match.symbol, match.name,
+            match.module, weak, relative, afterMapping)) {
 
-            LOG(10, "    link (weak) to definition in " << m->getName());
+            LOG(10, "    link (weak) to definition in "
+                << match.module->getName());
             return link;
         }
     }
@@ -460,56 +470,13 @@ Link *PerfectLinkResolver::resolveExternallyHelper(const char *name,
     return nullptr;
 }
 
-Link *PerfectLinkResolver::resolveNameAsLinkHelper(const char *name,
-    const SymbolVersion *version,
-    Module *module, bool weak, bool relative, bool afterMapping) {
+Link *PerfectLinkResolver::resolveNameAsLinkHelper(Symbol *symbol,
+    const char *name, Module *module, bool weak, bool relative,
+    bool afterMapping) {
 
-    LOG(1, "        resolveNameAsLinkHelper (" << name << ") inside "
+    LOG(11, "        resolveNameAsLinkHelper (" << name << ") inside "
         << module->getName());
 
-    if(auto link = resolveNameAsLinkHelper2(
-        name, module, weak, relative, afterMapping)) {
-
-        return link;
-    }
-    // if there is a default versioned symbol, we need to make a link to
-    // it, but this may not occur for gcc compiled binaries & libraries
-    if(!version) return nullptr;
-
-    std::string versionedName1(name);
-    versionedName1.append("@");
-    versionedName1.append(version->getName());
-    if(auto link = resolveNameAsLinkHelper2(
-        versionedName1.c_str(), module, weak, relative, afterMapping)) {
-
-        return link;
-    }
-    std::string versionedName2(name);
-    versionedName2.append("@@");
-    versionedName2.append(version->getName());
-    if(auto link = resolveNameAsLinkHelper2(
-        versionedName2.c_str(), module, weak, relative, afterMapping)) {
-
-        return link;
-    }
-    return nullptr;
-}
-
-Link *PerfectLinkResolver::resolveNameAsLinkHelper2(const char *name,
-    Module *module, bool weak, bool relative, bool afterMapping) {
-
-    Symbol *symbol = nullptr;
-    auto list = module->getElfSpace()->getDynamicSymbolList();
-    if(!list) {
-        LOG(11, "no dynamic symbol list " << module->getName());
-        return nullptr;
-    }
-    symbol = list->find(name);
-    if(!symbol) {
-        LOG(11, "no symbol " << module->getName());
-        return nullptr;
-    }
-
     // early out if we are not searching for weak symbols
     if(!weak && symbol->getBind() == Symbol::BIND_WEAK) return nullptr;
 
@@ -40,10 +40,8 @@ private:
     Link *resolveExternallyHelper(const char *name, const SymbolVersion *version,
         Conductor *conductor, Module *module, bool weak, bool relative,
         bool afterMapping);
-    Link *resolveNameAsLinkHelper(const char *name, const SymbolVersion *version,
+    Link *resolveNameAsLinkHelper(Symbol *symbol, const char *name,
         Module *module, bool weak, bool relative, bool afterMapping);
-    Link *resolveNameAsLinkHelper2(const char *name, Module *module,
-        bool weak, bool relative, bool afterMapping);
 public:
     // redirectCopyRelocs assumes afterMapping=true
     Link *redirectCopyRelocs(Conductor *conductor, Symbol *symbol, bool relative);
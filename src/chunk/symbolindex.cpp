@@ -0,0 +1,134 @@
+#include <cstring>
+#include <initializer_list>
+#include "symbolindex.h"
+#include "concrete.h"
+#include "elf/elfspace.h"
+#include "elf/symbol.h"
+#include "log/log.h"
+
+size_t SymbolIndex::KeyHash::operator () (const Key &key) const {
+    // FNV-1a
+    size_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < key.length; i ++) {
+        hash ^= static_cast<unsigned char>(key.data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool SymbolIndex::KeyEqual::operator () (const Key &a, const Key &b) const {
+    return a.length == b.length && !std::memcmp(a.data, b.data, a.length);
+}
+
+void SymbolIndex::update(Program *program) {
+    if(program != this->program) {
+        entryMap.clear();
+        moduleCount = 0;
+        this->program = program;
+    }
+
+    auto iterable = program->getChildren()->getIterable();
+    for(size_t i = moduleCount; i < iterable->getCount(); i ++) {
+        add(iterable->get(i));
+    }
+    moduleCount = iterable->getCount();
+}
+
+void SymbolIndex::add(Module *module) {
+    auto space = module->getElfSpace();
+    auto list = space ? space->getDynamicSymbolList() : nullptr;
+    if(!list) return;
+
+    size_t count = 0;
+    for(auto sym : *list) {
+        Kind kind;
+        Key version;
+        auto key = split(sym->getName(), &kind, &version);
+        auto &entries = entryMap[key];
+
+        // like SymbolList::find, only the first symbol with a name is used
+        bool seen = false;
+        for(auto it = entries.rbegin();
+            it != entries.rend() && it->module == module; ++ it) {
+
+            if(it->kind == kind && sameVersion(it->version, version)) {
+                seen = true;
+                break;
+            }
+        }
+        if(seen) continue;
+
+        auto symbol = sym->getAliasFor() ? sym->getAliasFor() : sym;
+        entries.push_back({module, kind, version, symbol,
+            sym->getName()});
+        count ++;
+    }
+
+    LOG(10, "indexed " << std::dec << count << " dynamic symbols of "
+        << module->getName());
+}
+
+void SymbolIndex::find(const char *name, const SymbolVersion *version,
+    std::vector<Match> &matches) const {
+
+    Kind kind;
+    Key exactVersion;
+    auto it = entryMap.find(split(name, &kind, &exactVersion));
+    if(it == entryMap.end()) return;
+
+    // versioned names are only tried for a plain name with a version
+    bool versioned = (kind == KIND_PLAIN && version);
+    Key wanted = {"", 0};
+    if(versioned) {
+        wanted.data = version->getName();
+        wanted.length = std::strlen(wanted.data);
+    }
+
+    const auto &entries = it->second;
+    for(size_t begin = 0, end = 0; begin < entries.size(); begin = end) {
+        auto module = entries[begin].module;
+        while(end < entries.size() && entries[end].module == module) end ++;
+
+        for(size_t i = begin; i < end; i ++) {
+            const auto &e = entries[i];
+            if(e.kind == kind && sameVersion(e.version, exactVersion)) {
+                matches.push_back({module, e.symbol, e.name});
+            }
+        }
+        if(!versioned) continue;
+        for(auto wantedKind : {KIND_NONDEFAULT, KIND_DEFAULT}) {
+            for(size_t i = begin; i < end; i ++) {
+                const auto &e = entries[i];
+                if(e.kind == wantedKind && sameVersion(e.version, wanted)) {
+                    matches.push_back({module, e.symbol, e.name});
+                }
+            }
+        }
+    }
+}
+
+SymbolIndex::Key SymbolIndex::split(const char *name, Kind *kind,
+    Key *version) {
+
+    auto at = std::strchr(name, '@');
+    if(!at) {
+        *kind = KIND_PLAIN;
+        *version = {"", 0};
+        return {name, std::strlen(name)};
+    }
+
+    auto v = at + 1;
+    if(*v == '@') {
+        *kind = KIND_DEFAULT;
+        v ++;
+    }
+    else {
+        *kind = KIND_NONDEFAULT;
+    }
+    *version = {v, std::strlen(v)};
+    return {name, static_cast<size_t>(at - name)};
+}
+
+bool SymbolIndex::sameVersion(const Key &a, const Key &b) {
+    return KeyEqual()(a, b);
+}
@@ -0,0 +1,75 @@
+#ifndef EGALITO_CHUNK_SYMBOL_INDEX_H
+#define EGALITO_CHUNK_SYMBOL_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+class Program;
+class Module;
+class Symbol;
+class SymbolVersion;
+
+/** Program-wide index of dynamic symbols, so that resolving a name by
+    searching other modules costs one hash probe instead of one lookup per
+    module (and per version suffix). Symbol names like "name@@ver" are
+    split when indexed, so lookups never build strings.
+
+    Modules are indexed in Program order, which is the dependency search
+    order, and the index is extended whenever new modules are added.
+*/
+class SymbolIndex {
+public:
+    /** A candidate definition, in the order the modules are searched. */
+    struct Match {
+        Module *module;
+        Symbol *symbol;     // aliases already followed
+        const char *name;   // full name in the dynamic symbol table
+    };
+private:
+    enum Kind {
+        KIND_PLAIN,         // name
+        KIND_NONDEFAULT,    // name@ver
+        KIND_DEFAULT        // name@@ver
+    };
+    struct Key {
+        const char *data;   // not NUL-terminated at length
+        size_t length;
+    };
+    struct KeyHash {
+        size_t operator () (const Key &key) const;
+    };
+    struct KeyEqual {
+        bool operator () (const Key &a, const Key &b) const;
+    };
+    struct Entry {
+        Module *module;
+        Kind kind;
+        Key version;        // empty for KIND_PLAIN
+        Symbol *symbol;
+        const char *name;
+    };
+    typedef std::unordered_map<Key, std::vector<Entry>, KeyHash, KeyEqual>
+        MapType;
+    MapType entryMap;
+    Program *program;
+    size_t moduleCount;
+public:
+    SymbolIndex() : program(nullptr), moduleCount(0) {}
+
+    /** Indexes any modules added to program since the last call. */
+    void update(Program *program);
+
+    /** Finds definitions of name (with version, if given) in every module,
+        in search order. Within a module, the exact name comes before
+        name@version, which comes before name@@version.
+    */
+    void find(const char *name, const SymbolVersion *version,
+        std::vector<Match> &matches) const;
+private:
+    void add(Module *module);
+    static Key split(const char *name, Kind *kind, Key *version);
+    static bool sameVersion(const Key &a, const Key &b);
+};
+
+#endif
@@ -0,0 +1,6 @@
+#include "unwind.h"
+#include "link.h"
+
+FunctionLSDA::~FunctionLSDA() {
+    for(auto type : typeList) delete type;
+}
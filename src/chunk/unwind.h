@@ -0,0 +1,119 @@
+#ifndef EGALITO_CHUNK_UNWIND_H
+#define EGALITO_CHUNK_UNWIND_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include "types.h"
+
+class DwarfCIE;
+class Instruction;
+class InstructionSemantic;
+class Link;
+
+/** A function's entry in .gcc_except_table. Call sites are anchored to
+    Instructions like the CFA rows, and type table entries are Links,
+    since the type_info objects they point to may move too. The action
+    and exception specification tables are kept as raw bytes.
+*/
+class FunctionLSDA {
+public:
+    class CallSite {
+    private:
+        Instruction *start;
+        Instruction *end;         // first one after the range, or null
+        Instruction *landingPad;  // null if none
+        uint64_t action;
+    public:
+        CallSite(Instruction *start, Instruction *end,
+            Instruction *landingPad, uint64_t action) : start(start),
+            end(end), landingPad(landingPad), action(action) {}
+
+        Instruction *getStart() const { return start; }
+        Instruction *getEnd() const { return end; }
+        Instruction *getLandingPad() const { return landingPad; }
+        uint64_t getAction() const { return action; }
+    };
+private:
+    std::vector<CallSite> callSiteList;
+    std::string actionTable;
+    uint8_t typeEncoding;
+    std::vector<Link *> typeList;  // from filter 1 on; null catches all
+    std::string specTable;
+public:
+    FunctionLSDA(uint8_t typeEncoding, const std::string &actionTable,
+        const std::string &specTable) : actionTable(actionTable),
+        typeEncoding(typeEncoding), specTable(specTable) {}
+    ~FunctionLSDA();
+
+    void addCallSite(Instruction *start, Instruction *end,
+        Instruction *landingPad, uint64_t action)
+        { callSiteList.emplace_back(start, end, landingPad, action); }
+    void addType(Link *type) { typeList.push_back(type); }
+
+    const std::vector<CallSite> &getCallSiteList() const
+        { return callSiteList; }
+    const std::string &getActionTable() const { return actionTable; }
+    uint8_t getTypeEncoding() const { return typeEncoding; }
+    const std::vector<Link *> &getTypeList() const { return typeList; }
+    const std::string &getSpecTable() const { return specTable; }
+};
+
+/** Call frame information of a Function, as rows of CFA instructions
+    that each start at an Instruction rather than at a code offset, so
+    the rows follow the code when it moves. Code inserted after an
+    anchor falls under that anchor's row; code inserted in front of one
+    with ChunkMutator::insertBeforeJumpTo() takes over the anchor, and
+    so starts the row itself.
+
+    The semantics of the original code are remembered, so that inserted
+    code that moves the stack pointer can be told apart; EhFrameBuilder
+    adjusts the CFA offset across it.
+
+    The personality routine comes from the CIE and is shared by every
+    function that uses it.
+*/
+class FunctionUnwind {
+public:
+    class Row {
+    private:
+        Instruction *instruction;
+        std::string program;  // raw CFA instructions, without advances
+    public:
+        Row(Instruction *instruction, const std::string &program)
+            : instruction(instruction), program(program) {}
+
+        Instruction *getInstruction() const { return instruction; }
+        const std::string &getProgram() const { return program; }
+    };
+private:
+    DwarfCIE *cie;
+    std::vector<Row> rowList;
+    std::set<InstructionSemantic *> originalSet;
+    Link *personality;
+    FunctionLSDA *lsda;
+public:
+    FunctionUnwind(DwarfCIE *cie)
+        : cie(cie), personality(nullptr), lsda(nullptr) {}
+    ~FunctionUnwind() { delete lsda; }
+
+    DwarfCIE *getCIE() const { return cie; }
+
+    void setPersonality(Link *personality)
+        { this->personality = personality; }
+    Link *getPersonality() const { return personality; }
+    void setLSDA(FunctionLSDA *lsda) { this->lsda = lsda; }
+    FunctionLSDA *getLSDA() const { return lsda; }
+
+    void addRow(Instruction *instruction, const std::string &program)
+        { rowList.emplace_back(instruction, program); }
+    const std::vector<Row> &getRowList() const { return rowList; }
+
+    void addOriginal(InstructionSemantic *semantic)
+        { originalSet.insert(semantic); }
+    /** Whether semantic was in the function when the rows were read. */
+    bool isOriginal(InstructionSemantic *semantic) const
+        { return originalSet.count(semantic) != 0; }
+};
+
+#endif
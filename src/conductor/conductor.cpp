@@ -5,6 +5,7 @@
 #include "passes.h"
 #include "chunk/ifunc.h"
 #include "chunk/tls.h"
+#include "chunk/symbolindex.h"
 #include "elf/elfmap.h"
 #include "elf/elfdynamic.h"
 #include "generate/debugelf.h"
@@ -35,7 +36,9 @@
 
 IFuncList *egalito_ifuncList __attribute__((weak));
 
-Conductor::Conductor() : mainThreadPointer(0), ifuncList(nullptr) {
+Conductor::Conductor() : mainThreadPointer(0), ifuncList(nullptr),
+    symbolIndex(new SymbolIndex()), keepUnwindInfo(false) {
+
     program = new Program();
     program->setLibraryList(new LibraryList());
 
@@ -43,6 +46,7 @@ Conductor::Conductor() : mainThreadPointer(0), ifuncList(nullptr) {
 }
 
 Conductor::~Conductor() {
+    delete symbolIndex;
     delete program;
 }
 
@@ -171,6 +175,11 @@ void Conductor::parseEgalitoArchive(const char *archive) {
     ConductorPasses(this).newArchivePasses(program);
 }
 
+SymbolIndex *Conductor::getSymbolIndex() {
+    symbolIndex->update(program);
+    return symbolIndex;
+}
+
 void Conductor::resolvePLTLinks() {
     ResolvePLTPass resolvePLT(this);
     program->accept(&resolvePLT);
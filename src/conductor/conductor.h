@@ -12,6 +12,7 @@ class ElfMap;
 class Module;
 class ChunkVisitor;
 class IFuncList;
+class SymbolIndex;
 struct EgalitoTLS;
 
 class Conductor {
@@ -20,6 +21,8 @@ private:
     address_t mainThreadPointer;
     size_t TLSOffsetFromTCB;
     IFuncList *ifuncList;
+    SymbolIndex *symbolIndex;
+    bool keepUnwindInfo;
 
     std::set<Module *> resolveFinished;
 public:
@@ -37,6 +40,12 @@ public:
     Module *parseExtraLibrary(ElfMap *elf, const std::string &name = "");
     void parseEgalitoArchive(const char *archive);
 
+    /** Attach .eh_frame rows to each Function while parsing, so that
+        mirror and union output can regenerate .eh_frame. Off by default.
+    */
+    void setKeepUnwindInfo(bool keep) { keepUnwindInfo = keep; }
+    bool getKeepUnwindInfo() const { return keepUnwindInfo; }
+
     void resolvePLTLinks();
     void resolveTLSLinks();
     void resolveData(bool multipleElf = false, bool justBridge = false);
@@ -56,6 +65,8 @@ public:
 
     address_t getMainThreadPointer() const { return mainThreadPointer; }
     IFuncList *getIFuncList() const { return ifuncList; }
+    /** Up to date with every Module in the Program. */
+    SymbolIndex *getSymbolIndex();
 
     void loadTLSDataFor(address_t tcb);
 
@@ -30,6 +30,7 @@ bool EgalitoInterface::setLogLevel(const char *logname, int level) {
 }
 
 void EgalitoInterface::initializeParsing() {
+    setup.setKeepUnwindInfo(true);  // for generate()
     setup.createNewProgram();
 }
 
@@ -27,7 +27,8 @@ public:
     EgalitoInterface(bool verboseLogging = true, bool useLoggingEnvVar = true);
 
     /** Creates Program. Call this before any invocation of parse(), and may be
-        called repeatedly to reset the Program.
+        called repeatedly to reset the Program. Unwind information is kept so
+        that generate() can write .eh_frame.
     */
     void initializeParsing();
 
@@ -28,6 +28,7 @@
 #include "pass/updatelink.h"
 #include "pass/collectglobals.h"
 #include "pass/offsetsledding.h"
+#include "pass/attachunwind.h"
 #include "analysis/jumptable.h"
 #include "log/log.h"
 #include "log/temp.h"
@@ -37,8 +38,10 @@ void ConductorPasses::newElfPasses(ElfSpace *space) {
     ElfMap *elf = space->getElfMap();
     RelocList *relocList = space->getRelocList();
 
+    // .eh_frame is only needed to find functions when there are no symbols
+    auto symbolList = space->getSymbolList();
     Module *module = Disassemble::module(elf,
-        space->getSymbolList(), space->getDwarfInfo(),
+        symbolList, symbolList ? nullptr : space->getDwarfInfo(),
         space->getDynamicSymbolList(), relocList);
     space->setModule(module);
     module->setElfSpace(space);
@@ -94,6 +97,14 @@ void ConductorPasses::newElfPasses(ElfSpace *space) {
         RUN_PASS(UpdateLink(), module);
     }
 #endif
+
+    // before anything moves code, for regenerating .eh_frame
+    if(conductor->getKeepUnwindInfo() && elf->findSection(".eh_frame")) {
+        if(auto info = space->getDwarfInfo()) {
+            RUN_PASS(AttachUnwindPass(elf, info), module);
+        }
+    }
+
     RUN_PASS(InferLinksPass(elf), module);
 
     // this can run pretty much whenever, but let's put it here for now.
@@ -61,8 +61,14 @@ void ConductorSetup::parseEgalito(bool fromArchive) {
     LoaderEmulator::getInstance().setup(conductor);
 }
 
+void ConductorSetup::setKeepUnwindInfo(bool keep) {
+    this->keepUnwindInfo = keep;
+    if(conductor) conductor->setKeepUnwindInfo(keep);
+}
+
 void ConductorSetup::createNewProgram() {
     this->conductor = new Conductor();
+    conductor->setKeepUnwindInfo(keepUnwindInfo);
     ::egalito_conductor = conductor;
     this->elf = nullptr;
     this->egalito = nullptr;
@@ -28,9 +28,14 @@ private:
     ElfMap *egalito;
     Conductor *conductor;
     address_t sandboxBase;
+    bool keepUnwindInfo;
 public:
     ConductorSetup() : elf(nullptr), egalito(nullptr), conductor(nullptr),
-        sandboxBase(SANDBOX_BASE_ADDRESS) {}
+        sandboxBase(SANDBOX_BASE_ADDRESS), keepUnwindInfo(false) {}
+    /** Call before parsing if mirror or union output should get a
+        regenerated .eh_frame; see Conductor::setKeepUnwindInfo().
+    */
+    void setKeepUnwindInfo(bool keep);
     Module *parseElfFiles(const char *executable, bool withSharedLibs = true,
         bool injectEgalito = false);
     Module *injectElfFiles(const char *executable, bool withSharedLibs = true,
@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 #include <set>
 #include <sstream>  // for debugging
 #include <capstone/x86.h>
@@ -16,6 +17,7 @@
 #include "operation/mutator.h"
 #include "instr/concrete.h"
 #include "util/intervaltree.h"
+#include "util/parallel.h"
 #include "instr/writer.h"  // for debugging
 #include "log/log.h"
 #include "log/temp.h"
@@ -120,12 +122,21 @@ Module *Disassemble::makeModuleFromSymbols(ElfMap *elfMap,
     }
 #endif
 
+    // skip Symbols that we don't think represent functions
+    std::vector<Symbol *> functionSymbols;
     for(auto sym : *symbolList) {
-        // skip Symbols that we don't think represent functions
-        if(!sym->isFunction()) continue;
+        if(sym->isFunction()) functionSymbols.push_back(sym);
+    }
+
+    // functions are independent once their bounds are known, so they
+    // can be decoded in parallel and attached in the original order
+    std::vector<Function *> functions(functionSymbols.size());
+    parallelFor(functionSymbols.size(), [&] (size_t i) {
+        functions[i] = Disassemble::function(elfMap, functionSymbols[i],
+            symbolList, dynamicSymbolList);
+    });
 
-        Function *function = Disassemble::function(elfMap, sym, symbolList,
-            dynamicSymbolList);
+    for(auto function : functions) {
         functionList->getChildren()->add(function);
         function->setParent(functionList);
         LOG(10, "adding function " << function->getName()
@@ -490,7 +501,7 @@ Function *DisassembleX86Function::function(Symbol *symbol,
 }
 
 Function *DisassembleX86Function::fuzzyFunction(const Range &range,
-    ElfSection *section) {
+    ElfSection *section, Sweep *sweep) {
 
     address_t virtualAddress = section->getVirtualAddress();
     address_t readAddress = section->getReadAddress()
@@ -505,8 +516,10 @@ Function *DisassembleX86Function::fuzzyFunction(const Range &range,
     function->setPosition(
         positionFactory->makeAbsolutePosition(intervalVirtualAddress));
 
-    disassembleBlocks(function, readAddress + intervalOffset,
-        intervalSize, intervalVirtualAddress);
+    if(!sweep || !disassembleFromSweep(function, range, sweep)) {
+        disassembleBlocks(function, readAddress + intervalOffset,
+            intervalSize, intervalVirtualAddress);
+    }
 
     {
         ChunkMutator m(function);  // recalculate cached values if necessary
@@ -515,8 +528,45 @@ Function *DisassembleX86Function::fuzzyFunction(const Range &range,
     return function;
 }
 
+bool DisassembleX86Function::disassembleFromSweep(Function *function,
+    const Range &range, Sweep *sweep) {
+
+    // only usable if the sweep decoded exactly this range's instructions
+    if(range.getStart() < sweep->start) return false;
+    size_t startOffset = range.getStart() - sweep->start;
+    size_t endOffset = startOffset + range.getSize();
+    if(endOffset > sweep->end) return false;
+
+    auto &offsets = sweep->offsets;
+    auto first = std::lower_bound(offsets.begin(), offsets.end(),
+        static_cast<uint32_t>(startOffset));
+    if(first == offsets.end() || *first != startOffset) return false;
+
+    size_t begin = first - offsets.begin();
+    size_t end = begin;
+    while(end < offsets.size() && offsets[end] < endOffset) {
+        if(!sweep->instructions[end]) return false;  // already claimed
+        end ++;
+    }
+
+    // an instruction straddling the end would be truncated by capstone
+    size_t boundary = (end < offsets.size() ? offsets[end] : sweep->end);
+    if(boundary != endOffset) return false;
+
+    Block *block = makeBlock(function, nullptr);
+    for(size_t j = begin; j < end; j ++) {
+        block = appendInstruction(function, block, sweep->instructions[j],
+            sweep->blockEnds[j]);
+        sweep->instructions[j] = nullptr;
+    }
+    finishBlocks(function, block, range.getSize());
+
+    return true;
+}
+
 void DisassembleX86Function::firstDisassemblyPass(ElfSection *section,
-    IntervalTree &splitRanges, IntervalTree &functionPadding) {
+    IntervalTree &splitRanges, IntervalTree &functionPadding,
+    Sweep *sweep) {
 
     // Get address of region to disassemble
     address_t virtualAddress = section->getVirtualAddress();
@@ -524,14 +574,27 @@ void DisassembleX86Function::firstDisassemblyPass(ElfSection *section,
         + section->convertVAToOffset(virtualAddress);
     size_t readSize = section->getSize();
 
-    cs_insn *insn;
-    size_t count = cs_disasm(handle.raw(),
-        (const uint8_t *)readAddress, readSize, virtualAddress, 0, &insn);
+    if(sweep) {
+        sweep->start = virtualAddress;
+        sweep->end = 0;
+    }
+
+    // decode one instruction at a time into a single reused cs_insn
+    const uint8_t *code = (const uint8_t *)readAddress;
+    size_t codeSize = readSize;
+    uint64_t address = virtualAddress;
+    cs_insn *ins = cs_malloc(handle.raw());
 
     size_t nopBytes = 0;
     //enum { PROLOGUE_NONE, PROLOGUE_PUSH } prologueState = PROLOGUE_NONE;
-    for(size_t j = 0; j < count; j++) {
-        auto ins = &insn[j];
+    while(cs_disasm_iter(handle.raw(), &code, &codeSize, &address, ins)) {
+        if(sweep) {
+            sweep->offsets.push_back(ins->address - virtualAddress);
+            sweep->blockEnds.push_back(shouldSplitBlockAt(ins));
+            sweep->instructions.push_back(
+                Disassemble::instruction(ins, handle, true));
+            sweep->end = address - virtualAddress;
+        }
 
         address_t target = 0;
         if(shouldSplitFunctionDueTo(ins, &target)) {
@@ -576,7 +639,7 @@ void DisassembleX86Function::firstDisassemblyPass(ElfSection *section,
             nopBytes));
     }
 
-    if(count > 0) cs_free(insn, count);
+    cs_free(ins, 1);
 }
 
 // for deregister_tm_clones, register_tm_clones, __do_global_dtors_aux, and frame_dummy
@@ -700,8 +763,11 @@ FunctionList *DisassembleX86Function::linearDisassembly(const char *sectionName,
         }
     }
 
+    // The same pass keeps every decoded instruction, so that functions
+    // can be built below without decoding .text a second time.
     IntervalTree functionPadding(sectionRange);
-    firstDisassemblyPass(section, splitRanges, functionPadding);
+    Sweep sweep;
+    firstDisassemblyPass(section, splitRanges, functionPadding, &sweep);
 
     // Shrink functions, removing nop padding bytes
     IntervalTree functionsWithoutPadding(sectionRange);
@@ -764,11 +830,31 @@ FunctionList *DisassembleX86Function::linearDisassembly(const char *sectionName,
     LOG(1, "Splitting code section into " << intervalList.size()
         << " fuzzy functions");
 
+    // Ranges are disjoint, so workers claim distinct sweep entries. Any
+    // range the sweep cannot supply (e.g. .init/.fini) is decoded again,
+    // with the worker's own thread-local capstone handle.
+    std::vector<Function *> functions(intervalList.size());
+    parallelFor(intervalList.size(), [&] (size_t i) {
+        LOG(11, "Split into function " << intervalList[i]
+            << " at section offset "
+            << section->convertVAToOffset(intervalList[i].getStart()));
+        DisasmHandle handle(true);
+        functions[i] = DisassembleX86Function(handle, elfMap)
+            .fuzzyFunction(intervalList[i], section, &sweep);
+    });
+
+    // instructions that ended up outside of any function (nop padding)
+    for(auto instr : sweep.instructions) {
+        if(instr) {
+            delete instr->getSemantic();
+            delete instr;
+        }
+    }
+
     FunctionList *functionList = new FunctionList();
-    for(const Range &range : intervalList) {
-        LOG(11, "Split into function " << range << " at section offset "
-            << section->convertVAToOffset(range.getStart()));
-        Function *function = fuzzyFunction(range, section);
+    for(size_t i = 0; i < intervalList.size(); i ++) {
+        const Range &range = intervalList[i];
+        Function *function = functions[i];
 
         if(auto dsym = dynamicSymbolList->find(range.getStart())) {
             LOG(12, "    renaming fuzzy function [" << function->getName()
@@ -1260,8 +1346,6 @@ FunctionList *DisassembleRISCVFunction::linearDisassembly(
 void DisassembleFunctionBase::disassembleBlocks(Function *function,
     address_t readAddress, size_t readSize, address_t virtualAddress) {
 
-    PositionFactory *positionFactory = PositionFactory::getInstance();
-
     LOG(19, "disassemble 0x" << std::hex << readAddress << " size " << readSize
         << ", virtual address " << virtualAddress);
     #ifndef ARCH_RISCV
@@ -1285,41 +1369,10 @@ void DisassembleFunctionBase::disassembleBlocks(Function *function,
         // Create Instruction from cs_insn/rv_instr
         auto instr = Disassemble::instruction(ins, handle, true);
 
-        Chunk *prevChunk = nullptr;
-        if(block->getChildren()->getIterable()->getCount() > 0) {
-            prevChunk = block->getChildren()->getIterable()->getLast();
-        }
-        else if(function->getChildren()->getIterable()->getCount() > 0) {
-            prevChunk = function->getChildren()->getIterable()->getLast();
-        }
-        else {
-            prevChunk = nullptr;
-        }
-        instr->setPosition(
-            positionFactory->makePosition(prevChunk, instr, block->getSize()));
-
-        ChunkMutator(block, false).append(instr);
-        if(split) {
-            LOG(11, "split-instr in block: " << j+1);
-            ChunkMutator(function, false).append(block);
-
-            block = makeBlock(function, block);
-        }
-    }
-
-    if(block->getSize() > 0) {
-        CLOG0(10, "fall-through function [%s]... "
-            "adding basic block\n", function->getName().c_str());
-        ChunkMutator(function, false).append(block);
-    }
-    if(block->getSize() == 0) {
-        delete block;
+        block = appendInstruction(function, block, instr, split);
     }
 
-    if(function->getSize() < readSize) {
-        LOG(1, "disassembly error? " << function->getName()
-            << " " << function->getSize() << " < " << readSize);
-    }
+    finishBlocks(function, block, readSize);
 
 #ifdef ARCH_X86_64
     if(false) {
@@ -1375,6 +1428,53 @@ void DisassembleFunctionBase::disassembleBlocks(Function *function,
     #endif
 }
 
+Block *DisassembleFunctionBase::appendInstruction(Function *function,
+    Block *block, Instruction *instr, bool split) {
+
+    PositionFactory *positionFactory = PositionFactory::getInstance();
+
+    Chunk *prevChunk = nullptr;
+    if(block->getChildren()->getIterable()->getCount() > 0) {
+        prevChunk = block->getChildren()->getIterable()->getLast();
+    }
+    else if(function->getChildren()->getIterable()->getCount() > 0) {
+        prevChunk = function->getChildren()->getIterable()->getLast();
+    }
+    else {
+        prevChunk = nullptr;
+    }
+    instr->setPosition(
+        positionFactory->makePosition(prevChunk, instr, block->getSize()));
+
+    ChunkMutator(block, false).append(instr);
+    if(split) {
+        LOG(11, "split-instr in block: "
+            << block->getChildren()->getIterable()->getCount());
+        ChunkMutator(function, false).append(block);
+
+        block = makeBlock(function, block);
+    }
+    return block;
+}
+
+void DisassembleFunctionBase::finishBlocks(Function *function, Block *block,
+    size_t readSize) {
+
+    if(block->getSize() > 0) {
+        CLOG0(10, "fall-through function [%s]... "
+            "adding basic block\n", function->getName().c_str());
+        ChunkMutator(function, false).append(block);
+    }
+    if(block->getSize() == 0) {
+        delete block;
+    }
+
+    if(function->getSize() < readSize) {
+        LOG(1, "disassembly error? " << function->getName()
+            << " " << function->getSize() << " < " << readSize);
+    }
+}
+
 void DisassembleFunctionBase::disassembleCustomBlocks(Function *function,
     address_t readAddress, address_t virtualAddress,
     const std::vector<std::pair<address_t, size_t>> &blockBoundaries) {
@@ -66,6 +66,9 @@ protected:
     void disassembleCustomBlocks(Function *function, address_t readAddress,
         address_t virtualAddress,
         const std::vector<std::pair<address_t, size_t>> &blockBoundaries);
+    Block *appendInstruction(Function *function, Block *block,
+        Instruction *instr, bool split);
+    void finishBlocks(Function *function, Block *block, size_t readSize);
 
     bool shouldSplitBlockAt(cs_insn *ins);
     #ifdef ARCH_RISCV
@@ -77,18 +80,35 @@ protected:
 };
 
 class DisassembleX86Function : public DisassembleFunctionBase {
+public:
+    /** Instructions decoded by one linear sweep over a code section, in
+        address order, so that functions can be built without decoding
+        their bytes again. Instructions are claimed (set to nullptr) as
+        functions take them.
+    */
+    struct Sweep {
+        address_t start;                    // section virtual address
+        size_t end;                         // offset past the last decode
+        std::vector<uint32_t> offsets;      // instruction start offsets
+        std::vector<bool> blockEnds;        // instruction ends a block
+        std::vector<Instruction *> instructions;
+    };
 public:
     using DisassembleFunctionBase::DisassembleFunctionBase;
 
     Function *function(Symbol *symbol, SymbolList *symbolList,
         SymbolList *dynamicSymbolList);
-    Function *fuzzyFunction(const Range &range, ElfSection *section);
+    Function *fuzzyFunction(const Range &range, ElfSection *section,
+        Sweep *sweep = nullptr);
     FunctionList *linearDisassembly(const char *sectionName,
         DwarfUnwindInfo *dwarfInfo, SymbolList *dynamicSymbolList,
         RelocList *relocList);
 private:
     void firstDisassemblyPass(ElfSection *section,
-        IntervalTree &splitRanges, IntervalTree &functionPadding);
+        IntervalTree &splitRanges, IntervalTree &functionPadding,
+        Sweep *sweep = nullptr);
+    bool disassembleFromSweep(Function *function, const Range &range,
+        Sweep *sweep);
 public:
     void disassembleCrtBeginFunctions(ElfSection *section, Range crtbegin,
         IntervalTree &splitRanges);
@@ -1,12 +1,17 @@
 #include "handle.h"
 
-bool DisasmHandle::initialized[2] = {false, false};
-csh DisasmHandle::handle[2];
+thread_local DisasmHandle::ThreadHandles DisasmHandle::handles;
+
+DisasmHandle::ThreadHandles::~ThreadHandles() {
+    for(int i = 0; i < 2; i ++) {
+        if(initialized[i]) cs_close(&handle[i]);
+    }
+}
 
 DisasmHandle::DisasmHandle(bool detailed) {
     this->which = detailed ? 1 : 0;
-    csh *h = &handle[which];
-    if(!initialized[which]) {
+    csh *h = &handles.handle[which];
+    if(!handles.initialized[which]) {
 #ifdef ARCH_X86_64
         if(cs_open(CS_ARCH_X86, CS_MODE_64, h) != CS_ERR_OK) {
             throw "Can't initialize capstone handle!";
@@ -26,7 +31,7 @@ DisasmHandle::DisasmHandle(bool detailed) {
             cs_option(*h, CS_OPT_DETAIL, CS_OPT_ON);
         }
 
-        initialized[which] = true;
+        handles.initialized[which] = true;
     }
 }
 
@@ -3,16 +3,27 @@
 
 #include <capstone/capstone.h>
 
+/** Provides a Capstone handle, with or without instruction details.
+
+    Handles are opened lazily and kept per thread (and closed when the
+    thread exits), so threads can disassemble concurrently.
+*/
 class DisasmHandle {
 private:
-    static bool initialized[2];
-    static csh handle[2];
+    struct ThreadHandles {
+        bool initialized[2];
+        csh handle[2];
+
+        ThreadHandles() : initialized{false, false} {}
+        ~ThreadHandles();
+    };
+    static thread_local ThreadHandles handles;
     int which;
 public:
     DisasmHandle(bool detailed = false);
     ~DisasmHandle();
 
-    csh &raw() { return handle[which]; }
+    csh &raw() { return handles.handle[which]; }
 };
 
 #endif
@@ -70,3 +70,16 @@ int64_t DwarfCursor::parseNextEncodedPointer(uint8_t encoding) {
 
     return result;
 }
+
+size_t DwarfCursor::getEncodedPointerSize(uint8_t encoding) {
+    switch(encoding & 0x0f) {
+    case DW_EH_PE_ptr:      return 8;
+    case DW_EH_PE_udata2:   return 2;
+    case DW_EH_PE_udata4:   return 4;
+    case DW_EH_PE_udata8:   return 8;
+    case DW_EH_PE_sdata2:   return 2;
+    case DW_EH_PE_sdata4:   return 4;
+    case DW_EH_PE_sdata8:   return 8;
+    default:                return 0;
+    }
+}
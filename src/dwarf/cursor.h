@@ -28,6 +28,9 @@ public:
         return *this;
     }
 
+    /** Size of a pointer with encoding, or 0 if its size varies. */
+    static size_t getEncodedPointerSize(uint8_t encoding);
+
     template <typename ElementType>
     ElementType nextEncodedPointer(uint8_t encoding) {
         return static_cast<ElementType>(parseNextEncodedPointer(encoding));
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <algorithm>
 #include "entry.h"
 #include "defines.h"
 
@@ -11,7 +12,7 @@ DwarfCIE::Augmentation::Augmentation() {
 }
 
 DwarfCIE::DwarfCIE(address_t startAddress, uint64_t length, uint64_t index)
-    : DwarfEntry(startAddress, length), index(index) {
+    : DwarfEntry(startAddress, length), index(index), augmentation(nullptr) {
 
     this->cieId = 0;
     this->codeAlignFactor = 0;
@@ -21,7 +22,7 @@ DwarfCIE::DwarfCIE(address_t startAddress, uint64_t length, uint64_t index)
 
 DwarfFDE::DwarfFDE(address_t startAddress, uint64_t length, uint64_t cieIndex)
     : DwarfEntry(startAddress, length), cieIndex(cieIndex), ciePointer(0),
-    pcBegin(0), pcRange(0) {
+    pcBegin(0), pcRange(0), augmentation(nullptr) {
 
 }
 
@@ -47,3 +48,23 @@ DwarfCIE *DwarfUnwindInfo::getCIE(uint64_t cieIndex) {
     assert(cieIndex < cieList.size());
     return cieList[cieIndex];
 }
+
+DwarfFDE *DwarfUnwindInfo::findFDE(address_t address) {
+    if(sortedFDEList.size() != fdeList.size()) {
+        sortedFDEList = fdeList;
+        std::sort(sortedFDEList.begin(), sortedFDEList.end(),
+            [] (DwarfFDE *a, DwarfFDE *b) {
+                return a->getPcBegin() < b->getPcBegin();
+            });
+    }
+
+    // last FDE starting at or before address
+    auto it = std::upper_bound(sortedFDEList.begin(), sortedFDEList.end(),
+        address, [] (address_t address, DwarfFDE *fde) {
+            return static_cast<int64_t>(address) < fde->getPcBegin();
+        });
+    if(it == sortedFDEList.begin()) return nullptr;
+    auto fde = *(it - 1);
+    if(address >= fde->getPcBegin() + fde->getPcRange()) return nullptr;
+    return fde;
+}
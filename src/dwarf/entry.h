@@ -13,15 +13,22 @@ private:
     address_t startAddress;
     uint64_t length;        // size of CIE structure, excluding length field
     DwarfState *state;
+    address_t instructionStart;  // read address of the CFA instructions
+    address_t instructionEnd;
 public:
     DwarfEntry(address_t startAddress, uint64_t length)
-        : startAddress(startAddress), length(length), state(nullptr) {}
+        : startAddress(startAddress), length(length), state(nullptr),
+        instructionStart(0), instructionEnd(0) {}
 
     void setState(DwarfState *state) { this->state = state; }
+    void setInstructions(address_t start, address_t end)
+        { instructionStart = start, instructionEnd = end; }
 
     address_t getStartAddress() const { return startAddress; }
     uint64_t getLength() const { return length; }
     DwarfState *getState() const { return state; }
+    address_t getInstructionStart() const { return instructionStart; }
+    address_t getInstructionEnd() const { return instructionEnd; }
 };
 
 // Dwarf Common Information Entry (CIE)
@@ -121,6 +128,7 @@ private:
     std::vector<DwarfCIE *> cieList;
     std::vector<DwarfFDE *> fdeList;
     std::unordered_map<address_t, uint64_t> cieMap;
+    std::vector<DwarfFDE *> sortedFDEList;  // by pcBegin, built on demand
 public:
     void addCIE(DwarfCIE *cie);
     void addFDE(DwarfFDE *fde);
@@ -129,6 +137,9 @@ public:
     bool findCIE(address_t address, uint64_t *index);
     DwarfCIE *getCIE(size_t cieIndex);
 
+    /** Finds the FDE whose code range contains address, if any. */
+    DwarfFDE *findFDE(address_t address);
+
     std::vector<DwarfCIE *>::iterator cieBegin() { return cieList.begin(); }
     std::vector<DwarfCIE *>::iterator cieEnd() { return cieList.end(); }
     std::vector<DwarfFDE *>::iterator fdeBegin() { return fdeList.begin(); }
@@ -0,0 +1,139 @@
+#include <set>
+#include <algorithm>
+#include "lsda.h"
+#include "cursor.h"
+#include "defines.h"
+#include "elf/elfmap.h"
+#include "log/log.h"
+
+DwarfLSDAParser::DwarfLSDAParser(ElfMap *elfMap)
+    : readAddress(0), virtualAddress(0), size(0) {
+
+    if(auto section = elfMap->findSection(".gcc_except_table")) {
+        this->readAddress = section->getReadAddress();
+        this->virtualAddress = section->getVirtualAddress();
+        this->size = section->getSize();
+    }
+}
+
+DwarfLSDA *DwarfLSDAParser::parse(address_t address) {
+    if(address < virtualAddress || address >= virtualAddress + size) {
+        LOG(1, "LSDA at 0x" << std::hex << address
+            << " is outside .gcc_except_table");
+        return nullptr;
+    }
+    const address_t end = readAddress + size;
+    DwarfCursor cursor(readAddress + (address - virtualAddress));
+
+    // landing pads must be offsets from the start of the function
+    if(cursor.next<uint8_t>() != DW_EH_PE_omit) {
+        LOG(1, "LSDA at 0x" << std::hex << address
+            << " has its own landing pad base");
+        return nullptr;
+    }
+
+    uint8_t typeEncoding = cursor.next<uint8_t>();
+    address_t typeBase = 0;
+    if(typeEncoding != DW_EH_PE_omit) {
+        auto offset = cursor.nextUleb128();
+        typeBase = cursor.getCursor() + offset;
+    }
+
+    uint8_t callSiteEncoding = cursor.next<uint8_t>();
+    auto callSiteLength = cursor.nextUleb128();
+    const address_t actionStart = cursor.getCursor() + callSiteLength;
+    if((callSiteEncoding & 0x70) != DW_EH_PE_absptr || actionStart > end) {
+        LOG(1, "LSDA at 0x" << std::hex << address
+            << " has an unexpected call-site table");
+        return nullptr;
+    }
+
+    auto lsda = new DwarfLSDA(typeEncoding);
+    address_t actionEnd = actionStart;
+    int64_t typeCount = 0;
+    std::vector<address_t> specList;
+    while(cursor.getCursor() < actionStart) {
+        DwarfLSDA::CallSite site;
+        site.start = cursor.nextEncodedPointer<address_t>(callSiteEncoding);
+        site.length = cursor.nextEncodedPointer<address_t>(callSiteEncoding);
+        site.landingPad
+            = cursor.nextEncodedPointer<address_t>(callSiteEncoding);
+        site.action = cursor.nextUleb128();
+        if(site.action && !parseActions(actionStart + site.action - 1,
+            actionStart, &actionEnd, &typeCount, specList)) {
+
+            delete lsda;
+            return nullptr;
+        }
+        lsda->addCallSite(site);
+    }
+    lsda->setActionTable(std::string(
+        reinterpret_cast<const char *>(actionStart), actionEnd - actionStart));
+    if(!typeCount && specList.empty()) return lsda;
+
+    // exception specifications are lists of type indices, ending in 0
+    address_t specEnd = typeBase;
+    for(auto spec : specList) {
+        DwarfCursor list(typeBase + spec);
+        while(list.getCursor() < end) {
+            auto index = static_cast<int64_t>(list.nextUleb128());
+            if(!index) break;
+            typeCount = std::max(typeCount, index);
+        }
+        specEnd = std::max(specEnd, list.getCursor());
+    }
+
+    const size_t typeSize = DwarfCursor::getEncodedPointerSize(typeEncoding);
+    const uint8_t application = typeEncoding & 0x70;
+    if(typeEncoding == DW_EH_PE_omit || !typeSize
+        || (application != DW_EH_PE_absptr && application != DW_EH_PE_pcrel)
+        || specEnd > end || typeBase < actionEnd + typeCount * typeSize) {
+
+        LOG(1, "LSDA at 0x" << std::hex << address
+            << " has a type table that cannot be moved");
+        delete lsda;
+        return nullptr;
+    }
+
+    for(int64_t i = 1; i <= typeCount; i ++) {
+        address_t entry = typeBase - i * typeSize;
+        DwarfCursor type(entry);
+        address_t value = type.nextEncodedPointer<address_t>(typeEncoding);
+        if(application == DW_EH_PE_pcrel) {
+            // a zero entry stays zero, and catches everything
+            value = (value == entry) ? 0
+                : value - readAddress + virtualAddress;
+        }
+        lsda->addType(value);
+    }
+    lsda->setSpecTable(std::string(
+        reinterpret_cast<const char *>(typeBase), specEnd - typeBase));
+    return lsda;
+}
+
+/** Follows the chain of action records that starts at record. */
+bool DwarfLSDAParser::parseActions(address_t record, address_t tableStart,
+    address_t *tableEnd, int64_t *typeCount,
+    std::vector<address_t> &specList) {
+
+    const address_t end = readAddress + size;
+    std::set<address_t> seen;
+    while(seen.insert(record).second) {
+        if(record < tableStart || record >= end) {
+            LOG(1, "LSDA action record is outside .gcc_except_table");
+            return false;
+        }
+        DwarfCursor cursor(record);
+        int64_t filter = cursor.nextSleb128();
+        address_t next = cursor.getCursor();
+        int64_t displacement = cursor.nextSleb128();
+        *tableEnd = std::max(*tableEnd, cursor.getCursor());
+
+        if(filter > 0) *typeCount = std::max(*typeCount, filter);
+        else if(filter < 0) specList.push_back(-filter - 1);
+
+        if(!displacement) break;
+        record = next + displacement;
+    }
+    return true;
+}
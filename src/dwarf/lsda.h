@@ -0,0 +1,67 @@
+#ifndef EGALITO_DWARF_LSDA_H
+#define EGALITO_DWARF_LSDA_H
+
+#include <string>
+#include <vector>
+#include "types.h"
+
+class ElfMap;
+
+/** One function's language-specific data area in .gcc_except_table, as
+    used by C++ exception handling. Call sites and landing pads are code
+    offsets from the start of the function, and the type table is decoded
+    into addresses. The action and exception specification tables refer
+    to neither, and are kept as raw bytes.
+*/
+class DwarfLSDA {
+public:
+    struct CallSite {
+        address_t start;
+        address_t length;
+        address_t landingPad;  // 0 if none
+        uint64_t action;       // 1 + offset into the action table, or 0
+    };
+private:
+    std::vector<CallSite> callSiteList;
+    std::string actionTable;
+    uint8_t typeEncoding;
+    std::vector<address_t> typeList;  // from filter 1 on; 0 catches all
+    std::string specTable;
+public:
+    DwarfLSDA(uint8_t typeEncoding) : typeEncoding(typeEncoding) {}
+
+    void addCallSite(const CallSite &site) { callSiteList.push_back(site); }
+    void setActionTable(const std::string &table) { actionTable = table; }
+    void addType(address_t type) { typeList.push_back(type); }
+    void setSpecTable(const std::string &table) { specTable = table; }
+
+    const std::vector<CallSite> &getCallSiteList() const
+        { return callSiteList; }
+    const std::string &getActionTable() const { return actionTable; }
+    uint8_t getTypeEncoding() const { return typeEncoding; }
+    const std::vector<address_t> &getTypeList() const { return typeList; }
+    const std::string &getSpecTable() const { return specTable; }
+};
+
+/** Parses entries of .gcc_except_table. Only entries that can be written
+    back at another address are accepted: landing pads must be relative
+    to the function, and type table entries must be fixed-size absolute
+    or pc-relative pointers.
+*/
+class DwarfLSDAParser {
+private:
+    address_t readAddress;
+    address_t virtualAddress;
+    size_t size;
+public:
+    DwarfLSDAParser(ElfMap *elfMap);
+
+    /** Returns nullptr if the entry at address cannot be parsed. */
+    DwarfLSDA *parse(address_t address);
+private:
+    bool parseActions(address_t record, address_t tableStart,
+        address_t *tableEnd, int64_t *typeCount,
+        std::vector<address_t> &specList);
+};
+
+#endif
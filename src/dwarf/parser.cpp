@@ -141,8 +141,8 @@ DwarfCIE *DwarfParser::parseCIE(DwarfCursor start, DwarfCursor end,
             switch(static_cast<char>(*ptr)) {
             case 'P':
                 augmentation->setPersonalityEncoding(start.next<uint8_t>());
-                augmentation->setPersonalityEncodingRoutine(
-                    start.nextEncodedPointer<uint64_t>(augmentation->getPersonalityEncoding()));
+                augmentation->setPersonalityEncodingRoutine(nextVirtualPointer(
+                    start, augmentation->getPersonalityEncoding()));
                 break;
             case 'R':
                 augmentation->setCodeEnc(start.next<uint8_t>());
@@ -171,6 +171,7 @@ DwarfCIE *DwarfParser::parseCIE(DwarfCursor start, DwarfCursor end,
     CLOG(10, "  Return address column: %lu", cie->getRetAddressReg());
     CLOG(10, "");
 
+    cie->setInstructions(start.getCursor(), end.getCursor());
     DwarfInstructionDecoder decoder(start, end, cie, 0);
     auto state = decoder.parseInstructions();
     cie->setState(state);
@@ -192,14 +193,18 @@ DwarfFDE *DwarfParser::parseFDE(DwarfCursor start, DwarfCursor end,
     fde->setPcRange(start.nextEncodedPointer<uint64_t>(codeEnc & 0x0f));
 
     if(cie->getAugmentation()) {  // if CIE has augmentation, so do FDEs
-        start.nextUleb128();  // skip the augmentation length
+        auto augmentationLength = start.nextUleb128();
+        DwarfCursor instructions = start;
+        instructions.skip(augmentationLength);
 
         // will be set to 0 if the LSDA encoding is DW_EH_PE_omit
-        const auto lsdaPointer = start.nextEncodedPointer<uint64_t>(
+        const auto lsdaPointer = nextVirtualPointer(start,
             cie->getAugmentation()->getLsdaEnc());
 
         fde->setAugmentation(new DwarfFDE::Augmentation(lsdaPointer));
+        start = instructions;
     }
+    fde->setInstructions(start.getCursor(), end.getCursor());
 
     CLOG(10, "\n%08lx %016lx %08lx FDE cie=%08lx pc=%016lx..%016lx",
         start.getStart() - readAddress, length,
@@ -208,13 +213,29 @@ DwarfFDE *DwarfParser::parseFDE(DwarfCursor start, DwarfCursor end,
         fde->getPcBegin(), 
         fde->getPcBegin() + fde->getPcRange());
     DwarfInstructionDecoder decoder(start, end, cie, fde->getPcBegin());
-    // XXX: temporarily disable DWARF instructions parsing, as we only use the
-    // extracted function bounds.
+    // instructions are decoded per function when needed, see
+    // DwarfRowSplitter.
     /*auto state = decoder.parseInstructions();
     fde->setState(state);*/
     return fde;
 }
 
+/** Like DwarfCursor::nextEncodedPointer(), but pc-relative pointers are
+    resolved against the virtual address of the cursor. A zero value stays
+    zero (no pointer), as in the unwinder.
+*/
+uint64_t DwarfParser::nextVirtualPointer(DwarfCursor &cursor,
+    uint8_t encoding) {
+
+    address_t location = cursor.getCursor();
+    auto pointer = cursor.nextEncodedPointer<uint64_t>(encoding);
+    if(encoding != DW_EH_PE_omit && (encoding & 0x70) == DW_EH_PE_pcrel) {
+        if(pointer == location) return 0;
+        pointer += virtualAddress - readAddress;
+    }
+    return pointer;
+}
+
 // ----
 // DwarfExpressionDecoder and DwarfInstructionDecoder follow
 
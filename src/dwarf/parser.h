@@ -33,6 +33,7 @@ private:
         uint64_t index);
     DwarfFDE *parseFDE(DwarfCursor start, DwarfCursor end, uint64_t length,
         size_t cieIndex, uint32_t entryID);
+    uint64_t nextVirtualPointer(DwarfCursor &cursor, uint8_t encoding);
 };
 
 #endif
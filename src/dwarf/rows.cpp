@@ -0,0 +1,127 @@
+#include "rows.h"
+#include "entry.h"
+#include "cursor.h"
+#include "defines.h"
+#include "log/log.h"
+
+bool DwarfRowSplitter::split(DwarfFDE *fde, RowList &rowList) {
+    const uint64_t codeAlignFactor = cie->getCodeAlignFactor();
+    DwarfCursor start(fde->getInstructionStart());
+    DwarfCursor end(fde->getInstructionEnd());
+    address_t offset = 0;
+
+    rowList.clear();
+    rowList.emplace_back(0, std::string());
+
+    while(start < end) {
+        address_t opStart = start.getCursor();
+        uint8_t opcode = start.next<uint8_t>();
+        uint64_t advance = 0;
+        bool isAdvance = false;
+        uint64_t length;
+
+        switch(opcode & 0xc0) {
+        case DW_CFA_advance_loc:
+            advance = opcode & 0x3f;
+            isAdvance = true;
+            break;
+        case DW_CFA_offset:
+            start.nextUleb128();
+            break;
+        case DW_CFA_restore:
+            break;
+        default:
+            switch(opcode) {
+            case DW_CFA_nop:
+                continue;  // only padding, drop it
+            case DW_CFA_advance_loc1:
+                advance = start.next<uint8_t>();
+                isAdvance = true;
+                break;
+            case DW_CFA_advance_loc2:
+                advance = start.next<uint16_t>();
+                isAdvance = true;
+                break;
+            case DW_CFA_advance_loc4:
+                advance = start.next<uint32_t>();
+                isAdvance = true;
+                break;
+            case DW_CFA_MIPS_advance_loc8:
+                advance = start.next<uint64_t>();
+                isAdvance = true;
+                break;
+
+            case DW_CFA_remember_state:
+            case DW_CFA_restore_state:
+            case DW_CFA_GNU_window_save:
+                break;
+
+            case DW_CFA_restore_extended:
+            case DW_CFA_undefined:
+            case DW_CFA_same_value:
+            case DW_CFA_def_cfa_register:
+            case DW_CFA_def_cfa_offset:
+            case DW_CFA_GNU_args_size:
+                start.nextUleb128();
+                break;
+
+            case DW_CFA_offset_extended:
+            case DW_CFA_register:
+            case DW_CFA_def_cfa:
+            case DW_CFA_val_offset:
+            case DW_CFA_GNU_negative_offset_extended:
+                start.nextUleb128();
+                start.nextUleb128();
+                break;
+
+            case DW_CFA_offset_extended_sf:
+            case DW_CFA_def_cfa_sf:
+            case DW_CFA_val_offset_sf:
+                start.nextUleb128();
+                start.nextSleb128();
+                break;
+
+            case DW_CFA_def_cfa_offset_sf:
+                start.nextSleb128();
+                break;
+
+            case DW_CFA_def_cfa_expression:
+                length = start.nextUleb128();
+                start.skip(length);
+                break;
+
+            case DW_CFA_expression:
+            case DW_CFA_val_expression:
+                start.nextUleb128();
+                length = start.nextUleb128();
+                start.skip(length);
+                break;
+
+            case DW_CFA_set_loc:
+            default:
+                LOG(1, "can't split CFA instructions with opcode 0x"
+                    << std::hex << static_cast<int>(opcode));
+                return false;
+            }
+        }
+
+        if(isAdvance) {
+            offset += advance * codeAlignFactor;
+            if(rowList.size() > 1 && rowList.back().second.empty()) {
+                rowList.back().first = offset;
+            }
+            else {
+                rowList.emplace_back(offset, std::string());
+            }
+        }
+        else {
+            rowList.back().second.append(reinterpret_cast<const char *>(opStart),
+                start.getCursor() - opStart);
+        }
+    }
+
+    if(rowList.size() > 1 && rowList.back().second.empty()) {
+        rowList.pop_back();
+    }
+    return true;
+}
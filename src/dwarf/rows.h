@@ -0,0 +1,32 @@
+#ifndef EGALITO_DWARF_ROWS_H
+#define EGALITO_DWARF_ROWS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "types.h"
+
+class DwarfCIE;
+class DwarfFDE;
+
+/** Splits the CFA instructions of an FDE at its advance instructions.
+    Each row holds the raw instructions that take effect at one code
+    offset from the start of the FDE. Apart from the advances, CFA
+    instructions do not depend on code addresses, so the rows can be
+    replayed at new offsets once the code has moved.
+*/
+class DwarfRowSplitter {
+public:
+    typedef std::vector<std::pair<address_t, std::string>> RowList;
+private:
+    DwarfCIE *cie;
+public:
+    DwarfRowSplitter(DwarfCIE *cie) : cie(cie) {}
+
+    /** Returns false if the instructions use DW_CFA_set_loc or an opcode
+        this does not know the length of.
+    */
+    bool split(DwarfFDE *fde, RowList &rowList);
+};
+
+#endif
@@ -22,7 +22,7 @@
 #include "config.h"
 
 ElfSpace::ElfSpace(ElfMap *elf, const std::string &name,
-    const std::string &fullPath) : elf(elf), dwarf(nullptr),
+    const std::string &fullPath) : elf(elf), dwarf(nullptr), dwarfParsed(false),
     name(name), fullPath(fullPath), module(nullptr),
     symbolList(nullptr), dynamicSymbolList(nullptr),
     relocList(nullptr), aliasMap(nullptr) {
@@ -48,11 +48,6 @@ void ElfSpace::findSymbolsAndRelocs() {
         this->symbolList = SymbolList::buildSymbolList(elf);
     }
 
-    if(!symbolList) {
-        DwarfParser dwarfParser(elf);
-        this->dwarf = dwarfParser.getUnwindInfo();
-    }
-
     if(elf->isDynamic()) {
         this->dynamicSymbolList = SymbolList::buildDynamicSymbolList(elf);
     }
@@ -61,6 +56,15 @@ void ElfSpace::findSymbolsAndRelocs() {
         = RelocList::buildRelocList(elf, symbolList, dynamicSymbolList);
 }
 
+DwarfUnwindInfo *ElfSpace::getDwarfInfo() {
+    if(!dwarfParsed) {
+        DwarfParser dwarfParser(elf);
+        this->dwarf = dwarfParser.getUnwindInfo();
+        dwarfParsed = true;
+    }
+    return dwarf;
+}
+
 std::string ElfSpace::getAlternativeSymbolFile() const {
     auto buildIdSection = elf->findSection(".note.gnu.build-id");
     if(buildIdSection) {
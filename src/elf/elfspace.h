@@ -16,6 +16,7 @@ class ElfSpace {
 private:
     ElfMap *elf;
     DwarfUnwindInfo *dwarf;
+    bool dwarfParsed;
     std::string name;
     std::string fullPath;
     Module *module;
@@ -41,7 +42,11 @@ public:
     SymbolList *getSymbolList() const { return symbolList; }
     SymbolList *getDynamicSymbolList() const { return dynamicSymbolList; }
     RelocList *getRelocList() const { return relocList; }
-    DwarfUnwindInfo *getDwarfInfo() const { return dwarf; }
+
+    /** Parses .eh_frame the first time it is asked for; null if there is
+        no .eh_frame.
+    */
+    DwarfUnwindInfo *getDwarfInfo();
 
     FunctionAliasMap *getAliasMap() const { return aliasMap; }
     void setAliasMap(FunctionAliasMap *aliasMap) { this->aliasMap = aliasMap; }
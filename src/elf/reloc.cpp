@@ -17,6 +17,11 @@ void RelocSection::add(Reloc *reloc) {
     relocList.push_back(reloc);
 }
 
+void RelocList::reserve(size_t count) {
+    relocList.reserve(count);
+    relocMap.reserve(count);
+}
+
 bool RelocList::add(Reloc *reloc) {
     relocList.push_back(reloc);
     address_t address = reloc->getAddress();
@@ -69,6 +74,7 @@ RelocList *RelocList::buildRelocList(ElfMap *elf, SymbolList *symbolList,
             elf->getCharmap() + s->sh_offset);
 
         size_t count = s->sh_size / sizeof(*data);
+        list->reserve(list->relocList.size() + count);
         for(size_t i = 0; i < count; i ++) {
             ElfXX_Rela *r = &data[i];
             auto symbolIndex = ELFXX_R_SYM(r->r_info);
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <elf.h>
 
@@ -66,11 +67,12 @@ class RelocList {
 private:
     typedef std::vector<Reloc *> ListType;
     ListType relocList;
-    typedef std::map<address_t, Reloc *> MapType;
-    MapType relocMap;
+    typedef std::unordered_map<address_t, Reloc *> MapType;
+    MapType relocMap;   // first reloc at each address
     typedef std::map<std::string, RelocSection *> SectionListType;
     SectionListType sectionList;
 public:
+    void reserve(size_t count);
     bool add(Reloc *reloc);
 
     ListType::iterator begin() { return relocList.begin(); }
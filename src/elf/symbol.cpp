@@ -55,21 +55,40 @@ bool Symbol::isMarker() const {
         && shndx > 0;
 }
 
+void SymbolList::reserve(size_t count) {
+    symbolList.reserve(count);
+    indexMap.reserve(count);
+    spaceList.reserve(count);
+
+    size_t size = 16;
+    while(size * 3 < count * 4) size *= 2;
+    if(size > nameTable.size()) resizeNameTable(size);
+}
+
 bool SymbolList::add(Symbol *symbol, size_t index) {
     // Can't check just by name since it may not be unique
-    //auto it = symbolMap.find(symbol->getName());
-    //if(it != symbolMap.end()) return false;
 
     symbolList.push_back(symbol);
     if(indexMap.size() <= index) indexMap.resize(index + 1);
     indexMap[index] = symbol;
-    if(symbolMap.find(symbol->getName()) == symbolMap.end()) {
-        symbolMap[symbol->getName()] = symbol;
-    }
+    addName(symbol->getName(), symbol);
     if(symbol->getType() != Symbol::TYPE_SECTION
         && symbol->getName()[0] != '$') {
 
-        spaceMap[symbol->getAddress()] = symbol;
+        if(spaceListSorted) {
+            auto address = symbol->getAddress();
+            auto it = spaceList.begin()
+                + (findSpace(address) - spaceList.cbegin());
+            if(it != spaceList.end() && (*it).first == address) {
+                (*it).second = symbol;
+            }
+            else {
+                spaceList.emplace(it, address, symbol);
+            }
+        }
+        else {
+            spaceList.emplace_back(symbol->getAddress(), symbol);
+        }
     }
     return true;
 }
@@ -85,22 +104,26 @@ Symbol *SymbolList::get(size_t index) {
 }
 
 Symbol *SymbolList::find(const char *name) {
-    auto it = symbolMap.find(name);
-    if(it != symbolMap.end()) {
-        auto sym = (*it).second;
-        if(sym->getAliasFor()) {
-            sym = sym->getAliasFor();
+    if(nameTable.empty()) return nullptr;
+
+    size_t hash = hashName(name);
+    size_t mask = nameTable.size() - 1;
+    for(size_t i = hash & mask; nameTable[i].symbol; i = (i + 1) & mask) {
+        const auto &slot = nameTable[i];
+        if(slot.hash == hash && !strcmp(slot.name, name)) {
+            auto sym = slot.symbol;
+            if(sym->getAliasFor()) {
+                sym = sym->getAliasFor();
+            }
+            return sym;
         }
-        return sym;
-    }
-    else {
-        return nullptr;
     }
+    return nullptr;
 }
 
 Symbol *SymbolList::find(address_t address) {
-    auto it = spaceMap.find(address);
-    if(it != spaceMap.end()) {
+    auto it = findSpace(address);
+    if(it != spaceList.end() && (*it).first == address) {
         auto sym = (*it).second;
         if(sym->getAliasFor()) {
             sym = sym->getAliasFor();
@@ -112,6 +135,79 @@ Symbol *SymbolList::find(address_t address) {
     }
 }
 
+size_t SymbolList::hashName(const char *name) {
+    // FNV-1a
+    size_t hash = 14695981039346656037ull;
+    for(const char *p = name; *p; p ++) {
+        hash ^= static_cast<unsigned char>(*p);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void SymbolList::addName(const char *name, Symbol *symbol) {
+    // keep the load factor at most 3/4
+    if((nameCount + 1) * 4 > nameTable.size() * 3) {
+        resizeNameTable(nameTable.empty() ? 16 : nameTable.size() * 2);
+    }
+
+    size_t hash = hashName(name);
+    size_t mask = nameTable.size() - 1;
+    size_t i = hash & mask;
+    for( ; nameTable[i].symbol; i = (i + 1) & mask) {
+        const auto &slot = nameTable[i];
+        if(slot.hash == hash && !strcmp(slot.name, name)) {
+            return;  // the first symbol with this name is kept
+        }
+    }
+    nameTable[i] = NameSlot{name, hash, symbol};
+    nameCount ++;
+}
+
+void SymbolList::resizeNameTable(size_t size) {
+    NameTableType oldTable(size, NameSlot{nullptr, 0, nullptr});
+    oldTable.swap(nameTable);
+
+    size_t mask = size - 1;
+    for(const auto &slot : oldTable) {
+        if(!slot.symbol) continue;
+        size_t i = slot.hash & mask;
+        while(nameTable[i].symbol) i = (i + 1) & mask;
+        nameTable[i] = slot;
+    }
+}
+
+SymbolList::SpaceListType::const_iterator SymbolList::findSpace(
+    address_t address) const {
+
+    return std::lower_bound(spaceList.begin(), spaceList.end(), address,
+        [](const std::pair<address_t, Symbol *> &a, address_t address) {
+            return a.first < address;
+        });
+}
+
+void SymbolList::sortSpaceList() {
+    std::stable_sort(spaceList.begin(), spaceList.end(),
+        [](const std::pair<address_t, Symbol *> &a,
+            const std::pair<address_t, Symbol *> &b) {
+
+            return a.first < b.first;
+        });
+
+    // stable, so the symbol added last at each address is the one kept
+    size_t count = 0;
+    for(const auto &entry : spaceList) {
+        if(count > 0 && spaceList[count - 1].first == entry.first) {
+            spaceList[count - 1] = entry;
+        }
+        else {
+            spaceList[count ++] = entry;
+        }
+    }
+    spaceList.resize(count);
+    spaceListSorted = true;
+}
+
 SymbolList *SymbolList::buildSymbolList(ElfMap *elfMap,
     std::string symbolFile) {
 
@@ -357,6 +453,7 @@ SymbolList *SymbolList::buildAnySymbolList(ElfMap *elfMap,
     auto sym = elfMap->getSectionReadPtr<ElfXX_Sym *>(section);
     auto s = section->getHeader();
     int symcount = s->sh_size / s->sh_entsize;
+    list->reserve(symcount);
     for(int j = 0; j < symcount; j ++, sym ++) {
         auto type = Symbol::typeFromElfToInternal(sym->st_info);
         auto bind = Symbol::bindFromElfToInternal(sym->st_info);
@@ -398,6 +495,7 @@ SymbolList *SymbolList::buildAnySymbolList(ElfMap *elfMap,
         list->add(symbol, (size_t)j);
     }
 
+    list->sortSpaceList();
     list->buildMappingList();
     return list;
 }
@@ -454,8 +552,8 @@ Symbol *SymbolListWithMapping::findMappingAbove(Symbol *symbol) {
 }
 
 size_t SymbolList::estimateSizeOf(Symbol *symbol) {
-    auto it = spaceMap.upper_bound(symbol->getAddress());
-    while(it != spaceMap.end()) {
+    auto it = findSpace(symbol->getAddress() + 1);
+    while(it != spaceList.end()) {
         Symbol *other = (*it).second;
         // for AARCH64, if the next symbol is a mapping symbol, then it is
         // still part of the same function
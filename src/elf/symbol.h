@@ -118,21 +118,39 @@ private:
     bool hasVersionInfo() const { return verList.size() > 0; }
 };
 
+/** Symbols of one ELF symbol table. Names are looked up in an open
+    addressing hash table whose keys point into the string table (the first
+    symbol with a name wins), and addresses in an array that is sorted once
+    the whole table has been added (the last symbol added at an address
+    wins). Symbols added after that, such as ones made up by passes, are
+    inserted in address order. Lookups do not modify the list, so they may
+    run concurrently.
+*/
 class SymbolList {
 private:
     typedef std::vector<Symbol *> ListType;
     ListType symbolList;
     typedef std::vector<Symbol *> IndexMapType;
     IndexMapType indexMap;
-    typedef std::map<std::string, Symbol *> MapType;
-    MapType symbolMap;
-    std::map<address_t, Symbol *> spaceMap;
+    struct NameSlot {
+        const char *name;   // name when added, even if the symbol is renamed
+        size_t hash;
+        Symbol *symbol;     // nullptr if the slot is empty
+    };
+    typedef std::vector<NameSlot> NameTableType;
+    NameTableType nameTable;    // size is zero or a power of two
+    size_t nameCount;
+    typedef std::vector<std::pair<address_t, Symbol *>> SpaceListType;
+    SpaceListType spaceList;    // sorted by buildAnySymbolList()
+    bool spaceListSorted;
     // elfmap this symbol list was built from. this may be a separate symbol elfmap.
     ElfMap *sourceElfMap;
 public:
-    SymbolList(ElfMap *sourceElfMap = nullptr) : sourceElfMap(sourceElfMap) {}
+    SymbolList(ElfMap *sourceElfMap = nullptr) : nameCount(0),
+        spaceListSorted(false), sourceElfMap(sourceElfMap) {}
     virtual ~SymbolList() {}
 
+    void reserve(size_t count);
     bool add(Symbol *symbol, size_t index);
     void addAlias(Symbol *symbol, size_t otherIndex);
     Symbol *get(size_t index);
@@ -158,6 +176,12 @@ private:
     static SymbolList *buildAnySymbolList(ElfMap *elfMap,
         const char *sectionName, unsigned sectionType);
     static Symbol *findSizeZero(SymbolList *list, const char *sym);
+
+    static size_t hashName(const char *name);
+    void addName(const char *name, Symbol *symbol);
+    void resizeNameTable(size_t size);
+    SpaceListType::const_iterator findSpace(address_t address) const;
+    void sortSpaceList();
 };
 
 class SymbolListWithMapping : public SymbolList {
@@ -5,6 +5,7 @@
 #include "modulegen.h"
 #include "sectionlist.h"
 #include "concretedeferred.h"
+#include "ehframe.h"
 #include "transform/sandbox.h"
 #include "chunk/concrete.h"
 #include "operation/find2.h"
@@ -78,6 +79,13 @@ void BasicElfCreator::execute() {
             auto gnuhashSection = new Section(".gnu.hash", SHT_GNU_HASH, SHF_ALLOC);
             gnuhashSection->setContent(gnuhash);
             getSectionList()->addSection(gnuhashSection);
+
+            if(getConfig()->isSysvHash()) {
+                auto hash = new HashSectionContent();
+                auto hashSection = new Section(".hash", SHT_HASH, SHF_ALLOC);
+                hashSection->setContent(hash);
+                getSectionList()->addSection(hashSection);
+            }
         }
 
         // .rela.dyn
@@ -263,6 +271,13 @@ void GenerateSectionTable::makeShdrTable() {
                     shdr->sh_link = sectionList->indexOf(".dynsym");
                 });
             }
+            else if(auto v = dynamic_cast<HashSectionContent *>(section->getContent())) {
+                deferred->addFunction([this, sectionList, v] (ElfXX_Shdr *shdr) {
+                    shdr->sh_addralign = 8;
+                    shdr->sh_entsize = sizeof(uint32_t);
+                    shdr->sh_link = sectionList->indexOf(".dynsym");
+                });
+            }
             else if(auto v = dynamic_cast<TBSSContent *>(section->getContent())) {
                 deferred->addFunction([this, sectionList, v] (ElfXX_Shdr *shdr) {
                     shdr->sh_size = v->getMemSize();
@@ -405,6 +420,12 @@ void BasicElfStructure::makeDynamicSection() {
             auto gnuhashSection = getSection(".gnu.hash");
             return gnuhashSection->getHeader()->getAddress();
         });
+        if(getConfig()->isSysvHash()) {
+            dynamic->addPair(DT_HASH, [this] () {
+                auto hashSection = getSection(".hash");
+                return hashSection->getHeader()->getAddress();
+            });
+        }
     }
 
     dynamic->addPair(DT_RELA, [this] () {
@@ -498,6 +519,7 @@ void AssignSectionsToSegments::execute() {
         dynSegment->addContains(getSection(".dynsym"));
         if(!getConfig()->isUnionOutput()) {
             dynSegment->addContains(getSection(".gnu.hash"));
+            if(auto s = getSection(".hash")) dynSegment->addContains(s);
         }
         dynSegment->addContains(getSection(".rela.dyn"));
         dynSegment->addContains(getSection(".dynamic"));
@@ -560,6 +582,64 @@ void TextSectionCreator::execute() {
     phdrTable->add(loadSegment);
 }
 
+void MakeEhFrame::execute() {
+    // the page after the code, as placed by TextSectionCreator
+    auto backing = getData()->getBacking();
+    address_t address = (backing->getBase() + backing->getBuffer().length()
+        + 0xfff) & ~0xfff;
+
+    EhFrameBuilder builder(address);
+    size_t dropped = 0;
+    for(auto module : CIter::children(getData()->getProgram())) {
+        for(auto function : CIter::functions(module)) {
+            if(!function->getUnwind()) continue;
+            if(!builder.add(function)) dropped ++;
+        }
+    }
+    LOG(1, "regenerated " << std::dec << builder.getFDECount()
+        << " FDEs, dropped " << dropped);
+    if(builder.getFDECount() == 0) return;
+
+    MakePaddingSection makePadding(0);
+    makePadding.setData(getData());
+    makePadding.setConfig(getConfig());
+    makePadding.execute();
+
+    auto frame = builder.getFrame();
+    auto frameSection = new Section(".eh_frame", SHT_PROGBITS, SHF_ALLOC);
+    frameSection->setContent(new DeferredString(frame));
+    frameSection->getHeader()->setAddress(address);
+    getSectionList()->addSection(frameSection);
+
+    address_t hdrAddress = address + frame.length();
+    auto exceptTable = builder.getExceptTable();
+    Section *tableSection = nullptr;
+    if(!exceptTable.empty()) {
+        tableSection = new Section(".gcc_except_table", SHT_PROGBITS,
+            SHF_ALLOC);
+        tableSection->setContent(new DeferredString(exceptTable));
+        tableSection->getHeader()->setAddress(hdrAddress);
+        getSectionList()->addSection(tableSection);
+        hdrAddress += exceptTable.length();
+    }
+
+    auto hdrSection = new Section(".eh_frame_hdr", SHT_PROGBITS, SHF_ALLOC);
+    hdrSection->setContent(new DeferredString(builder.getHeader(hdrAddress)));
+    hdrSection->getHeader()->setAddress(hdrAddress);
+    getSectionList()->addSection(hdrSection);
+
+    auto phdrTable = getSection("=phdr_table")->castAs<PhdrTableContent *>();
+    auto loadSegment = new SegmentInfo(PT_LOAD, PF_R, 0x1000);
+    loadSegment->addContains(frameSection);
+    if(tableSection) loadSegment->addContains(tableSection);
+    loadSegment->addContains(hdrSection);
+    phdrTable->add(loadSegment);
+
+    auto ehFrameSegment = new SegmentInfo(PT_GNU_EH_FRAME, PF_R, 0x4);
+    ehFrameSegment->addContains(hdrSection);
+    phdrTable->add(ehFrameSegment);
+}
+
 MakeInitArray::MakeInitArray(int stage) : stage(stage), initArraySize(0) {
     setName(StreamAsString() << "MakeInitArray{stage=" << stage << "}");
 }
@@ -1030,6 +1110,47 @@ bfd_elf_gnu_hash (const char *namearg)
   return h & 0xffffffff;
 }
 
+// the SysV hash function, from binutils/bfd/elf.c
+static unsigned long
+bfd_elf_hash (const char *namearg)
+{
+  const unsigned char *name = (const unsigned char *) namearg;
+  unsigned long h = 0;
+  unsigned long g;
+  int ch;
+
+  while ((ch = *name++) != '\0')
+    {
+      h = (h << 4) + ch;
+      if ((g = (h & 0xf0000000)) != 0)
+        {
+          h ^= g >> 24;
+          /* The ELF ABI says `h &= ~g', but this is equivalent in
+             this case and on some machines one insn instead of two.  */
+          h ^= g;
+        }
+    }
+  return h & 0xffffffff;
+}
+
+/** Bucket count for a hash table with the given number of symbols,
+    chosen like ld does without optimization: about one symbol per bucket.
+*/
+static size_t computeBucketCount(size_t symbolCount) {
+    static const size_t buckets[] = {
+        1, 3, 17, 37, 67, 97, 131, 197, 263, 521, 1031, 2053, 4099, 8209,
+        16411, 32771, 65537, 131101, 262147
+    };
+    const size_t count = sizeof(buckets) / sizeof(*buckets);
+
+    size_t best = buckets[0];
+    for(size_t i = 0; i < count; i ++) {
+        best = buckets[i];
+        if(i + 1 < count && symbolCount < buckets[i + 1]) break;
+    }
+    return best;
+}
+
 void MakeDynsymHash::execute() {
     auto gnuhash = getData()->getSection(".gnu.hash")->castAs<GnuHashSectionContent *>();
     auto dynsym = getData()->getSection(".dynsym")->castAs<SymbolTableContent *>();
@@ -1040,14 +1161,17 @@ void MakeDynsymHash::execute() {
     dynstr->writeTo(dynstrStream);
     auto dynstrData = dynstrStream.str();
 
-    bucketList.resize(1011);
-    //bucketList.resize(10007);
+    typedef std::pair<SymbolInTable, SymbolTableContent::DeferredType *>
+        EntryType;
+    std::vector<EntryType> entryList;
+    std::vector<uint32_t> hashList;  // for entries from firstHashedSymbol
 
     bool hashing = false;
     size_t firstHashedSymbol = 0;
     for(auto sym : *dynsym) {
+        entryList.emplace_back(dynsym->getKey(sym), sym);
+
         auto elfSym = sym->getElfPtr();
-        LOG(1, "elfSym address " << elfSym->st_value);
         // Skip the undefined symbols (first, address == 0), don't hash them.
         // These will be looked up in another library, not in our own .dynsym.
         if(elfSym->st_value) hashing = true;
@@ -1057,25 +1181,56 @@ void MakeDynsymHash::execute() {
         }
 
         auto name = dynstrData.c_str() + elfSym->st_name;
-        auto hash = bfd_elf_gnu_hash(name);
-
-        LOG(1, "elfSym name [" << name << "] hash 0x" << std::hex << hash);
-        bucketList[hash % bucketList.size()].push_back(name);
+        hashList.push_back(bfd_elf_gnu_hash(name));
+        LOG(11, "elfSym name [" << name << "] hash 0x"
+            << std::hex << hashList.back());
     }
 
-    size_t index = 0;
-    for(const auto &bucket : bucketList) {
-        for(const auto &name : bucket) {
-            indexMap[name] = index++;
+    const size_t hashedCount = hashList.size();
+    const size_t bucketCount = computeBucketCount(hashedCount);
+
+    // Place each symbol after those of earlier buckets, keeping the
+    // .dynsym order within a bucket.
+    std::vector<uint32_t> bucketStart(bucketCount + 1, 0);
+    for(auto hash : hashList) bucketStart[hash % bucketCount + 1] ++;
+    for(size_t b = 0; b < bucketCount; b ++) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    std::vector<uint32_t> position(hashedCount);
+    std::vector<uint32_t> chainList(hashedCount);
+    {
+        std::vector<uint32_t> next(bucketStart.begin(), bucketStart.end() - 1);
+        for(size_t i = 0; i < hashedCount; i ++) {
+            auto p = next[hashList[i] % bucketCount] ++;
+            position[i] = p;
+            chainList[p] = hashList[i] & ~1;
+        }
+    }
+    for(size_t b = 0; b < bucketCount; b ++) {
+        if(bucketStart[b + 1] > bucketStart[b]) {
+            chainList[bucketStart[b + 1] - 1] |= 1;  // end of chain
         }
     }
 
+    // Bloom filter sized like ld does, with two bits set per symbol.
     typedef uint64_t BloomType;  // Assumes ELFCLASS64
-    const uint32_t bloomShift = 5;
-    std::vector<BloomType> bloomList; //= {-1ul, -1ul};
-    for(size_t i = 0; i < 0x100; i ++) bloomList.push_back(-1ul);
+    const uint32_t wordShift = 6;  // log2 of bits in BloomType
+    uint32_t maskBitsLog2 = 1;  // ceil(log2(hashedCount)) + 1
+    while((1ul << (maskBitsLog2 - 1)) < hashedCount) maskBitsLog2 ++;
+    if(maskBitsLog2 < 3) maskBitsLog2 = 5;
+    else if((1ul << (maskBitsLog2 - 2)) & hashedCount) maskBitsLog2 += 3;
+    else maskBitsLog2 += 2;
+    if(maskBitsLog2 < wordShift) maskBitsLog2 = wordShift;
+
+    const uint32_t bloomShift = maskBitsLog2;
+    std::vector<BloomType> bloomList(1ul << (maskBitsLog2 - wordShift), 0);
+    for(auto hash : hashList) {
+        auto &word = bloomList[(hash >> wordShift) & (bloomList.size() - 1)];
+        word |= BloomType(1) << (hash & 63);
+        word |= BloomType(1) << ((hash >> bloomShift) & 63);
+    }
 
-    gnuhash->add(static_cast<uint32_t>(bucketList.size()));     // nbuckets
+    gnuhash->add(static_cast<uint32_t>(bucketCount));           // nbuckets
     gnuhash->add(static_cast<uint32_t>(firstHashedSymbol));     // symoffset
     gnuhash->add(static_cast<uint32_t>(bloomList.size()));      // bloom_size
     gnuhash->add(static_cast<uint32_t>(bloomShift));            // bloom_shift
@@ -1086,11 +1241,10 @@ void MakeDynsymHash::execute() {
     }
 
     // bucket_list
-    size_t symIndex = firstHashedSymbol;
-    for(const auto &bucket : bucketList) {
-        if(bucket.size()) {
-            gnuhash->add(static_cast<uint32_t>(symIndex));
-            symIndex += bucket.size();
+    for(size_t b = 0; b < bucketCount; b ++) {
+        if(bucketStart[b + 1] > bucketStart[b]) {
+            gnuhash->add(static_cast<uint32_t>(
+                firstHashedSymbol + bucketStart[b]));
         }
         else {
             // 0's observed in real binaries
@@ -1099,37 +1253,52 @@ void MakeDynsymHash::execute() {
     }
 
     // chain
-    for(const auto &bucket : bucketList) {
-        for(const auto &name : bucket) {
-            auto hash = bfd_elf_gnu_hash(name.c_str());
-            //uint32_t value = (hash % bucketList.size()) & ~1;
-            uint32_t value = hash & ~1;
-            if(name == bucket.back()) value += 1;
-            gnuhash->add(value);
-        }
+    for(auto value : chainList) {
+        gnuhash->add(value);
     }
-    
-    // .dymsym sorting
-    auto oldValueMap = dynsym->getValueMap();  // deep copy
+
+    // .dymsym sorting; hashed symbols follow all unhashed ones
     dynsym->clearAll();
-    for(const auto &pair : oldValueMap) {
-        auto key = pair.first;
-        auto val = pair.second;
-        auto it = indexMap.find(key.getName());
-        if(it != indexMap.end()) {
-            LOG(1, "Found symbol index for name [" << (*it).first << "] at index "
-                << (*it).second);
-            key.setTableIndex((*it).second);
+    for(size_t i = 0; i < entryList.size(); i ++) {
+        auto key = entryList[i].first;
+        if(i >= firstHashedSymbol) {
+            key.setTableIndex(1 + position[i - firstHashedSymbol]);
         }
-        dynsym->insertSorted(key, val);
+        dynsym->insertSorted(key, entryList[i].second);
     }
 
     dynsym->recalculateIndices();
 
-    //auto newValueMap = dynsym->getValueMap();  // deep copy
-    //for(const auto &val : *dynsym) {
-    //    LOG(1, "new order for symbol with name [" << val->getName() << "]");
-    //}
+    if(auto section = getData()->getSection(".hash")) {
+        makeSysvHash(section->castAs<HashSectionContent *>(), dynsym,
+            dynstrData);
+    }
+}
+
+void MakeDynsymHash::makeSysvHash(HashSectionContent *hash,
+    SymbolTableContent *dynsym, const std::string &dynstrData) {
+
+    const size_t symbolCount = dynsym->getCount();
+    const size_t bucketCount = computeBucketCount(symbolCount);
+    std::vector<uint32_t> bucketList(bucketCount, 0);
+    std::vector<uint32_t> chainList(symbolCount, 0);
+
+    // index 0 is STN_UNDEF, which terminates every chain
+    size_t index = 0;
+    for(auto sym : *dynsym) {
+        if(index) {
+            auto name = dynstrData.c_str() + sym->getElfPtr()->st_name;
+            auto &bucket = bucketList[bfd_elf_hash(name) % bucketCount];
+            chainList[index] = bucket;
+            bucket = index;
+        }
+        index ++;
+    }
+
+    hash->add(static_cast<uint32_t>(bucketCount));  // nbucket
+    hash->add(static_cast<uint32_t>(symbolCount));  // nchain
+    for(auto bucket : bucketList) hash->add(bucket);
+    for(auto chain : chainList) hash->add(chain);
 }
 
 void MakeGlobalSymbols::execute() {
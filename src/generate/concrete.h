@@ -64,6 +64,15 @@ public:
     virtual std::string getName() const { return "TextSectionCreator"; }
 };
 
+/** Regenerates .eh_frame, .gcc_except_table and .eh_frame_hdr for the
+    functions that had unwind information, in a read-only segment after
+    the code. Must run after TextSectionCreator.
+*/
+class MakeEhFrame : public NormalElfOperation {
+public:
+    virtual void execute();
+};
+
 class Function;
 class InitArraySectionContent;
 class MakeInitArray : public NormalElfOperation {
@@ -109,12 +118,17 @@ public:
     virtual void execute();
 };
 
+class HashSectionContent;
+class SymbolTableContent;
+/** Fills in .gnu.hash (and .hash, if present), and reorders .dynsym to
+    match the GNU hash chains.
+*/
 class MakeDynsymHash : public NormalElfOperation {
-private:
-    std::vector<std::vector<std::string>> bucketList;
-    std::map<std::string, size_t> indexMap;
 public:
     virtual void execute();
+private:
+    void makeSysvHash(HashSectionContent *hash, SymbolTableContent *dynsym,
+        const std::string &dynstrData);
 };
 
 class MakeGlobalSymbols : public NormalElfOperation {
@@ -268,6 +268,11 @@ public:
     using DeferredIntegerList::DeferredIntegerList;
 };
 
+class HashSectionContent : public DeferredIntegerList {
+public:
+    using DeferredIntegerList::DeferredIntegerList;
+};
+
 class TBSSContent : public DeferredString {
 private:
     size_t memSize;
@@ -50,19 +50,23 @@ private:
     bool positionIndependent;
     bool unionOutput;
     bool freestandingKernel;
+    bool sysvHash;
 public:
     ElfConfig() : dynamicallyLinked(false), positionIndependent(false),
-        unionOutput(false), freestandingKernel(false) {}
+        unionOutput(false), freestandingKernel(false), sysvHash(false) {}
 
     void setDynamicallyLinked(bool enable) { dynamicallyLinked = enable; }
     void setPositionIndependent(bool enable) { positionIndependent = enable; }
     void setUnionOutput(bool enable) { unionOutput = enable; }
     void setFreestandingKernel(bool enable) { freestandingKernel = enable; }
+    /** Also emit a DT_HASH table, for loaders without DT_GNU_HASH. */
+    void setSysvHash(bool enable) { sysvHash = enable; }
 
     bool isDynamicallyLinked() const { return dynamicallyLinked; }
     bool isPositionIndependent() const { return positionIndependent; }
     bool isUnionOutput() const { return unionOutput; }
     bool isFreestandingKernel() const { return freestandingKernel; }
+    bool isSysvHash() const { return sysvHash; }
 };
 
 class ElfOperationTrace {
@@ -0,0 +1,557 @@
+#include <algorithm>
+#include "ehframe.h"
+#include "chunk/concrete.h"
+#include "chunk/unwind.h"
+#include "dwarf/entry.h"
+#include "dwarf/cursor.h"
+#include "dwarf/defines.h"
+#include "instr/concrete.h"
+#include "log/log.h"
+
+static void appendUleb128(std::string &out, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if(value) byte |= 0x80;
+        out.push_back(static_cast<char>(byte));
+    } while(value);
+}
+
+static void appendSleb128(std::string &out, int64_t value) {
+    for(;;) {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bool done = (value == 0 && !(byte & 0x40))
+            || (value == -1 && (byte & 0x40));
+        if(!done) byte |= 0x80;
+        out.push_back(static_cast<char>(byte));
+        if(done) break;
+    }
+}
+
+template <typename Type>
+static void append(std::string &out, Type value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename Type>
+static void patch(std::string &out, size_t offset, Type value) {
+    out.replace(offset, sizeof(value),
+        reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void appendAdvance(std::string &out, uint64_t delta) {
+    if(delta == 0) return;
+    if(delta < 0x40) {
+        out.push_back(static_cast<char>(DW_CFA_advance_loc | delta));
+    }
+    else if(delta <= 0xff) {
+        out.push_back(DW_CFA_advance_loc1);
+        append<uint8_t>(out, delta);
+    }
+    else if(delta <= 0xffff) {
+        out.push_back(DW_CFA_advance_loc2);
+        append<uint16_t>(out, delta);
+    }
+    else {
+        out.push_back(DW_CFA_advance_loc4);
+        append<uint32_t>(out, delta);
+    }
+}
+
+// target in the given encoding, as written at location
+static std::string encodePointer(uint8_t encoding, address_t target,
+    address_t location) {
+
+    uint64_t value = target;
+    if(target && (encoding & 0x70) == DW_EH_PE_pcrel) {
+        value = target - location;
+    }
+    // little-endian, so truncating keeps the low bytes
+    return std::string(reinterpret_cast<const char *>(&value),
+        DwarfCursor::getEncodedPointerSize(encoding));
+}
+
+// the offset of instr in function, if it is still there
+static bool getOffset(Function *function, Instruction *instr,
+    address_t *offset) {
+
+    auto block = instr->getParent();
+    if(!block || block->getParent() != function) return false;
+    *offset = instr->getAddress() - function->getAddress();
+    return true;
+}
+
+/** The CFA rule, as far as inserted code can disturb it. */
+struct CfaRule {
+    uint64_t reg;
+    int64_t offset;
+    bool isExpression;
+
+    CfaRule() : reg(0), offset(0), isExpression(false) {}
+};
+
+// follows the CFA rule through CFA instructions without advances
+static bool trackCfa(const std::string &program, int64_t dataAlignFactor,
+    CfaRule &rule, std::vector<CfaRule> &stack) {
+
+    DwarfCursor cursor(reinterpret_cast<address_t>(program.data()));
+    const address_t end = cursor.getCursor() + program.size();
+    while(cursor.getCursor() < end) {
+        uint8_t opcode = cursor.next<uint8_t>();
+        uint64_t length;
+
+        switch(opcode & 0xc0) {
+        case DW_CFA_offset:
+            cursor.nextUleb128();
+            continue;
+        case DW_CFA_restore:
+            continue;
+        case DW_CFA_advance_loc:
+            return false;
+        default:
+            break;
+        }
+
+        switch(opcode) {
+        case DW_CFA_nop:
+        case DW_CFA_GNU_window_save:
+            break;
+        case DW_CFA_remember_state:
+            stack.push_back(rule);
+            break;
+        case DW_CFA_restore_state:
+            if(!stack.empty()) {
+                rule = stack.back();
+                stack.pop_back();
+            }
+            break;
+
+        case DW_CFA_def_cfa:
+            rule.reg = cursor.nextUleb128();
+            rule.offset = cursor.nextUleb128();
+            rule.isExpression = false;
+            break;
+        case DW_CFA_def_cfa_sf:
+            rule.reg = cursor.nextUleb128();
+            rule.offset = cursor.nextSleb128() * dataAlignFactor;
+            rule.isExpression = false;
+            break;
+        case DW_CFA_def_cfa_register:
+            rule.reg = cursor.nextUleb128();
+            rule.isExpression = false;
+            break;
+        case DW_CFA_def_cfa_offset:
+            rule.offset = cursor.nextUleb128();
+            break;
+        case DW_CFA_def_cfa_offset_sf:
+            rule.offset = cursor.nextSleb128() * dataAlignFactor;
+            break;
+        case DW_CFA_def_cfa_expression:
+            length = cursor.nextUleb128();
+            cursor.skip(length);
+            rule.isExpression = true;
+            break;
+
+        case DW_CFA_restore_extended:
+        case DW_CFA_undefined:
+        case DW_CFA_same_value:
+        case DW_CFA_GNU_args_size:
+            cursor.nextUleb128();
+            break;
+        case DW_CFA_offset_extended:
+        case DW_CFA_register:
+        case DW_CFA_val_offset:
+        case DW_CFA_GNU_negative_offset_extended:
+            cursor.nextUleb128();
+            cursor.nextUleb128();
+            break;
+        case DW_CFA_offset_extended_sf:
+        case DW_CFA_val_offset_sf:
+            cursor.nextUleb128();
+            cursor.nextSleb128();
+            break;
+        case DW_CFA_expression:
+        case DW_CFA_val_expression:
+            cursor.nextUleb128();
+            length = cursor.nextUleb128();
+            cursor.skip(length);
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef ARCH_X86_64
+static const uint64_t DWARF_RSP = 7;
+
+// how many bytes instr pushes onto the stack; false if it sets %rsp in
+// some other way
+static bool getStackGrowth(Instruction *instr, int64_t *growth) {
+    *growth = 0;
+    auto semantic = instr->getSemantic();
+    auto assembly = semantic->getAssembly();
+    // calls return with %rsp where it was
+    if(semantic->isControlFlow() || !assembly) return true;
+
+    auto asmOps = assembly->getAsmOperands();
+    auto count = asmOps->getOpCount();
+    auto operands = asmOps->getOperands();
+    // AT&T operand order: the destination is the last operand
+    bool toRSP = count > 0 && operands[count - 1].type == X86_OP_REG
+        && operands[count - 1].reg == X86_REG_RSP;
+
+    switch(assembly->getId()) {
+    case X86_INS_PUSH:
+    case X86_INS_PUSHFQ:
+        *growth = 8;
+        return true;
+    case X86_INS_POP:
+    case X86_INS_POPFQ:
+        if(toRSP) return false;
+        *growth = -8;
+        return true;
+    case X86_INS_SUB:
+    case X86_INS_ADD:
+        if(!toRSP) break;
+        if(count != 2 || operands[0].type != X86_OP_IMM) return false;
+        *growth = (assembly->getId() == X86_INS_SUB)
+            ? operands[0].imm : -operands[0].imm;
+        return true;
+    case X86_INS_LEA:
+        if(!toRSP) break;
+        if(operands[0].mem.base != X86_REG_RSP
+            || operands[0].mem.index != X86_REG_INVALID) {
+
+            return false;
+        }
+        *growth = -operands[0].mem.disp;
+        return true;
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+        return true;
+    default:
+        break;
+    }
+    if(toRSP) return false;
+
+    for(size_t i = 0; i < assembly->getImplicitRegsWriteCount(); i ++) {
+        if(assembly->getImplicitRegsWrite()[i] == X86_REG_RSP) return false;
+    }
+    return true;
+}
+#endif
+
+// pads an entry so that the next one starts 8-aligned
+static void padEntry(std::string &out, size_t entryStart) {
+    while((out.size() - entryStart) % 8) out.push_back(DW_CFA_nop);
+}
+
+size_t EhFrameBuilder::addCIE(FunctionUnwind *unwind) {
+    auto cie = unwind->getCIE();
+    auto it = cieMap.find(cie);
+    if(it != cieMap.end()) return (*it).second;
+
+    auto augmentation = cie->getAugmentation();
+    auto personality = unwind->getPersonality();
+    bool hasLSDA = augmentation
+        && augmentation->getLsdaEnc() != DW_EH_PE_omit;
+    bool isSignal = augmentation && augmentation->getIsSignal();
+    std::string augmentationString = "z";
+    if(personality) augmentationString += 'P';
+    if(hasLSDA) augmentationString += 'L';
+    augmentationString += 'R';
+    if(isSignal) augmentationString += 'S';
+
+    size_t start = frame.size();
+    append<uint32_t>(frame, 0);  // length, patched below
+    append<uint32_t>(frame, 0);  // CIE id
+    frame.push_back(1);  // version
+    frame.append(augmentationString.c_str(), augmentationString.size() + 1);
+    appendUleb128(frame, cie->getCodeAlignFactor());
+    appendSleb128(frame, cie->getDataAlignFactor());
+    frame.push_back(static_cast<char>(cie->getRetAddressReg()));
+
+    // augmentation data, in the order of the string
+    std::string data;
+    if(personality) {
+        uint8_t encoding = augmentation->getPersonalityEncoding();
+        data.push_back(static_cast<char>(encoding));
+        address_t location = frameAddress + frame.size() + 1 + data.size();
+        data += encodePointer(encoding, personality->getTargetAddress(),
+            location);
+    }
+    if(hasLSDA) data.push_back(DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+    data.push_back(DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+    appendUleb128(frame, data.size());  // less than 0x80, so one byte
+    frame += data;
+
+    frame.append(reinterpret_cast<const char *>(cie->getInstructionStart()),
+        cie->getInstructionEnd() - cie->getInstructionStart());
+    padEntry(frame, start);
+    patch<uint32_t>(frame, start, frame.size() - start - 4);
+
+    cieMap[cie] = start;
+    return start;
+}
+
+bool EhFrameBuilder::add(Function *function) {
+    auto unwind = function->getUnwind();
+    if(!unwind) return false;
+
+    // retarget the rows first, so nothing is written if they fail
+    auto cie = unwind->getCIE();
+    const uint64_t codeAlignFactor = cie->getCodeAlignFactor();
+    const address_t begin = function->getAddress();
+    const address_t end = begin + function->getSize();
+    std::vector<std::pair<address_t, std::string>> rowList;
+    for(const auto &row : unwind->getRowList()) {
+        auto instr = row.getInstruction();
+        auto block = instr->getParent();
+        address_t address;
+        if(block && block->getParent() == function) {
+            address = instr->getAddress();
+            if((!rowList.empty() && address < rowList.back().first)
+                || address >= end) {
+
+                LOG(1, "CFA rows of " << function->getName()
+                    << " are out of order, dropping its FDE");
+                return false;
+            }
+        }
+        else if(!rowList.empty()) {
+            // the anchor was removed; its row joins the previous one
+            address = rowList.back().first;
+        }
+        else address = begin;
+
+        if(!rowList.empty() && rowList.back().first == address) {
+            rowList.back().second += row.getProgram();
+        }
+        else rowList.emplace_back(address, row.getProgram());
+    }
+
+    // inserted code that pushes or pops moves a %rsp-based CFA with it
+    CfaRule rule;
+    std::vector<CfaRule> ruleStack;
+    const int64_t dataAlignFactor = cie->getDataAlignFactor();
+    if(!trackCfa(std::string(
+        reinterpret_cast<const char *>(cie->getInstructionStart()),
+        cie->getInstructionEnd() - cie->getInstructionStart()),
+        dataAlignFactor, rule, ruleStack)) {
+
+        LOG(1, "can't follow the CFA rule of " << function->getName()
+            << ", dropping its FDE");
+        return false;
+    }
+
+    std::string program;
+    address_t location = begin;  // of the last advance
+    address_t previous = begin;
+    size_t rowIndex = 0;
+    int64_t growth = 0;       // pushed by inserted code so far
+    int64_t nextGrowth = 0;
+#ifdef ARCH_X86_64
+    bool lost = false;        // inserted code set %rsp some other way
+#endif
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            address_t address = instr->getAddress();
+            if(address < previous) {
+                LOG(1, "code of " << function->getName()
+                    << " is out of order, dropping its FDE");
+                return false;
+            }
+            previous = address;
+
+            std::string here;
+            while(rowIndex < rowList.size()
+                && rowList[rowIndex].first == address) {
+
+                here += rowList[rowIndex].second;
+                rowIndex ++;
+            }
+            if(!trackCfa(here, dataAlignFactor, rule, ruleStack)) {
+                LOG(1, "can't follow the CFA rule of "
+                    << function->getName() << ", dropping its FDE");
+                return false;
+            }
+            bool moved = (nextGrowth != growth);
+            growth = nextGrowth;
+
+#ifdef ARCH_X86_64
+            bool onStack = rule.isExpression || rule.reg == DWARF_RSP;
+            if(onStack && (lost || (growth && rule.isExpression))) {
+                LOG(1, "inserted code in " << function->getName()
+                    << " moves the CFA, dropping its FDE");
+                return false;
+            }
+            if(onStack && (growth || moved)) {
+                here.push_back(DW_CFA_def_cfa_offset);
+                appendUleb128(here, rule.offset + growth);
+            }
+#endif
+            if(!here.empty()) {
+                appendAdvance(program, (address - location) / codeAlignFactor);
+                location = address;
+                program += here;
+            }
+
+#ifdef ARCH_X86_64
+            if(!unwind->isOriginal(instr->getSemantic())) {
+                int64_t pushed;
+                if(getStackGrowth(instr, &pushed)) nextGrowth += pushed;
+                else lost = true;
+            }
+#endif
+        }
+    }
+    if(rowIndex != rowList.size()) {
+        LOG(1, "CFA rows of " << function->getName()
+            << " are out of order, dropping its FDE");
+        return false;
+    }
+#ifdef ARCH_X86_64
+    if(lost && (rule.isExpression || rule.reg == DWARF_RSP)) {
+        LOG(1, "inserted code in " << function->getName()
+            << " moves the CFA, dropping its FDE");
+        return false;
+    }
+#endif
+
+    std::string lsdaBytes;
+    std::vector<TypeEntry> lsdaTypeList;
+    auto lsda = unwind->getLSDA();
+    if(lsda && !makeLSDA(function, lsda, lsdaBytes, lsdaTypeList)) {
+        return false;
+    }
+
+    size_t cieStart = addCIE(unwind);
+    auto augmentation = unwind->getCIE()->getAugmentation();
+    bool hasLSDA = augmentation
+        && augmentation->getLsdaEnc() != DW_EH_PE_omit;
+
+    size_t start = frame.size();
+    append<uint32_t>(frame, 0);  // length, patched below
+    append<uint32_t>(frame, frame.size() - cieStart);  // CIE pointer
+    append<int32_t>(frame, begin - (frameAddress + frame.size()));
+    append<uint32_t>(frame, function->getSize());
+    if(hasLSDA) {
+        appendUleb128(frame, 4);  // augmentation data length
+        if(lsda) lsdaList.emplace_back(frame.size(), exceptTable.size());
+        append<int32_t>(frame, 0);  // LSDA, set in getFrame()
+    }
+    else {
+        appendUleb128(frame, 0);  // augmentation data length
+    }
+    frame += program;
+    padEntry(frame, start);
+    patch<uint32_t>(frame, start, frame.size() - start - 4);
+
+    if(lsda && hasLSDA) {
+        for(auto type : lsdaTypeList) {
+            type.offset += exceptTable.size();
+            typeList.push_back(type);
+        }
+        exceptTable += lsdaBytes;
+    }
+
+    table.emplace_back(begin, start);
+    return true;
+}
+
+bool EhFrameBuilder::makeLSDA(Function *function, FunctionLSDA *lsda,
+    std::string &out, std::vector<TypeEntry> &typeOut) {
+
+    std::string callSites;
+    address_t previousEnd = 0;
+    for(const auto &site : lsda->getCallSiteList()) {
+        address_t start = 0, end = function->getSize(), landingPad = 0;
+        if(!getOffset(function, site.getStart(), &start)
+            || (site.getEnd() && !getOffset(function, site.getEnd(), &end))
+            || (site.getLandingPad() && (!getOffset(function,
+                site.getLandingPad(), &landingPad) || !landingPad))
+            || start < previousEnd || end < start) {
+
+            LOG(1, "LSDA call sites of " << function->getName()
+                << " are out of order, dropping its FDE");
+            return false;
+        }
+        previousEnd = end;
+        appendUleb128(callSites, start);
+        appendUleb128(callSites, end - start);
+        appendUleb128(callSites, landingPad);
+        appendUleb128(callSites, site.getAction());
+    }
+
+    // from the call-site table encoding to the end of the type table
+    std::string body;
+    body.push_back(DW_EH_PE_uleb128);
+    appendUleb128(body, callSites.size());
+    body += callSites;
+    body += lsda->getActionTable();
+
+    // landing pads are relative to the start of the function
+    out.push_back(static_cast<char>(DW_EH_PE_omit));
+    const auto &types = lsda->getTypeList();
+    if(types.empty() && lsda->getSpecTable().empty()) {
+        out.push_back(static_cast<char>(DW_EH_PE_omit));
+        out += body;
+        return true;
+    }
+
+    uint8_t encoding = lsda->getTypeEncoding();
+    size_t typeSize = DwarfCursor::getEncodedPointerSize(encoding);
+    out.push_back(static_cast<char>(encoding));
+    appendUleb128(out, body.size() + types.size() * typeSize);
+    out += body;
+    // entries are indexed backwards from the end of the type table
+    for(auto it = types.rbegin(); it != types.rend(); ++it) {
+        if(*it) typeOut.push_back(TypeEntry{out.size(), encoding, *it});
+        out.append(typeSize, '\0');
+    }
+    out += lsda->getSpecTable();
+    return true;
+}
+
+std::string EhFrameBuilder::getFrame() const {
+    std::string out = frame;
+    const address_t tableAddress = getExceptTableAddress();
+    for(const auto &lsda : lsdaList) {
+        patch<int32_t>(out, lsda.first,
+            tableAddress + lsda.second - (frameAddress + lsda.first));
+    }
+    append<uint32_t>(out, 0);  // terminator
+    return out;
+}
+
+std::string EhFrameBuilder::getExceptTable() const {
+    std::string out = exceptTable;
+    const address_t tableAddress = getExceptTableAddress();
+    for(const auto &type : typeList) {
+        auto bytes = encodePointer(type.encoding,
+            type.link->getTargetAddress(), tableAddress + type.offset);
+        out.replace(type.offset, bytes.size(), bytes);
+    }
+    while(out.size() % 4) out.push_back(0);
+    return out;
+}
+
+std::string EhFrameBuilder::getHeader(address_t hdrAddress) {
+    std::sort(table.begin(), table.end());
+
+    std::string out;
+    out.push_back(1);  // version
+    out.push_back(DW_EH_PE_pcrel | DW_EH_PE_sdata4);  // eh_frame_ptr
+    out.push_back(DW_EH_PE_udata4);  // fde_count
+    out.push_back(DW_EH_PE_datarel | DW_EH_PE_sdata4);  // table entries
+    append<int32_t>(out, frameAddress - (hdrAddress + out.size()));
+    append<uint32_t>(out, table.size());
+    for(const auto &entry : table) {
+        append<int32_t>(out, entry.first - hdrAddress);
+        append<int32_t>(out, frameAddress + entry.second - hdrAddress);
+    }
+    return out;
+}
@@ -0,0 +1,72 @@
+#ifndef EGALITO_GENERATE_EHFRAME_H
+#define EGALITO_GENERATE_EHFRAME_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include "types.h"
+
+class Function;
+class FunctionUnwind;
+class FunctionLSDA;
+class DwarfCIE;
+class Link;
+
+/** Builds .eh_frame from the FunctionUnwind rows of functions at their
+    final addresses, and the binary search table in .eh_frame_hdr.
+
+    Each original CIE in use is written again with pc-relative FDE
+    addresses, keeping its personality routine. LSDAs are written into a
+    new .gcc_except_table right after .eh_frame, with their call sites
+    at the new instruction offsets.
+
+    Where the CFA is based on %rsp, inserted pushes, pops and constant
+    adjustments of %rsp get DW_CFA_def_cfa_offset rows of their own.
+*/
+class EhFrameBuilder {
+private:
+    struct TypeEntry {
+        size_t offset;  // in exceptTable
+        uint8_t encoding;
+        Link *link;
+    };
+private:
+    address_t frameAddress;
+    std::string frame;
+    std::map<DwarfCIE *, size_t> cieMap;  // offset in frame
+    std::vector<std::pair<address_t, size_t>> table;  // FDE pc and offset
+    std::string exceptTable;
+    std::vector<std::pair<size_t, size_t>> lsdaList;  // pointer and LSDA
+    std::vector<TypeEntry> typeList;
+public:
+    EhFrameBuilder(address_t frameAddress) : frameAddress(frameAddress) {}
+
+    /** Adds an FDE for function. Returns false if its rows or its LSDA
+        call sites are no longer in address order, e.g. because its
+        blocks were reordered, or if inserted code sets %rsp in a way the
+        CFA can't follow, such as realigning the stack.
+    */
+    bool add(Function *function);
+
+    size_t getFDECount() const { return table.size(); }
+
+    /** The contents of .eh_frame, including the zero terminator. */
+    std::string getFrame() const;
+
+    /** The contents of .gcc_except_table, which goes right after
+        .eh_frame, padded to 4 bytes. Empty if there are no LSDAs.
+    */
+    std::string getExceptTable() const;
+    address_t getExceptTableAddress() const
+        { return frameAddress + frame.size() + 4; }
+
+    /** The contents of .eh_frame_hdr, placed at hdrAddress. */
+    std::string getHeader(address_t hdrAddress);
+private:
+    size_t addCIE(FunctionUnwind *unwind);
+    bool makeLSDA(Function *function, FunctionLSDA *lsda,
+        std::string &out, std::vector<TypeEntry> &typeOut);
+};
+
+#endif
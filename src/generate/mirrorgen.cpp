@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include "mirrorgen.h"
 #include "modulegen.h"
 #include "data.h"
@@ -8,6 +9,9 @@ MirrorGen::MirrorGen(Program *program, SandboxBacking *backing)
 
     getConfig()->setDynamicallyLinked(true);
     getConfig()->setPositionIndependent(true);
+    if(std::getenv("EGALITO_SYSV_HASH")) {
+        getConfig()->setSysvHash(true);
+    }
 }
 
 void MirrorGen::preCodeGeneration() {
@@ -49,6 +53,7 @@ void MirrorGen::generateContent(const std::string &filename) {
     }
     pipeline.add(new MakeDynsymHash());  // after all .dynsym entries added
     pipeline.add(new TextSectionCreator());
+    pipeline.add(new MakeEhFrame());
     pipeline.add(new GenerateSectionTable());
     pipeline.add(new ElfFileWriter(filename));
 
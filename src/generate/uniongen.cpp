@@ -45,6 +45,7 @@ void UnionGen::generateContent(const std::string &filename) {
         }
     }
     pipeline.add(new TextSectionCreator());
+    pipeline.add(new MakeEhFrame());
     pipeline.add(new GenerateSectionTable());
     pipeline.add(new ElfFileWriter(filename));
 
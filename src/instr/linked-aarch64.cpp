@@ -384,18 +384,22 @@ void LinkedInstruction::makeAllLinked(Module *module) {
         DataFlow df;
         LiveRegister live;
         PointerDetection pd;
+        std::vector<Function *> functionList;
         for(auto func : CIter::functions(module)) {
-            df.addUseDefFor(func);
+            functionList.push_back(func);
         }
+        df.addUseDefFor(functionList);
         for(auto func : CIter::functions(module)) {
             live.detect(df.getWorkingSet(func));
         }
         for(auto func : CIter::functions(module)) {
             df.adjustCallUse(&live, func, module);
         }
+        std::vector<UDRegMemWorkingSet *> workingList;
         for(auto func : CIter::functions(module)) {
-            pd.detect(df.getWorkingSet(func));
+            workingList.push_back(df.getWorkingSet(func));
         }
+        pd.detect(workingList);
 
         resolveLinks(module, pd.getList());
         saveToFile(module, pd.getList());
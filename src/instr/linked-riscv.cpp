@@ -51,12 +51,16 @@ void LinkedInstruction::makeAllLinked(Module *module) {
 
     DataFlow df;
     PointerDetection pd;
+    std::vector<Function *> functionList;
     for(auto func : CIter::functions(module)) {
-        df.addUseDefFor(func);
+        functionList.push_back(func);
     }
+    df.addUseDefFor(functionList);
+    std::vector<UDRegMemWorkingSet *> workingList;
     for(auto func : CIter::functions(module)) {
-        pd.detect(df.getWorkingSet(func));
+        workingList.push_back(df.getWorkingSet(func));
     }
+    pd.detect(workingList);
 
     resolveLinks(module, pd.getList());
 }
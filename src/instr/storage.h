@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 #include "assembly.h"
 
 class InstructionStorage {
@@ -26,6 +27,7 @@ private:
 public:
     static AssemblyFactory *getInstance() { return &instance; }
 private:
+    std::mutex mutex;  // functions may be disassembled in parallel
     std::vector<AssemblyPtr> assemblyList;
 public:
     AssemblyPtr buildAssembly(InstructionStorage *storage, address_t address);
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+#include "async.h"
+#include "log.h"
+
+/** Single-producer single-consumer ring of length-prefixed events. */
+class AsyncLogRing {
+private:
+    std::vector<char> buffer;   // size is a power of two
+    std::atomic<size_t> head;   // total bytes written
+    std::atomic<size_t> tail;   // total bytes read
+    std::atomic<bool> orphaned; // the owning thread has exited
+public:
+    AsyncLogRing(size_t size)
+        : buffer(size), head(0), tail(0), orphaned(false) {}
+
+    size_t getCapacity() const { return buffer.size() - sizeof(uint32_t); }
+    bool push(const std::string &event);
+    bool pop(std::string &event);
+
+    bool isEmpty() const { return head.load() == tail.load(); }
+    bool isOrphaned() const { return orphaned.load(); }
+    void orphan() { orphaned.store(true); }
+private:
+    void copyIn(size_t position, const char *data, size_t size);
+    void copyOut(size_t position, char *data, size_t size) const;
+};
+
+bool AsyncLogRing::push(const std::string &event) {
+    uint32_t size = event.size();
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    if(buffer.size() - (h - t) < sizeof size + size) return false;
+
+    copyIn(h, reinterpret_cast<const char *>(&size), sizeof size);
+    copyIn(h + sizeof size, event.data(), size);
+    head.store(h + sizeof size + size, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogRing::pop(std::string &event) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    if(h == t) return false;
+
+    uint32_t size;
+    copyOut(t, reinterpret_cast<char *>(&size), sizeof size);
+    event.resize(size);
+    copyOut(t + sizeof size, &event[0], size);
+    tail.store(t + sizeof size + size, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogRing::copyIn(size_t position, const char *data, size_t size) {
+    size_t offset = position & (buffer.size() - 1);
+    size_t first = std::min(size, buffer.size() - offset);
+    std::memcpy(&buffer[offset], data, first);
+    std::memcpy(&buffer[0], data + first, size - first);
+}
+
+void AsyncLogRing::copyOut(size_t position, char *data, size_t size) const {
+    size_t offset = position & (buffer.size() - 1);
+    size_t first = std::min(size, buffer.size() - offset);
+    std::memcpy(data, &buffer[offset], first);
+    std::memcpy(data + first, &buffer[0], size - first);
+}
+
+/** Reads back the arguments recorded by AsyncLog::recordPrintf(). */
+class AsyncLogArguments {
+public:
+    struct Argument {
+        AsyncLog::ArgumentType type;
+        union {
+            long long s;
+            unsigned long long u;
+            double d;
+            const void *p;
+            const char *string;
+        };
+
+        long long asSigned() const;
+        unsigned long long asUnsigned() const;
+        double asDouble() const;
+    };
+private:
+    const char *data;
+    const char *end;
+public:
+    AsyncLogArguments(const char *data, const char *end)
+        : data(data), end(end) {}
+
+    bool next(Argument &argument);
+private:
+    template <typename Type>
+    void read(Type &value);
+};
+
+long long AsyncLogArguments::Argument::asSigned() const {
+    switch(type) {
+    case AsyncLog::ARG_SIGNED:      return s;
+    case AsyncLog::ARG_UNSIGNED:    return static_cast<long long>(u);
+    case AsyncLog::ARG_DOUBLE:      return static_cast<long long>(d);
+    default:
+        return static_cast<long long>(reinterpret_cast<uintptr_t>(p));
+    }
+}
+
+unsigned long long AsyncLogArguments::Argument::asUnsigned() const {
+    return static_cast<unsigned long long>(asSigned());
+}
+
+double AsyncLogArguments::Argument::asDouble() const {
+    switch(type) {
+    case AsyncLog::ARG_DOUBLE:      return d;
+    case AsyncLog::ARG_UNSIGNED:    return static_cast<double>(u);
+    default:                        return static_cast<double>(asSigned());
+    }
+}
+
+bool AsyncLogArguments::next(Argument &argument) {
+    if(data >= end) return false;
+
+    argument.type = static_cast<AsyncLog::ArgumentType>(*data++);
+    switch(argument.type) {
+    case AsyncLog::ARG_SIGNED:      read(argument.s); break;
+    case AsyncLog::ARG_UNSIGNED:    read(argument.u); break;
+    case AsyncLog::ARG_DOUBLE:      read(argument.d); break;
+    case AsyncLog::ARG_POINTER:     read(argument.p); break;
+    case AsyncLog::ARG_STRING: {
+        uint32_t length;
+        read(length);
+        argument.string = data;
+        data += length + 1;
+        break;
+    }
+    }
+    return true;
+}
+
+template <typename Type>
+void AsyncLogArguments::read(Type &value) {
+    std::memcpy(&value, data, sizeof value);
+    data += sizeof value;
+}
+
+template <typename Type>
+static void appendFormatted(std::string &out, const std::string &spec,
+    Type value) {
+
+    char buffer[256];
+    int length = std::snprintf(buffer, sizeof buffer, spec.c_str(), value);
+    if(length < 0) return;
+    if(static_cast<size_t>(length) < sizeof buffer) {
+        out.append(buffer, length);
+    }
+    else {
+        std::vector<char> large(length + 1);
+        std::snprintf(large.data(), large.size(), spec.c_str(), value);
+        out.append(large.data(), length);
+    }
+}
+
+static void appendDigits(std::string &spec, const char *&f,
+    AsyncLogArguments &arguments, bool precision) {
+
+    if(*f == '*') {
+        f ++;
+        AsyncLogArguments::Argument argument;
+        if(!arguments.next(argument)) return;
+        long long value = argument.asSigned();
+        if(precision && value < 0) {
+            spec.pop_back();    // a negative precision is ignored
+            return;
+        }
+        spec += std::to_string(value);
+    }
+    else {
+        while(*f >= '0' && *f <= '9') spec.push_back(*f++);
+    }
+}
+
+/** Formats like printf, with each conversion using the stored argument
+    type instead of its length modifier.
+*/
+static void formatPrintf(const char *format, AsyncLogArguments &arguments,
+    std::string &out) {
+
+    const char *f = format;
+    while(*f) {
+        if(*f != '%') {
+            out.push_back(*f++);
+            continue;
+        }
+        if(f[1] == '%') {
+            out.push_back('%');
+            f += 2;
+            continue;
+        }
+
+        const char *start = f++;
+        std::string spec("%");
+        while(*f && std::strchr("-+ #0'", *f)) spec.push_back(*f++);
+        appendDigits(spec, f, arguments, false);
+        if(*f == '.') {
+            spec.push_back(*f++);
+            appendDigits(spec, f, arguments, true);
+        }
+        while(*f && std::strchr("hlLqjzt", *f)) f ++;
+
+        char conversion = *f;
+        if(!conversion) {
+            out.append(start);
+            break;
+        }
+        f ++;
+
+        AsyncLogArguments::Argument argument;
+        if(!arguments.next(argument)) {
+            out.append(start, f - start);
+            continue;
+        }
+
+        switch(conversion) {
+        case 'd': case 'i':
+            appendFormatted(out, spec + "ll" + conversion,
+                argument.asSigned());
+            break;
+        case 'u': case 'o': case 'x': case 'X':
+            appendFormatted(out, spec + "ll" + conversion,
+                argument.asUnsigned());
+            break;
+        case 'c':
+            appendFormatted(out, spec + conversion,
+                static_cast<int>(argument.asSigned()));
+            break;
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            appendFormatted(out, spec + conversion, argument.asDouble());
+            break;
+        case 's':
+            appendFormatted(out, spec + conversion,
+                argument.type == AsyncLog::ARG_STRING
+                    ? argument.string : "(?)");
+            break;
+        case 'p':
+            appendFormatted(out, spec + conversion,
+                argument.type == AsyncLog::ARG_POINTER
+                    ? argument.p : nullptr);
+            break;
+        case 'n':
+            break;  // nothing is written back
+        default:
+            out.append(start, f - start);
+            break;
+        }
+    }
+}
+
+/** Shared by all threads: the list of rings and the background thread. */
+class AsyncLogState {
+private:
+    std::mutex ringMutex;       // guards ringList
+    std::vector<AsyncLogRing *> ringList;
+    std::mutex drainMutex;      // only one thread consumes events at a time
+    std::thread *drainThread;
+    std::atomic<bool> stopping;
+    std::string event;
+    std::string output;
+public:
+    enum {
+        RING_SIZE = 1 << 20
+    };
+
+    AsyncLogState() : drainThread(nullptr), stopping(false) {}
+
+    AsyncLogRing *makeRing();
+    void startThread();
+    void stopThread();
+    bool drain();
+    void writeDirectly(const std::string &event);
+
+    static AsyncLogState *getInstance() {
+        static AsyncLogState instance;
+        return &instance;
+    }
+private:
+    bool drainLocked();
+    void format(const std::string &event);
+    void run();
+};
+
+AsyncLogRing *AsyncLogState::makeRing() {
+    auto ring = new AsyncLogRing(RING_SIZE);
+    std::lock_guard<std::mutex> lock(ringMutex);
+    ringList.push_back(ring);
+    return ring;
+}
+
+void AsyncLogState::startThread() {
+    stopping = false;
+    drainThread = new std::thread(&AsyncLogState::run, this);
+}
+
+void AsyncLogState::stopThread() {
+    stopping = true;
+    drainThread->join();
+    delete drainThread;
+    drainThread = nullptr;
+    drain();
+}
+
+bool AsyncLogState::drain() {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    return drainLocked();
+}
+
+void AsyncLogState::writeDirectly(const std::string &event) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    drainLocked();  // everything queued before this event comes first
+    format(event);
+    (*LogStream::getStream()) << output;
+    output.clear();
+}
+
+bool AsyncLogState::drainLocked() {
+    std::vector<AsyncLogRing *> rings;
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        rings = ringList;
+    }
+
+    bool found = false;
+    for(auto ring : rings) {
+        while(ring->pop(event)) {
+            format(event);
+            found = true;
+        }
+    }
+    if(found) {
+        (*LogStream::getStream()) << output;
+        output.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    for(auto it = ringList.begin(); it != ringList.end(); ) {
+        // an orphaned ring receives no more events
+        if((*it)->isOrphaned() && (*it)->isEmpty()) {
+            delete *it;
+            it = ringList.erase(it);
+        }
+        else ++it;
+    }
+    return found;
+}
+
+void AsyncLogState::format(const std::string &event) {
+    if(event.empty()) return;
+
+    auto type = static_cast<AsyncLog::EventType>(event[0]);
+    if(type == AsyncLog::EVENT_TEXT) {
+        output.append(event, 1, std::string::npos);
+        return;
+    }
+
+    const char *format;
+    std::memcpy(&format, &event[1], sizeof format);
+    AsyncLogArguments arguments(event.data() + 1 + sizeof format,
+        event.data() + event.size());
+    formatPrintf(format, arguments, output);
+    if(type == AsyncLog::EVENT_PRINTF_N) output.push_back('\n');
+}
+
+void AsyncLogState::run() {
+    while(!stopping) {
+        if(!drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+/** Appends whatever is written to a text event. */
+class AsyncLogTextBuffer : public std::streambuf {
+private:
+    std::string *event;
+public:
+    AsyncLogTextBuffer(std::string *event) : event(event) {}
+protected:
+    virtual int overflow(int c);
+    virtual std::streamsize xsputn(const char *s, std::streamsize n);
+private:
+    void begin();
+};
+
+int AsyncLogTextBuffer::overflow(int c) {
+    if(c != traits_type::eof()) {
+        begin();
+        event->push_back(static_cast<char>(c));
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize AsyncLogTextBuffer::xsputn(const char *s, std::streamsize n) {
+    begin();
+    event->append(s, n);
+    return n;
+}
+
+void AsyncLogTextBuffer::begin() {
+    if(event->empty()) event->push_back(AsyncLog::EVENT_TEXT);
+}
+
+/** Per-thread ring and staging buffers. */
+class AsyncLogThread {
+private:
+    AsyncLogRing *ring;
+    std::string textEvent;
+    std::string printfEvent;
+    AsyncLogTextBuffer textBuffer;
+    std::ostream textStream;
+public:
+    AsyncLogThread() : ring(nullptr), textBuffer(&textEvent),
+        textStream(&textBuffer) {}
+    ~AsyncLogThread();
+
+    AsyncLogRing *getRing();
+    std::string &getTextEvent() { return textEvent; }
+    std::string &getPrintfEvent() { return printfEvent; }
+    std::ostream &getTextStream() { return textStream; }
+};
+
+AsyncLogThread::~AsyncLogThread() {
+    if(ring) ring->orphan();
+}
+
+AsyncLogRing *AsyncLogThread::getRing() {
+    if(!ring) ring = AsyncLogState::getInstance()->makeRing();
+    return ring;
+}
+
+static thread_local AsyncLogThread thisThread;
+
+bool AsyncLog::enabled = false;
+
+void AsyncLog::start() {
+    if(enabled) return;
+
+    // construct the state first, so that it is destroyed after stop()
+    auto state = AsyncLogState::getInstance();
+    static bool registered = false;
+    if(!registered) {
+        std::atexit(&AsyncLog::stop);
+        registered = true;
+    }
+
+    state->startThread();
+    enabled = true;
+}
+
+void AsyncLog::stop() {
+    if(!enabled) return;
+
+    enabled = false;
+    AsyncLogState::getInstance()->stopThread();
+    LogStream::getStream()->flush();
+}
+
+void AsyncLog::flush() {
+    AsyncLogState::getInstance()->drain();
+    LogStream::getStream()->flush();
+}
+
+std::ostream &AsyncLog::getTextStream() {
+    return thisThread.getTextStream();
+}
+
+void AsyncLog::commitText() {
+    auto &event = thisThread.getTextEvent();
+    if(!event.empty()) commitEvent(event);
+}
+
+std::string &AsyncLog::beginEvent(EventType type) {
+    auto &event = thisThread.getPrintfEvent();
+    event.assign(1, static_cast<char>(type));
+    return event;
+}
+
+void AsyncLog::commitEvent(std::string &event) {
+    auto ring = thisThread.getRing();
+    if(event.size() > ring->getCapacity()) {
+        AsyncLogState::getInstance()->writeDirectly(event);
+    }
+    else {
+        while(!ring->push(event)) std::this_thread::yield();
+    }
+    event.clear();
+}
+
+void AsyncLog::encodeOne(std::string &event, const char *value) {
+    if(!value) value = "(null)";
+
+    uint32_t length = std::strlen(value);
+    append(event, ARG_STRING, length);
+    event.append(value, length + 1);
+}
@@ -0,0 +1,116 @@
+#ifndef EGALITO_LOG_ASYNC_H
+#define EGALITO_LOG_ASYNC_H
+
+#include <iosfwd>
+#include <string>
+#include <cstddef>
+#include <type_traits>
+
+/** Logging backend that moves formatting and output off the threads that
+    log. Each thread appends compact events to its own ring buffer without
+    taking a lock: CLOG and CLOG0 record the address of their format string
+    and the raw arguments, while LOG and LOG0 record the text that they
+    wrote to a thread-local stream. A background thread formats the events
+    and writes them to LogStream's output.
+
+    Format strings must stay valid until they are written (string literals
+    do). Each thread's messages keep their order, but messages from
+    different threads, and output that bypasses the logging macros, may
+    appear in any order relative to each other until flush() is called.
+    Call start() and stop() while only one thread is logging. Setting
+    EGALITO_DEBUG=async also calls start().
+*/
+class AsyncLog {
+public:
+    enum EventType {
+        EVENT_TEXT,
+        EVENT_PRINTF,
+        EVENT_PRINTF_N      // printf followed by a newline
+    };
+    enum ArgumentType {
+        ARG_SIGNED,
+        ARG_UNSIGNED,
+        ARG_DOUBLE,
+        ARG_POINTER,
+        ARG_STRING          // length, then the characters and a NUL
+    };
+private:
+    static bool enabled;
+public:
+    static bool isEnabled() { return enabled; }
+
+    /** Starts the background thread. stop() is also called at exit. */
+    static void start();
+    /** Writes out all pending events and stops the background thread. */
+    static void stop();
+    /** Writes out all pending events from every thread. */
+    static void flush();
+
+    /** Stream for LOG and LOG0; commitText() queues what was written. */
+    static std::ostream &getTextStream();
+    static void commitText();
+
+    template <typename... Args>
+    static void recordPrintf(bool newline, const char *format,
+        Args... args);
+private:
+    static std::string &beginEvent(EventType type);
+    static void commitEvent(std::string &event);
+
+    static void encode(std::string &event) {}
+    template <typename Type, typename... Args>
+    static void encode(std::string &event, Type value, Args... args);
+
+    static void encodeOne(std::string &event, const char *value);
+    static void encodeOne(std::string &event, std::nullptr_t)
+        { append(event, ARG_POINTER, static_cast<const void *>(nullptr)); }
+    static void encodeOne(std::string &event, double value)
+        { append(event, ARG_DOUBLE, value); }
+    template <typename Type>
+    static void encodeOne(std::string &event, const Type *value)
+        { append(event, ARG_POINTER, static_cast<const void *>(value)); }
+    template <typename Type>
+    static typename std::enable_if<std::is_integral<Type>::value
+        || std::is_enum<Type>::value>::type
+        encodeOne(std::string &event, Type value);
+
+    template <typename Type>
+    static void append(std::string &event, ArgumentType type, Type value);
+};
+
+template <typename... Args>
+void AsyncLog::recordPrintf(bool newline, const char *format,
+    Args... args) {
+
+    std::string &event = beginEvent(newline ? EVENT_PRINTF_N : EVENT_PRINTF);
+    event.append(reinterpret_cast<const char *>(&format), sizeof format);
+    encode(event, args...);
+    commitEvent(event);
+}
+
+template <typename Type, typename... Args>
+void AsyncLog::encode(std::string &event, Type value, Args... args) {
+    encodeOne(event, value);
+    encode(event, args...);
+}
+
+template <typename Type>
+typename std::enable_if<std::is_integral<Type>::value
+    || std::is_enum<Type>::value>::type
+    AsyncLog::encodeOne(std::string &event, Type value) {
+
+    if(std::is_enum<Type>::value || std::is_signed<Type>::value) {
+        append(event, ARG_SIGNED, static_cast<long long>(value));
+    }
+    else {
+        append(event, ARG_UNSIGNED, static_cast<unsigned long long>(value));
+    }
+}
+
+template <typename Type>
+void AsyncLog::append(std::string &event, ArgumentType type, Type value) {
+    event.push_back(static_cast<char>(type));
+    event.append(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
+#endif
@@ -16,6 +16,7 @@ LogLevelSetting::LogLevelSetting(const char *group,
 std::ostream *LogStream::output = DEFAULT_STREAM;
 
 void LogStream::overrideStream(std::ostream *out) {
+    if(AsyncLog::isEnabled()) AsyncLog::flush();
     output = (out ? out : DEFAULT_STREAM);
 }
 
@@ -65,5 +66,6 @@ int _log_printf_n(const char *format, ...) {
 }
 
 std::ostream &_log_stream() {
+    if(AsyncLog::isEnabled()) return AsyncLog::getTextStream();
     return *LogStream::getStream();
 }
@@ -5,6 +5,7 @@
 #include <string>
 #include <iostream>  // for operator <<
 #include "defaults.h"
+#include "async.h"
 
 /* Any file which wishes to use logging must define DEBUG_GROUP
     as some lower-case string foo, and ensure that D_foo exists in
@@ -39,6 +40,7 @@ public:
 int _log_printf(const char *format, ...);
 int _log_printf_n(const char *format, ...);
 std::ostream &_log_stream();
+inline void _log_commit() { if(AsyncLog::isEnabled()) AsyncLog::commitText(); }
 
 #define _APPEND(x, y) x ## y
 #define _APPEND2(x, y) _APPEND(x, y)
@@ -59,25 +61,33 @@ std::ostream &_log_stream();
         do { \
             if(_logLevel.shouldShow(level)) { \
                 _log_stream() << __VA_ARGS__ << '\n'; \
+                _log_commit(); \
             } \
         } while(0)
     #define LOG0(level, ...) \
         do { \
             if(_logLevel.shouldShow(level)) { \
                 _log_stream() << __VA_ARGS__; \
+                _log_commit(); \
             } \
         } while(0)
 
     #define CLOG(level, format, ...) \
         do { \
             if(_logLevel.shouldShow(level)) { \
-                _log_printf_n(format, ##__VA_ARGS__); \
+                if(AsyncLog::isEnabled()) { \
+                    AsyncLog::recordPrintf(true, format, ##__VA_ARGS__); \
+                } \
+                else _log_printf_n(format, ##__VA_ARGS__); \
             } \
         } while(0)
     #define CLOG0(level, format, ...) \
         do { \
             if(_logLevel.shouldShow(level)) { \
-                _log_printf(format, ##__VA_ARGS__); \
+                if(AsyncLog::isEnabled()) { \
+                    AsyncLog::recordPrintf(false, format, ##__VA_ARGS__); \
+                } \
+                else _log_printf(format, ##__VA_ARGS__); \
             } \
         } while(0)
 #else
@@ -96,7 +96,10 @@ void SettingsParser::parseFile(const std::string &filename) {
 }
 
 void SettingsParser::parseSetting(const std::string &setting) {
-    if(setting.find('/') != std::string::npos) {
+    if(setting == "async") {
+        AsyncLog::start();
+    }
+    else if(setting.find('/') != std::string::npos) {
         parseFile(setting);
     }
     else if(setting.find('=') != std::string::npos) {
@@ -3,6 +3,7 @@
 #include <capstone/x86.h>
 #include "addinline.h"
 #include "analysis/frametype.h"
+#include "analysis/regflow.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/semantic.h"
@@ -12,23 +13,35 @@
 #include "log/log.h"
 #include "log/temp.h"
 
+ChunkAddInline::Statistics ChunkAddInline::statistics;
+
+ChunkAddInline::ChunkAddInline(Modification *modification)
+    : modification(modification), liveness(nullptr) {}
+
 ChunkAddInline::ChunkAddInline(std::vector<Register> regList,
-    std::function<std::vector<Instruction *> (unsigned int)> generator) {
+    std::function<std::vector<Instruction *> (unsigned int)> generator)
+    : liveness(nullptr) {
 
     modification = new ModificationImpl(regList, generator);
 }
 
-std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point) {
+std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point,
+    bool after) {
+
     auto function = dynamic_cast<Function *>(point->getParent()->getParent());
     assert(function != nullptr);
 
     bool redzone = !FrameType::hasStackFrame(function);
     SaveRestoreRegisters saveRestore(point, redzone);
 
-    auto regList = modification->getClobberedRegisters();
+    auto regList = getSavedRegisters(point, after);
     unsigned int stackBytesAdded = 0;
     stackBytesAdded += regList.size() * 8;  // for pushes
-    if(redzone) stackBytesAdded += 0x80;
+    if(redzone && regList.size() > 0) stackBytesAdded += 0x80;
+
+    statistics.sites ++;
+    if(regList.size() > 0) statistics.spillSites ++;
+    statistics.saved += regList.size();
 
     std::vector<Instruction *> instrList;
     extendList(instrList, saveRestore.getRegSaveCode(regList));
@@ -38,14 +51,40 @@ std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point) {
     return std::move(instrList);
 }
 
+ChunkAddInline::RegList ChunkAddInline::getSavedRegisters(
+    Instruction *point, bool after) {
+
+    auto regList = modification->getClobberedRegisters();
+#ifdef ARCH_X86_64
+    if(!liveness || !liveness->isAnalyzed(point)) return regList;
+
+    RegisterSet live = after
+        ? liveness->getLiveAfter(point) : liveness->getLiveBefore(point);
+    RegList saved;
+    for(auto reg : regList) {
+        int id = (reg == X86_REG_EFLAGS)
+            ? X86Register::FLAGS : X86Register::convertToPhysical(reg);
+        if(id == X86Register::INVALID || (live & RegisterEffect::bit(id))) {
+            saved.push_back(reg);
+        }
+        else {
+            statistics.dead ++;
+        }
+    }
+    return saved;
+#else
+    return regList;
+#endif
+}
+
 void ChunkAddInline::insertBefore(Instruction *point, bool beforeJumpTo) {
-    auto newCode = getFullCode(point);
+    auto newCode = getFullCode(point, false);
     auto block = dynamic_cast<Block *>(point->getParent());
     ChunkMutator(block, true).insertBefore(point, newCode, beforeJumpTo);
 }
 
 void ChunkAddInline::insertAfter(Instruction *point) {
-    auto newCode = getFullCode(point);
+    auto newCode = getFullCode(point, true);
     auto block = dynamic_cast<Block *>(point->getParent());
     ChunkMutator(block, true).insertAfter(point, newCode);
 }
@@ -6,10 +6,25 @@
 #include "instr/instr.h"
 #include "instr/register.h"
 
+class RegisterLiveness;
+
 class ChunkAddInline {
 public:
     typedef std::vector<Instruction *> InstrList;
     typedef std::vector<Register> RegList;
+
+    /** Counts over all insertions, to show how often registers still had
+        to be saved on the stack.
+    */
+    class Statistics {
+    public:
+        unsigned long sites;        // insertions
+        unsigned long spillSites;   // insertions that saved any register
+        unsigned long saved;        // registers saved and restored
+        unsigned long dead;         // clobbered registers that were dead
+    public:
+        Statistics() : sites(0), spillSites(0), saved(0), dead(0) {}
+    };
 public:
     /*class InsertionState {
     private:
@@ -59,6 +74,8 @@ private:
     };
 private:
     Modification *modification;
+    RegisterLiveness *liveness;
+    static Statistics statistics;
 public:
     // allow this modification to be applied in multiple places.
     // takes ownership of modification and will free it.
@@ -67,10 +84,22 @@ public:
         std::function<std::vector<Instruction *> (unsigned int)> generator);
     ~ChunkAddInline() { delete modification; }
 
+    /** Clobbered registers (including the flags) that liveness shows are
+        dead at the insertion point are not saved. If none need saving, the
+        red zone is not skipped either and stackBytesAdded is 0. Points added
+        to the function after liveness was computed save everything.
+    */
+    void setLiveness(RegisterLiveness *liveness)
+        { this->liveness = liveness; }
+
     void insertBefore(Instruction *point, bool beforeJumpTo);
     void insertAfter(Instruction *point);
+
+    static const Statistics &getStatistics() { return statistics; }
+    static void resetStatistics() { statistics = Statistics(); }
 private:
-    std::vector<Instruction *> getFullCode(Instruction *point);
+    std::vector<Instruction *> getFullCode(Instruction *point, bool after);
+    RegList getSavedRegisters(Instruction *point, bool after);
     void extendList(std::vector<Instruction *> &list,
         const std::vector<Instruction *> &additions);
 };
@@ -18,6 +18,21 @@
 #endif
 #include "log/log.h"
 
+ChunkMutator::ChunkMutator(Chunk *chunk, bool allowUpdates)
+    : chunk(chunk), allowUpdates(allowUpdates) {
+
+    // instructions may be added or removed, so rescan them when asked,
+    // and don't copy out stale code
+    for(Chunk *c = chunk; c; c = c->getParent()) {
+        if(auto function = dynamic_cast<Function *>(c)) {
+            function->invalidateFeatures();
+            function->clearCache();
+            break;
+        }
+        if(dynamic_cast<FunctionList *>(c)) break;
+    }
+}
+
 void ChunkMutator::makePositionFor(Chunk *child) {
     PositionFactory *positionFactory = PositionFactory::getInstance();
     Position *pos = nullptr;
@@ -370,6 +385,7 @@ void ChunkMutator::splitFunctionBefore(Block *point) {
     for(auto child : moveList) {
         ChunkMutator(function).remove(child);
         delete child->getPosition();
+        child->setPosition(nullptr);
     }
     auto functionList = dynamic_cast<FunctionList *>(function->getParent());
     functionList->getChildren()->add(function2);
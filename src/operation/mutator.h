@@ -21,8 +21,7 @@ private:
     Chunk *chunk;
     bool allowUpdates;
 public:
-    ChunkMutator(Chunk *chunk, bool allowUpdates = true)
-        : chunk(chunk), allowUpdates(allowUpdates) {}
+    ChunkMutator(Chunk *chunk, bool allowUpdates = true);
     ~ChunkMutator() { updatePositions(); }
 
     void makePositionFor(Chunk *child);
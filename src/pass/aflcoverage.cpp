@@ -8,8 +8,11 @@
 #include "operation/addinline.h"
 #include "operation/find2.h"
 #include "pass/switchcontext.h"
+#include "analysis/regsummary.h"
 #include "types.h"
 
+#include "log/log.h"
+
 void AFLCoveragePass::visit(Program *program) {
     auto allocateFunc = ChunkFind2(program).findFunction(
         "egalito_allocate_afl_shm");
@@ -47,7 +50,21 @@ void AFLCoveragePass::visit(Program *program) {
 
 void AFLCoveragePass::visit(Module *module) {
     if(module->getLibrary()->getRole() != Library::ROLE_EXTRA) {
+#ifdef ARCH_X86_64
+        RegisterSummary moduleSummary(module);
+        summary = &moduleSummary;
+        auto before = ChunkAddInline::getStatistics();
+        recurse(module);
+        summary = nullptr;
+
+        auto after = ChunkAddInline::getStatistics();
+        LOG(1, "afl coverage: " << std::dec
+            << (after.spillSites - before.spillSites) << " of "
+            << (after.sites - before.sites) << " sites saved registers in "
+            << module->getName());
+#else
         recurse(module);
+#endif
     }
 }
 
@@ -91,7 +108,11 @@ void AFLCoveragePass::visit(Function *function) {
     // sphinx3, function does tail recursion to itself
     if(function->getName() == "mdef_phone_id") return;
 
+#ifdef ARCH_X86_64
+    liveness = summary ? summary->getLiveness(function) : nullptr;
+#endif
     recurse(function);
+    liveness = nullptr;
 }
 
 void AFLCoveragePass::visit(Block *block) {
@@ -198,6 +219,7 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
         return std::vector<Instruction *>{ mov1Instr, xorInstr, incInstr, shrInstr, mov2Instr };
 #endif
     });
+    ai.setLiveness(liveness);
 	auto instr1 = block->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, true);
 }
@@ -3,12 +3,17 @@
 
 #include "chunkpass.h"
 
+class RegisterSummary;
+class RegisterLiveness;
+
 class AFLCoveragePass : public ChunkPass {
 private:
     Function *entryPoint;
     unsigned long blockID;
+    RegisterSummary *summary;
+    RegisterLiveness *liveness;  // of the current function, for ChunkAddInline
 public:
-    AFLCoveragePass() : blockID(1) {}
+    AFLCoveragePass() : blockID(1), summary(nullptr), liveness(nullptr) {}
     virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
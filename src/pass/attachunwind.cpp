@@ -0,0 +1,162 @@
+#include "attachunwind.h"
+#include "chunk/unwind.h"
+#include "chunk/link.h"
+#include "dwarf/entry.h"
+#include "dwarf/rows.h"
+#include "dwarf/cursor.h"
+#include "log/log.h"
+
+void AttachUnwindPass::visit(Module *module) {
+    this->module = module;
+    recurse(module->getFunctionList());
+    LOG(1, "attached unwind info to " << std::dec << attached
+        << " functions in " << module->getName());
+}
+
+void AttachUnwindPass::visit(Function *function) {
+    auto fde = info->findFDE(function->getAddress());
+    if(!fde) return;
+    if(static_cast<address_t>(fde->getPcBegin()) != function->getAddress()) {
+        return;
+    }
+    auto cie = info->getCIE(fde->getCieIndex());
+    if(!cie) return;
+
+    DwarfRowSplitter::RowList rowList;
+    if(!DwarfRowSplitter(cie).split(fde, rowList)) return;
+
+    // anchor each row to the instruction at its offset
+    auto unwind = new FunctionUnwind(cie);
+    std::map<address_t, Instruction *> instrMap;  // by offset
+    auto row = rowList.begin();
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            address_t offset = instr->getAddress() - function->getAddress();
+            instrMap[offset] = instr;
+            unwind->addOriginal(instr->getSemantic());
+            for(; row != rowList.end() && row->first <= offset; ++row) {
+                if(row->first != offset) {
+                    LOG(1, "CFA row at offset " << std::dec << row->first
+                        << " is inside an instruction of "
+                        << function->getName());
+                    delete unwind;
+                    return;
+                }
+                unwind->addRow(instr, row->second);
+            }
+        }
+    }
+    if(row != rowList.end()) {
+        LOG(1, "CFA rows go past the end of " << function->getName());
+        delete unwind;
+        return;
+    }
+
+    if(auto augmentation = cie->getAugmentation()) {
+        if(augmentation->getPersonalityEncodingRoutine()) {
+            auto personality = getPersonality(cie);
+            if(!personality) {
+                delete unwind;
+                return;
+            }
+            unwind->setPersonality(personality);
+        }
+    }
+    if(fde->getAugmentation() && fde->getAugmentation()->getLsdaPointer()) {
+        auto lsda = makeLSDA(function,
+            fde->getAugmentation()->getLsdaPointer(), instrMap);
+        if(!lsda) {
+            LOG(1, "dropping unwind info of " << function->getName()
+                << ", its LSDA cannot be rewritten");
+            delete unwind;
+            return;
+        }
+        unwind->setLSDA(lsda);
+    }
+
+    function->setUnwind(unwind);
+    attached ++;
+}
+
+Link *AttachUnwindPass::getPersonality(DwarfCIE *cie) {
+    auto it = personalityMap.find(cie);
+    if(it != personalityMap.end()) return (*it).second;
+
+    auto augmentation = cie->getAugmentation();
+    uint8_t encoding = augmentation->getPersonalityEncoding();
+    uint8_t application = encoding & 0x70;
+    Link *link = nullptr;
+    if(DwarfCursor::getEncodedPointerSize(encoding)
+        && (application == DW_EH_PE_absptr
+            || application == DW_EH_PE_pcrel)) {
+
+        link = makeLink(augmentation->getPersonalityEncodingRoutine());
+    }
+    if(!link) {
+        LOG(1, "can't find personality routine at 0x" << std::hex
+            << augmentation->getPersonalityEncodingRoutine());
+    }
+    personalityMap[cie] = link;
+    return link;
+}
+
+FunctionLSDA *AttachUnwindPass::makeLSDA(Function *function,
+    address_t address, const std::map<address_t, Instruction *> &instrMap) {
+
+    auto parsed = lsdaParser.parse(address);
+    if(!parsed) return nullptr;
+
+    auto lsda = new FunctionLSDA(parsed->getTypeEncoding(),
+        parsed->getActionTable(), parsed->getSpecTable());
+    auto findInstruction = [&] (address_t offset) -> Instruction * {
+        auto it = instrMap.find(offset);
+        return (it != instrMap.end()) ? (*it).second : nullptr;
+    };
+    bool ok = true;
+    for(const auto &site : parsed->getCallSiteList()) {
+        auto start = findInstruction(site.start);
+        address_t endOffset = site.start + site.length;
+        auto end = findInstruction(endOffset);
+        auto landingPad = findInstruction(site.landingPad);
+        if(!start || (!end && endOffset != function->getSize())
+            || (site.landingPad && !landingPad)) {
+
+            LOG(1, "LSDA call site at offset " << std::dec << site.start
+                << " is not at instructions of " << function->getName());
+            ok = false;
+            break;
+        }
+        lsda->addCallSite(start, end,
+            site.landingPad ? landingPad : nullptr, site.action);
+    }
+    for(auto type : parsed->getTypeList()) {
+        if(!ok) break;
+        Link *link = type ? makeLink(type) : nullptr;
+        if(type && !link) {
+            LOG(1, "can't find type_info at 0x" << std::hex << type);
+            ok = false;
+        }
+        lsda->addType(link);
+    }
+    delete parsed;
+
+    if(!ok) {
+        delete lsda;
+        return nullptr;
+    }
+    return lsda;
+}
+
+Link *AttachUnwindPass::makeLink(address_t address) {
+    if(auto function = CIter::spatial(module->getFunctionList())
+        ->find(address)) {
+
+        return new NormalLink(function, Link::SCOPE_WITHIN_MODULE);
+    }
+    if(module->getPLTList()) {
+        if(auto plt = CIter::spatial(module->getPLTList())->find(address)) {
+            return new PLTLink(address, plt);
+        }
+    }
+    return LinkFactory::makeDataLink(module, address, true);
+}
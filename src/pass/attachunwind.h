@@ -0,0 +1,44 @@
+#ifndef EGALITO_PASS_ATTACH_UNWIND_H
+#define EGALITO_PASS_ATTACH_UNWIND_H
+
+#include <map>
+#include "pass/chunkpass.h"
+#include "dwarf/lsda.h"
+
+class ElfMap;
+class DwarfUnwindInfo;
+class DwarfCIE;
+class Link;
+class FunctionLSDA;
+
+/** Gives each Function with an FDE in .eh_frame a FunctionUnwind, whose
+    rows are anchored to instructions. This must run while instructions
+    are still at their original addresses. The FDE's CFA instructions are
+    only decoded here, one function at a time.
+
+    The personality routine, and the type table of each LSDA, become
+    Links. A function whose LSDA cannot be parsed or anchored gets no
+    FunctionUnwind at all, so that exceptions stop there instead of
+    skipping its handlers.
+*/
+class AttachUnwindPass : public ChunkPass {
+private:
+    DwarfUnwindInfo *info;
+    DwarfLSDAParser lsdaParser;
+    Module *module;
+    std::map<DwarfCIE *, Link *> personalityMap;
+    size_t attached;
+public:
+    AttachUnwindPass(ElfMap *elf, DwarfUnwindInfo *info)
+        : info(info), lsdaParser(elf), module(nullptr), attached(0) {}
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+private:
+    Link *getPersonality(DwarfCIE *cie);
+    FunctionLSDA *makeLSDA(Function *function, address_t address,
+        const std::map<address_t, Instruction *> &instrMap);
+    Link *makeLink(address_t address);
+};
+
+#endif
@@ -8,8 +8,29 @@
 #include "analysis/walker.h"
 #include "chunk/dump.h"
 #include "conductor/conductor.h"
+#include "util/parallel.h"
 #include "log/log.h"
 
+void FindSyscalls::visit(FunctionList *functionList) {
+    std::vector<Function *> functions;
+    for(auto function : CIter::children(functionList)) {
+        functions.push_back(function);
+    }
+
+    parallelAnalyze<FindSyscalls>(functions.size(),
+        [&] (size_t i, FindSyscalls &result) {
+            result.findArguments = findArguments;
+            functions[i]->accept(&result);
+        },
+        [&] (size_t i, FindSyscalls &result) {
+            numberMap.insert(result.numberMap.begin(), result.numberMap.end());
+            argumentMap.insert(result.argumentMap.begin(),
+                result.argumentMap.end());
+            unknownSet.insert(result.unknownSet.begin(),
+                result.unknownSet.end());
+        });
+}
+
 void FindSyscalls::visit(Function *function) {
 #ifdef ARCH_X86_64
     LOG(10, "Finding syscalls in function " << function->getName());
@@ -17,30 +38,41 @@ void FindSyscalls::visit(Function *function) {
     // a constant syscall set, and in fact we actually track calls to it as
     // equivalent to a syscall() instruction.
     if (isSyscallFunction(function)) return;
+    // wrappers may also tail-call syscall() with a jmp
+    if (!function->getFeatures().has(FunctionFeatures::FEATURE_SYSCALL
+        | FunctionFeatures::FEATURE_DIRECT_CALL
+        | FunctionFeatures::FEATURE_DIRECT_JUMP)) {
 
-    auto graph = new ControlFlowGraph(function);
-    auto config = new UDConfiguration(graph);
-    auto working = new UDRegMemWorkingSet(function, graph);
-    auto usedef = new UseDef(config, working);
+        return;
+    }
+
+    ControlFlowGraph graph(function);
+    UDConfiguration config(&graph);
+    UDRegMemWorkingSet working(function, &graph);
+    UseDef usedef(&config, &working);
 
-    SccOrder order(graph);
-    order.genFull(0);
-    usedef->analyze(order.get());
+    usedef.analyze(graph.getSccOrder());
 
     for (auto block : CIter::children(function)) {
         for (auto instr : CIter::children(block)) {
             auto assembly = instr->getSemantic()->getAssembly();
-            auto state = working->getState(instr);
+            auto state = working.getState(instr);
             if (assembly && assembly->getId() == X86_INS_SYSCALL) {
                 std::set<unsigned long> values;
                 seen.clear();
                 auto rax = X86Register::convertToPhysical(X86_REG_RAX);
                 if(getRegisterValue(state, rax, values)) {
                     numberMap[instr] = values;
+                    static const int argumentRegs[] = {
+                        X86_REG_RDI, X86_REG_RSI, X86_REG_RDX,
+                        X86_REG_R10, X86_REG_R8, X86_REG_R9
+                    };
+                    addArguments(instr, state, argumentRegs, 6);
                 }
                 else {
                     LOG(1, "WARNING: Unable to determine syscall number for " 
                         << instr->getName() << " inside [" << function->getName() << "]");
+                    unknownSet.insert(instr);
                 }
             }
             else if (auto cfi = dynamic_cast<ControlFlowInstruction *>(
@@ -54,22 +86,29 @@ void FindSyscalls::visit(Function *function) {
                     // on the subset of the callgraph that we care about,
                     // the user will already have been notified about this,
                     // or perhaps it's already on a whitelist somewhere.
-                    continue;
+                    if (!func_target) continue;
                 }
                 else {
                     func_target = dynamic_cast<Function *>(target);
                 }
-                if (func_target && isSyscallFunction(function)) {
+                if (func_target && isSyscallFunction(func_target)) {
                     LOG(10, "found call to syscall() function");
                     std::set<unsigned long> values;
                     seen.clear();
                     auto rdi = X86Register::convertToPhysical(X86_REG_RDI);
                     if(getRegisterValue(state, rdi, values)) {
                         numberMap[instr] = values;
+                        // the sixth argument is passed on the stack
+                        static const int argumentRegs[] = {
+                            X86_REG_RSI, X86_REG_RDX, X86_REG_RCX,
+                            X86_REG_R8, X86_REG_R9
+                        };
+                        addArguments(instr, state, argumentRegs, 5);
                     }
                     else {
                         LOG(1, "WARNING: Unable to determine syscall number for " 
                             << instr->getName() << " inside [" << function->getName() << "]");
+                        unknownSet.insert(instr);
                     }
                 }
             }
@@ -104,6 +143,22 @@ bool FindSyscalls::isSyscallFunction(Function *function) {
     return false;
 }
 
+void FindSyscalls::addArguments(Instruction *instr, UDState *state,
+    const int *regList, size_t count) {
+
+    if(!findArguments) return;
+
+    ArgumentList arguments(ARGUMENT_COUNT);
+    for(size_t i = 0; i < count; i ++) {
+        seen.clear();
+        auto reg = X86Register::convertToPhysical(regList[i]);
+        if(!getRegisterValue(state, reg, arguments[i])) {
+            arguments[i].clear();
+        }
+    }
+    argumentMap[instr] = std::move(arguments);
+}
+
 bool FindSyscalls::getRegisterValue(UDState *state, int curreg, std::set<unsigned long> &valueSet) {
     bool all_constants = true;
     if (seen.find(state) == seen.end()) {
@@ -136,7 +191,9 @@ bool FindSyscalls::getRegisterValue(UDState *state, int curreg, std::set<unsigne
             else if (auto rnode
                 = dynamic_cast<TreeNodePhysicalRegister *>(node)) {
                 auto reg = rnode->getRegister();
-                getRegisterValue(s, reg, valueSet);
+                if(!getRegisterValue(s, reg, valueSet)) {
+                    all_constants = false;
+                }
             }
             else {
                 if (!node) {
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 #include "chunkpass.h"
 #include "log/registry.h"
@@ -11,16 +12,37 @@
 class UDState;
 
 class FindSyscalls : public ChunkPass {
+public:
+    enum {
+        ARGUMENT_COUNT = 6
+    };
+    /** Possible values of each argument; empty if they are not all known. */
+    typedef std::vector<std::set<unsigned long>> ArgumentList;
 private:
+    bool findArguments;
     std::map<Instruction *, std::set<unsigned long>> numberMap;
+    std::map<Instruction *, ArgumentList> argumentMap;
+    std::set<Instruction *> unknownSet;
     std::set<UDState *> seen;
 public: 
+    FindSyscalls(bool findArguments = false) : findArguments(findArguments) {}
+
+    /** Analyzes the functions in parallel. */
+    virtual void visit(FunctionList *functionList);
     virtual void visit(Function *function);
 
     const std::map<Instruction *, std::set<unsigned long>> &getNumberMap() const
         { return numberMap; }
+    /** Filled in for each entry of the number map if findArguments is set. */
+    const std::map<Instruction *, ArgumentList> &getArgumentMap() const
+        { return argumentMap; }
+    /** Syscalls and calls to syscall() whose number was not found. */
+    const std::set<Instruction *> &getUnknownSet() const
+        { return unknownSet; }
 private:
     bool isSyscallFunction(Function *function);
+    void addArguments(Instruction *instr, UDState *state,
+        const int *regList, size_t count);
     bool getRegisterValue(UDState *state, int curreg, std::set<unsigned long> &valueSet);
 };
 
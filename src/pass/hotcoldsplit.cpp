@@ -0,0 +1,190 @@
+#include <set>
+#include "hotcoldsplit.h"
+#include "analysis/controlflow.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+#include "pass/promotejumps.h"
+#include "log/log.h"
+
+/** The block of the same function that a direct branch goes to, if any. */
+static Block *getTargetBlock(Instruction *instr) {
+    auto v = dynamic_cast<ControlFlowInstruction *>(instr->getSemantic());
+    if(!v || !dynamic_cast<NormalLink *>(v->getLink())) return nullptr;
+
+    auto target = &*v->getLink()->getTarget();
+    auto block = dynamic_cast<Block *>(target);
+    if(auto i = dynamic_cast<Instruction *>(target)) {
+        block = dynamic_cast<Block *>(i->getParent());
+    }
+    if(!block || block->getParent() != instr->getParent()->getParent()) {
+        return nullptr;
+    }
+    return block;
+}
+
+void HotColdSplitPass::visit(Module *module) {
+    splitList.clear();
+    recurse(module);
+
+    for(const auto &pair : splitList) {
+        split(pair.first, pair.second);
+    }
+    LOG(1, "HotColdSplitPass: split " << coldFunctions.size()
+        << " function(s)");
+}
+
+void HotColdSplitPass::visit(Function *function) {
+    auto it = profile.find(function);
+    if(it == profile.end()) return;
+    const auto &counts = it->second;
+
+    auto isCold = [&counts] (Block *block) {
+        auto found = counts.find(block->getAddress());
+        return found != counts.end() && (*found).second == 0;
+    };
+
+    // a function that never ran is cold as a whole
+    auto entry = function->getChildren()->getIterable()->get(0);
+    if(!entry || isCold(entry)) return;
+
+    std::vector<Block *> coldList;
+    size_t coldSize = 0;
+    for(auto block : CIter::children(function)) {
+        auto last = block->getChildren()->getIterable()->getLast();
+        if(auto ij = dynamic_cast<IndirectJumpInstruction *>(
+            last->getSemantic())) {
+
+            if(ij->isForJumpTable()) return;
+        }
+
+        if(isCold(block)) {
+            coldList.push_back(block);
+            coldSize += block->getSize();
+        }
+    }
+    if(coldList.empty() || coldSize < minColdSize) return;
+
+#ifdef ARCH_X86_64
+    // JRCXZ and JECXZ have no rel32 form to reach the other part
+    std::set<Block *> cold(coldList.begin(), coldList.end());
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto target = getTargetBlock(instr);
+            if(!target || cold.count(block) == cold.count(target)) continue;
+
+            auto id = static_cast<ControlFlowInstruction *>(
+                instr->getSemantic())->getId();
+            if(id == X86_INS_JCXZ || id == X86_INS_JECXZ
+                || id == X86_INS_JRCXZ) {
+
+                LOG(10, "not splitting " << function->getName()
+                    << ", its " << instr->getName() << " changes parts");
+                return;
+            }
+        }
+    }
+#endif
+
+    splitList.emplace_back(function, coldList);
+}
+
+void HotColdSplitPass::split(Function *function,
+    const std::vector<Block *> &coldList) {
+
+#ifdef ARCH_X86_64
+    LOG(10, "splitting cold blocks out of " << function->getName());
+    std::set<Block *> cold(coldList.begin(), coldList.end());
+    auto positionFactory = PositionFactory::getInstance();
+
+    // fall-throughs between the two parts become explicit jumps, each in
+    // its own block so that blocks still end in their only branch
+    std::vector<std::pair<Block *, Block *>> fallThroughs;
+    {
+        ControlFlowGraph cfg(function);
+        for(size_t id = 0; id < cfg.getCount(); id ++) {
+            auto node = cfg.get(id);
+            for(auto link : node->forwardLinks()) {
+                auto cflink = dynamic_cast<ControlFlowLink *>(&*link);
+                if(cflink->getFollowJump()) continue;
+
+                auto block = node->getBlock();
+                auto next = cfg.get(cflink->getTargetID())->getBlock();
+                if(cold.count(block) != cold.count(next)) {
+                    fallThroughs.emplace_back(block, next);
+                }
+            }
+        }
+    }
+    for(const auto &pair : fallThroughs) {
+        auto block = pair.first;
+        auto target = pair.second->getChildren()->getIterable()->get(0);
+
+        auto branch = new Instruction();
+        auto semantic = new ControlFlowInstruction(
+            X86_INS_JMP, branch, "\xe9", "jmp", 4);
+        semantic->setLink(new NormalLink(target, Link::SCOPE_EXTERNAL_JUMP));
+        branch->setSemantic(semantic);
+
+        auto connecting = new Block();
+        connecting->setPosition(positionFactory->makePosition(block,
+            connecting, block->getAddress() + block->getSize()
+                - function->getAddress()));
+        ChunkMutator(connecting).append(branch);
+        ChunkMutator(function).insertAfter(block, connecting);
+        if(cold.count(block)) cold.insert(connecting);
+    }
+
+    // the parts are placed apart later, so branches from one to the other
+    // leave the function and need rel32 displacements
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto target = getTargetBlock(instr);
+            if(!target || cold.count(block) == cold.count(target)) continue;
+
+            auto v = static_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(v->getLink()->isExternalJump()) continue;
+            v->setLink(new NormalLink(v->getLink()->getTarget(),
+                Link::SCOPE_EXTERNAL_JUMP));
+            if(v->getDisplacementSize() == 1) {
+                PromoteJumpsPass::resize(instr, true);
+            }
+        }
+    }
+
+    // move the cold blocks (in their original order) to the end, then
+    // split them off into their own function
+    std::vector<Block *> moveList;
+    for(auto block : CIter::children(function)) {
+        if(cold.count(block)) moveList.push_back(block);
+    }
+    for(auto block : moveList) {
+        ChunkMutator(function).remove(block);
+        delete block->getPosition();
+        block->setPosition(nullptr);
+    }
+    for(auto block : moveList) {
+        auto last = function->getChildren()->getIterable()->getLast();
+        block->setPosition(positionFactory->makePosition(last, block,
+            function->getSize()));
+        ChunkMutator(function).append(block);
+    }
+
+    ChunkMutator(function).splitFunctionBefore(moveList.front());
+
+    auto coldFunction = static_cast<Function *>(
+        moveList.front()->getParent());
+    coldFunction->setName(function->getName() + ".cold");
+    coldFunctions.push_back(coldFunction);
+
+    {
+        ChunkMutator(function, true);
+    }
+    {
+        ChunkMutator(coldFunction, true);
+    }
+#else
+    LOG(1, "HotColdSplitPass is only supported on x86_64");
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef EGALITO_PASS_HOT_COLD_SPLIT_H
+#define EGALITO_PASS_HOT_COLD_SPLIT_H
+
+#include <map>
+#include <vector>
+#include "chunkpass.h"
+#include "types.h"
+
+/** Moves the never-executed blocks of executed functions into separate
+    "<name>.cold" functions, using ChunkMutator::splitFunctionBefore().
+
+    Block counts come from an edge profile (see ProfileEdgePass), keyed
+    by original block address; blocks without a count are kept hot.
+    Wherever a block fell through into a block of the other part, an
+    explicit jmp is added, and branches between the parts become rel32
+    jumps out of the function. Functions with jump tables are left alone,
+    as are those whose cold part is smaller than the minimum size or that
+    would need a JRCXZ between the parts. The cold functions can then be
+    placed together, away from the hot code.
+*/
+class HotColdSplitPass : public ChunkPass {
+public:
+    typedef std::map<address_t, unsigned long> BlockCounts;
+private:
+    const std::map<Function *, BlockCounts> &profile;
+    size_t minColdSize;
+    std::vector<std::pair<Function *, std::vector<Block *>>> splitList;
+    std::vector<Function *> coldFunctions;
+public:
+    HotColdSplitPass(const std::map<Function *, BlockCounts> &profile,
+        size_t minColdSize = 16)
+        : profile(profile), minColdSize(minColdSize) {}
+
+    /** The new cold functions, in the order they were created. */
+    const std::vector<Function *> &getColdFunctions() const
+        { return coldFunctions; }
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+    virtual void visit(PLTList *pltList) {}
+    virtual void visit(DataRegionList *dataRegionList) {}
+private:
+    void split(Function *function, const std::vector<Block *> &coldList);
+};
+
+#endif
@@ -38,14 +38,26 @@ void JumpTablePass::visit(JumpTableList *jumpTableList) {
     JumptableDetection search(module);
     search.detect(module);
 
-    auto count1 = search.getTableList().size();
+    // Only functions whose jump tables changed in the last round have a
+    // different CFG, so only they are analyzed again. Descriptors found
+    // in earlier rounds are kept and not turned into tables twice.
+    size_t made = 0;
     while(1) {
-        makeJumpTable(jumpTableList, search.getTableList());
-        search.detect(module);
-        auto count2 = search.getTableList().size();
-        LOG(1, "count1 = " << count1 << " -> " << count2);
-        if(count1 == count2) break;
-        count1 = count2;
+        const auto &tables = search.getTableList();
+        std::vector<JumpTableDescriptor *> found(
+            tables.begin() + made, tables.end());
+        made = tables.size();
+
+        auto changed = makeJumpTable(jumpTableList, found);
+        LOG(1, "found " << found.size() << " jump tables, "
+            << changed.size() << " functions to revisit");
+        if(changed.empty()) break;
+
+        std::vector<Function *> revisit;
+        for(auto function : CIter::functions(module)) {
+            if(changed.count(function)) revisit.push_back(function);
+        }
+        search.detect(revisit);
     }
 
 #ifdef ARCH_X86_64
@@ -68,9 +80,11 @@ void JumpTablePass::visit(JumpTableList *jumpTableList) {
 #endif
 }
 
-void JumpTablePass::makeJumpTable(JumpTableList *jumpTableList,
+std::set<Function *> JumpTablePass::makeJumpTable(
+    JumpTableList *jumpTableList,
     const std::vector<JumpTableDescriptor *> &tables) {
 
+    std::set<Function *> changed;
     for(auto descriptor : tables) {
         // this constructor automatically creates JumpTableEntry children
 
@@ -125,7 +139,16 @@ void JumpTablePass::makeJumpTable(JumpTableList *jumpTableList,
         if(n < (size_t)count) {
             jumpTable->getDescriptor()->setEntries(n);
         }
+
+        // jumps through this table may now have new CFG edges
+        if(jumpTable->getChildren()->genericGetSize() > 0) {
+            for(auto instr : jumpTable->getJumpInstructionList()) {
+                changed.insert(
+                    dynamic_cast<Function *>(instr->getParent()->getParent()));
+            }
+        }
     }
+    return changed;
 }
 
 size_t JumpTablePass::makeChildren(JumpTable *jumpTable, int count) {
@@ -2,6 +2,7 @@
 #define EGALITO_PASS_JUMP_TABLE_PASS_H
 
 #include <map>
+#include <set>
 #include "chunkpass.h"
 
 /** Constructs jump table data structures in the given Module. */
@@ -20,7 +21,8 @@ public:
     size_t makeChildren(JumpTable *jumpTable, int count);
 
 private:
-    void makeJumpTable(JumpTableList *jumpTableList,
+    /** Returns the functions whose CFG changed as a result. */
+    std::set<Function *> makeJumpTable(JumpTableList *jumpTableList,
         const std::vector<JumpTableDescriptor *> &tables);
     void saveToFile() const;
     bool loadFromFile(JumpTableList *jumpTableList);
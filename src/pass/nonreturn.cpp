@@ -5,6 +5,7 @@
 #include "analysis/usedefutil.h"
 #include "analysis/walker.h"
 #include "chunk/concrete.h"
+#include "util/parallel.h"
 #ifdef ARCH_X86_64
     #include "instr/linked-x86_64.h"
 #endif
@@ -36,19 +37,51 @@ void NonReturnFunction::visit(FunctionList *functionList) {
     //TemporaryLogLevel tll("pass", 10);
     //TemporaryLogLevel tll2("analysis", 10);
 
+    std::vector<Function *> functions;
+    for(auto function : CIter::children(functionList)) {
+        functions.push_back(function);
+    }
+
+    // Within a round, functions only read whether others return, so they
+    // are analyzed in parallel and newly found ones are marked afterwards.
+    // Marks only accumulate, so this reaches the same fixpoint as visiting
+    // the functions one at a time.
     do {
         size = nonReturnList.size();
-        recurse(functionList);
+        parallelAnalyze<int>(functions.size(),
+            [&] (size_t i, int &never) {
+                never = functions[i]->returns() && neverReturns(functions[i]);
+            },
+            [&] (size_t i, int never) {
+                if(never) markNonreturn(functions[i]);
+            });
     } while(size != nonReturnList.size());
 }
 
-// Since Dominance requires an exit node to be spotted in the control flow
-// graph, we should do this in two passes
 void NonReturnFunction::visit(Function *function) {
     if(!function->returns()) return;
 
+    if(neverReturns(function)) markNonreturn(function);
+}
+
+void NonReturnFunction::markNonreturn(Function *function) {
+    LOG(10, "=== " << function->getName() << " never returns");
+    function->setNonreturn();
+    nonReturnList.insert(function);
+}
+
+// Since Dominance requires an exit node to be spotted in the control flow
+// graph, we should do this in two passes
+bool NonReturnFunction::neverReturns(Function *function) {
     //TemporaryLogLevel tll("pass", 10, function->hasName("mabort"));
 
+    // only calls and jumps can lead to a non-returning function
+    if(!function->getFeatures().has(FunctionFeatures::FEATURE_DIRECT_CALL
+        | FunctionFeatures::FEATURE_DIRECT_JUMP)) {
+
+        return false;
+    }
+
     // step-1
     std::vector<Instruction *> GNUErrorCalls;
     for(auto block : CIter::children(function)) {
@@ -78,9 +111,7 @@ void NonReturnFunction::visit(Function *function) {
         UDRegMemWorkingSet working(function, &cfg);
         UseDef usedef(&config, &working);
 
-        SccOrder order(&cfg);
-        order.genFull(0);
-        usedef.analyze(order.get());
+        usedef.analyze(cfg.getSccOrder());
 
         for(auto instr : GNUErrorCalls) {
             bool found;
@@ -97,16 +128,11 @@ void NonReturnFunction::visit(Function *function) {
     }
 
     // step-2
-    if(neverReturns(function)) {
-        LOG(10, "=== " << function->getName() << " never returns");
-        function->setNonreturn();
-        nonReturnList.insert(function);
-    }
+    return hasNonreturnExit(function);
 }
 
-bool NonReturnFunction::neverReturns(Function *function) {
+bool NonReturnFunction::hasNonreturnExit(Function *function) {
     ControlFlowGraph *cfg = nullptr;
-    Dominance *dom = nullptr;
     for(auto block : CIter::children(function)) {
         for(auto instr : CIter::children(block)) {
             if(auto cfi = dynamic_cast<ControlFlowInstruction *>(
@@ -123,23 +149,20 @@ bool NonReturnFunction::neverReturns(Function *function) {
                         cfg->dumpDot();
                         std::cout.flush();
                     }
-                    //Dominance dom(cfg);
-                    if(!dom) dom = new Dominance(cfg);
-                    auto pdom = dom->getPostDominators(0);
+                    // the dominator tree is cached by the CFG
+                    auto pdom = Dominance(cfg).getPostDominators(0);
                     auto nid = cfg->getIDFor(block);
                     if(std::find(pdom.begin(), pdom.end(), nid) == pdom.end()) {
                         continue;
                     }
 
                     delete cfg;
-                    delete dom;
                     return true;
                 }
             }
         }
     }
     delete cfg;
-    delete dom;
     return false;
 }
 
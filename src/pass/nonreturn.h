@@ -17,7 +17,12 @@ public:
     virtual void visit(FunctionList *functionList);
     virtual void visit(Function *function);
 private:
+    void markNonreturn(Function *function);
+    /** Marks non-returning calls in function, which changes only function
+        itself, and tells whether it never returns.
+    */
     bool neverReturns(Function *function);
+    bool hasNonreturnExit(Function *function);
     bool hasLinkToNeverReturn(ControlFlowInstruction *cfi);
     bool inList(Function *function);
 
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include "profileedge.h"
+#include "operation/addinline.h"
+#include "operation/mutator.h"
+#include "disasm/disassemble.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "log/log.h"
+
+#define EDGE_REGION_ADDRESS 0x33000000
+#define EDGE_MAPREGION_ADDRESS 0x34000000
+#define EDGE_SECTION_NAME ".profiling.edges"
+#define EDGE_MAPSECTION_NAME ".profiling.edgemap"
+
+// Higher weights are more likely to end up on the spanning tree, i.e.
+// without a counter.
+#define WEIGHT_VIRTUAL      (1L << 40)
+#define WEIGHT_UNMEASURABLE (1L << 30)
+#define WEIGHT_BACK_EDGE    (1L << 20)
+#define WEIGHT_SPLIT        (1L << 10)
+
+template <typename ValueType>
+static void appendValue(std::string &bytes, ValueType value) {
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static ProfileEdgePass::Edge makeEdge(ControlFlow::id_t source,
+    ControlFlow::id_t target, ProfileEdgePass::EdgeKind kind,
+    int offset = 0) {
+
+    ProfileEdgePass::Edge edge;
+    edge.source = source;
+    edge.target = target;
+    edge.kind = kind;
+    edge.offset = offset;
+    edge.placement = ProfileEdgePass::PLACE_NONE;
+    edge.weight = 0;
+    edge.onTree = false;
+    edge.counter = ProfileEdgePass::COUNTER_UNKNOWN;
+    return edge;
+}
+
+static bool isConditionalJump(ControlFlowInstruction *cfi) {
+    auto mnemonic = cfi->getMnemonic();
+    return mnemonic.size() > 1 && mnemonic[0] == 'j' && mnemonic != "jmp";
+}
+
+// jcxz and friends have no rel32 form, so they can't be sent to a block
+// that may be out of rel8 range
+static bool canRetarget(ControlFlowInstruction *cfi) {
+#ifdef ARCH_X86_64
+    switch(cfi->getId()) {
+    case X86_INS_JCXZ:
+    case X86_INS_JECXZ:
+    case X86_INS_JRCXZ:
+        return false;
+    default:
+        break;
+    }
+#endif
+    return isConditionalJump(cfi);
+}
+
+void ProfileEdgePass::visit(Module *module) {
+#ifdef ARCH_X86_64
+    if(module->getDataRegionList()->findDataSection(EDGE_SECTION_NAME)) {
+        LOG(0, "ProfileEdgePass: module is already instrumented");
+        return;
+    }
+
+    createSections(module);
+    recurse(module);
+    updateHeaders();
+
+    LOG(0, "ProfileEdgePass: " << counterCount << " edge counters in "
+        << functionCount << " functions");
+#else
+    LOG(0, "ProfileEdgePass is only supported on x86_64");
+#endif
+}
+
+bool ProfileEdgePass::shouldInstrument(Function *function) {
+    if(function->getChildren()->getIterable()->getCount() == 0) return false;
+    if(function->getName() == "_init") return false;
+    if(function->getName() == "_fini") return false;
+    if(function->getName() == "__libc_csu_init") return false;
+    if(function->getName() == "__libc_csu_fini") return false;
+    return true;
+}
+
+void ProfileEdgePass::visit(Function *function) {
+    if(!shouldInstrument(function)) return;
+
+    ControlFlowGraph cfg(function);
+    std::vector<Edge> edges;
+    buildEdges(function, &cfg, edges);
+    choosePlacements(function, &cfg, edges);
+    chooseSpanningTree(cfg.getCount() + 1, edges);
+
+    size_t unknown = 0;
+    for(auto &edge : edges) {
+        if(edge.onTree) {
+            edge.counter = COUNTER_TREE;
+        }
+        else if(edge.placement == PLACE_NONE) {
+            edge.counter = COUNTER_UNKNOWN;
+            unknown ++;
+        }
+        else {
+            edge.counter = static_cast<int32_t>(counterCount ++);
+            appendCounter();
+        }
+    }
+
+    // the map records block addresses from before instrumentation
+    appendMap(function, &cfg, edges);
+
+    for(const auto &edge : edges) {
+        if(edge.counter >= 0) instrument(function, &cfg, edge);
+    }
+
+    {
+        ChunkMutator(function, true);
+    }
+
+    if(unknown) {
+        LOG(1, "ProfileEdgePass: " << unknown << " edge(s) in ["
+            << function->getName() << "] can't be measured");
+    }
+}
+
+void ProfileEdgePass::buildEdges(Function *function, ControlFlowGraph *cfg,
+    std::vector<Edge> &edges) {
+
+    ControlFlow::id_t exitID = cfg->getCount();
+    for(ControlFlow::id_t id = 0; id < exitID; id ++) {
+        auto node = cfg->get(id);
+        auto last = node->getBlock()->getChildren()->getIterable()->getLast();
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            last->getSemantic());
+
+        bool hasSuccessor = false;
+        bool jumpsWithin = false;
+        for(auto link : node->forwardLinks()) {
+            auto cflink = dynamic_cast<ControlFlowLink *>(&*link);
+            EdgeKind kind = EDGE_TABLE;
+            if(!cflink->getFollowJump()) {
+                kind = EDGE_FALLTHROUGH;
+            }
+            else if(cfi) {
+                kind = EDGE_JUMP;
+                jumpsWithin = true;
+            }
+            edges.push_back(makeEdge(id, cflink->getTargetID(), kind,
+                cflink->getOffset()));
+            hasSuccessor = true;
+        }
+
+        if(!hasSuccessor) {
+            edges.push_back(makeEdge(id, exitID, EDGE_EXIT));
+        }
+        else if(cfi && !jumpsWithin && isConditionalJump(cfi)) {
+            // conditional tail jump out of the function
+            edges.push_back(makeEdge(id, exitID, EDGE_JUMP));
+        }
+    }
+
+    edges.push_back(makeEdge(exitID, 0, EDGE_VIRTUAL));
+}
+
+void ProfileEdgePass::choosePlacements(Function *function,
+    ControlFlowGraph *cfg, std::vector<Edge> &edges) {
+
+    ControlFlow::id_t exitID = cfg->getCount();
+    std::vector<size_t> outDegree(exitID + 1), inDegree(exitID + 1);
+    for(const auto &edge : edges) {
+        outDegree[edge.source] ++;
+        inDegree[edge.target] ++;
+    }
+
+    for(auto &edge : edges) {
+        if(edge.kind == EDGE_VIRTUAL) {
+            edge.weight = WEIGHT_VIRTUAL;
+            continue;
+        }
+
+        auto source = cfg->get(edge.source)->getBlock();
+        auto last = source->getChildren()->getIterable()->getLast();
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            last->getSemantic());
+        bool conditional = cfi && isConditionalJump(cfi);
+
+        if(outDegree[edge.source] == 1 && !conditional) {
+            edge.placement = (edge.kind == EDGE_FALLTHROUGH)
+                ? PLACE_AFTER_LAST : PLACE_BEFORE_LAST;
+        }
+        else if(edge.target != exitID && inDegree[edge.target] == 1
+            && edge.offset == 0) {
+
+            edge.placement = PLACE_TARGET;
+        }
+        else if(edge.kind == EDGE_FALLTHROUGH) {
+            edge.placement = PLACE_SPLIT_FALLTHROUGH;
+        }
+        else if(edge.kind == EDGE_JUMP && canRetarget(cfi)) {
+            edge.placement = PLACE_SPLIT_JUMP;
+        }
+
+        if(edge.placement == PLACE_NONE) {
+            edge.weight = WEIGHT_UNMEASURABLE;
+            continue;
+        }
+
+        // exits run once per call, so they are the cheapest to count
+        edge.weight = (edge.kind == EDGE_EXIT) ? 1 : 2;
+        if(edge.placement == PLACE_SPLIT_FALLTHROUGH
+            || edge.placement == PLACE_SPLIT_JUMP) {
+
+            edge.weight += WEIGHT_SPLIT;
+        }
+        if(edge.target != exitID) {
+            auto target = cfg->get(edge.target)->getBlock();
+            if(target->getAddress() <= source->getAddress()) {
+                edge.weight += WEIGHT_BACK_EDGE;
+            }
+        }
+    }
+}
+
+size_t ProfileEdgePass::chooseSpanningTree(size_t nodeCount,
+    std::vector<Edge> &edges) {
+
+    std::vector<size_t> order(edges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&edges] (size_t a, size_t b) {
+            return edges[a].weight > edges[b].weight;
+        });
+
+    std::vector<size_t> parent(nodeCount);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent] (size_t x) {
+        while(parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+
+    size_t chords = 0;
+    for(auto index : order) {
+        auto &edge = edges[index];
+        auto a = find(edge.source);
+        auto b = find(edge.target);
+        edge.onTree = (a != b);
+        if(edge.onTree) {
+            parent[a] = b;
+        }
+        else {
+            chords ++;
+        }
+    }
+    return chords;
+}
+
+void ProfileEdgePass::instrument(Function *function, ControlFlowGraph *cfg,
+    const Edge &edge) {
+
+    auto counter = edge.counter;
+    auto generator = [this, counter] (unsigned int stackBytesAdded) {
+        return ChunkAddInline::InstrList{makeIncrement(counter)};
+    };
+    ChunkAddInline::RegList flags = {X86_REG_EFLAGS};
+
+    auto source = cfg->get(edge.source)->getBlock();
+    // look up instructions only now, earlier insertions may have moved them
+    auto last = source->getChildren()->getIterable()->getLast();
+    auto positionFactory = PositionFactory::getInstance();
+
+    switch(edge.placement) {
+    case PLACE_BEFORE_LAST: {
+        // the flags are dead once control leaves the function
+        auto semantic = last->getSemantic();
+        bool leaves = (edge.kind == EDGE_EXIT)
+            && (dynamic_cast<ReturnInstruction *>(semantic)
+                || dynamic_cast<ControlFlowInstruction *>(semantic)
+                || dynamic_cast<IndirectJumpInstruction *>(semantic));
+        ChunkAddInline ai(leaves ? ChunkAddInline::RegList() : flags,
+            generator);
+        ai.insertBefore(last, true);
+        break;
+    }
+    case PLACE_AFTER_LAST: {
+        ChunkAddInline ai(flags, generator);
+        ai.insertAfter(last);
+        break;
+    }
+    case PLACE_TARGET: {
+        auto target = cfg->get(edge.target)->getBlock();
+        auto first = target->getChildren()->getIterable()->get(0);
+        ChunkAddInline ai(flags, generator);
+        ai.insertBefore(first, true);
+        break;
+    }
+    case PLACE_SPLIT_FALLTHROUGH: {
+        // a placeholder gives ChunkAddInline somewhere to insert before
+        auto block = new Block();
+        block->setPosition(positionFactory->makePosition(source, block,
+            source->getAddress() + source->getSize()
+                - function->getAddress()));
+        auto nop = Disassemble::instruction({0x90});
+        ChunkMutator(block).append(nop);
+        ChunkMutator(function).insertAfter(source, block);
+
+        ChunkAddInline ai(flags, generator);
+        ai.insertBefore(nop, false);
+        ChunkMutator(block, true).removeLast();
+        break;
+    }
+    case PLACE_SPLIT_JUMP: {
+        auto cfi = static_cast<ControlFlowInstruction *>(last->getSemantic());
+        auto lastBlock = function->getChildren()->getIterable()->getLast();
+
+        auto block = new Block();
+        block->setPosition(positionFactory->makePosition(lastBlock, block,
+            function->getSize()));
+        auto jump = new Instruction();
+        auto jumpSem = new ControlFlowInstruction(
+            X86_INS_JMP, jump, "\xe9", "jmp", 4);
+        jumpSem->setLink(cfi->getLink());
+        jump->setSemantic(jumpSem);
+        ChunkMutator(block).append(jump);
+        ChunkMutator(function).insertAfter(lastBlock, block);
+
+        ChunkAddInline ai(flags, generator);
+        ai.insertBefore(jump, false);
+
+        // PromoteJumpsPass widens the jcc if the new block is out of reach
+        cfi->setLink(new NormalLink(block, Link::SCOPE_INTERNAL_JUMP));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+Instruction *ProfileEdgePass::makeIncrement(size_t counter) {
+    /*
+        48 ff 05 00 00 00 00         incq   counter(%rip)
+    */
+    DisasmHandle handle(true);
+    auto instr = new Instruction();
+    auto sem = new LinkedInstruction(instr);
+    sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
+        std::vector<unsigned char>{0x48, 0xff, 0x05, 0x00, 0x00, 0x00, 0x00}));
+    sem->setLink(new DataOffsetLink(section,
+        COUNTER_HEADER_SIZE + counter * sizeof(uint64_t),
+        Link::SCOPE_INTERNAL_DATA));
+    sem->setIndex(0);
+    instr->setSemantic(sem);
+    return instr;
+}
+
+static DataSection *makeSection(Module *module, address_t address,
+    const char *name, size_t alignment, unsigned permissions) {
+
+    auto regionList = module->getDataRegionList();
+    auto region = new DataRegion(address);
+    region->setPosition(new AbsolutePosition(address));
+    regionList->getChildren()->add(region);
+    region->setParent(regionList);
+
+    auto section = new DataSection();
+    section->setName(name);
+    section->setAlignment(alignment);
+    section->setPermissions(permissions);
+    section->setPosition(new AbsoluteOffsetPosition(section, 0));
+    section->setType(DataSection::TYPE_DATA);
+    region->getChildren()->add(section);
+    section->setParent(region);
+
+    return section;
+}
+
+static void appendBytes(DataSection *section, const std::string &data) {
+    auto region = static_cast<DataRegion *>(section->getParent());
+    region->setSize(region->getSize() + data.length());
+    section->setSize(section->getSize() + data.length());
+
+    auto bytes = region->getDataBytes();
+    bytes.append(data);
+    region->saveDataBytes(bytes);
+}
+
+static void replaceBytes(DataSection *section, const std::string &data) {
+    auto region = static_cast<DataRegion *>(section->getParent());
+    auto bytes = region->getDataBytes();
+    bytes.replace(0, data.length(), data);
+    region->saveDataBytes(bytes);
+}
+
+void ProfileEdgePass::createSections(Module *module) {
+    section = makeSection(module, EDGE_REGION_ADDRESS, EDGE_SECTION_NAME,
+        0x8, SHF_WRITE | SHF_ALLOC);
+    mapSection = makeSection(module, EDGE_MAPREGION_ADDRESS,
+        EDGE_MAPSECTION_NAME, 0x1, SHF_ALLOC);
+
+    // the counts are filled in by updateHeaders()
+    appendBytes(section, std::string(COUNTER_HEADER_SIZE, '\0'));
+    appendBytes(mapSection, std::string(MAP_HEADER_SIZE, '\0'));
+    updateHeaders();
+}
+
+void ProfileEdgePass::appendCounter() {
+    appendBytes(section, std::string(sizeof(uint64_t), '\0'));
+}
+
+/*  Each function record in .profiling.edgemap is
+
+        u32 nameLength, char name[nameLength],
+        u32 nodeCount, u64 blockAddress[nodeCount],
+        u32 edgeCount, { u32 source, u32 target, i32 counter }[edgeCount]
+
+    where node nodeCount is the virtual exit node, and counter is an index
+    into .profiling.edges or one of COUNTER_TREE, COUNTER_UNKNOWN.
+*/
+void ProfileEdgePass::appendMap(Function *function, ControlFlowGraph *cfg,
+    const std::vector<Edge> &edges) {
+
+    std::string record;
+    const auto &name = function->getName();
+    appendValue<uint32_t>(record, name.length());
+    record.append(name);
+
+    appendValue<uint32_t>(record, cfg->getCount());
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        appendValue<uint64_t>(record, cfg->get(id)->getBlock()->getAddress());
+    }
+
+    appendValue<uint32_t>(record, edges.size());
+    for(const auto &edge : edges) {
+        appendValue<uint32_t>(record, edge.source);
+        appendValue<uint32_t>(record, edge.target);
+        appendValue<int32_t>(record, edge.counter);
+    }
+
+    appendBytes(mapSection, record);
+    functionCount ++;
+}
+
+void ProfileEdgePass::updateHeaders() {
+    std::string header;
+    appendValue<uint32_t>(header, COUNTER_MAGIC);
+    appendValue<uint32_t>(header, FORMAT_VERSION);
+    appendValue<uint64_t>(header, counterCount);
+    replaceBytes(section, header);
+
+    header.clear();
+    appendValue<uint32_t>(header, MAP_MAGIC);
+    appendValue<uint32_t>(header, FORMAT_VERSION);
+    appendValue<uint32_t>(header, functionCount);
+    replaceBytes(mapSection, header);
+}
@@ -0,0 +1,99 @@
+#ifndef EGALITO_PASS_PROFILE_EDGE_H
+#define EGALITO_PASS_PROFILE_EDGE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "chunkpass.h"
+#include "analysis/controlflow.h"
+#include "chunk/dataregion.h"
+
+/** Counts how often each control-flow edge of each function is taken.
+
+    Following Ball and Larus, each function's ControlFlowGraph is extended
+    with a virtual exit node and an exit->entry edge, and counters are
+    only placed on the edges that are not in a maximum spanning tree of
+    that graph. The counts of the tree edges (and of every block) follow
+    from flow conservation; etprofile --edges solves for them. Edges that
+    are expensive or impossible to instrument, and likely loop back edges,
+    are weighted so that they end up on the tree.
+
+    .profiling.edges holds a header (magic, version, counter count)
+    followed by one 64-bit counter per instrumented edge, and is written
+    to edgeprofile.data at exit by ProfileSavePass. .profiling.edgemap
+    describes the blocks and edges of each function, see visit(Function).
+*/
+class ProfileEdgePass : public ChunkPass {
+public:
+    static const uint32_t COUNTER_MAGIC = 0x50454745;  // "EGEP"
+    static const uint32_t MAP_MAGIC = 0x4d454745;      // "EGEM"
+    static const uint32_t FORMAT_VERSION = 1;
+    static const size_t COUNTER_HEADER_SIZE = 16;
+    static const size_t MAP_HEADER_SIZE = 12;
+
+    // counter field of an edge in .profiling.edgemap
+    static const int32_t COUNTER_TREE = -1;     // derived by flow conservation
+    static const int32_t COUNTER_UNKNOWN = -2;  // could not be instrumented
+
+    enum EdgeKind {
+        EDGE_FALLTHROUGH,
+        EDGE_JUMP,          // direct jump, conditional or not
+        EDGE_TABLE,         // jump table entry
+        EDGE_EXIT,          // return, tail jump, noreturn call
+        EDGE_VIRTUAL,       // exit -> entry, never instrumented
+    };
+
+    enum Placement {
+        PLACE_NONE,
+        PLACE_BEFORE_LAST,  // source has a single successor
+        PLACE_AFTER_LAST,   // source has a single fall-through successor
+        PLACE_TARGET,       // target has a single predecessor
+        PLACE_SPLIT_FALLTHROUGH,    // new block between source and target
+        PLACE_SPLIT_JUMP,   // new block at function end, jcc retargeted
+    };
+
+    struct Edge {
+        ControlFlow::id_t source;
+        ControlFlow::id_t target;
+        EdgeKind kind;
+        int offset;         // offset of the jump target within its block
+        Placement placement;
+        long weight;
+        bool onTree;
+        int32_t counter;
+    };
+private:
+    DataSection *section;
+    DataSection *mapSection;
+    size_t counterCount;
+    size_t functionCount;
+public:
+    ProfileEdgePass() : section(nullptr), mapSection(nullptr),
+        counterCount(0), functionCount(0) {}
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+
+    /** Marks the edges of a maximum spanning tree (by weight) of the
+        undirected graph with nodeCount nodes, using Kruskal's algorithm.
+        Returns the number of edges left off the tree.
+    */
+    static size_t chooseSpanningTree(size_t nodeCount,
+        std::vector<Edge> &edges);
+private:
+    bool shouldInstrument(Function *function);
+    void buildEdges(Function *function, ControlFlowGraph *cfg,
+        std::vector<Edge> &edges);
+    void choosePlacements(Function *function, ControlFlowGraph *cfg,
+        std::vector<Edge> &edges);
+    void instrument(Function *function, ControlFlowGraph *cfg,
+        const Edge &edge);
+    Instruction *makeIncrement(size_t counter);
+    void createSections(Module *module);
+    void appendCounter();
+    void appendMap(Function *function, ControlFlowGraph *cfg,
+        const std::vector<Edge> &edges);
+    void updateHeaders();
+};
+
+#endif
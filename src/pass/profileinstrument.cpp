@@ -7,55 +7,262 @@
 #include "instr/concrete.h"
 #include "log/log.h"
 
+#define GET_BYTE(x, shift) static_cast<unsigned char>(((x) >> (shift*8)) & 0xff)
+#define GET_BYTES(x) GET_BYTE((x),0), GET_BYTE((x),1), GET_BYTE((x),2), GET_BYTE((x),3)
+
+void ProfileInstrumentPass::visit(Module *module) {
+    size_t count = 0;
+    for(auto function : CIter::functions(module)) {
+        if(shouldInstrument(function)) count ++;
+    }
+    if(count == 0) return;
+
+    // keep each per-thread block on its own cache lines
+    blockStride = (count * sizeof(uint64_t) + 63) & ~63;
+    if(blockCount < 2 || (blockCount & (blockCount - 1))) {
+        LOG(0, "ProfileInstrumentPass: block count must be a power of two"
+            " greater than one");
+        blockCount = 16;
+    }
+
+    sampleSection = (samplePeriod > 1) ? createSampleSection(module) : nullptr;
+
+    recurse(module);
+
+    if(mode == MODE_PER_THREAD) {
+        auto section = createDataSection(module).first;
+        growSection(section, blockCount * blockStride);
+        if(sampleSection) growSection(sampleSection, blockCount * blockStride);
+    }
+}
+
+bool ProfileInstrumentPass::shouldInstrument(Function *function) {
+    if(function->getName() == "_init") return false;
+    if(function->getName() == "_fini") return false;
+    if(function->getName() == "__libc_csu_init") return false;
+    if(function->getName() == "__libc_csu_fini") return false;
+    return true;
+}
+
 void ProfileInstrumentPass::visit(Function *function) {
-    if(function->getName() == "_init") return;
-    if(function->getName() == "_fini") return;
-    if(function->getName() == "__libc_csu_init") return;
-    if(function->getName() == "__libc_csu_fini") return;
+    if(!shouldInstrument(function)) return;
 
     auto module = static_cast<Module *>(function->getParent()->getParent());
     auto sectionPair = createDataSection(module);
 
-    ChunkAddInline ai({}, [this, sectionPair, function] (unsigned int stackBytesAdded) {
-        /*
-           ff 05 f8 01 00 f0            incl   -0xffffe08(%rip)
+    auto counter = addVariable(sectionPair.first, function);
+    appendFunctionName(sectionPair.second, function->getName());
+    auto countdown = sampleSection ? addCountdown(sampleSection) : nullptr;
 
-           48 ff 05 f8 01 00 f0         incq   -0xffffe08(%rip)
-        */
+    if(mode == MODE_PER_THREAD) {
+        instrumentPerThread(function, counter, countdown);
+    }
+    else {
+        instrumentGlobal(function, counter, countdown);
+    }
+
+    LOG(0, "adding profiling to function [" << function->getName()
+        << "] using global var "
+        << std::hex << counter->getTargetAddress());
+}
+
+void ProfileInstrumentPass::instrumentGlobal(Function *function,
+    Link *counter, Link *countdown) {
+
+    auto block1 = function->getChildren()->getIterable()->get(0);
+    auto instr1 = block1->getChildren()->getIterable()->get(0);
+
+    // The flags are dead at function entry, so they are not saved.
+    ChunkAddInline ai({}, [this, counter, countdown, instr1]
+        (unsigned int stackBytesAdded) {
 
-        //auto instr = Disassemble::instruction({0xff, 0x05, 0x00, 0x00, 0x00, 0x00});
         DisasmHandle handle(true);
-        auto instr = new Instruction();
-        auto sem = new LinkedInstruction(instr);
-        sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x48, 0xff, 0x05, 0x00, 0x00, 0x00, 0x00}));
-        sem->setLink(addVariable(sectionPair.first, function));
-        sem->setIndex(0);
-        instr->setSemantic(sem);
-        appendFunctionName(sectionPair.second, function->getName());
-
-        return std::vector<Instruction *>{ instr };
+        std::vector<Instruction *> list;
+        auto linked = [&handle, &list] (std::vector<unsigned char> bytes,
+            Link *link) {
+
+            auto instr = new Instruction();
+            auto sem = new LinkedInstruction(instr);
+            sem->setAssembly(DisassembleInstruction(handle)
+                .makeAssemblyPtr(bytes));
+            sem->setLink(link);
+            sem->setIndex(0);
+            instr->setSemantic(sem);
+            list.push_back(instr);
+        };
+        std::vector<unsigned char> lock;
+        if(atomic) lock.push_back(0xf0);
+
+        if(!countdown) {
+            /*
+               48 ff 05 f8 01 00 f0         incq   -0xffffe08(%rip)
+               f0 48 ff 05 f8 01 00 f0      lock incq -0xffffe08(%rip)
+            */
+            auto bytes = lock;
+            bytes.insert(bytes.end(), {0x48, 0xff, 0x05, 0x00, 0x00, 0x00, 0x00});
+            linked(bytes, counter);
+            return list;
+        }
+
+        /*
+               48 ff 0d 00 00 00 00         decq   cd(%rip)
+               79 xx                        jns    skip
+               48 c7 05 00 00 00 00 NN-1    movq   $N-1, cd(%rip)
+            (f0) 48 81 05 00 00 00 00 NN    (lock) addq $N, counter(%rip)
+            skip:
+        */
+        linked({0x48, 0xff, 0x0d, 0x00, 0x00, 0x00, 0x00}, countdown);
+
+        auto jns = new Instruction();
+        auto jnsSem = new ControlFlowInstruction(
+            X86_INS_JNS, jns, "\x79", "jns", 1);
+        jnsSem->setLink(new NormalLink(instr1, Link::SCOPE_INTERNAL_JUMP));
+        jns->setSemantic(jnsSem);
+        list.push_back(jns);
+
+        unsigned int reset = samplePeriod - 1;
+        linked({0x48, 0xc7, 0x05, 0x00, 0x00, 0x00, 0x00, GET_BYTES(reset)},
+            new DataOffsetLink(*static_cast<DataOffsetLink *>(countdown)));
+
+        auto bytes = lock;
+        unsigned int period = samplePeriod;
+        bytes.insert(bytes.end(), {0x48, 0x81, 0x05, 0x00, 0x00, 0x00, 0x00,
+            GET_BYTES(period)});
+        linked(bytes, counter);
+        return list;
     });
-	auto block1 = function->getChildren()->getIterable()->get(0);
-	auto instr1 = block1->getChildren()->getIterable()->get(0);
-    ai.insertBefore(instr1, true);
+
+    if(!countdown) {
+        ai.insertBefore(instr1, true);
+    }
+    else {
+        // the jns targets instr1 itself, so jumps to instr1 must not be
+        // redirected into the new code
+        ai.insertBefore(instr1, false);
+    }
 
     {
         ChunkMutator(function, true);
     }
 
-	auto instr0 = block1->getChildren()->getIterable()->get(0);
+    auto instr0 = block1->getChildren()->getIterable()->get(0);
     auto sem = static_cast<LinkedInstruction *>(instr0->getSemantic());
     sem->regenerateAssembly();
-    LOG(0, "adding profiling to function [" << function->getName()
-        << "] using global var " 
-        << std::hex << sem->getLink()->getTargetAddress());
 }
 
+void ProfileInstrumentPass::instrumentPerThread(Function *function,
+    Link *counter, Link *countdown) {
+
+    auto block1 = function->getChildren()->getIterable()->get(0);
+    auto instr1 = block1->getChildren()->getIterable()->get(0);
+
+    // %r11 and the flags are scratch at function entry and are not saved;
+    // %r10 may hold a static chain pointer, so it is. The block offset
+    // is (hash(%fs:0) mod blockCount) * blockStride.
+    ChunkAddInline ai({}, [this, counter, countdown]
+        (unsigned int stackBytesAdded) {
+
+        DisasmHandle handle(true);
+        std::vector<Instruction *> list;
+        auto linked = [&handle, &list] (std::vector<unsigned char> bytes,
+            Link *link) {
+
+            auto instr = new Instruction();
+            auto sem = new LinkedInstruction(instr);
+            sem->setAssembly(DisassembleInstruction(handle)
+                .makeAssemblyPtr(bytes));
+            sem->setLink(link);
+            sem->setIndex(0);
+            instr->setSemantic(sem);
+            list.push_back(instr);
+        };
+
+        unsigned char shift = 64;
+        for(size_t n = blockCount; n > 1; n >>= 1) shift --;
+        unsigned int stride = blockStride;
+
+        /*
+            41 52                        push   %r10
+            64 4c 8b 1c 25 00 00 00 00   mov    %fs:0x0,%r11
+            4d 69 db 47 86 c8 61         imul   $0x61c88647,%r11,%r11
+            49 c1 eb SS                  shr    $(64-log2(blocks)),%r11
+            4d 69 db NN NN NN NN         imul   $stride,%r11,%r11
+        */
+        list.push_back(Disassemble::instruction({0x41, 0x52}));
+        list.push_back(Disassemble::instruction(
+            {0x64, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00}));
+        list.push_back(Disassemble::instruction(
+            {0x4d, 0x69, 0xdb, 0x47, 0x86, 0xc8, 0x61}));
+        list.push_back(Disassemble::instruction({0x49, 0xc1, 0xeb, shift}));
+        list.push_back(Disassemble::instruction(
+            {0x4d, 0x69, 0xdb, GET_BYTES(stride)}));
+
+        auto pop = Disassemble::instruction({0x41, 0x5a});  // pop %r10
+        std::vector<unsigned char> lock;
+        if(atomic) lock.push_back(0xf0);
+
+        if(!countdown) {
+            /*
+                4c 8d 15 00 00 00 00         lea    counter(%rip),%r10
+             (f0) 4b ff 04 1a                (lock) incq (%r10,%r11)
+            */
+            linked({0x4c, 0x8d, 0x15, 0x00, 0x00, 0x00, 0x00}, counter);
+            auto bytes = lock;
+            bytes.insert(bytes.end(), {0x4b, 0xff, 0x04, 0x1a});
+            list.push_back(Disassemble::instruction(bytes));
+            list.push_back(pop);
+            return list;
+        }
+
+        /*
+                4c 8d 15 00 00 00 00         lea    cd(%rip),%r10
+                4b ff 0c 1a                  decq   (%r10,%r11)
+                79 xx                        jns    skip
+                4b c7 04 1a NN-1             movq   $N-1,(%r10,%r11)
+                4c 8d 15 00 00 00 00         lea    counter(%rip),%r10
+             (f0) 4b 81 04 1a NN             (lock) addq $N,(%r10,%r11)
+            skip:
+                41 5a                        pop    %r10
+        */
+        linked({0x4c, 0x8d, 0x15, 0x00, 0x00, 0x00, 0x00}, countdown);
+        list.push_back(Disassemble::instruction({0x4b, 0xff, 0x0c, 0x1a}));
+
+        auto jns = new Instruction();
+        auto jnsSem = new ControlFlowInstruction(
+            X86_INS_JNS, jns, "\x79", "jns", 1);
+        jnsSem->setLink(new NormalLink(pop, Link::SCOPE_INTERNAL_JUMP));
+        jns->setSemantic(jnsSem);
+        list.push_back(jns);
+
+        unsigned int reset = samplePeriod - 1;
+        list.push_back(Disassemble::instruction(
+            {0x4b, 0xc7, 0x04, 0x1a, GET_BYTES(reset)}));
+        linked({0x4c, 0x8d, 0x15, 0x00, 0x00, 0x00, 0x00}, counter);
+        auto bytes = lock;
+        unsigned int period = samplePeriod;
+        bytes.insert(bytes.end(), {0x4b, 0x81, 0x04, 0x1a, GET_BYTES(period)});
+        list.push_back(Disassemble::instruction(bytes));
+        list.push_back(pop);
+        return list;
+    });
+
+    // inserted code contains jumps to itself, so don't swap semantics
+    ai.insertBefore(instr1, false);
+
+    {
+        ChunkMutator(function, true);
+    }
+}
+
+#undef GET_BYTE
+#undef GET_BYTES
+
 #define DATA_REGION_ADDRESS 0x30000000
 #define DATA_NAMEREGION_ADDRESS 0x31000000
+#define DATA_SAMPLEREGION_ADDRESS 0x32000000
 #define DATA_SECTION_NAME ".profiling"
 #define DATA_NAMESECTION_NAME ".profiling.names"
+#define DATA_SAMPLESECTION_NAME ".profiling.sample"
 
 std::pair<DataSection *, DataSection *> ProfileInstrumentPass
     ::createDataSection(Module *module) {
@@ -98,6 +305,29 @@ std::pair<DataSection *, DataSection *> ProfileInstrumentPass
     return std::make_pair(section, nameSection);
 }
 
+DataSection *ProfileInstrumentPass::createSampleSection(Module *module) {
+    auto regionList = module->getDataRegionList();
+    if(auto section = regionList->findDataSection(DATA_SAMPLESECTION_NAME)) {
+        return section;
+    }
+
+    auto region = new DataRegion(DATA_SAMPLEREGION_ADDRESS);
+    region->setPosition(new AbsolutePosition(DATA_SAMPLEREGION_ADDRESS));
+    regionList->getChildren()->add(region);
+    region->setParent(regionList);
+
+    auto section = new DataSection();
+    section->setName(DATA_SAMPLESECTION_NAME);
+    section->setAlignment(0x8);
+    section->setPermissions(SHF_WRITE | SHF_ALLOC);
+    section->setPosition(new AbsoluteOffsetPosition(section, 0));
+    section->setType(DataSection::TYPE_DATA);
+    region->getChildren()->add(section);
+    section->setParent(region);
+
+    return section;
+}
+
 Link *ProfileInstrumentPass::addVariable(DataSection *section, Function *function) {
     auto region = static_cast<DataRegion *>(section->getParent());
     auto offset = section->getSize();
@@ -125,6 +355,20 @@ Link *ProfileInstrumentPass::addVariable(DataSection *section, Function *functio
     return new DataOffsetLink(section, offset, Link::SCOPE_INTERNAL_DATA);
 }
 
+Link *ProfileInstrumentPass::addCountdown(DataSection *section) {
+    auto offset = section->getSize();
+    growSection(section, offset + 8);
+    return new DataOffsetLink(section, offset, Link::SCOPE_INTERNAL_DATA);
+}
+
+void ProfileInstrumentPass::growSection(DataSection *section, size_t size) {
+    if(size <= section->getSize()) return;
+
+    auto region = static_cast<DataRegion *>(section->getParent());
+    region->setSize(region->getSize() + size - section->getSize());
+    section->setSize(size);
+}
+
 void ProfileInstrumentPass::appendFunctionName(DataSection *nameSection,
     const std::string &name) {
 
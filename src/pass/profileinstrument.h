@@ -6,13 +6,56 @@
 #include "chunk/dataregion.h"
 #include "chunk/function.h"
 
+/** Adds an entry counter to each function, stored in .profiling.
+
+    In MODE_GLOBAL there is one counter per function, shared by all
+    threads. In MODE_PER_THREAD, .profiling holds several counter blocks
+    and each thread selects one by hashing its thread pointer (%fs:0);
+    the blocks are summed by etprofile. Either mode can use lock-prefixed
+    increments (setAtomic) and can count only every Nth entry through a
+    per-function countdown (setSamplePeriod), adding N each time.
+
+    Since every instrumented entry reads %fs:0, MODE_PER_THREAD must not
+    be used on code that can run before the thread pointer is set up: the
+    dynamic loader, or a static executable, whose startup code calls
+    functions such as memcpy before __libc_setup_tls() has run.
+*/
 class ProfileInstrumentPass : public ChunkPass {
 public:
+    enum Mode {
+        MODE_GLOBAL,
+        MODE_PER_THREAD,
+    };
+private:
+    Mode mode;
+    bool atomic;
+    size_t samplePeriod;
+    size_t blockCount;
+    size_t blockStride;
+    DataSection *sampleSection;
+public:
+    ProfileInstrumentPass(Mode mode = MODE_GLOBAL) : mode(mode),
+        atomic(false), samplePeriod(1), blockCount(16), blockStride(0),
+        sampleSection(nullptr) {}
+
+    void setAtomic(bool atomic) { this->atomic = atomic; }
+    void setSamplePeriod(size_t period) { samplePeriod = period; }
+    /** Number of per-thread counter blocks, a power of two (at least 2). */
+    void setBlockCount(size_t count) { blockCount = count; }
+
+    virtual void visit(Module *module);
     virtual void visit(Function *function);
 private:
+    bool shouldInstrument(Function *function);
+    void instrumentGlobal(Function *function, Link *counter, Link *countdown);
+    void instrumentPerThread(Function *function, Link *counter,
+        Link *countdown);
     std::pair<DataSection *, DataSection*> createDataSection(Module *module);
+    DataSection *createSampleSection(Module *module);
     Link *addVariable(DataSection *section, Function *function);
+    Link *addCountdown(DataSection *section);
     void appendFunctionName(DataSection *nameSection, const std::string &name);
+    void growSection(DataSection *section, size_t size);
 };
 
 #endif
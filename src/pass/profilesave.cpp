@@ -12,6 +12,8 @@
 #define DATA_REGION_NAME ("region-" #DATA_REGION_ADDRESS)
 #define DATA_SECTION_NAME ".profiling"
 #define DATA_NAMESECTION_NAME ".profiling.names"
+#define EDGE_SECTION_NAME ".profiling.edges"
+#define EDGE_MAPSECTION_NAME ".profiling.edgemap"
 
 /*
 	0000000000000000 <profiling_save_bytes>:
@@ -48,7 +50,8 @@ void ProfileSavePass::visit(Module *module) {
     }
 
     auto function = new Function();
-    function->setName("egalito_profiling_save_bytes");
+    function->setName(mode == SAVE_EDGES
+        ? "egalito_profiling_save_edges" : "egalito_profiling_save_bytes");
     function->setPosition(new AbsolutePosition(0x0));
 
     auto block = new Block();
@@ -67,7 +70,8 @@ void ProfileSavePass::visit(Module *module) {
         auto leaSem = new LinkedInstruction(leaInstr);
         leaSem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
             std::vector<unsigned char>{0x48, 0x8d, 0x3d, 0x00, 0x00, 0x00, 0x00}));
-        leaSem->setLink(appendString(nameSection, "profile.data"));
+        leaSem->setLink(appendString(nameSection,
+            mode == SAVE_EDGES ? "edgeprofile.data" : "profile.data"));
         leaSem->setIndex(0);
         leaInstr->setSemantic(leaSem);
         m.append(leaInstr);
@@ -112,9 +116,15 @@ void ProfileSavePass::visit(Module *module) {
 std::pair<DataSection *, DataSection *> ProfileSavePass
     ::getDataSections(Module *module) {
 
+    // the output file name is appended to the second section
+    const char *sectionName = (mode == SAVE_EDGES)
+        ? EDGE_SECTION_NAME : DATA_SECTION_NAME;
+    const char *nameSectionName = (mode == SAVE_EDGES)
+        ? EDGE_MAPSECTION_NAME : DATA_NAMESECTION_NAME;
+
     auto regionList = module->getDataRegionList();
-    if(auto section = regionList->findDataSection(DATA_SECTION_NAME)) {
-        if(auto nameSection = regionList->findDataSection(DATA_NAMESECTION_NAME)) {
+    if(auto section = regionList->findDataSection(sectionName)) {
+        if(auto nameSection = regionList->findDataSection(nameSectionName)) {
             return std::make_pair(section, nameSection);
         }
     }
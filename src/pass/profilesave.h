@@ -4,8 +4,24 @@
 #include "chunkpass.h"
 #include "chunk/dataregion.h"
 
+/** Adds a fini function that writes a profiling section out to a file.
+
+    SAVE_FUNCTIONS saves the ProfileInstrumentPass counters (.profiling)
+    to profile.data; SAVE_EDGES saves the ProfileEdgePass counters
+    (.profiling.edges) to edgeprofile.data. Each run appends one copy of
+    the section, so the file accumulates counts across runs.
+*/
 class ProfileSavePass : public ChunkPass {
 public:
+    enum Mode {
+        SAVE_FUNCTIONS,
+        SAVE_EDGES,
+    };
+private:
+    Mode mode;
+public:
+    ProfileSavePass(Mode mode = SAVE_FUNCTIONS) : mode(mode) {}
+
     virtual void visit(Module *module);
 private:
     std::pair<DataSection *, DataSection*> getDataSections(Module *module);
@@ -1,59 +1,147 @@
 #include <capstone/capstone.h>
 #include "promotejumps.h"
+#include "chunk/concrete.h"
 #include "operation/mutator.h"
 #include "instr/concrete.h"
 #include "log/log.h"
 #include "log/temp.h"
 #include "chunk/dump.h"
 
-void PromoteJumpsPass::visit(Function *function) {
-    changed = false;
-    recurse(function);
-    while(changed) {
-        changed = false;
-        recurse(function);
+static bool isCountJump(unsigned int id) {
+#ifdef ARCH_X86_64
+    return id == X86_INS_JCXZ || id == X86_INS_JECXZ || id == X86_INS_JRCXZ;
+#else
+    return false;
+#endif
+}
+
+void PromoteJumpsPass::visit(Program *program) {
+    std::vector<Function *> functionList;
+    for(auto module : CIter::modules(program)) {
+        for(auto function : CIter::functions(module)) {
+            functionList.push_back(function);
+        }
     }
+    relax(functionList);
+}
+
+void PromoteJumpsPass::visit(Module *module) {
+    std::vector<Function *> functionList;
+    for(auto function : CIter::functions(module)) {
+        functionList.push_back(function);
+    }
+    relax(functionList);
+}
+
+void PromoteJumpsPass::visit(Function *function) {
+    relax({function});
 
     ChunkDumper d;
     IF_LOG(11) function->accept(&d);
 }
 
-void PromoteJumpsPass::visit(Instruction *instruction) {
+void PromoteJumpsPass::relax(const std::vector<Function *> &functionList) {
 #ifdef ARCH_X86_64
-    auto v = dynamic_cast<ControlFlowInstruction *>(instruction->getSemantic());
-    if(!v) return;
-
-    if(!v->getLink()) return;
+    std::vector<Instruction *> jumpList;
+    long sizeBefore = 0;
+    for(auto function : functionList) {
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                auto v = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(!v || !v->getLink() || !v->getLink()->isRIPRelative()) {
+                    continue;
+                }
+                if(isCountJump(v->getId())
+                    || !getNarrowerOpcode(v->getId()).empty()) {
 
-    address_t disp = v->calculateDisplacement();
-    if(v->getDisplacementSize() == 1) {
-        if(!fitsIn<signed char>(disp)) {
-            promote(instruction);
+                    jumpList.push_back(instr);
+                    sizeBefore += v->getSize();
+                }
+            }
         }
-        else if(v->getLink()->isExternalJump()) {
-            promote(instruction);
+    }
+
+    // start optimistic: every jump that may be short is made short
+    for(auto instr : jumpList) {
+        resize(instr, !canBeShort(instr));
+    }
+
+    // widen jumps that are out of reach; sizes only ever grow, so
+    // displacements only grow and this terminates
+    std::vector<Instruction *> trampolineList;
+    size_t rounds = 0;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        rounds ++;
+        for(auto instr : jumpList) {
+            auto v = static_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(v->getDisplacementSize() != 1) continue;
+            if(fitsIn<signed char>(v->calculateDisplacement())) continue;
+
+            if(isCountJump(v->getId())) {
+                trampolineList.push_back(makeTrampoline(instr));
+            }
+            else {
+                resize(instr, true);
+            }
+            changed = true;
         }
     }
 
-    if(!fitsIn<signed int>(disp)) {
-        LOG(1, "Error: displacement in " << instruction->getName()
-            << " is too large for 32-bit reach: " << std::hex << disp);
-        std::abort();
+    long sizeAfter = 2 * trampolineList.size();  // short jumps over them
+    jumpList.insert(jumpList.end(),
+        trampolineList.begin(), trampolineList.end());
+    for(auto instr : jumpList) {
+        auto v = static_cast<ControlFlowInstruction *>(instr->getSemantic());
+        sizeAfter += v->getSize();
+
+        address_t disp = v->calculateDisplacement();
+        if(!fitsIn<signed int>(disp)) {
+            LOG(1, "Error: displacement in " << instr->getName()
+                << " is too large for 32-bit reach: " << std::hex << disp);
+            std::abort();
+        }
     }
+
+    savedBytes += sizeBefore - sizeAfter;
+    LOG(1, "relaxed " << std::dec << jumpList.size() << " jumps in "
+        << rounds << " rounds, saving " << (sizeBefore - sizeAfter)
+        << " bytes");
+#endif
+}
+
+bool PromoteJumpsPass::canBeShort(Instruction *instruction) {
+#ifdef ARCH_X86_64
+    auto v = static_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    if(isCountJump(v->getId())) return true;
+
+    // other functions are only placed later, by the generator
+    return !v->getLink()->isExternalJump();
+#else
+    return false;
 #endif
 }
 
-void PromoteJumpsPass::promote(Instruction *instruction) {
-    changed = true;
+void PromoteJumpsPass::resize(Instruction *instruction, bool wide) {
 #ifdef ARCH_X86_64
-    LOG(10, "promote jump instruction " << instruction->getName());
-    auto v = dynamic_cast<ControlFlowInstruction *>(instruction->getSemantic());
+    auto v = static_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    int displacementSize = wide ? 4 : 1;
+    if(v->getDisplacementSize() == displacementSize) return;
+
+    LOG(10, (wide ? "promote" : "shrink") << " jump instruction "
+        << instruction->getName());
     LOG(11, "    target before = " << v->getLink()->getTargetAddress());
 
     size_t oldSize = v->getSize();
 
-    v->setOpcode(getWiderOpcode(v->getId()));
-    v->setDisplacementSize(4);
+    v->setOpcode(wide ? getWiderOpcode(v->getId())
+        : getNarrowerOpcode(v->getId()));
+    v->setDisplacementSize(displacementSize);
 
     ChunkMutator(instruction->getParent())
         .modifiedChildSize(instruction, v->getSize() - oldSize);
@@ -62,6 +150,64 @@ void PromoteJumpsPass::promote(Instruction *instruction) {
 #endif
 }
 
+Instruction *PromoteJumpsPass::makeTrampoline(Instruction *instruction) {
+#ifdef ARCH_X86_64
+    /*
+        jrcxz 1f        (was: jrcxz target)
+        jmp 2f
+    1:  jmp target      (rel32)
+    2:
+
+        Each jmp gets a block of its own, so that blocks still end at
+        control flow.
+    */
+    LOG(10, "trampoline for jump instruction " << instruction->getName());
+    auto v = static_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    auto block = static_cast<Block *>(instruction->getParent());
+    auto function = static_cast<Function *>(block->getParent());
+
+    Chunk *next = instruction->getNextSibling();
+    if(!next) {
+        if(auto nextBlock = static_cast<Block *>(block->getNextSibling())) {
+            next = nextBlock->getChildren()->getIterable()->get(0);
+        }
+    }
+    if(!next) {
+        LOG(1, "Error: no fall-through after " << instruction->getName());
+        std::abort();
+    }
+
+    auto skip = new Instruction();
+    auto skipSem = new ControlFlowInstruction(
+        X86_INS_JMP, skip, "\xeb", "jmp", 1);
+    skipSem->setLink(new NormalLink(next, Link::SCOPE_INTERNAL_JUMP));
+    skip->setSemantic(skipSem);
+
+    auto far = new Instruction();
+    auto farSem = new ControlFlowInstruction(
+        X86_INS_JMP, far, "\xe9", "jmp", 4);
+    farSem->setLink(v->getLink());
+    far->setSemantic(farSem);
+
+    v->setLink(new NormalLink(far, Link::SCOPE_INTERNAL_JUMP));
+    ChunkMutator(block).insertAfter(instruction,
+        std::vector<Instruction *>{skip, far});
+
+    {
+        ChunkMutator m(function);
+        if(auto rest = static_cast<Instruction *>(far->getNextSibling())) {
+            m.splitBlockBefore(rest);
+        }
+        m.splitBlockBefore(far);
+        m.splitBlockBefore(skip);
+    }
+    return far;
+#else
+    return nullptr;
+#endif
+}
+
 std::string PromoteJumpsPass::getWiderOpcode(unsigned int id) {
     std::string opcode;
 #define WRITE_BYTE(b) opcode += static_cast<unsigned char>(b)
@@ -86,8 +232,8 @@ std::string PromoteJumpsPass::getWiderOpcode(unsigned int id) {
     case X86_INS_JCXZ:
     case X86_INS_JRCXZ:
     case X86_INS_JECXZ:
-        // TODO: handle properly
-        LOG(1, "Can't promote JRCXZ or JECXZ right now, always short.");
+        // always short, see makeTrampoline()
+        LOG(1, "Can't promote JRCXZ or JECXZ, always short.");
         break;
     default:
         LOG(1, "Unknown jump opcode id encountered: " << id);
@@ -96,3 +242,32 @@ std::string PromoteJumpsPass::getWiderOpcode(unsigned int id) {
 #undef WRITE_BYTE
     return std::move(opcode);
 }
+
+/** Returns an empty string for instructions without a rel8 form. */
+std::string PromoteJumpsPass::getNarrowerOpcode(unsigned int id) {
+    std::string opcode;
+#define WRITE_BYTE(b) opcode += static_cast<unsigned char>(b)
+    switch(id) {
+    case X86_INS_JMP:     WRITE_BYTE(0xeb); break;
+    case X86_INS_JA:      WRITE_BYTE(0x77); break;
+    case X86_INS_JAE:     WRITE_BYTE(0x73); break;
+    case X86_INS_JB:      WRITE_BYTE(0x72); break;
+    case X86_INS_JBE:     WRITE_BYTE(0x76); break;
+    case X86_INS_JG:      WRITE_BYTE(0x7f); break;
+    case X86_INS_JGE:     WRITE_BYTE(0x7d); break;
+    case X86_INS_JL:      WRITE_BYTE(0x7c); break;
+    case X86_INS_JLE:     WRITE_BYTE(0x7e); break;
+    case X86_INS_JNO:     WRITE_BYTE(0x71); break;
+    case X86_INS_JNP:     WRITE_BYTE(0x7b); break;
+    case X86_INS_JNS:     WRITE_BYTE(0x79); break;
+    case X86_INS_JO:      WRITE_BYTE(0x70); break;
+    case X86_INS_JP:      WRITE_BYTE(0x7a); break;
+    case X86_INS_JS:      WRITE_BYTE(0x78); break;
+    case X86_INS_JE:      WRITE_BYTE(0x74); break;
+    case X86_INS_JNE:     WRITE_BYTE(0x75); break;
+    default:
+        break;
+    }
+#undef WRITE_BYTE
+    return std::move(opcode);
+}
@@ -1,22 +1,47 @@
 #ifndef EGALITO_PASS_PROMOTE_JUMPS_H
 #define EGALITO_PASS_PROMOTE_JUMPS_H
 
+#include <vector>
 #include "chunkpass.h"
 
-/** This whole pass is x86_64-specific. */
+/** Chooses the shortest encoding of every direct jump and Jcc. Jumps start
+    out with rel8 displacements and are widened to rel32 until every
+    displacement fits; since sizes only grow, this reaches a fixpoint.
+    JRCXZ and JECXZ have no rel32 form and get a trampoline instead, in
+    blocks of its own.
+
+    Jumps out of a function are always kept wide: the generator places
+    functions only after this pass has run, so their distance is unknown.
+    Visiting a Program or Module relaxes all of its functions together.
+
+    This whole pass is x86_64-specific.
+*/
 class PromoteJumpsPass : public ChunkPass {
 private:
-    bool changed;
+    long savedBytes;
 public:
-    virtual void visit(Module *module) { recurse(module->getFunctionList()); }
+    PromoteJumpsPass() : savedBytes(0) {}
+
+    virtual void visit(Program *program);
+    virtual void visit(Module *module);
     virtual void visit(Function *function);
-    virtual void visit(Instruction *instruction);
+
+    /** Net bytes of code removed so far (negative if code grew). */
+    long getSavedBytes() const { return savedBytes; }
 
     template <typename NarrowType>
     static bool fitsIn(address_t address);
+
+    /** Switches a jump between its rel8 and rel32 forms. JRCXZ and JECXZ
+        have no rel32 form and must not be widened.
+    */
+    static void resize(Instruction *instruction, bool wide);
 private:
-    void promote(Instruction *instruction);
+    void relax(const std::vector<Function *> &functionList);
+    bool canBeShort(Instruction *instruction);
+    Instruction *makeTrampoline(Instruction *instruction);
     static std::string getWiderOpcode(unsigned int id);
+    static std::string getNarrowerOpcode(unsigned int id);
 };
 
 template <typename NarrowType>
@@ -4,14 +4,34 @@
 #include "instr/concrete.h"
 #include "instr/register.h"
 #include "disasm/disassemble.h"
+#include "analysis/regflow.h"
 #include "operation/mutator.h"
 #include "util/streamasstring.h"
 #include "log/log.h"
 
+void RetpolinePass::visit(Program *program) {
+#ifdef ARCH_X86_64
+    if(mode == MODE_SHARED) thunkModule = program->getMain();
+    recurse(program);
+#endif
+}
+
 void RetpolinePass::visit(Module *module) {
 #ifdef ARCH_X86_64
     this->module = module;
+    bool ownThunks = !thunkModule;
+    if(ownThunks) thunkModule = module;
     recurse(module->getFunctionList());
+    if(ownThunks) {
+        // the next module must not link to thunks in this one
+        thunkModule = nullptr;
+        sharedThunks.clear();
+        retpolineList.clear();
+    }
+
+    LOG(1, "RetpolinePass: " << std::dec << thunkCount << " thunks of "
+        << thunkSize << " bytes, " << directCount
+        << " branches made direct, after " << module->getName());
 #endif
 }
 
@@ -19,47 +39,113 @@ void RetpolinePass::visit(Function *function) {
 #ifdef ARCH_X86_64
     if(function->getName().find("_ssse3") != std::string::npos) return;
 
+    // collect first, shared thunks add instructions to blocks
+    std::vector<Instruction *> sites;
     for(auto block : CIter::children(function)) {
         for(auto instr : CIter::children(block)) {
             auto semantic = instr->getSemantic();
             if(auto v = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
                 if(v->isForJumpTable()) continue;
-
-                log_instruction(instr, "before:");
-
-                auto trampoline = makeOutlinedTrampoline(module, instr);
-                auto newSem = new ControlFlowInstruction(
-                    X86_INS_JMP, instr, "\xe9", "jmpq", 4);
-                newSem->setLink(new NormalLink(trampoline, Link::SCOPE_EXTERNAL_JUMP));
-                instr->setSemantic(newSem);
-
-                ChunkMutator(block, true).modifiedChildSize(instr,
-                    newSem->getSize() - semantic->getSize());
-                delete semantic;
-
-                log_instruction(instr, "after: ");
+                sites.push_back(instr);
             }
             else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
-                log_instruction(instr, "before:");
-
-                auto trampoline = makeOutlinedTrampoline(module, instr);
-                auto newSem = new ControlFlowInstruction(
-                    X86_INS_CALL, instr, "\xe8", "callq", 4);
-                newSem->setLink(new NormalLink(trampoline, Link::SCOPE_EXTERNAL_JUMP));
-                instr->setSemantic(newSem);
+                sites.push_back(instr);
+            }
+        }
+    }
 
-                ChunkMutator(block, true).modifiedChildSize(instr,
-                    newSem->getSize() - semantic->getSize());
-                delete semantic;
+    for(auto instr : sites) {
+        auto block = static_cast<Block *>(instr->getParent());
+        auto semantic = instr->getSemantic();
+        bool isCall = (dynamic_cast<IndirectCallInstruction *>(semantic)
+            != nullptr);
+
+        log_instruction(instr, "before:");
+        if(makeDirect && branchDirectly(instr)) {
+            directCount ++;
+            log_instruction(instr, "after: ");
+            continue;
+        }
 
-                log_instruction(instr, "after: ");
-            }
+        std::vector<Instruction *> loadList;
+        auto trampoline = (mode == MODE_SHARED)
+            ? getSharedThunk(instr, loadList)
+            : makeOutlinedTrampoline(thunkModule, instr);
+        auto newSem = isCall
+            ? new ControlFlowInstruction(X86_INS_CALL, instr, "\xe8", "callq", 4)
+            : new ControlFlowInstruction(X86_INS_JMP, instr, "\xe9", "jmpq", 4);
+        newSem->setLink(new NormalLink(trampoline, Link::SCOPE_EXTERNAL_JUMP));
+        instr->setSemantic(newSem);
+
+        ChunkMutator(block, true).modifiedChildSize(instr,
+            newSem->getSize() - semantic->getSize());
+        delete semantic;
+        log_instruction(instr, "after: ");
+
+        if(!loadList.empty()) {
+            // jumps to the site must load the target too
+            ChunkMutator(block, true).insertBefore(instr, loadList, true);
         }
     }
     ChunkMutator(function, true);
 #endif
 }
 
+bool RetpolinePass::branchDirectly(Instruction *instr) {
+#ifdef ARCH_X86_64
+    auto semantic = static_cast<IndirectControlFlowInstructionBase *>(
+        instr->getSemantic());
+    if(semantic->hasMemoryOperand()) return false;
+    auto reg = X86Register::convertToPhysical(semantic->getRegister());
+    if(reg == X86Register::INVALID) return false;
+
+    // find the last write to reg in this block, if any
+    RegisterEffectModel model;
+    for(auto prev = instr->getPreviousSibling(); prev;
+        prev = prev->getPreviousSibling()) {
+
+        auto prevInstr = static_cast<Instruction *>(prev);
+        if(!(model.getEffect(prevInstr).getDef() & RegisterEffect::bit(reg))) {
+            continue;
+        }
+
+        // lea function(%rip), %reg
+        auto linked = dynamic_cast<LinkedInstruction *>(
+            prevInstr->getSemantic());
+        if(!linked || !linked->getLink()) return false;
+        auto assembly = linked->getAssembly();
+        if(!assembly || assembly->getId() != X86_INS_LEA) return false;
+        auto asmOps = assembly->getAsmOperands();
+        const auto &dest = asmOps->getOperands()[asmOps->getOpCount() - 1];
+        if(dest.type != X86_OP_REG
+            || X86Register::convertToPhysical(dest.reg) != reg
+            || X86Register::getWidth(reg, dest.reg) != 8) {
+
+            return false;
+        }
+
+        auto target = dynamic_cast<Function *>(linked->getLink()->getTarget());
+        if(!target || target->getParent() != module->getFunctionList()) {
+            return false;
+        }
+
+        bool isCall = (dynamic_cast<IndirectCallInstruction *>(semantic)
+            != nullptr);
+        auto newSem = isCall
+            ? new ControlFlowInstruction(X86_INS_CALL, instr, "\xe8", "callq", 4)
+            : new ControlFlowInstruction(X86_INS_JMP, instr, "\xe9", "jmpq", 4);
+        newSem->setLink(new NormalLink(target, Link::SCOPE_EXTERNAL_JUMP));
+        instr->setSemantic(newSem);
+
+        ChunkMutator(static_cast<Block *>(instr->getParent()), true)
+            .modifiedChildSize(instr, newSem->getSize() - semantic->getSize());
+        delete semantic;
+        return true;
+    }
+#endif
+    return false;
+}
+
 void RetpolinePass::log_instruction(Instruction *instr, const char *message) {
     IF_LOG(10) {
         LOG0(1, "RetpolinePass: " << message << " ");
@@ -103,7 +189,69 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
     auto found = retpolineList.find(name);
     if(found != retpolineList.end()) return (*found).second;
 
+    std::vector<Instruction *> movInsList;
+    if(dynamic_cast<IndirectControlFlowInstructionBase *>(semantic)) {
+        movInsList = makeMovInstruction(instr);
+    }
+    if(movInsList.empty()) {
+        LOG(1, "WARNING: couldn't rewrite " << instr->getName()
+            << " for retpoline! Using hlt instr");
+        movInsList.push_back(Disassemble::instruction({0xf4}));
+    }
+
+    auto function = makeThunk(module, name, movInsList);
+    retpolineList[name] = function;
+    return function;
+#else
+    return nullptr;
+#endif
+}
+
+Function *RetpolinePass::getSharedThunk(Instruction *instr,
+    std::vector<Instruction *> &loadList) {
+
+#ifdef ARCH_X86_64
+    auto semantic = static_cast<IndirectControlFlowInstructionBase *>(
+        instr->getSemantic());
 
+    int reg;
+    if(semantic->hasMemoryOperand()) {
+        auto load = makeLoadInstruction(instr);
+        if(!load) return makeOutlinedTrampoline(thunkModule, instr);
+        loadList.push_back(load);
+        reg = X86Register::R11;
+    }
+    else {
+        reg = X86Register::convertToPhysical(semantic->getRegister());
+        if(!X86Register::isInteger(reg) || reg == X86Register::SP) {
+            return makeOutlinedTrampoline(thunkModule, instr);
+        }
+    }
+
+    sharedThunks.resize(X86Register::REGISTER_NUMBER);
+    if(auto thunk = sharedThunks[reg]) return thunk;
+
+    // movq %reg, (%rsp)
+    unsigned char rex = (reg >= 8) ? 0x4c : 0x48;
+    unsigned char modrm = 0x04 | ((reg & 7) << 3);
+    auto movIns = Disassemble::instruction({rex, 0x89, modrm, 0x24});
+
+    // same naming as the compiler's -mindirect-branch=thunk
+    std::string name = std::string("__x86_indirect_thunk_")
+        + X86Register::getRepresentativeName(reg);
+    auto thunk = makeThunk(thunkModule, name, {movIns});
+    thunk->setAlignment(THUNK_ALIGNMENT);
+    sharedThunks[reg] = thunk;
+    return thunk;
+#else
+    return nullptr;
+#endif
+}
+
+Function *RetpolinePass::makeThunk(Module *module, const std::string &name,
+    const std::vector<Instruction *> &movInsList) {
+
+#ifdef ARCH_X86_64
     // retpoline_r11_trampoline:
     //   call set_up_target;
     // capture_spec:
@@ -154,17 +302,6 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
         }
 
         {
-            std::vector<Instruction *> movInsList;
-            if(dynamic_cast<IndirectControlFlowInstructionBase *>(semantic)) {
-                movInsList = makeMovInstruction(instr);
-            }
-
-            if(movInsList.empty()) {
-                LOG(1, "WARNING: couldn't rewrite " << instr->getName()
-                    << " for retpoline! Using hlt instr");
-                movInsList.push_back(Disassemble::instruction({0xf4}));
-            }
-
             auto retIns = new Instruction();
             auto retSem = new ReturnInstruction();
             static DisasmHandle handle(true);
@@ -187,7 +324,10 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
 
     module->getFunctionList()->getChildren()->add(function);
     module->getFunctionList()->getChildren()->clearSpatial();
-    retpolineList[name] = function;
+    function->setParent(module->getFunctionList());
+
+    thunkCount ++;
+    thunkSize += function->getSize();
     return function;
 #else
     return nullptr;
@@ -197,6 +337,21 @@ Function *RetpolinePass::makeOutlinedTrampoline(Module *module, Instruction *ins
 std::vector<Instruction *> RetpolinePass::makeMovInstruction(
     Instruction *instr) {
 
+#ifdef ARCH_X86_64
+    auto ins1 = makeLoadInstruction(instr);
+    if(!ins1) return {};
+
+    // movq %r11, (%rsp)
+    DisasmHandle handle(true);
+    std::vector<unsigned char> bin4{0x4c, 0x89, 0x1c, 0x24};
+    auto ins2 = DisassembleInstruction(handle).instruction(bin4);
+    return {ins1, ins2};
+#else
+    return {};
+#endif
+}
+
+Instruction *RetpolinePass::makeLoadInstruction(Instruction *instr) {
 #ifdef ARCH_X86_64
     auto semantic = static_cast<IndirectControlFlowInstructionBase *>(instr->getSemantic());
     auto cs_reg = semantic->getRegister();
@@ -205,6 +360,7 @@ std::vector<Instruction *> RetpolinePass::makeMovInstruction(
     auto indexReg = X86Register::convertToPhysical(semantic->getIndexRegister());
     auto scale = semantic->getScale();
     int64_t displacement = semantic->getDisplacement();
+    if(reg == X86Register::INVALID) return nullptr;  // no base register
 
     // movq EA, %r11
     std::vector<unsigned char> bin2;
@@ -250,8 +406,8 @@ std::vector<Instruction *> RetpolinePass::makeMovInstruction(
             unsigned char sib = bits << 6;
             if(reg >= 8) sib |= (reg - 8);
             else         sib |= reg;
-            if(indexReg > 8) sib |= (indexReg - 8) << 3;
-            else             sib |= indexReg << 3;
+            if(indexReg >= 8) sib |= (indexReg - 8) << 3;
+            else              sib |= indexReg << 3;
             bin2[3] = sib;
         }
         for(int i = 0; i < 4; i++) {
@@ -271,13 +427,8 @@ std::vector<Instruction *> RetpolinePass::makeMovInstruction(
         bin2.push_back(operand);
     }
     DisasmHandle handle(true);
-    auto ins1 = DisassembleInstruction(handle).instruction(bin2);
-
-    // movq %r11, (%rsp)
-    std::vector<unsigned char> bin4{0x4c, 0x89, 0x1c, 0x24};
-    auto ins2 = DisassembleInstruction(handle).instruction(bin4);
-    return {ins1, ins2};
+    return DisassembleInstruction(handle).instruction(bin2);
 #else
-    return {};
+    return nullptr;
 #endif
 }
@@ -6,19 +6,64 @@
 #include <string>
 #include "chunkpass.h"
 
+/** Sends indirect calls and jumps through retpoline thunks, which keep
+    the indirect target from being predicted.
+
+    In MODE_PER_OPERAND, every distinct register or memory operand gets a
+    thunk that loads the target itself. In MODE_SHARED, memory operands are
+    loaded into %r11 at the call site instead, so there is at most one thunk
+    per register, each on its own cache line. Visiting a Program shares
+    these thunks between all its modules, which only suits union output.
+
+    With setMakeDirect(), a register that was loaded with the address of a
+    function in this module earlier in the same block is branched to
+    directly instead. Jump table jumps are never changed.
+*/
 class RetpolinePass : public ChunkPass {
+public:
+    enum Mode {
+        MODE_PER_OPERAND,
+        MODE_SHARED
+    };
+    enum {
+        THUNK_ALIGNMENT = 64  // cache line size
+    };
 private:
-    std::map<std::string, Function *> retpolineList;
+    Mode mode;
+    bool makeDirect;
+    // thunks in thunkModule
+    std::map<std::string, Function *> retpolineList;  // by name
+    std::vector<Function *> sharedThunks;  // indexed by register
     Module *module;
+    Module *thunkModule;
+    size_t thunkCount;
+    size_t thunkSize;
+    size_t directCount;
 public:
-    RetpolinePass() : module(nullptr) {}
+    RetpolinePass(Mode mode = MODE_PER_OPERAND) : mode(mode),
+        makeDirect(false), module(nullptr), thunkModule(nullptr),
+        thunkCount(0), thunkSize(0), directCount(0) {}
+
+    void setMakeDirect(bool makeDirect) { this->makeDirect = makeDirect; }
+
+    virtual void visit(Program *program);
     virtual void visit(Module *module);
+
+    size_t getThunkCount() const { return thunkCount; }
+    size_t getThunkSize() const { return thunkSize; }
+    size_t getDirectCount() const { return directCount; }
 protected:
     virtual void visit(Function *function);
 private:
     void log_instruction(Instruction *instr, const char *message);
+    bool branchDirectly(Instruction *instr);
     Function *makeOutlinedTrampoline(Module *module, Instruction *instr);
+    Function *getSharedThunk(Instruction *instr,
+        std::vector<Instruction *> &loadList);
+    Function *makeThunk(Module *module, const std::string &name,
+        const std::vector<Instruction *> &movInsList);
     std::vector<Instruction *> makeMovInstruction(Instruction *instr);
+    Instruction *makeLoadInstruction(Instruction *instr);
 };
 
 #endif
@@ -5,9 +5,12 @@
 #include "sanitizevolatileregisters.h"
 #include "operation/mutator.h"
 #include "instr/concrete.h"
+#include "analysis/regsummary.h"
 
 #include "disasm/disassemble.h"
 
+#include "log/log.h"
+
 
 /// SanitizeVolatileRegistersPass : Poisons compiler-placed return GPIs by exploiting calling conventions. Specifically, X86-64 calling conventions 
 /// mark RCX, and R8-11 as volatile registers not used for return values. We can sanitize these registers before returning from a function without 
@@ -16,55 +19,93 @@
 /// Can also do this for indirect call GPIs. the X86-64 calling conventions mark R11 as a volatile register not involved in passing parameters.
 
 /// Compatibility note: GCC will violate the calling convention w.r.t. caller-saved registers at levels O2, O3, and Os. Specifically, it will not 
-/// insert save/restore instructions for caller-saved registers in the caller code if the called function does not use the register. Use of this 
-/// pass on GCC binaries produced at level O2, O3, and Os will likely result in unsound behavior in its current form.
-
-/// TODO: Improve this pass with intra- and inter-procedural data-flow analysis to achieve compatbility with GCC O2+ optimizations. Probably also 
-///       for O1 and O0 as well, still see errors there with transforming GCC binaries. Additionally, data-flow analysis should allow us to detect 
-///       and clobber more registers if they are unused (both inter and intraprocedurally) and potentially clobber nonvolatile registers as well.
+/// insert save/restore instructions for caller-saved registers in the caller code if the called function does not use the register. To stay 
+/// sound on such binaries, RegisterSummary computes for every function which caller-saved registers may be read after it returns, taking the 
+/// registers its direct callers keep live across the call into account, and only registers that are provably dead at a given point are 
+/// poisoned.
 
 void SanitizeVolatileRegistersPass::visit(Module *module) {
+#ifdef ARCH_X86_64
+    RegisterSummary moduleSummary(module);
+    summary = &moduleSummary;
     recurse(module->getFunctionList());
+    summary = nullptr;
+
+    LOG(1, "inserted " << std::dec << inserted << " poisoning instructions, "
+        << skipped << " registers were live");
+#endif
 }
 
 void SanitizeVolatileRegistersPass::visit(Function* function) {
-    // Find all return instructions
-	for (auto block : CIter::children(function)){
-		for (auto instr : CIter::children(block)){
-			auto semantic = instr->getSemantic();
-   			if(dynamic_cast<ReturnInstruction *>(semantic)){
-        		poisonReturn(instr);
-    		}
-            else if(dynamic_cast<IndirectCallInstruction *>(semantic)){
-                poisonIndirectCall(instr);
+#ifdef ARCH_X86_64
+    auto liveness = summary->getLiveness(function);
+    if(!liveness) return;
+
+    // Find all return and indirect call instructions, and what is live
+    // there, before changing any blocks
+    std::vector<std::pair<Instruction *, RegisterSet>> returns;
+    std::vector<std::pair<Instruction *, RegisterSet>> indirectCalls;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto semantic = instr->getSemantic();
+            if(dynamic_cast<ReturnInstruction *>(semantic)) {
+                returns.emplace_back(instr, liveness->getLiveBefore(instr));
+            }
+            else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+                indirectCalls.emplace_back(instr,
+                    liveness->getLiveBefore(instr));
             }
-		}
-	}
-	return;
+        }
+    }
+
+    for(auto pair : returns) poisonReturn(pair.first, pair.second);
+    for(auto pair : indirectCalls) poisonIndirectCall(pair.first, pair.second);
+#endif
 }
 
-void SanitizeVolatileRegistersPass::poisonReturn(Instruction* instr){
-    // Insert a string of register sanitization operations before the return 
+#ifdef ARCH_X86_64
+static const struct {
+    int reg;
+    std::vector<unsigned char> bytes;
+} poisonList[] = {
+    {X86Register::R1,  {0x48, 0x31, 0xC9}},  // XOR RCX, RCX
+    {X86Register::R8,  {0x4D, 0x31, 0xC0}},  // XOR R8, R8
+    {X86Register::R9,  {0x4D, 0x31, 0xC9}},  // XOR R9, R9
+    {X86Register::R10, {0x4D, 0x31, 0xD2}},  // XOR R10, R10
+    {X86Register::R11, {0x4D, 0x31, 0xDB}},  // XOR R11, R11
+};
+
+void SanitizeVolatileRegistersPass::poisonReturn(Instruction* instr, RegisterSet live){
+    // Insert a string of register sanitization operations before the return,
+    // for the registers no caller can read afterwards
     Block* parent_block = (Block *)instr->getParent();
     ChunkMutator block_m(parent_block, true);
-    
-    block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x48, 0x31, 0xC9}));  // XOR RCX, RCX
-    block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x4D, 0x31, 0xC0}));  // XOR R8, R8
-    block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x4D, 0x31, 0xC9}));  // XOR R9, R9
-    block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x4D, 0x31, 0xD2}));  // XOR R10, R10
-    block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x4D, 0x31, 0xDB}));  // XOR R11, R11
-    
+    for(const auto &poison : poisonList) {
+        if(live & RegisterEffect::bit(poison.reg)) {
+            skipped ++;
+            continue;
+        }
+        block_m.insertBeforeJumpTo(instr, Disassemble::instruction(poison.bytes));
+        inserted ++;
+    }
+
     // Update function to account for new block size
-    ChunkMutator func_m((Function *) parent_block->getParent(), true); 
+    ChunkMutator func_m((Function *) parent_block->getParent(), true);
 }
 
-void SanitizeVolatileRegistersPass::poisonIndirectCall(Instruction* instr){
-    // Insert a string of register sanitization operations before the return 
+void SanitizeVolatileRegistersPass::poisonIndirectCall(Instruction* instr, RegisterSet live){
+    // R11 is not a parameter register, but it may hold the call target
+    if(live & RegisterEffect::bit(X86Register::R11)) {
+        skipped ++;
+        return;
+    }
+
     Block* parent_block = (Block *)instr->getParent();
     ChunkMutator block_m(parent_block, true);
-    
     block_m.insertBeforeJumpTo(instr, Disassemble::instruction({0x4D, 0x31, 0xDB}));  // XOR R11, R11
-    
+    inserted ++;
+
     // Update function to account for new block size
-    ChunkMutator func_m((Function *) parent_block->getParent(), true); 
-}
\ No newline at end of file
+    ChunkMutator func_m((Function *) parent_block->getParent(), true);
+}
+#endif
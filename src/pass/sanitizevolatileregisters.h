@@ -3,19 +3,29 @@
 
 #include "chunkpass.h"
 #include "instr/assembly.h"
+#include "analysis/regflow.h"
+
+class RegisterSummary;
 
 class SanitizeVolatileRegistersPass : public ChunkPass {
-    
+private:
+    RegisterSummary *summary;
+    size_t inserted;
+    size_t skipped;
 public:
+    SanitizeVolatileRegistersPass()
+        : summary(nullptr), inserted(0), skipped(0) {}
     virtual void visit(Module *module);
 
 protected:
     virtual void visit(Function *function);
 
+#ifdef ARCH_X86_64
 private:
-    void poisonReturn(Instruction* instr);
-    void poisonIndirectCall(Instruction* instr);
+    void poisonReturn(Instruction* instr, RegisterSet live);
+    void poisonIndirectCall(Instruction* instr, RegisterSet live);
+#endif
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,166 @@
+#include <cstddef>  // for offsetof
+#include <linux/audit.h>
+#include <linux/seccomp.h>
+#include <sys/syscall.h>  // for SYS_restart_syscall
+#include "seccompfilter.h"
+#include "log/log.h"
+
+#if defined(ARCH_X86_64)
+    #define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+    #define SECCOMP_X32_SYSCALL_BIT 0x40000000
+#elif defined(ARCH_AARCH64)
+    #define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(ARCH_ARM)
+    #define SECCOMP_AUDIT_ARCH AUDIT_ARCH_ARM
+#elif defined(ARCH_RISCV)
+    #define SECCOMP_AUDIT_ARCH AUDIT_ARCH_RISCV64
+#endif
+
+static sock_filter statement(uint16_t code, uint32_t k) {
+    return sock_filter{code, 0, 0, k};
+}
+
+static sock_filter jump(uint16_t code, uint32_t k, uint8_t jt, uint8_t jf) {
+    return sock_filter{code, jt, jf, k};
+}
+
+bool SeccompFilter::Rule::isConstrained() const {
+    for(const auto &values : arguments) {
+        if(!values.empty()) return true;
+    }
+    return false;
+}
+
+void SeccompFilter::allow(unsigned long number) {
+    allow(number, std::vector<ValueSet>());
+}
+
+void SeccompFilter::allow(unsigned long number,
+    const std::vector<ValueSet> &arguments) {
+
+    auto it = ruleMap.find(number);
+    bool first = (it == ruleMap.end());
+    if(first) it = ruleMap.emplace(number, Rule()).first;
+
+    auto &rule = (*it).second;
+    for(size_t i = 0; i < ARGUMENT_COUNT; i ++) {
+        auto &values = rule.arguments[i];
+        if(!first && values.empty()) continue;  // anything is allowed already
+
+        if(i >= arguments.size() || arguments[i].empty()) {
+            values.clear();
+            continue;
+        }
+        for(auto value : arguments[i]) {
+            values.insert(static_cast<uint32_t>(value));
+        }
+        if(values.size() > MAX_ARGUMENT_VALUES) values.clear();
+    }
+}
+
+std::vector<sock_filter> SeccompFilter::compile() const {
+    std::vector<sock_filter> code;
+
+    code.push_back(statement(BPF_LD | BPF_W | BPF_ABS,
+        offsetof(struct seccomp_data, arch)));
+    code.push_back(jump(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0));
+    code.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS));
+    code.push_back(statement(BPF_LD | BPF_W | BPF_ABS,
+        offsetof(struct seccomp_data, nr)));
+#ifdef SECCOMP_X32_SYSCALL_BIT
+    code.push_back(jump(BPF_JMP | BPF_JGE | BPF_K,
+        SECCOMP_X32_SYSCALL_BIT, 0, 1));
+    code.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS));
+#endif
+
+    // the kernel itself restarts syscalls interrupted by a signal, such as
+    // nanosleep, so this never appears in the code
+    auto rules = ruleMap;
+    rules[SYS_restart_syscall] = Rule();
+
+    // split the syscall numbers into denied and allowed intervals, merging
+    // consecutive syscalls that are allowed with any arguments
+    std::vector<Interval> intervals{{0, nullptr}};
+    for(const auto &kv : rules) {
+        uint32_t number = kv.first;
+        const Rule *rule = &kv.second;
+
+        auto &last = intervals.back();  // denied, and starts at or before
+        if(last.start == number) {
+            auto size = intervals.size();
+            auto previous = (size > 1 ? intervals[size - 2].rule : nullptr);
+            if(previous && !previous->isConstrained()
+                && !rule->isConstrained()) {
+
+                intervals.pop_back();
+            }
+            else {
+                last.rule = rule;
+            }
+        }
+        else {
+            intervals.push_back({number, rule});
+        }
+        intervals.push_back({number + 1, nullptr});
+    }
+
+    compileTree(intervals, 0, intervals.size(), code);
+
+    LOG(1, "seccomp filter allows " << rules.size() << " syscalls in "
+        << intervals.size() << " intervals using " << code.size()
+        << " instructions");
+    return code;
+}
+
+void SeccompFilter::compileTree(const std::vector<Interval> &intervals,
+    size_t begin, size_t end, std::vector<sock_filter> &code) const {
+
+    if(end - begin == 1) {
+        compileRule(intervals[begin].rule, code);
+        return;
+    }
+
+    // below the middle interval falls through, above it jumps over
+    size_t middle = begin + (end - begin) / 2;
+    std::vector<sock_filter> below;
+    compileTree(intervals, begin, middle, below);
+
+    uint32_t start = intervals[middle].start;
+    if(below.size() <= 0xff) {
+        code.push_back(jump(BPF_JMP | BPF_JGE | BPF_K, start,
+            below.size(), 0));
+    }
+    else {
+        code.push_back(jump(BPF_JMP | BPF_JGE | BPF_K, start, 0, 1));
+        code.push_back(statement(BPF_JMP | BPF_JA, below.size()));
+    }
+    code.insert(code.end(), below.begin(), below.end());
+    compileTree(intervals, middle, end, code);
+}
+
+void SeccompFilter::compileRule(const Rule *rule,
+    std::vector<sock_filter> &code) const {
+
+    if(!rule) {
+        code.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS));
+        return;
+    }
+
+    for(size_t i = 0; i < ARGUMENT_COUNT; i ++) {
+        const auto &values = rule->arguments[i];
+        if(values.empty()) continue;
+
+        // the low half of each 64-bit argument comes first (little-endian)
+        code.push_back(statement(BPF_LD | BPF_W | BPF_ABS,
+            offsetof(struct seccomp_data, args) + i * sizeof(uint64_t)));
+        size_t remaining = values.size();
+        for(auto value : values) {
+            // on a match, skip the rest of the values and the kill
+            code.push_back(jump(BPF_JMP | BPF_JEQ | BPF_K, value,
+                remaining, 0));
+            remaining --;
+        }
+        code.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS));
+    }
+    code.push_back(statement(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+}
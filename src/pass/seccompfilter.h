@@ -0,0 +1,59 @@
+#ifndef EGALITO_PASS_SECCOMP_FILTER_H
+#define EGALITO_PASS_SECCOMP_FILTER_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <linux/filter.h>  // for struct sock_filter
+
+/** A program-wide allowlist of system calls, compiled into a seccomp-BPF
+    filter that kills the process on any other system call.
+
+    The filter checks the architecture, then binary-searches the syscall
+    number over the allowed and denied ranges. Syscalls that are only made
+    with known arguments also compare those arguments. Only the low 32 bits
+    of an argument are compared, since the analysis does not track whether
+    a constant was written through a 32-bit register. Syscalls that only
+    the kernel issues, i.e. restart_syscall, are always allowed.
+*/
+class SeccompFilter {
+public:
+    enum {
+        ARGUMENT_COUNT = 6,
+        MAX_ARGUMENT_VALUES = 8     // larger sets are not checked
+    };
+    typedef std::set<unsigned long> ValueSet;
+private:
+    struct Rule {
+        // arguments with no constraint are empty
+        std::vector<std::set<uint32_t>> arguments;
+        Rule() : arguments(ARGUMENT_COUNT) {}
+        bool isConstrained() const;
+    };
+    std::map<unsigned long, Rule> ruleMap;
+public:
+    /** Allows a syscall with any arguments. */
+    void allow(unsigned long number);
+    /** Allows a syscall whose argument i is in arguments[i], or is
+        anything if that set is empty. Allowing a syscall several times
+        allows the union of the argument sets.
+    */
+    void allow(unsigned long number, const std::vector<ValueSet> &arguments);
+
+    bool isAllowed(unsigned long number) const
+        { return ruleMap.find(number) != ruleMap.end(); }
+    size_t getCount() const { return ruleMap.size(); }
+
+    std::vector<sock_filter> compile() const;
+private:
+    struct Interval {
+        uint32_t start;
+        const Rule *rule;   // nullptr if denied
+    };
+    void compileTree(const std::vector<Interval> &intervals,
+        size_t begin, size_t end, std::vector<sock_filter> &code) const;
+    void compileRule(const Rule *rule, std::vector<sock_filter> &code) const;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #include <vector>
+#include <set>
 #include <cassert>
 #include "shadowstack.h"
+#include "chunk/features.h"
+#include "chunk/plt.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
@@ -8,8 +11,11 @@
 #include "operation/addinline.h"
 #include "operation/find2.h"
 #include "pass/switchcontext.h"
+#include "analysis/regsummary.h"
 #include "types.h"
 
+#include "log/log.h"
+
 void ShadowStackPass::visit(Program *program) {
     auto allocateFunc = ChunkFind2(program).findFunction(
         mode == MODE_GS ? "egalito_allocate_shadow_stack_gs"
@@ -36,7 +42,12 @@ void ShadowStackPass::visit(Program *program) {
                 ChunkMutator m(block1, true);
                 m.prepend(call);
             }
+
+            // it returns after the shadow stack exists, so it can't push
+            exclude(sourceFunc, "allocates the shadow stack");
         }
+
+        excludeRuntime(allocateFunc);
     }
 
     if(auto f = dynamic_cast<Function *>(program->getEntryPoint())) {
@@ -63,56 +74,273 @@ void ShadowStackPass::visit(Module *module) {
     ChunkMutator(block).append(instr);
 
     this->violationTarget = function;
+    findExcluded(module);
+
+    RegisterSummary moduleSummary(module);
+    summary = &moduleSummary;
+    auto before = ChunkAddInline::getStatistics();
+    size_t instrumentedBefore = instrumented, elidedBefore = elided;
     recurse(module);
+    summary = nullptr;
+
+    auto after = ChunkAddInline::getStatistics();
+    LOG(1, "shadow stack: " << std::dec << (instrumented - instrumentedBefore)
+        << " functions instrumented, " << (elided - elidedBefore)
+        << " proven safe in " << module->getName());
+    LOG(1, "shadow stack: " << std::dec << (after.spillSites - before.spillSites)
+        << " of " << (after.sites - before.sites)
+        << " sites saved registers in " << module->getName());
 #endif
 }
 
 void ShadowStackPass::visit(Function *function) {
-    if(function->getName() == "egalito_endbr_violation") return;
-    if(function->getName() == "egalito_shadowstack_violation") return;
-    if(function->getName() == "egalito_allocate_shadow_stack_gs") return;
-    if(function->getName() == "egalito_allocate_shadow_stack_const") return;
-    if(function->getName() == "get_gs") return;
+    if(function == violationTarget || function == entryPoint) return;
+    if(excluded.count(function)) return;
 
-    if(function->getName() == "obstack_free") return;  // jne tail rec, for const ss
+    // code added by other egalito passes, e.g. egalito_endbr_violation
+    if(function->getName().compare(0, 8, "egalito_") == 0) return;
 
-    if(function->getName() == "_start" || function == entryPoint) return;
-    if(function->getName() == "__libc_start_main") return;
-    if(function->getName() == "mmap64") return;
-    if(function->getName() == "mmap") return;
-    if(function->getName() == "arch_prctl") return;
+    if(elide && isReturnAddressSafe(function)) {
+        LOG(10, "shadow stack not needed for [" << function->getName() << "]");
+        elided ++;
+        return;
+    }
 
-    // const shadow stack needs these
-    if(function->getName() == "__longjmp") return;
-    if(function->getName() == "__longjmp_chk") return;
+    liveness = summary ? summary->getLiveness(function) : nullptr;
+    pushToShadowStack(function);
+    recurse(function);
+    liveness = nullptr;
+    instrumented ++;
+}
 
-    // mempcpy does jmp into middle of this:
-    //if(function->getName() == "__memcpy_avx_unaligned_erms") return;
-    if(function->getName().find("memcpy") != std::string::npos) return;
+/** Whether operand is memory that might be on the stack. A pointer loaded
+    from anywhere, including an argument, may point into a caller's frame
+    right next to the return address; only %rip-relative globals cannot.
+*/
+static bool isPointerOperand(const cs_x86_op &operand) {
+    return operand.type == X86_OP_MEM && operand.mem.base != X86_REG_RIP;
+}
 
-    // memcpy does jmp into middle of this:
-    //if(function->getName() == "__memmove_sse2_unaligned_erms") return;
-    if(function->getName().find("memmove") != std::string::npos) return;
+/** Whether instruction may store through a pointer. */
+static bool storesThroughPointer(AssemblyPtr assembly) {
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    auto operands = asmOps->getOperands();
+
+    switch(assembly->getId()) {
+    case X86_INS_NOP:
+    case X86_INS_LEA:
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+        return false;
+    case X86_INS_STOSB:
+    case X86_INS_STOSW:
+    case X86_INS_STOSD:
+    case X86_INS_STOSQ:
+    case X86_INS_MOVSB:
+    case X86_INS_MOVSW:
+    case X86_INS_MOVSD:
+    case X86_INS_MOVSQ:
+        return true;
+    case X86_INS_XCHG:
+    case X86_INS_XADD:
+    case X86_INS_CMPXCHG:
+        // either operand may be written
+        for(size_t i = 0; i < count; i ++) {
+            if(isPointerOperand(operands[i])) return true;
+        }
+        return false;
+    default:
+        // AT&T operand order: the destination comes last
+        return count > 0 && isPointerOperand(operands[count - 1]);
+    }
+}
 
-    // this has ja, conditional tail recursion
-    //if(function->getName() == "__memset_avx2_unaligned_erms") return;
-    if(function->getName().find("memset") != std::string::npos) return;
+bool ShadowStackPass::isReturnAddressSafe(Function *function) {
+    // a callee or the kernel could be handed a pointer into this frame,
+    // and without explicit stack pointer operands no such pointer exists
+    auto features = function->getFeatures();
+    if(!features.isKnown() || features.hasCall()) return false;
+    if(features.has(FunctionFeatures::FEATURE_SYSCALL
+        | FunctionFeatures::FEATURE_STACK_POINTER)) {
 
-    // blacklist all mem* functions?
-    //if(function->getName().find("mem") != std::string::npos) return;
+        return false;
+    }
 
-    // this has jne, conditional tail recursion
-    // __strncasecmp_l_avx
-    //if(function->getName() == "__strncasecmp_l_avx") return;
-    if(function->getName().find("str") != std::string::npos) return;
+    // code jumped to would return with an address this function never
+    // checked, so tail calls disqualify it too; so does any store that
+    // could reach a caller's frame
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto semantic = instr->getSemantic();
+            if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+                if(!cfi->getLink() || cfi->getLink()->isExternalJump()) {
+                    return false;
+                }
+            }
+            else if(auto ij = dynamic_cast<IndirectJumpInstruction *>(
+                semantic)) {
 
-    // sphinx3, function does tail recursion to itself
-    if(function->getName() == "mdef_phone_id") return;
+                if(!ij->isForJumpTable()) return false;
+            }
+            else if(dynamic_cast<DataLinkedControlFlowInstruction *>(
+                semantic)) {
 
-    pushToShadowStack(function);
-    recurse(function);
+                return false;
+            }
+            else {
+                auto assembly = semantic->getAssembly();
+                if(!assembly || storesThroughPointer(assembly)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static Function *getFunctionOf(Chunk *chunk) {
+    while(chunk && !dynamic_cast<Function *>(chunk)) {
+        chunk = chunk->getParent();
+    }
+    return dynamic_cast<Function *>(chunk);
+}
+
+static Function *getTargetFunction(Link *link, Chunk **target) {
+    *target = link ? link->getTarget() : nullptr;
+    if(auto plt = dynamic_cast<PLTTrampoline *>(*target)) {
+        *target = plt->getTarget();
+    }
+    return getFunctionOf(*target);
+}
+
+static bool isEntry(Chunk *target, Function *function) {
+    if(target == function) return true;
+    auto block1 = function->getChildren()->getIterable()->get(0);
+    if(target == block1) return true;
+    return target == block1->getChildren()->getIterable()->get(0);
+}
+
+/** Whether instruction loads %rsp with a value not derived from this
+    frame's own stack pointer, as longjmp and context switches do.
+*/
+static bool switchesStack(Instruction *instruction) {
+    auto assembly = instruction->getSemantic()->getAssembly();
+    if(!assembly) return false;
+
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    if(count == 0) return false;
+
+    // AT&T operand order: the destination comes last
+    const auto &dest = asmOps->getOperands()[count - 1];
+    if(dest.type != X86_OP_REG || dest.reg != X86_REG_RSP) return false;
+
+    const auto &source = asmOps->getOperands()[0];
+    switch(assembly->getId()) {
+    case X86_INS_POP:
+    case X86_INS_XCHG:
+        return true;
+    case X86_INS_MOV:
+        if(asmOps->getMode() == AssemblyOperands::MODE_MEM_REG) return true;
+        // %rbp holds an earlier value of this frame's %rsp
+        return asmOps->getMode() == AssemblyOperands::MODE_REG_REG
+            && source.reg != X86_REG_RSP && source.reg != X86_REG_RBP;
+    case X86_INS_LEA:
+        return source.mem.base != X86_REG_RSP
+            && source.mem.base != X86_REG_RBP;
+    default:
+        return false;
+    }
 }
 
+void ShadowStackPass::findExcluded(Module *module) {
+    for(auto function : CIter::functions(module)) {
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                if(switchesStack(instr)) {
+                    exclude(function, "switches stacks");
+                }
+
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(!cfi || !cfi->getLink()) continue;
+
+                // the check before a conditional jump would run on both paths
+                // (compare ids: inserted calls are named "call", not "callq")
+                bool conditional = (cfi->getId() != X86_INS_CALL
+                    && cfi->getId() != X86_INS_JMP);
+                if(conditional && cfi->getLink()->isExternalJump()) {
+                    exclude(function, "has a conditional tail call");
+                }
+
+                Chunk *target;
+                auto targetFunction = getTargetFunction(cfi->getLink(),
+                    &target);
+                if(!targetFunction) continue;
+                if(!isEntry(target, targetFunction)) {
+                    if(targetFunction != function) {
+                        exclude(targetFunction, "is entered past its start");
+                    }
+                }
+                else if(targetFunction == function
+                    && cfi->getId() != X86_INS_CALL
+                    && cfi->getLink()->isExternalJump()) {
+
+                    exclude(function, "tail calls itself");
+                }
+            }
+        }
+    }
+}
+
+void ShadowStackPass::excludeRuntime(Function *allocateFunc) {
+    size_t excludedBefore = excluded.size();
+
+    // the runtime library itself
+    if(auto runtime = dynamic_cast<Module *>(
+        allocateFunc->getParent()->getParent())) {
+
+        for(auto function : CIter::functions(runtime)) {
+            exclude(function, "is part of the shadow stack runtime");
+        }
+    }
+
+    // and whatever the allocator calls before the shadow stack is set up
+    // (mmap, arch_prctl), but not the rest of the runtime's callees
+    std::vector<Function *> work{allocateFunc};
+    std::set<Function *> seen(work.begin(), work.end());
+    while(!work.empty()) {
+        auto function = work.back();
+        work.pop_back();
+        exclude(function, "is called to allocate the shadow stack");
+
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(!cfi) continue;
+
+                Chunk *target;
+                auto callee = getTargetFunction(cfi->getLink(), &target);
+                if(callee && seen.insert(callee).second) {
+                    work.push_back(callee);
+                }
+            }
+        }
+    }
+
+    LOG(1, "shadow stack: " << std::dec << (excluded.size() - excludedBefore)
+        << " functions excluded for the runtime");
+}
+
+void ShadowStackPass::exclude(Function *function, const char *reason) {
+    if(excluded.insert(function).second) {
+        LOG(10, "no shadow stack for [" << function->getName() << "]: "
+            << reason);
+    }
+}
 
 void ShadowStackPass::visit(Instruction *instruction) {
     auto semantic = instruction->getSemantic();
@@ -120,7 +348,7 @@ void ShadowStackPass::visit(Instruction *instruction) {
         popFromShadowStack(instruction);
     }
     else if(auto v = dynamic_cast<ControlFlowInstruction *>(semantic)) {
-        if(v->getMnemonic() != "callq"
+        if(v->getId() != X86_INS_CALL
             && v->getLink() && v->getLink()->isExternalJump()) {  // tail recursion
 
             popFromShadowStack(instruction);
@@ -178,6 +406,7 @@ void ShadowStackPass::pushToShadowStackConst(Function *function) {
 
         return std::vector<Instruction *>{ mov1Instr, mov2Instr };
     });
+    ai.setLiveness(liveness);
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, false);
@@ -215,6 +444,7 @@ void ShadowStackPass::pushToShadowStackGS(Function *function) {
 
         return std::vector<Instruction *>{ mov1Instr, leaInstr, mov2Instr, mov3Instr, mov4Instr };
     });
+    ai.setLiveness(liveness);
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
     ai.insertBefore(instr1, false);
@@ -263,6 +493,7 @@ void ShadowStackPass::popFromShadowStackConst(Instruction *instruction) {
         jne->setSemantic(jneSem);
         return std::vector<Instruction *>{ movInstr, cmpInstr, jne };
     });
+    ai.setLiveness(liveness);
     ai.insertBefore(instruction, true);
 }
 
@@ -306,6 +537,7 @@ void ShadowStackPass::popFromShadowStackGS(Instruction *instruction) {
 
         return std::vector<Instruction *>{ mov1Instr, mov2Instr, cmpInstr, jne, leaInstr, mov3Instr };
     });
+    ai.setLiveness(liveness);
     ai.insertBefore(instruction, true);
 }
 
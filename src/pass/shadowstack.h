@@ -1,8 +1,26 @@
 #ifndef EGALITO_PASS_SHADOW_STACK_H
 #define EGALITO_PASS_SHADOW_STACK_H
 
+#include <set>
 #include "chunkpass.h"
 
+class RegisterSummary;
+class RegisterLiveness;
+
+/** Checks return addresses against a copy kept on a shadow stack, either at
+    a constant offset below the stack (MODE_CONST) or in a separate stack
+    addressed through %gs (MODE_GS).
+
+    Functions where that cannot work are found structurally: the runtime
+    that allocates the shadow stack and what its allocator calls (but not
+    everything the runtime calls), functions that
+    switch stacks, have conditional tail calls, tail call themselves, or
+    are entered past their start by other functions.
+
+    With elision, functions whose return address provably cannot be
+    overwritten while they run are not instrumented either; see
+    isReturnAddressSafe().
+*/
 class ShadowStackPass : public ChunkPass {
 public:
     enum Mode {
@@ -13,14 +31,35 @@ private:
     Mode mode;
     Function *violationTarget;
     Function *entryPoint;
+    bool elide;
+    std::set<Function *> excluded;
+    RegisterSummary *summary;
+    RegisterLiveness *liveness;  // of the current function, for ChunkAddInline
+    size_t instrumented;
+    size_t elided;
 public:
     ShadowStackPass(Mode mode = MODE_CONST) : mode(mode),
-        violationTarget(nullptr), entryPoint(nullptr) {}
+        violationTarget(nullptr), entryPoint(nullptr), elide(false),
+        summary(nullptr), liveness(nullptr), instrumented(0), elided(0) {}
     virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
     virtual void visit(Instruction *instruction);
+
+    void setElide(bool elide) { this->elide = elide; }
+    size_t getInstrumentedCount() const { return instrumented; }
+    size_t getElidedCount() const { return elided; }
+
+    /** A function that calls nothing, makes no system calls, does not
+        tail call, never names %rsp explicitly and stores to memory only
+        through %rip-relative operands cannot reach its return address,
+        so the address stays intact.
+    */
+    static bool isReturnAddressSafe(Function *function);
 private:
+    void findExcluded(Module *module);
+    void excludeRuntime(Function *allocateFunc);
+    void exclude(Function *function, const char *reason);
     void pushToShadowStack(Function *function);
     void pushToShadowStackConst(Function *function);
     void pushToShadowStackGS(Function *function);
@@ -183,9 +183,7 @@ void StackExtendPass::extendStack(Function *function, FrameType *frame) {
     IF_LOG(10) cfg.dumpDot();
 
     //TemporaryLogLevel tll("analysis", 11);
-    SccOrder order(&cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
+    usedef.analyze(cfg.getSccOrder());
 
     //TemporaryLogLevel tll2("pass", 10, function->hasName("egalito_hook_jit_fixup"));
 
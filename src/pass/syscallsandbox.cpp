@@ -4,18 +4,55 @@
 #include "operation/find2.h"
 #include "operation/mutator.h"
 #include "chunk/block.h"
+#include "chunk/concrete.h"
 #include "instr/instr.h"
 #include "instr/concrete.h"
 #include "disasm/disassemble.h"
 #include "log/log.h"
 
+void SyscallSandbox::visit(Program *program) {
+    recurse(program);
+    if(mode != MODE_FILTER) return;
+
+    if(unknownCount) {
+        LOG(0, "WARNING: " << unknownCount << " syscall sites have unknown"
+            " numbers, and will be killed by the seccomp filter");
+    }
+    // without the filter, the output would run unconfined
+    if(!writeFilter(filter.compile())) {
+        throw "SyscallSandbox could not write the seccomp filter into"
+            " egalito_sandbox_filter, is libsandbox loaded?";
+    }
+}
+
 void SyscallSandbox::visit(Function *function) {
-    FindSyscalls findSyscalls;
+    FindSyscalls findSyscalls(mode == MODE_FILTER);
     function->accept(&findSyscalls);
+    unknownCount += findSyscalls.getUnknownSet().size();
+
+    if(mode == MODE_FILTER) {
+        const auto &argumentMap = findSyscalls.getArgumentMap();
+        for(auto kv : findSyscalls.getNumberMap()) {
+            auto arguments = argumentMap.find(kv.first);
+            for(auto value : kv.second) {
+                if(arguments != argumentMap.end()) {
+                    filter.allow(value, (*arguments).second);
+                }
+                else {
+                    filter.allow(value);
+                }
+            }
+        }
+        return;
+    }
+
     auto list = findSyscalls.getNumberMap();
     for(auto kv : list) {
         auto syscallInstr = kv.first;
         auto syscallValues = kv.second;
+        if(dynamic_cast<ControlFlowInstruction *>(syscallInstr->getSemantic())) {
+            continue;  // a call to syscall(), the handlers expect %rax
+        }
         if(syscallValues.size() != 1) {
             LOG(1, "ERROR: expected one possible system call value, got "
                 << syscallValues.size() << " possibilities, at "
@@ -25,23 +62,77 @@ void SyscallSandbox::visit(Function *function) {
         }
         int value = static_cast<int>(*syscallValues.begin());
 
-        std::ostringstream name;
-        name << "egalito_sandbox_syscall_" << value;
-
-        auto func = ChunkFind2(program).findFunction(name.str().c_str());
-        if (!func) {
-            func = ChunkFind2(program).findFunction("egalito_sandbox_syscall_default");
-            if(!func) {
-                LOG(2, "Looking for sandbox enforcement function [" << name.str()
-                    << "] or default handler, neither was found!");
-                continue;
-            }
+        auto func = findHandler(value);
+        if(!func) {
+            LOG(2, "Looking for sandbox enforcement function for syscall "
+                << value << " or default handler, neither was found!");
+            continue;
         }
 
         addEnforcement(function, syscallInstr, func);
     }
 }
 
+Function *SyscallSandbox::findHandler(int value) {
+    auto it = handlerMap.find(value);
+    if(it != handlerMap.end()) return (*it).second;
+
+    std::ostringstream name;
+    name << "egalito_sandbox_syscall_" << value;
+
+    auto func = ChunkFind2(program).findFunction(name.str().c_str());
+    if(!func) {
+        const int DEFAULT = -1;
+        auto def = handlerMap.find(DEFAULT);
+        if(def == handlerMap.end()) {
+            def = handlerMap.emplace(DEFAULT, ChunkFind2(program)
+                .findFunction("egalito_sandbox_syscall_default")).first;
+        }
+        func = (*def).second;
+    }
+    handlerMap[value] = func;
+    return func;
+}
+
+bool SyscallSandbox::writeFilter(const std::vector<sock_filter> &code) {
+    for(auto module : CIter::children(program)) {
+        if(!module->getDataRegionList()) continue;
+        for(auto region : CIter::children(module->getDataRegionList())) {
+            for(auto section : CIter::children(region)) {
+                for(auto var : section->getGlobalVariables()) {
+                    if(var->getName() != "egalito_sandbox_filter") continue;
+
+                    // struct { unsigned int length; sock_filter code[]; }
+                    auto symbol = var->getNonNullSymbol();
+                    size_t capacity = (symbol->getSize() - sizeof(uint32_t))
+                        / sizeof(sock_filter);
+                    if(code.size() > capacity
+                        || code.size() > static_cast<size_t>(BPF_MAXINSNS)) {
+
+                        LOG(0, "ERROR: seccomp filter has " << code.size()
+                            << " instructions, more than " << capacity);
+                        return false;
+                    }
+
+                    uint32_t length = code.size();
+                    auto bytes = region->getDataBytes();
+                    size_t offset = var->getAddress() - region->getAddress();
+                    if(offset + symbol->getSize() > bytes.size()) return false;
+                    bytes.replace(offset, sizeof length,
+                        reinterpret_cast<const char *>(&length), sizeof length);
+                    bytes.replace(offset + sizeof length,
+                        code.size() * sizeof(sock_filter),
+                        reinterpret_cast<const char *>(code.data()),
+                        code.size() * sizeof(sock_filter));
+                    region->saveDataBytes(bytes);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
 void SyscallSandbox::addEnforcement(Function *function, Instruction *syscallInstr, Function*enforce) {
 #ifdef ARCH_X86_64
     /*
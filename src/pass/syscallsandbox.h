@@ -1,16 +1,49 @@
 #ifndef EGALITO_PASS_SYSCALL_SANDBOX_H
 #define EGALITO_PASS_SYSCALL_SANDBOX_H
 
+#include <map>
 #include "chunkpass.h"
+#include "seccompfilter.h"
 
+/** Restricts the system calls that a program can make.
+
+    In MODE_INSTRUMENT, each syscall with a known number calls the handler
+    egalito_sandbox_syscall_N (or egalito_sandbox_syscall_default) first,
+    and is skipped if the handler returns zero.
+
+    In MODE_FILTER, the syscalls are left alone. Instead, every syscall
+    number found in the program goes into a seccomp-BPF allowlist, which
+    is written into the egalito_sandbox_filter variable so that libsandbox
+    installs it at startup. Any syscall whose number was not found is then
+    killed by the kernel; see getUnknownCount(). If the filter cannot be
+    written, visiting the Program throws rather than leave it unconfined.
+*/
 class SyscallSandbox : public ChunkPass {
+public:
+    enum Mode {
+        MODE_INSTRUMENT,
+        MODE_FILTER
+    };
 private:
     Program *program;
+    Mode mode;
+    std::map<int, Function *> handlerMap;   // nullptr if not found
+    SeccompFilter filter;
+    size_t unknownCount;
 public:
-    SyscallSandbox(Program *program) : program(program) {}
+    SyscallSandbox(Program *program, Mode mode = MODE_INSTRUMENT)
+        : program(program), mode(mode), unknownCount(0) {}
+
+    virtual void visit(Program *program);
     virtual void visit(Function *function);
+
+    const SeccompFilter &getFilter() const { return filter; }
+    /** Number of syscall sites whose number could not be determined. */
+    size_t getUnknownCount() const { return unknownCount; }
 private:   
+    Function *findHandler(int value);
     void addEnforcement(Function *function, Instruction *syscallInstr, Function*enforce);
+    bool writeFilter(const std::vector<sock_filter> &code);
 };
 
 #endif
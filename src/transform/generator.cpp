@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <cstdio>  // for std::fflush
 #include <cstring>
+#include <algorithm>
 #include "generator.h"
 #include "chunk/cache.h"
 #include "operation/mutator.h"
@@ -24,6 +25,10 @@ public:
     void assignAddress(ChunkType *chunk, Slot slot);
     void copyToSandbox(ChunkType *chunk, Sandbox *sandbox);
 private:
+    bool writeFromCache(ChunkType *chunk, char *output, address_t address);
+    void writeCode(ChunkType *chunk, char *output);
+    size_t getPaddingSize(ChunkType *chunk);
+    void writePadding(char *output, size_t padding);
     void addPaddingBytes(ChunkType *chunk, Sandbox *sandbox);
 };
 
@@ -41,47 +46,70 @@ void GeneratorHelper<ChunkType>::assignAddress(ChunkType *chunk, Slot slot) {
 #endif
 }
 
+template <>
+bool GeneratorHelper<Function>::writeFromCache(Function *function,
+    char *output, address_t address) {
+
+    auto cache = function->getCache();
+    if(cache && cache->isUsable()) {
+        //LOG(0, "generating with Cache: " << function->getName());
+        cache->copyAndFix(output, address);
+        return true;
+    }
+    return false;
+}
+
+template <>
+void GeneratorHelper<Function>::writeCode(Function *function, char *output) {
+    for(auto b : CIter::children(function)) {
+        for(auto i : CIter::children(b)) {
+            LOG(10, " at " << std::hex << i->getAddress());
+            auto semantic = i->getSemantic();
+            if(true /*useDisps*/) {
+                InstrWriterCString writer(output);
+                semantic->accept(&writer);
+            }
+            else {
+                InstrWriterForObjectFile writer(output);
+                semantic->accept(&writer);
+            }
+            output += semantic->getSize();
+        }
+    }
+}
+
 template <>
 void GeneratorHelper<Function>::copyToSandbox(Function *function, Sandbox *sandbox) {
     if(sandbox->supportsDirectWrites()) {
         char *output = reinterpret_cast<char *>(function->getAddress());
-        if(auto cache = function->getCache()) {
-            //LOG(0, "generating with Cache: " << function->getName());
-            cache->copyAndFix(output);
-            return;
-        }
-        for(auto b : CIter::children(function)) {
-            for(auto i : CIter::children(b)) {
-                LOG(10, " at " << std::hex << i->getAddress());
-                if(true /*useDisps*/) {
-                    InstrWriterCString writer(output);
-                    i->getSemantic()->accept(&writer);
-                }
-                else {
-                    InstrWriterForObjectFile writer(output);
-                    i->getSemantic()->accept(&writer);
-                }
-                output += i->getSemantic()->getSize();
-            }
-        }
+        if(writeFromCache(function, output, function->getAddress())) return;
+        writeCode(function, output);
+        addPaddingBytes(function, sandbox);
     }
     else {
+        // Claim the function's whole slot in the buffer at once and fill it
+        // in place, instead of appending to the std::string per instruction.
         auto backing = static_cast<MemoryBufferBacking *>(sandbox->getBacking());
-        InstrWriterCppString writer(backing->getBuffer());
-        for(auto b : CIter::children(function)) {
-            for(auto i : CIter::children(b)) {
-                i->getSemantic()->accept(&writer);
-            }
+        auto &buffer = backing->getBuffer();
+        size_t size = function->getSize();
+        size_t padding = getPaddingSize(function);
+        size_t offset = buffer.size();
+        buffer.resize(offset + size + padding);
+
+        char *output = &buffer[offset];
+        if(!writeFromCache(function, output, function->getAddress())) {
+            writeCode(function, output);
         }
+        writePadding(output + size, padding);
     }
-    addPaddingBytes(function, sandbox);
 }
 
 template <>
 void GeneratorHelper<PLTTrampoline>::copyToSandbox(PLTTrampoline *trampoline, Sandbox *sandbox) {
     if(sandbox->supportsDirectWrites()) {
         char *output = reinterpret_cast<char *>(trampoline->getAddress());
-        if(auto cache = trampoline->getCache()) {
+        auto cache = trampoline->getCache();
+        if(cache && cache->isUsable()) {
             //LOG(0, "generating with Cache: " << function->getName());
             cache->copyAndFix(output);
             return;
@@ -106,34 +134,43 @@ void GeneratorHelper<PLTTrampoline>::copyToSandbox(PLTTrampoline *trampoline, Sa
 }
 
 template <typename ChunkType>
-void GeneratorHelper<ChunkType>::addPaddingBytes(ChunkType *chunk, Sandbox *sandbox) {
+size_t GeneratorHelper<ChunkType>::getPaddingSize(ChunkType *chunk) {
     auto assignedSize = chunk->getAssignedPosition()->getAssignedSize();
-    if(assignedSize > chunk->getSize()) {
-        // Add appropriate number of NOP bytes
-        auto padding = assignedSize - chunk->getSize();
-        if(sandbox->supportsDirectWrites()) {
-            char *output = reinterpret_cast<char *>(chunk->getAddress());
-#ifdef ARCH_X86_64
-            std::memset(output + chunk->getSize(), 0x90, padding);
-#else
-            // Should use platform-specific NOP here
-            std::memset(output + chunk->getSize(), 0x0, padding);
-#endif
-        }
-        else {
-            auto backing = static_cast<MemoryBufferBacking *>(sandbox->getBacking());
+    if(assignedSize < chunk->getSize()) {
+        LOG(0, "ERROR: assigned size " << std::dec << assignedSize
+            << " is too small to store chunk ["
+            << chunk->getName() << "] of size " << chunk->getSize());
+        return 0;
+    }
+    return assignedSize - chunk->getSize();
+}
+
+template <typename ChunkType>
+void GeneratorHelper<ChunkType>::writePadding(char *output, size_t padding) {
 #ifdef ARCH_X86_64
-            backing->getBuffer().append(padding, static_cast<char>(0x90));
+    std::memset(output, 0x90, padding);
 #else
-            // Should use platform-specific NOP here
-            backing->getBuffer().append(padding, static_cast<char>(0x0));
+    // Should use platform-specific NOP here
+    std::memset(output, 0x0, padding);
 #endif
-        }
+}
+
+template <typename ChunkType>
+void GeneratorHelper<ChunkType>::addPaddingBytes(ChunkType *chunk, Sandbox *sandbox) {
+    // Add appropriate number of NOP bytes
+    auto padding = getPaddingSize(chunk);
+    if(!padding) return;
+
+    if(sandbox->supportsDirectWrites()) {
+        char *output = reinterpret_cast<char *>(chunk->getAddress());
+        writePadding(output + chunk->getSize(), padding);
     }
-    else if(assignedSize < chunk->getSize()) {
-        LOG(0, "ERROR: assigned size " << std::dec << assignedSize
-            << " is too small to store chunk ["
-            << chunk->getName() << "] of size " << chunk->getSize());
+    else {
+        auto &buffer = static_cast<MemoryBufferBacking *>(
+            sandbox->getBacking())->getBuffer();
+        size_t offset = buffer.size();
+        buffer.resize(offset + padding);
+        writePadding(&buffer[offset], padding);
     }
 }
 
@@ -161,6 +198,25 @@ void Generator::generateCode(Program *program) {
     }
 }
 
+Slot Generator::allocateFunction(Function *function, Function *previous) {
+    size_t alignment = function->getAlignment();
+    if(alignment <= 1) return sandbox->allocate(function->getSize());
+
+    // pad the previous slot, whose padding is written out with it
+    if(previous) {
+        auto position = previous->getAssignedPosition();
+        auto end = position->get() + position->getAssignedSize();
+        size_t padding = -end & (alignment - 1);
+        if(padding) {
+            auto extra = sandbox->allocate(padding);
+            position->set(Slot(position->get(),
+                position->getAssignedSize() + extra.getSize()));
+        }
+    }
+    return sandbox->allocate(
+        (function->getSize() + alignment - 1) & ~(alignment - 1));
+}
+
 std::vector<Function *> Generator::pickFunctionOrder(Module *module) {
     std::vector<Function *> order;
 
@@ -195,8 +251,10 @@ std::vector<Function *> Generator::pickFunctionOrder(Module *module) {
 
 void Generator::assignAddresses(Module *module) {
     auto order = pickFunctionOrder(module);
+    Function *previous = nullptr;
     for(auto f : order) {
-        auto slot = sandbox->allocate(f->getSize());
+        auto slot = allocateFunction(f, previous);
+        previous = f;
         LOG(2, "    alloc 0x" << std::hex << slot.getAddress()
             << " for [" << f->getName()
             << "] size " << std::dec << f->getSize());
@@ -222,6 +280,7 @@ void Generator::assignAddresses(Module *module) {
 void Generator::generateCode(Module *module) {
     LOG(1, "Copying code into sandbox");
     auto order = pickFunctionOrder(module);
+    reserveBuffer(module, order);
     for(auto f : order) {
         LOG(2, "    writing out [" << f->getName() << "] at 0x"
             << std::hex << f->getAddress());
@@ -238,8 +297,10 @@ void Generator::generateCode(Module *module) {
 }
 
 void Generator::assignAddresses(Module *module, const std::vector<Function *> &order) {
+    Function *previous = nullptr;
     for(auto f : order) {
-        auto slot = sandbox->allocate(f->getSize());
+        auto slot = allocateFunction(f, previous);
+        previous = f;
         LOG(2, "    alloc 0x" << std::hex << slot.getAddress()
             << " for [" << f->getName()
             << "] size " << std::dec << f->getSize());
@@ -264,6 +325,7 @@ void Generator::assignAddresses(Module *module, const std::vector<Function *> &o
 
 void Generator::generateCode(Module *module, const std::vector<Function *> &order) {
     LOG(1, "Copying code into sandbox");
+    reserveBuffer(module, order);
     for(auto f : order) {
         LOG(2, "    writing out [" << f->getName() << "] at 0x"
             << std::hex << f->getAddress());
@@ -293,6 +355,27 @@ void Generator::generateCodeForFunction(Function *function) {
     GeneratorHelper<Function>().copyToSandbox(function, sandbox);
 }
 
+void Generator::reserveBuffer(Module *module,
+    const std::vector<Function *> &order) {
+
+    if(sandbox->supportsDirectWrites()) return;
+
+    size_t total = 0;
+    for(auto f : order) {
+        total += std::max(f->getSize(),
+            f->getAssignedPosition()->getAssignedSize());
+    }
+    if(module->getPLTList()) {
+        for(auto plt : CIter::plts(module)) {
+            total += std::max(plt->getSize(),
+                plt->getAssignedPosition()->getAssignedSize());
+        }
+    }
+
+    auto &buffer = sandbox->getBacking()->getBuffer();
+    buffer.reserve(buffer.size() + total);
+}
+
 // These two functions are only used during JIT-Shuffling
 void Generator::pickFunctionAddressInSandbox(Function *function) {
     auto slot = sandbox->allocate(function->getSize());
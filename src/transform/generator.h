@@ -41,6 +41,12 @@ public:
     std::vector<Function *> pickFunctionOrder(Module *module);
 
 private:    
+    /** Allocates function's slot, aligned as it asks by padding the slot
+        of the function laid out before it.
+    */
+    Slot allocateFunction(Function *function, Function *previous);
+    /** Reserves room for a module's code when writing to a buffer. */
+    void reserveBuffer(Module *module, const std::vector<Function *> &order);
     void pickFunctionAddressInSandbox(Function *function);
     void pickPLTAddressInSandbox(PLTTrampoline *trampoline);
 };
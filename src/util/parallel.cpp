@@ -0,0 +1,21 @@
+#include <cstdlib>
+#include "parallel.h"
+
+size_t ParallelWorkers::count = 0;
+
+size_t ParallelWorkers::getCount() {
+    if(count == 0) {
+        if(const char *variable = std::getenv("EGALITO_THREADS")) {
+            setCount(std::strtoul(variable, nullptr, 0));
+        }
+        else {
+            count = 1;
+        }
+    }
+    return count;
+}
+
+void ParallelWorkers::setCount(size_t count) {
+    if(count == 0) count = std::thread::hardware_concurrency();
+    ParallelWorkers::count = (count ? count : 1);
+}
@@ -0,0 +1,93 @@
+#ifndef EGALITO_UTIL_PARALLEL_H
+#define EGALITO_UTIL_PARALLEL_H
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <cstddef>
+
+class ParallelWorkers {
+private:
+    static size_t count;
+public:
+    /** Number of threads used by parallel analyses, at least 1 (serial).
+        Defaults to the EGALITO_THREADS environment variable, where 0
+        means one thread per core.
+    */
+    static size_t getCount();
+    /** Sets the number of threads; 0 means one per core. */
+    static void setCount(size_t count);
+};
+
+/** Runs body(i) for each i in [0, count) on up to workerCount threads,
+    including the calling thread. Items are handed out one at a time, so
+    uneven items balance out. The first exception thrown by any body is
+    rethrown after all threads finish.
+*/
+template <typename BodyType>
+void parallelFor(size_t count, size_t workerCount, BodyType body) {
+    if(workerCount > count) workerCount = count;
+    if(workerCount <= 1) {
+        for(size_t i = 0; i < count; i ++) body(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto work = [&] () {
+        for(;;) {
+            size_t i = next.fetch_add(1);
+            if(i >= count) break;
+
+            try {
+                body(i);
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error) error = std::current_exception();
+                next = count;  // stop handing out work
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t t = 1; t < workerCount; t ++) threads.emplace_back(work);
+    work();
+    for(auto &thread : threads) thread.join();
+
+    if(error) std::rethrow_exception(error);
+}
+
+template <typename BodyType>
+void parallelFor(size_t count, BodyType body) {
+    parallelFor(count, ParallelWorkers::getCount(), body);
+}
+
+/** Runs analyze(i, result) for each i in [0, count) in parallel, where each
+    call fills in only its own result, and then merge(i, result) on the
+    calling thread in index order. Analyses may read but must not change
+    shared state; changes are made in merge, so the outcome does not depend
+    on how work was scheduled. ResultType must be default constructible and
+    must not be bool (std::vector<bool> elements share storage).
+*/
+template <typename ResultType, typename AnalyzeType, typename MergeType>
+void parallelAnalyze(size_t count, size_t workerCount, AnalyzeType analyze,
+    MergeType merge) {
+
+    std::vector<ResultType> results(count);
+    parallelFor(count, workerCount, [&] (size_t i) {
+        analyze(i, results[i]);
+    });
+    for(size_t i = 0; i < count; i ++) merge(i, results[i]);
+}
+
+template <typename ResultType, typename AnalyzeType, typename MergeType>
+void parallelAnalyze(size_t count, AnalyzeType analyze, MergeType merge) {
+    parallelAnalyze<ResultType>(count, ParallelWorkers::getCount(),
+        analyze, merge);
+}
+
+#endif
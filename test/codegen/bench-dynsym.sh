@@ -0,0 +1,33 @@
+#!/bin/bash
+# Compares ld.so symbol lookup (relocation) time of a program against its
+# mirror ELF, with and without an extra DT_HASH table.
+mkdir -p tmp
+
+prog=${1:-hello}
+runs=${2:-20}
+
+if [ ! -x ../binary/build/$prog ]; then
+    echo "Usage: $0 [test-program] [runs]" 1>&2
+    exit 1
+fi
+
+rm -f tmp/$prog-gnuhash tmp/$prog-sysvhash
+../../app/etelf -m ../binary/build/$prog tmp/$prog-gnuhash \
+    > tmp/$prog-gnuhash.log 2>&1
+EGALITO_SYSV_HASH=1 ../../app/etelf -m ../binary/build/$prog \
+    tmp/$prog-sysvhash > tmp/$prog-sysvhash.log 2>&1
+
+measure() {
+    local total=0
+    for i in $(seq $runs); do
+        cycles=$(LD_DEBUG=statistics LD_BIND_NOW=1 $1 2>&1 >/dev/null \
+            | grep 'time needed for relocation' \
+            | sed 's/.*relocation: *\([0-9]*\).*/\1/')
+        total=$((total + ${cycles:-0}))
+    done
+    echo "$2: $((total / runs)) cycles relocating (mean of $runs runs)"
+}
+
+measure ../binary/build/$prog "original"
+measure ./tmp/$prog-gnuhash "mirror, DT_GNU_HASH"
+measure ./tmp/$prog-sysvhash "mirror, DT_GNU_HASH and DT_HASH"
@@ -0,0 +1,55 @@
+#!/bin/bash
+# Reports the per-call overhead of each shadow stack variant, with and
+# without elision of functions proven safe. The workload is timed after a
+# plain union rewrite and after each variant; the difference is divided by
+# the number of calls counted with edge profiling.
+mkdir -p tmp
+
+prog=${1:-/bin/gzip}
+shift
+args=${@:--c -9 ../../app/etharden}
+runs=${RUNS:-5}
+name=$(basename $prog)
+
+if [ ! -x "$prog" ]; then
+    echo "Usage: $0 [program] [arguments...]" 1>&2
+    exit 1
+fi
+
+harden() {
+    ../../app/etharden -u $1 $prog tmp/$name-$2 > tmp/$name-$2.log 2>&1
+}
+
+harden --nop nop
+harden --ss-const const
+harden "--ss-elide --ss-const" const-elide
+harden --ss-gs gs
+harden "--ss-elide --ss-gs" gs-elide
+harden --profile-edges edges
+
+rm -f edgeprofile.data
+./tmp/$name-edges $args > /dev/null
+calls=$(../../app/etprofile --edges ./tmp/$name-edges \
+    | awk '$1 == "function" && $3 != "?" { calls += $3 } END { print calls }')
+if [ -z "$calls" ] || [ "$calls" -eq 0 ]; then
+    echo "could not count calls, see tmp/$name-edges.log" 1>&2
+    exit 1
+fi
+
+measure() {
+    local start=$(date +%s%N)
+    for i in $(seq $runs); do
+        $1 $args > /dev/null
+    done
+    echo $(( ($(date +%s%N) - start) / runs ))
+}
+
+base=$(measure ./tmp/$name-nop)
+echo "$name: $calls calls, $base ns per run (mean of $runs runs)"
+for variant in const const-elide gs gs-elide; do
+    time=$(measure ./tmp/$name-$variant)
+    summary=$(grep '^Instrumented' tmp/$name-$variant.log)
+    echo "  $variant: $(( time - base )) ns overhead," \
+        "$(awk "BEGIN { printf \"%.2f\", ($time - $base) / $calls }") ns per call" \
+        "(${summary:-no summary})"
+done
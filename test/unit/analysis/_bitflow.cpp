@@ -0,0 +1,98 @@
+#include "framework/include.h"
+#include "analysis/bitflow.h"
+#include "analysis/graph.h"
+
+namespace {
+class TestLink : public GraphLinkBase {
+private:
+    int target;
+public:
+    TestLink(int target) : target(target) {}
+    virtual int getTargetID() const { return target; }
+};
+
+class TestNode : public GraphNodeBase {
+private:
+    int id;
+    ListType links[2];
+public:
+    TestNode(int id) : id(id) {}
+    void addLink(GraphLinkBase *link, int direction)
+        { links[direction > 0].push_back(link); }
+    virtual int getID() const { return id; }
+    virtual ConcreteIterable<ListType> getLinks(int direction)
+        { return ConcreteIterable<ListType>(links[direction > 0]); }
+};
+
+class TestGraph : public GraphBase {
+private:
+    std::vector<TestNode> nodes;
+    std::vector<TestLink> storage;
+public:
+    TestGraph(size_t count, std::vector<std::pair<int, int>> edges) {
+        storage.reserve(edges.size() * 2);
+        for(size_t i = 0; i < count; i ++) nodes.emplace_back(i);
+        for(auto edge : edges) {
+            storage.emplace_back(edge.second);
+            nodes[edge.first].addLink(&storage.back(), 1);
+            storage.emplace_back(edge.first);
+            nodes[edge.second].addLink(&storage.back(), -1);
+        }
+    }
+    virtual GraphNodeBase *get(int id) { return &nodes[id]; }
+    virtual size_t getCount() const { return nodes.size(); }
+};
+}
+
+TEST_CASE("bit vectors", "[analysis][fast]") {
+    BitVector v(70);
+    v.setAll();
+    CHECK(v.count() == 70);
+    v.reset(65);
+    CHECK(!v.get(65));
+
+    BitVector w(70);
+    w.set(65);
+    CHECK(v.unionWith(w));
+    CHECK(!v.unionWith(w));
+    CHECK(v.count() == 70);
+
+    v.transfer(w, v);
+    CHECK(v == w);
+}
+
+TEST_CASE("bit-vector dataflow", "[analysis][fast]") {
+    // 0 -> 1 -> 3, 0 -> 2 -> 3, 3 -> 1 (loop)
+    TestGraph graph(4, {{0, 1}, {0, 2}, {1, 3}, {2, 3}, {3, 1}});
+
+    SECTION("forward facts reach around the loop") {
+        BitDataFlow flow(&graph, 3, BitDataFlow::FORWARD);
+        flow.getGen(2).set(0);
+        flow.getGen(3).set(1);
+        flow.getKill(1).set(0);
+        flow.solve();
+
+        CHECK(!flow.getIn(0).get(0));
+        CHECK(flow.getIn(1).get(0));
+        CHECK(flow.getIn(1).get(1));
+        CHECK(flow.getIn(3).get(0));
+        CHECK(!flow.getOut(1).get(0));
+    }
+
+    SECTION("backward facts start at exits") {
+        TestGraph exiting(5, {{0, 1}, {0, 2}, {1, 3}, {2, 3}, {3, 1},
+            {3, 4}});
+        BitDataFlow flow(&exiting, 2, BitDataFlow::BACKWARD);
+        BitVector boundary(2);
+        boundary.set(1);
+        flow.setBoundary(boundary);
+        flow.getGen(2).set(0);
+        flow.getKill(3).set(1);
+        flow.solve();
+
+        CHECK(flow.getOut(4).get(1));
+        CHECK(!flow.getIn(3).get(1));
+        CHECK(flow.getIn(0).get(0));
+        CHECK(!flow.getIn(1).get(0));
+    }
+}
@@ -0,0 +1,33 @@
+#include "framework/include.h"
+#include "analysis/callchain.h"
+
+TEST_CASE("call-chain clustering", "[analysis][fast]") {
+    SECTION("callee follows its heaviest caller") {
+        CallChainClustering c3;
+        auto main = c3.addFunction(100, 1000);
+        auto cold = c3.addFunction(100, 0);
+        auto helper = c3.addFunction(50, 500);
+        auto other = c3.addFunction(50, 10);
+        c3.addCall(other, helper, 1);
+        c3.addCall(main, helper, 40);
+
+        auto order = c3.computeOrder();
+        REQUIRE(order.size() == 4);
+        CHECK(order[0] == main);
+        CHECK(order[1] == helper);
+        CHECK(order[3] == cold);
+    }
+
+    SECTION("merge limit keeps clusters apart") {
+        CallChainClustering c3(128);
+        auto a = c3.addFunction(100, 100);
+        auto b = c3.addFunction(100, 1000);
+        c3.addCall(a, b, 10);
+
+        // b is denser, and too big to join a's cluster
+        auto order = c3.computeOrder();
+        REQUIRE(order.size() == 2);
+        CHECK(order[0] == b);
+        CHECK(order[1] == a);
+    }
+}
@@ -0,0 +1,55 @@
+#include "framework/include.h"
+#include "elf/elfmap.h"
+#include "elf/elfspace.h"
+#include "analysis/controlflow.h"
+#include "analysis/dominance.h"
+#include "conductor/conductor.h"
+#include "log/registry.h"
+
+TEST_CASE("CFG dominators and loops", "[analysis][fast][.]") {
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    ElfMap elf(TESTDIR "cfg");
+
+    Conductor conductor;
+    conductor.parseExecutable(&elf);
+
+    auto module = conductor.getMainSpace()->getModule();
+    auto f = CIter::named(module->getFunctionList())->find("main");
+
+    REQUIRE(f != nullptr);
+    ControlFlowGraph cfg(f);
+
+    // 0->1->2->3<->4->5
+    // |  |
+    // |  v
+    // +->6
+
+    SECTION("dominator tree") {
+        auto dom = cfg.getDominatorTree();
+        CHECK(dom == cfg.getDominatorTree());
+        for(size_t i = 0; i < cfg.getCount(); i++) {
+            CHECK(dom->dominates(0, i));
+        }
+        CHECK(dom->getImmediateDominator(6) == 0);
+        CHECK(dom->getImmediateDominator(4) == 3);
+        CHECK(dom->strictlyDominates(3, 4));
+        CHECK(!dom->dominates(4, 3));
+        CHECK(!dom->dominates(1, 6));
+    }
+
+    SECTION("post-dominator tree") {
+        auto pdom = cfg.getPostDominatorTree();
+        CHECK(pdom->dominates(4, 3));
+        CHECK(!pdom->dominates(3, 0));
+    }
+
+    SECTION("loop nesting") {
+        auto loops = cfg.getLoopNesting();
+        REQUIRE(loops->getLoopCount() == 1);
+        CHECK(loops->getLoop(0).getHeader() == 3);
+        CHECK(loops->isLoopHeader(3));
+        CHECK(loops->getDepth(4) == 1);
+        CHECK(loops->getDepth(0) == 0);
+    }
+}
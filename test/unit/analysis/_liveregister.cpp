@@ -0,0 +1,39 @@
+#include "framework/include.h"
+#include "analysis/liveregister.h"
+#include "analysis/regflow.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "instr/register.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+TEST_CASE("tail jumps kill caller-saved registers like calls",
+    "[analysis][fast][x86_64]") {
+
+    auto target = ChunkBuilder::makeFunction({
+        {0xc3}}, 0x1000);                           // retq
+
+    auto function = ChunkBuilder::makeFunction({
+        {0x48, 0x89, 0xf8},                         // mov %rdi, %rax
+        {0xe9, 0, 0, 0, 0}}, 0x2000);               // jmpq target
+    auto jump = function->getChildren()->getIterable()->getLast()
+        ->getChildren()->getIterable()->getLast();
+    jump->getSemantic()->setLink(
+        new NormalLink(target, Link::SCOPE_EXTERNAL_JUMP));
+
+    LiveRegister live;
+    auto info = live.getInfo(function);
+    for(int reg = 0; reg < X86Register::REGISTER_NUMBER; reg ++) {
+        auto bit = RegisterEffect::bit(reg);
+        if(RegisterEffectModel::getCallerSaved() & bit) {
+            CHECK(!info.get(reg));
+        }
+        else if(RegisterEffectModel::getCalleeSaved() & bit) {
+            CHECK(info.get(reg));
+        }
+    }
+
+    delete function;
+    delete target;
+}
+#endif
@@ -0,0 +1,195 @@
+#include <string>
+#include "framework/include.h"
+#include "analysis/regsummary.h"
+#include "pass/sanitizevolatileregisters.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "instr/concrete.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+static RegisterSet bits(std::initializer_list<int> regs) {
+    RegisterSet set = 0;
+    for(auto reg : regs) set |= RegisterEffect::bit(reg);
+    return set;
+}
+
+static void linkTo(Block *block, Function *target) {
+    auto instr = block->getChildren()->getIterable()->getLast();
+    instr->getSemantic()->setLink(
+        new NormalLink(target, Link::SCOPE_EXTERNAL_JUMP));
+}
+
+/** The registers zeroed by SanitizeVolatileRegistersPass in function. */
+static RegisterSet getPoisoned(Function *function) {
+    static const struct {
+        int reg;
+        std::string bytes;
+    } xorList[] = {
+        {X86Register::R1,  "\x48\x31\xc9"},
+        {X86Register::R8,  "\x4d\x31\xc0"},
+        {X86Register::R9,  "\x4d\x31\xc9"},
+        {X86Register::R10, "\x4d\x31\xd2"},
+        {X86Register::R11, "\x4d\x31\xdb"},
+    };
+
+    RegisterSet poisoned = 0;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            for(const auto &x : xorList) {
+                if(instr->getSemantic()->getData() == x.bytes) {
+                    poisoned |= RegisterEffect::bit(x.reg);
+                }
+            }
+        }
+    }
+    return poisoned;
+}
+
+static size_t countInstructions(Function *function) {
+    size_t count = 0;
+    for(auto block : CIter::children(function)) {
+        count += block->getChildren()->getIterable()->getCount();
+    }
+    return count;
+}
+
+static const RegisterSet allPoison = bits({X86Register::R1, X86Register::R8,
+    X86Register::R9, X86Register::R10, X86Register::R11});
+
+TEST_CASE("register summary of a leaf function",
+    "[analysis][fast][x86_64]") {
+
+    Module *module = ChunkBuilder::makeModule();
+    auto leaf = ChunkBuilder::makeFunction({
+        {0x48, 0x89, 0xf8},                         // mov %rdi, %rax
+        {0xc3}}, 0x1000);                           // retq
+    ChunkBuilder::add(module, leaf);
+
+    {
+        RegisterSummary summary(module);
+        REQUIRE(summary.isSummarized(leaf));
+        CHECK(summary.getClobbered(leaf) == bits({X86Register::R0}));
+        CHECK(summary.getLiveAtReturn(leaf)
+            == RegisterSummary::getLiveAtReturnByABI());
+    }
+
+    // nothing reads the scratch registers after a return by the ABI
+    SanitizeVolatileRegistersPass sanitize;
+    module->accept(&sanitize);
+    CHECK(getPoisoned(leaf) == allPoison);
+    CHECK(countInstructions(leaf) == 2 + 5);
+    auto last = leaf->getChildren()->getIterable()->getLast()
+        ->getChildren()->getIterable()->getLast();
+    CHECK(dynamic_cast<ReturnInstruction *>(last->getSemantic()));
+}
+
+TEST_CASE("register summaries follow a call chain",
+    "[analysis][fast][x86_64]") {
+
+    Module *module = ChunkBuilder::makeModule();
+
+    auto leaf = ChunkBuilder::makeFunction({
+        {0x49, 0x89, 0xf8},                         // mov %rdi, %r8
+        {0x4c, 0x89, 0xc0},                         // mov %r8, %rax
+        {0xc3}}, 0x1000);                           // retq
+
+    // middle keeps %rcx across the call, since leaf leaves it alone
+    auto middle = ChunkBuilder::makeFunction({
+        {0x48, 0x89, 0xf9},                         // mov %rdi, %rcx
+        {0xe8, 0, 0, 0, 0}}, 0x2000);               // callq leaf
+    linkTo(middle->getChildren()->getIterable()->getLast(), leaf);
+    auto block = ChunkBuilder::appendBlock(middle);
+    ChunkBuilder::append(block, {0x48, 0x89, 0xc8});  // mov %rcx, %rax
+    ChunkBuilder::append(block, {0xc3});              // retq
+
+    auto top = ChunkBuilder::makeFunction({
+        {0xe8, 0, 0, 0, 0}}, 0x3000);               // callq middle
+    linkTo(top->getChildren()->getIterable()->getLast(), middle);
+    ChunkBuilder::append(ChunkBuilder::appendBlock(top), {0xc3});  // retq
+
+    ChunkBuilder::add(module, leaf);
+    ChunkBuilder::add(module, middle);
+    ChunkBuilder::add(module, top);
+
+    {
+        RegisterSummary summary(module);
+        auto leafClobbered = bits({X86Register::R0, X86Register::R8});
+        CHECK(summary.getClobbered(leaf) == leafClobbered);
+        CHECK(summary.getClobbered(middle)
+            == (leafClobbered | bits({X86Register::R1})));
+        CHECK(summary.getClobbered(top) == summary.getClobbered(middle));
+
+        auto leafLive = summary.getLiveAtReturn(leaf);
+        CHECK(leafLive & RegisterEffect::bit(X86Register::R1));
+        CHECK(!(leafLive & RegisterEffect::bit(X86Register::R8)));
+        CHECK(summary.getLiveAtReturn(middle)
+            == RegisterSummary::getLiveAtReturnByABI());
+        CHECK(summary.getLiveAtReturn(top)
+            == RegisterSummary::getLiveAtReturnByABI());
+    }
+
+    SanitizeVolatileRegistersPass sanitize;
+    module->accept(&sanitize);
+    CHECK(getPoisoned(leaf) == (allPoison & ~bits({X86Register::R1})));
+    CHECK(countInstructions(leaf) == 3 + 4);
+    CHECK(getPoisoned(middle) == allPoison);
+    CHECK(getPoisoned(top) == allPoison);
+}
+
+TEST_CASE("register summaries through an external conditional tail jump",
+    "[analysis][fast][x86_64]") {
+
+    Module *module = ChunkBuilder::makeModule();
+
+    auto target = ChunkBuilder::makeFunction({
+        {0x4c, 0x89, 0xc8},                         // mov %r9, %rax
+        {0xc3}}, 0x1000);                           // retq
+
+    auto cond = ChunkBuilder::makeFunction({
+        {0x48, 0x85, 0xff},                         // test %rdi, %rdi
+        {0x0f, 0x84, 0, 0, 0, 0}}, 0x2000);         // je target
+    auto jump = cond->getChildren()->getIterable()->getLast()
+        ->getChildren()->getIterable()->getLast();
+    linkTo(cond->getChildren()->getIterable()->getLast(), target);
+    ChunkBuilder::append(ChunkBuilder::appendBlock(cond), {0xc3});  // retq
+
+    // caller keeps %r10 across the call, which may return from target
+    auto caller = ChunkBuilder::makeFunction({
+        {0x49, 0x89, 0xfa},                         // mov %rdi, %r10
+        {0xe8, 0, 0, 0, 0}}, 0x3000);               // callq cond
+    linkTo(caller->getChildren()->getIterable()->getLast(), cond);
+    auto block = ChunkBuilder::appendBlock(caller);
+    ChunkBuilder::append(block, {0x4c, 0x89, 0xd0});  // mov %r10, %rax
+    ChunkBuilder::append(block, {0xc3});              // retq
+
+    ChunkBuilder::add(module, target);
+    ChunkBuilder::add(module, cond);
+    ChunkBuilder::add(module, caller);
+
+    {
+        RegisterSummary summary(module);
+        CHECK(summary.getClobbered(target) == bits({X86Register::R0}));
+        CHECK(summary.getClobbered(cond)
+            == bits({X86Register::R0, X86Register::FLAGS}));
+
+        // the tail call passes its arguments on
+        auto liveness = summary.getLiveness(cond);
+        REQUIRE(liveness);
+        auto arguments = bits({X86Register::R1, X86Register::R8,
+            X86Register::R9});
+        CHECK((liveness->getLiveBefore(jump) & arguments) == arguments);
+
+        auto condLive = summary.getLiveAtReturn(cond);
+        CHECK(condLive & RegisterEffect::bit(X86Register::R10));
+        CHECK((summary.getLiveAtReturn(target) & condLive) == condLive);
+    }
+
+    SanitizeVolatileRegistersPass sanitize;
+    module->accept(&sanitize);
+    auto kept = allPoison & ~bits({X86Register::R10});
+    CHECK(getPoisoned(target) == kept);
+    CHECK(getPoisoned(cond) == kept);
+    CHECK(getPoisoned(caller) == allPoison);
+}
+#endif
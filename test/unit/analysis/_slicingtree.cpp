@@ -0,0 +1,40 @@
+#include "framework/include.h"
+#include "analysis/slicingtree.h"
+
+TEST_CASE("hash-consed slicing trees", "[analysis][fast]") {
+    TreeArena arena;
+    TreeArenaScope scope(&arena);
+    auto &factory = TreeFactory::instance();
+
+    SECTION("identical expressions are one node") {
+        auto a = factory.make<TreeNodeAddition>(
+            factory.make<TreeNodeConstant>(8),
+            factory.make<TreeNodeAddress>(0x1000));
+        auto b = factory.make<TreeNodeAddition>(
+            factory.make<TreeNodeConstant>(8),
+            factory.make<TreeNodeAddress>(0x1000));
+        CHECK(a == b);
+        CHECK(arena.getCount() == 3);
+
+        auto c = factory.make<TreeNodeSubtraction>(
+            factory.make<TreeNodeConstant>(8),
+            factory.make<TreeNodeAddress>(0x1000));
+        CHECK(static_cast<TreeNode *>(c) != static_cast<TreeNode *>(a));
+        CHECK(!a->equal(c));
+    }
+
+    SECTION("nodes with parents are never shared") {
+        auto a = factory.make<TreeNodeMultipleParents>();
+        auto b = factory.make<TreeNodeMultipleParents>();
+        CHECK(a != b);
+    }
+
+    SECTION("arenas do not share nodes") {
+        auto a = factory.make<TreeNodeConstant>(1);
+        TreeArena other;
+        TreeArenaScope otherScope(&other);
+        auto b = factory.make<TreeNodeConstant>(1);
+        CHECK(a != b);
+        CHECK(a->equal(b));
+    }
+}
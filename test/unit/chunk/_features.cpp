@@ -0,0 +1,36 @@
+#include "framework/include.h"
+#include "chunk/concrete.h"
+#include "chunk/features.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+TEST_CASE("function features of a leaf function", "[chunk][fast]") {
+    auto function = ChunkBuilder::makeFunction({
+        {0x0f, 0x05},           // syscall
+        {0xc3}});               // retq
+
+    auto features = function->getFeatures();
+    CHECK(features.isKnown());
+    CHECK(features.has(FunctionFeatures::FEATURE_SYSCALL));
+    CHECK(features.has(FunctionFeatures::FEATURE_RETURN));
+    CHECK(!features.hasCall());
+    CHECK(!features.has(FunctionFeatures::FEATURE_INDIRECT_JUMP));
+    CHECK(!features.has(FunctionFeatures::FEATURE_STACK_POINTER));
+    delete function;
+}
+
+TEST_CASE("function features are rescanned after mutation", "[chunk][fast]") {
+    auto function = ChunkBuilder::makeFunction({
+        {0xc3}});               // retq
+    CHECK(!function->getFeatures().has(
+        FunctionFeatures::FEATURE_STACK_POINTER));
+
+    ChunkBuilder::append(function, {0x48, 0x83, 0xec, 0x08});  // sub $8,%rsp
+    ChunkBuilder::append(function, {0xff, 0xe0});  // jmpq *%rax
+    CHECK(function->getFeatures().has(
+        FunctionFeatures::FEATURE_STACK_POINTER));
+    CHECK(function->getFeatures().has(
+        FunctionFeatures::FEATURE_INDIRECT_JUMP));
+    delete function;
+}
+#endif
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <sstream>
+#include "framework/include.h"
+#include "chunk/concrete.h"
+#include "chunk/resolver.h"
+#include "chunk/symbolindex.h"
+#include "conductor/conductor.h"
+#include "elf/elfmap.h"
+#include "elf/elfspace.h"
+#include "elf/symbol.h"
+#include "log/registry.h"
+
+typedef std::vector<std::pair<Module *, Symbol *>> ReferenceList;
+
+static ReferenceList findReferences(Program *program) {
+    ReferenceList references;
+    for(auto module : CIter::modules(program)) {
+        auto list = module->getElfSpace()->getDynamicSymbolList();
+        if(!list) continue;
+        for(auto symbol : *list) {
+            if(symbol->getSectionIndex() == 0 && *symbol->getName()) {
+                references.emplace_back(module, symbol);
+            }
+        }
+    }
+    return references;
+}
+
+static bool isDependency(Module *module, Module *other) {
+    const auto &dependencies = module->getLibrary()->getDependencies();
+    return other != module
+        && dependencies.find(other->getLibrary()) != dependencies.end();
+}
+
+// how lookups were done before the index: probe every module by name
+static Module *scanDefinition(Program *program, Module *module,
+    Symbol *symbol) {
+
+    for(auto m : CIter::modules(program)) {
+        if(!isDependency(module, m)) continue;
+        auto list = m->getElfSpace()->getDynamicSymbolList();
+        if(!list) continue;
+
+        if(list->find(symbol->getName())) return m;
+        if(auto version = symbol->getVersion()) {
+            std::string name(symbol->getName());
+            if(list->find((name + "@" + version->getName()).c_str())) {
+                return m;
+            }
+            if(list->find((name + "@@" + version->getName()).c_str())) {
+                return m;
+            }
+        }
+    }
+    return nullptr;
+}
+
+static Module *indexDefinition(Conductor &conductor, Module *module,
+    Symbol *symbol) {
+
+    std::vector<SymbolIndex::Match> matches;
+    conductor.getSymbolIndex()->find(symbol->getName(), symbol->getVersion(),
+        matches);
+    for(const auto &match : matches) {
+        if(isDependency(module, match.module)) return match.module;
+    }
+    return nullptr;
+}
+
+TEST_CASE("resolve references of glibc and a C++ program", "[chunk][full][.]") {
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    // the test runner is a large C++ program, and depends on glibc
+    ElfMap elf("/proc/self/exe");
+
+    Conductor conductor;
+    conductor.parseExecutable(&elf);
+    conductor.parseLibraries();
+    REQUIRE(conductor.getProgram()->getLibc() != nullptr);
+
+    auto program = conductor.getProgram();
+    auto references = findReferences(program);
+    CAPTURE(references.size());
+    REQUIRE(references.size() > 0);
+
+    typedef std::chrono::steady_clock Clock;
+    std::vector<Module *> scanned, indexed;
+
+    auto start = Clock::now();
+    for(const auto &ref : references) {
+        scanned.push_back(scanDefinition(program, ref.first, ref.second));
+    }
+    auto scanTime = Clock::now() - start;
+
+    start = Clock::now();
+    conductor.getSymbolIndex();
+    auto buildTime = Clock::now() - start;
+
+    start = Clock::now();
+    for(const auto &ref : references) {
+        indexed.push_back(indexDefinition(conductor, ref.first, ref.second));
+    }
+    auto indexTime = Clock::now() - start;
+
+    CHECK(scanned == indexed);
+
+    start = Clock::now();
+    size_t resolved = 0;
+    for(const auto &ref : references) {
+        if(auto link = PerfectLinkResolver().resolveExternallyStrongWeak(
+            ref.second, &conductor, ref.first, false)) {
+
+            resolved ++;
+            delete link;
+        }
+    }
+    auto resolveTime = Clock::now() - start;
+
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+    std::ostringstream stream;
+    stream << references.size() << " references in "
+        << program->getChildren()->getIterable()->getCount() << " modules\n"
+        << "  scan every module: "
+        << duration_cast<microseconds>(scanTime).count() << " us\n"
+        << "  build index: "
+        << duration_cast<microseconds>(buildTime).count() << " us\n"
+        << "  index lookups: "
+        << duration_cast<microseconds>(indexTime).count() << " us\n"
+        << "  resolved " << resolved << " links in "
+        << duration_cast<microseconds>(resolveTime).count() << " us\n";
+    WARN(stream.str());
+}
@@ -0,0 +1,223 @@
+#include <cstring>
+#include "framework/include.h"
+#include "generate/ehframe.h"
+#include "chunk/concrete.h"
+#include "chunk/unwind.h"
+#include "dwarf/entry.h"
+#include "dwarf/defines.h"
+#include "operation/mutator.h"
+#include "disasm/disassemble.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+template <typename Type>
+static Type read(const std::string &data, size_t offset) {
+    Type value;
+    std::memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+// everything in function so far was there when its rows were read
+static void markOriginal(Function *function) {
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            function->getUnwind()->addOriginal(instr->getSemantic());
+        }
+    }
+}
+
+TEST_CASE("CFA rows follow their instructions into .eh_frame",
+    "[generate][fast][x86_64]") {
+
+    Function *function = ChunkBuilder::makeFunction();
+    auto block = function->getChildren()->getIterable()->get(0);
+    auto push = ChunkBuilder::append(block, {0x55});            // push %rbp
+    auto mov = ChunkBuilder::append(block, {0x48, 0x89, 0xe5}); // mov %rsp,%rbp
+    ChunkBuilder::append(block, {0x5d});                        // pop %rbp
+    auto ret = ChunkBuilder::append(block, {0xc3});             // retq
+
+    // def_cfa %rsp+8; offset %rip at cfa-8
+    static const unsigned char initial[] = {0x0c, 0x07, 0x08, 0x90, 0x01};
+    DwarfCIE cie(0, 0, 0);
+    cie.setCodeAlignFactor(1);
+    cie.setDataAlignFactor(-8);
+    cie.setRetAddressReg(16);
+    cie.setInstructions(reinterpret_cast<address_t>(initial),
+        reinterpret_cast<address_t>(initial + sizeof(initial)));
+
+    auto unwind = new FunctionUnwind(&cie);
+    unwind->addRow(push, "");
+    unwind->addRow(mov, "\x0e\x10\x86\x02");  // cfa+16; %rbp at cfa-16
+    unwind->addRow(ret, "\x0c\x07\x08");      // def_cfa %rsp+8
+    function->setUnwind(unwind);
+    markOriginal(function);
+
+    // takes over mov as the anchor, since it also comes after the push
+    auto nop = Disassemble::instruction({0x90});
+    ChunkMutator(block).insertBeforeJumpTo(mov, nop);
+    REQUIRE(function->getSize() == 7);
+
+    const address_t frameAddress = 0x5000;
+    EhFrameBuilder builder(frameAddress);
+    REQUIRE(builder.add(function));
+    auto frame = builder.getFrame();
+
+    size_t fde = read<uint32_t>(frame, 0) + 4;  // after the CIE
+    CHECK(fde % 8 == 0);
+    CHECK(read<uint32_t>(frame, fde + 4) == fde + 4);  // CIE pointer
+    CHECK(frameAddress + fde + 8 + read<int32_t>(frame, fde + 8) == 0x1000);
+    CHECK(read<uint32_t>(frame, fde + 12) == 7);
+    CHECK(frame[fde + 16] == 0);  // no augmentation data
+
+    const std::string program("\x41\x0e\x10\x86\x02\x45\x0c\x07\x08", 9);
+    CHECK(frame.substr(fde + 17, program.size()) == program);
+    CHECK(read<uint32_t>(frame, frame.size() - 4) == 0);
+
+    address_t hdrAddress = frameAddress + frame.size();
+    auto header = builder.getHeader(hdrAddress);
+    CHECK(header.size() == 12 + 8);
+    CHECK(hdrAddress + 4 + read<int32_t>(header, 4) == frameAddress);
+    CHECK(read<uint32_t>(header, 8) == 1);
+    CHECK(hdrAddress + read<int32_t>(header, 12) == 0x1000);
+    CHECK(hdrAddress + read<int32_t>(header, 16) == frameAddress + fde);
+
+    delete function;
+}
+
+TEST_CASE("inserted pushes and pops move a %rsp-based CFA",
+    "[generate][fast][x86_64]") {
+
+    // no frame pointer, so the CFA stays based on %rsp
+    Function *function = ChunkBuilder::makeFunction();
+    auto block = function->getChildren()->getIterable()->get(0);
+    auto push = ChunkBuilder::append(block, {0x53});            // push %rbx
+    auto mov = ChunkBuilder::append(block, {0x48, 0x89, 0xfb}); // mov %rdi,%rbx
+    ChunkBuilder::append(block, {0x5b});                        // pop %rbx
+    auto ret = ChunkBuilder::append(block, {0xc3});             // retq
+
+    static const unsigned char initial[] = {0x0c, 0x07, 0x08, 0x90, 0x01};
+    DwarfCIE cie(0, 0, 0);
+    cie.setCodeAlignFactor(1);
+    cie.setDataAlignFactor(-8);
+    cie.setRetAddressReg(16);
+    cie.setInstructions(reinterpret_cast<address_t>(initial),
+        reinterpret_cast<address_t>(initial + sizeof(initial)));
+
+    auto unwind = new FunctionUnwind(&cie);
+    unwind->addRow(push, "");
+    unwind->addRow(mov, "\x0e\x10");  // def_cfa_offset 16
+    unwind->addRow(ret, "\x0e\x08");  // def_cfa_offset 8
+    function->setUnwind(unwind);
+    markOriginal(function);
+
+    SECTION("balanced instrumentation") {
+        // push %rdi; pop %rdi in front of the mov, taking over its row
+        ChunkMutator(block).insertBeforeJumpTo(mov,
+            Disassemble::instruction({0x57}));
+        ChunkMutator(block).insertAfter(mov,
+            Disassemble::instruction({0x5f}));
+        REQUIRE(function->getSize() == 8);
+
+        EhFrameBuilder builder(0x5000);
+        REQUIRE(builder.add(function));
+        auto frame = builder.getFrame();
+
+        size_t fde = read<uint32_t>(frame, 0) + 4;
+        CHECK(read<uint32_t>(frame, fde + 12) == 8);
+        // cfa+16 after push %rbx, +24 after push %rdi, +16 after pop %rdi,
+        // then +8 at the ret
+        const std::string program(
+            "\x41\x0e\x10\x41\x0e\x18\x41\x0e\x10\x44\x0e\x08", 12);
+        CHECK(frame.substr(fde + 17, program.size()) == program);
+    }
+
+    SECTION("stack realignment can't be followed") {
+        ChunkMutator(block).insertBeforeJumpTo(mov,
+            Disassemble::instruction({0x48, 0x83, 0xe4, 0xf0}));  // and $-16,%rsp
+
+        EhFrameBuilder builder(0x5000);
+        CHECK(!builder.add(function));
+        CHECK(builder.getFDECount() == 0);
+    }
+
+    delete function;
+}
+
+TEST_CASE("LSDA call sites follow their instructions into .gcc_except_table",
+    "[generate][fast][x86_64]") {
+
+    Function *function = ChunkBuilder::makeFunction();
+    auto block = function->getChildren()->getIterable()->get(0);
+    auto push = ChunkBuilder::append(block, {0x55});    // push %rbp
+    auto start = ChunkBuilder::append(block, {0x90});
+    auto middle = ChunkBuilder::append(block, {0x90});
+    auto end = ChunkBuilder::append(block, {0x5d});     // pop %rbp
+    ChunkBuilder::append(block, {0xc3});
+    auto pad = ChunkBuilder::append(
+        ChunkBuilder::appendBlock(function), {0x5d});
+    ChunkBuilder::append(function, {0xc3});
+
+    static const unsigned char initial[] = {0x0c, 0x07, 0x08, 0x90, 0x01};
+    DwarfCIE cie(0, 0, 0);
+    cie.setCodeAlignFactor(1);
+    cie.setDataAlignFactor(-8);
+    cie.setRetAddressReg(16);
+    cie.setInstructions(reinterpret_cast<address_t>(initial),
+        reinterpret_cast<address_t>(initial + sizeof(initial)));
+    DwarfCIE::Augmentation augmentation;
+    augmentation.setPersonalityEncoding(
+        DW_EH_PE_indirect | DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+    augmentation.setLsdaEnc(DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+    cie.setAugmentation(&augmentation);
+
+    // one catch clause, for the type at 0xa000
+    UnresolvedLink personality(0x9000);
+    auto lsda = new FunctionLSDA(DW_EH_PE_pcrel | DW_EH_PE_sdata4,
+        std::string("\x01\x00", 2), "");
+    lsda->addCallSite(start, end, pad, 1);
+    lsda->addType(new UnresolvedLink(0xa000));
+
+    auto unwind = new FunctionUnwind(&cie);
+    unwind->addRow(push, "");
+    unwind->setPersonality(&personality);
+    unwind->setLSDA(lsda);
+    function->setUnwind(unwind);
+    markOriginal(function);
+
+    // lands inside the call site
+    ChunkMutator(block).insertBeforeJumpTo(middle,
+        Disassemble::instruction({0x90}));
+    REQUIRE(function->getSize() == 8);
+
+    const address_t frameAddress = 0x5000;
+    EhFrameBuilder builder(frameAddress);
+    REQUIRE(builder.add(function));
+    auto frame = builder.getFrame();
+    auto table = builder.getExceptTable();
+    const address_t tableAddress = builder.getExceptTableAddress();
+    CHECK(tableAddress == frameAddress + frame.size());
+
+    CHECK(std::strcmp(frame.data() + 9, "zPLR") == 0);
+    CHECK(frame[17] == 7);  // augmentation data length
+    CHECK(static_cast<unsigned char>(frame[18]) == 0x9b);
+    CHECK(frameAddress + 19 + read<int32_t>(frame, 19) == 0x9000);
+    CHECK(frame[23] == 0x1b);  // LSDA encoding
+    CHECK(frame[24] == 0x1b);  // FDE encoding
+
+    size_t fde = read<uint32_t>(frame, 0) + 4;
+    CHECK(frame[fde + 16] == 4);
+    CHECK(frameAddress + fde + 17 + read<int32_t>(frame, fde + 17)
+        == tableAddress);
+
+    REQUIRE(table.size() == 16);
+    CHECK(static_cast<unsigned char>(table[0]) == DW_EH_PE_omit);
+    CHECK(table[1] == 0x1b);  // type encoding
+    CHECK(table[2] == 12);    // to the end of the type table
+    // uleb128 call site [1, 4) landing at 6, then the action table
+    const std::string callSites("\x01\x04\x01\x03\x06\x01\x01\x00", 8);
+    CHECK(table.substr(3, callSites.size()) == callSites);
+    CHECK(tableAddress + 11 + read<int32_t>(table, 11) == 0xa000);
+
+    delete function;
+}
+#endif
@@ -11,6 +11,39 @@ TEST_CASE("Build Symbol List", "[elf][symbollist]") {
     CHECK(symbolList->getCount() > 0);
 }
 
+TEST_CASE("Add Symbol After Build", "[elf][symbollist]") {
+    ElfMap *elf = new ElfMap(TESTDIR "hello");
+    SymbolList *symbolList = SymbolList::buildSymbolList(elf);
+
+    std::vector<std::pair<Symbol *, Symbol *>> found;
+    for(auto sym : *symbolList) {
+        if(sym->getAddress() == 0) continue;
+        found.emplace_back(sym, symbolList->find(sym->getAddress()));
+    }
+    Symbol *last = nullptr;
+    for(auto sym : *symbolList) {
+        if(sym->getType() == Symbol::TYPE_FUNC && sym->getSize() > 0
+            && (!last || sym->getAddress() > last->getAddress())) {
+
+            last = sym;
+        }
+    }
+    REQUIRE(last != nullptr);
+    auto lastSize = symbolList->estimateSizeOf(last);
+
+    // as DetectNullPtrPass does
+    auto index = symbolList->getCount();
+    auto symbol = new Symbol(0x0, 0x0, "egalito_null_ptr_check_fail",
+        Symbol::TYPE_FUNC, Symbol::BIND_GLOBAL, index, 0);
+    symbolList->add(symbol, index);
+
+    CHECK(symbolList->find(static_cast<address_t>(0)) == symbol);
+    for(const auto &pair : found) {
+        CHECK(symbolList->find(pair.first->getAddress()) == pair.second);
+    }
+    CHECK(symbolList->estimateSizeOf(last) == lastSize);
+}
+
 #if defined(ARCH_ARM)
 TEST_CASE("Mapping Symbol List ", "[elf][mappingsym]") {
     ElfMap *elf = new ElfMap(TESTDIR "hi5");
@@ -0,0 +1,115 @@
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include "framework/include.h"
+#include "chunk/concrete.h"
+#include "conductor/conductor.h"
+#include "elf/elfmap.h"
+#include "elf/elfspace.h"
+#include "elf/symbol.h"
+#include "elf/reloc.h"
+#include "log/registry.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static long long elapsed(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start).count();
+}
+
+// how lookups were done before: ordered maps with copied string keys
+static void compareSymbols(SymbolList *list, std::ostream &stream) {
+    std::map<std::string, Symbol *> nameMap;
+    std::map<address_t, Symbol *> spaceMap;
+    for(auto sym : *list) {
+        nameMap.emplace(sym->getName(), sym);
+        if(sym->getType() != Symbol::TYPE_SECTION
+            && sym->getName()[0] != '$') {
+
+            spaceMap[sym->getAddress()] = sym;
+        }
+    }
+
+    size_t found = 0;
+    auto start = Clock::now();
+    for(auto sym : *list) {
+        if(nameMap.find(sym->getName()) != nameMap.end()) found ++;
+        if(spaceMap.find(sym->getAddress()) != spaceMap.end()) found ++;
+    }
+    auto mapTime = elapsed(start);
+
+    size_t listFound = 0;
+    start = Clock::now();
+    for(auto sym : *list) {
+        if(list->find(sym->getName())) listFound ++;
+        if(list->find(sym->getAddress())) listFound ++;
+    }
+    auto listTime = elapsed(start);
+
+    CHECK(found == listFound);
+    stream << "    " << list->getCount() << " symbols: map "
+        << mapTime << " us, list " << listTime << " us\n";
+}
+
+static void compareRelocs(RelocList *list, std::ostream &stream) {
+    std::map<address_t, Reloc *> relocMap;
+    for(auto reloc : *list) relocMap.emplace(reloc->getAddress(), reloc);
+
+    size_t found = 0;
+    auto start = Clock::now();
+    for(auto reloc : *list) {
+        if(relocMap.find(reloc->getAddress()) != relocMap.end()) found ++;
+    }
+    auto mapTime = elapsed(start);
+
+    size_t listFound = 0;
+    start = Clock::now();
+    for(auto reloc : *list) {
+        if(list->find(reloc->getAddress())) listFound ++;
+    }
+    auto listTime = elapsed(start);
+
+    CHECK(found == listFound);
+    stream << "    " << relocMap.size() << " relocs: map "
+        << mapTime << " us, list " << listTime << " us\n";
+}
+
+TEST_CASE("look up symbols and relocs of glibc, libstdc++ and a C++ program",
+    "[elf][full][.]") {
+
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    // the test runner is a large C++ program
+    ElfMap elf("/proc/self/exe");
+
+    Conductor conductor;
+    conductor.parseExecutable(&elf);
+    conductor.parseLibraries();
+
+    auto program = conductor.getProgram();
+    REQUIRE(program->getLibc() != nullptr);
+    REQUIRE(program->getLibcpp() != nullptr);
+
+    std::ostringstream stream;
+    for(auto module : {program->getMain(), program->getLibc(),
+        program->getLibcpp()}) {
+
+        auto space = module->getElfSpace();
+        stream << space->getName() << '\n';
+
+        auto start = Clock::now();
+        SymbolList *symbolList = SymbolList::buildSymbolList(
+            space->getElfMap());
+        SymbolList *dynamicSymbolList = SymbolList::buildDynamicSymbolList(
+            space->getElfMap());
+        stream << "    build symbol lists: " << elapsed(start) << " us\n";
+
+        if(symbolList) compareSymbols(symbolList, stream);
+        compareSymbols(dynamicSymbolList, stream);
+        if(auto relocList = space->getRelocList()) {
+            compareRelocs(relocList, stream);
+        }
+    }
+    WARN(stream.str());
+}
@@ -0,0 +1,66 @@
+#include "chunkbuilder.h"
+#include "chunk/concrete.h"
+#include "operation/mutator.h"
+#include "disasm/disassemble.h"
+
+Module *ChunkBuilder::makeModule() {
+    Module *module = new Module();
+    FunctionList *functionList = new FunctionList();
+    module->getChildren()->add(functionList);
+    module->setFunctionList(functionList);
+    functionList->setParent(module);
+    return module;
+}
+
+void ChunkBuilder::add(Module *module, Function *function) {
+    module->getFunctionList()->getChildren()->add(function);
+    function->setParent(module->getFunctionList());
+}
+
+Function *ChunkBuilder::makeFunction(address_t address) {
+    Function *function = new Function(address);
+    function->setPosition(
+        PositionFactory::getInstance()->makeAbsolutePosition(address));
+    appendBlock(function);
+    return function;
+}
+
+Function *ChunkBuilder::makeFunction(const std::vector<Bytes> &instructions,
+    address_t address) {
+
+    Function *function = makeFunction(address);
+    for(const auto &bytes : instructions) {
+        append(function, bytes);
+    }
+    return function;
+}
+
+Block *ChunkBuilder::appendBlock(Function *function) {
+    auto blockList = function->getChildren()->getIterable();
+    Chunk *prev = blockList->getCount() ? blockList->getLast() : nullptr;
+
+    Block *block = new Block();
+    block->setPosition(PositionFactory::getInstance()->makePosition(
+        prev, block, function->getSize()));
+    ChunkMutator(function).append(block);
+    return block;
+}
+
+Instruction *ChunkBuilder::append(Block *block, Instruction *instr) {
+    auto instrList = block->getChildren()->getIterable();
+    Chunk *prev = instrList->getCount() ? instrList->getLast() : nullptr;
+
+    instr->setPosition(PositionFactory::getInstance()->makePosition(
+        prev, instr, block->getSize()));
+    ChunkMutator(block).append(instr);
+    return instr;
+}
+
+Instruction *ChunkBuilder::append(Block *block, const Bytes &bytes) {
+    return append(block, Disassemble::instruction(bytes, true,
+        block->getAddress() + block->getSize()));
+}
+
+Instruction *ChunkBuilder::append(Function *function, const Bytes &bytes) {
+    return append(function->getChildren()->getIterable()->getLast(), bytes);
+}
@@ -0,0 +1,41 @@
+#ifndef EGALITO_TEST_UNIT_FRAMEWORK_CHUNK_BUILDER_H
+#define EGALITO_TEST_UNIT_FRAMEWORK_CHUNK_BUILDER_H
+
+#include <vector>
+#include "types.h"
+
+class Module;
+class Function;
+class Block;
+class Instruction;
+
+/** Builds small functions out of raw instruction bytes for unit tests.
+    Each instruction is decoded at the address it ends up at, so relative
+    branch targets are what they would be in a disassembled function.
+*/
+class ChunkBuilder {
+public:
+    typedef std::vector<unsigned char> Bytes;
+public:
+    /** Creates a module with an empty function list. */
+    static Module *makeModule();
+    /** Adds function to the function list of module. */
+    static void add(Module *module, Function *function);
+
+    /** Creates a function containing one empty block. */
+    static Function *makeFunction(address_t address = 0x1000);
+    /** Creates a function with one block holding the given instructions. */
+    static Function *makeFunction(const std::vector<Bytes> &instructions,
+        address_t address = 0x1000);
+
+    /** Appends an empty block to the end of function. */
+    static Block *appendBlock(Function *function);
+    /** Appends instr to the end of block. */
+    static Instruction *append(Block *block, Instruction *instr);
+    /** Decodes bytes and appends the instruction to the end of block. */
+    static Instruction *append(Block *block, const Bytes &bytes);
+    /** Appends to the last block of function. */
+    static Instruction *append(Function *function, const Bytes &bytes);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <sstream>
+#include <streambuf>
+#include "framework/include.h"
+#include "conductor/conductor.h"
+#include "elf/elfmap.h"
+#include "log/registry.h"
+#include "log/log.h"
+
+static void logEverything(int i) {
+    CLOG(0, "%d %lx [%s] %5.2f %c %*d|%-4s|%zu%%", i, 0xabcul, "str",
+        3.14159, 'q', 4, 7, "ab", static_cast<size_t>(99));
+    CLOG0(0, "%s ", static_cast<const char *>(nullptr));
+    LOG(0, "stream " << i << std::hex << ' ' << 255 << std::dec);
+    LOG0(0, "partial ");
+    LOG(0, "line");
+}
+
+TEST_CASE("async logging writes the same output", "[log][fast]") {
+    std::ostringstream syncOutput, asyncOutput;
+
+    LogStream::overrideStream(&syncOutput);
+    for(int i = 0; i < 3; i ++) logEverything(i);
+
+    LogStream::overrideStream(&asyncOutput);
+    AsyncLog::start();
+    for(int i = 0; i < 3; i ++) logEverything(i);
+    AsyncLog::stop();
+    LogStream::overrideStream(nullptr);
+
+    CHECK(syncOutput.str() == asyncOutput.str());
+}
+
+class NullBuffer : public std::streambuf {
+protected:
+    virtual int overflow(int c) { return traits_type::not_eof(c); }
+    virtual std::streamsize xsputn(const char *s, std::streamsize n)
+        { return n; }
+};
+
+static long long parseLibc(const std::string &path, bool async) {
+    NullBuffer buffer;
+    std::ostream output(&buffer);
+    LogStream::overrideStream(&output);
+    auto registry = GroupRegistry::getInstance();
+    for(const auto &name : registry->getSettingNames()) {
+        registry->applySetting(name, 10);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if(async) AsyncLog::start();
+    {
+        Conductor conductor;
+        conductor.parseAnything(path);
+    }
+    if(async) AsyncLog::stop();
+    auto time = std::chrono::steady_clock::now() - start;
+
+    registry->muteAllSettings();
+    LogStream::overrideStream(nullptr);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        time).count();
+}
+
+TEST_CASE("log all of a libc parse at level 10", "[log][full][.]") {
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    std::string path;
+    {
+        ElfMap elf(TESTDIR "hello");
+        Conductor conductor;
+        conductor.parseExecutable(&elf);
+        conductor.parseLibraries();
+        auto libc = conductor.getLibraryList()->getLibc();
+        REQUIRE(libc != nullptr);
+        path = libc->getResolvedPath();
+    }
+
+    auto syncTime = parseLibc(path, false);
+    auto asyncTime = parseLibc(path, true);
+
+    std::ostringstream stream;
+    stream << path << " at level 10\n"
+        << "  synchronous: " << syncTime << " ms\n"
+        << "  asynchronous: " << asyncTime << " ms (until flushed)\n";
+    WARN(stream.str());
+}
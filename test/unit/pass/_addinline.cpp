@@ -0,0 +1,58 @@
+#include "framework/include.h"
+#include "operation/addinline.h"
+#include "analysis/controlflow.h"
+#include "analysis/regflow.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+#include <capstone/x86.h>
+
+static void insertNop(Instruction *point, RegisterLiveness *liveness,
+    ChunkAddInline::RegList regList) {
+
+    ChunkAddInline ai(regList, [] (unsigned int stackBytesAdded) {
+        return ChunkAddInline::InstrList{
+            Disassemble::instruction({0x90})};  // nop
+    });
+    ai.setLiveness(liveness);
+    ai.insertBefore(point, true);
+}
+
+TEST_CASE("inline code only saves live registers", "[pass][fast][x86_64]") {
+    Function *function = ChunkBuilder::makeFunction();
+    auto mov = ChunkBuilder::append(function,
+        {0x49, 0xc7, 0xc3, 0x01, 0, 0, 0});  // mov $1, %r11
+    auto add = ChunkBuilder::append(function,
+        {0x4c, 0x01, 0xd8});    // add %r11, %rax
+    ChunkBuilder::append(function, {0xc3});  // retq
+
+    ControlFlowGraph cfg(function);
+    RegisterLiveness liveness(&cfg);
+    ChunkAddInline::resetStatistics();
+
+    // %r11 and the flags are both overwritten by what follows
+    size_t size = function->getSize();
+    insertNop(mov, &liveness, {X86_REG_EFLAGS, X86_REG_R11});
+    CHECK(function->getSize() == size + 1);
+    CHECK(ChunkAddInline::getStatistics().spillSites == 0);
+    CHECK(ChunkAddInline::getStatistics().dead == 2);
+
+    // add reads %r11; the red zone is skipped since there is no frame
+    size = function->getSize();
+    insertNop(add, &liveness, {X86_REG_R11});
+    CHECK(function->getSize() == size + 5 + 2 + 1 + 2 + 8);
+
+    // without liveness, everything is saved
+    size = function->getSize();
+    insertNop(mov, nullptr, {X86_REG_R11});
+    CHECK(function->getSize() == size + 5 + 2 + 1 + 2 + 8);
+
+    const auto &statistics = ChunkAddInline::getStatistics();
+    CHECK(statistics.sites == 3);
+    CHECK(statistics.spillSites == 2);
+    CHECK(statistics.saved == 2);
+    delete function;
+}
+#endif
@@ -0,0 +1,47 @@
+#include "framework/include.h"
+#include "pass/findsyscalls.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+TEST_CASE("syscall numbers are found through a tail-called syscall()",
+    "[pass][fast][x86_64]") {
+
+    Library library("libc.so.6", Library::ROLE_LIBC);
+    Module *module = ChunkBuilder::makeModule();
+    module->setLibrary(&library);
+
+    auto syscall = ChunkBuilder::makeFunction({
+        {0x0f, 0x05},                               // syscall
+        {0xc3}}, 0x2000);                           // retq
+    syscall->setName("syscall");
+
+    auto wrapper = ChunkBuilder::makeFunction({
+        {0x48, 0xc7, 0xc7, 0x3c, 0, 0, 0},          // mov $0x3c, %rdi
+        {0xe9, 0, 0, 0, 0}}, 0x1000);               // jmp syscall
+    wrapper->setName("exit_wrapper");
+    auto jump = wrapper->getChildren()->getIterable()->get(0)
+        ->getChildren()->getIterable()->getLast();
+    jump->getSemantic()->setLink(
+        new NormalLink(syscall, Link::SCOPE_EXTERNAL_JUMP));
+
+    ChunkBuilder::add(module, syscall);
+    ChunkBuilder::add(module, wrapper);
+
+    CHECK(!wrapper->getFeatures().hasCall());
+    FindSyscalls findSyscalls;
+    wrapper->accept(&findSyscalls);
+
+    const auto &numberMap = findSyscalls.getNumberMap();
+    REQUIRE(numberMap.size() == 1);
+    CHECK(numberMap.begin()->first == jump);
+    CHECK(numberMap.begin()->second == std::set<unsigned long>{60});
+    CHECK(findSyscalls.getUnknownSet().empty());
+
+    delete wrapper;
+    delete syscall;
+    delete module->getFunctionList();
+    delete module;
+}
+#endif
@@ -0,0 +1,65 @@
+#include <cstring>
+#include "framework/include.h"
+#include "pass/hotcoldsplit.h"
+#include "pass/promotejumps.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "instr/concrete.h"
+#include "instr/writer.h"
+#include "operation/mutator.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+TEST_CASE("branches into a cold part still reach it once it is moved",
+    "[pass][fast][x86_64]") {
+
+    Module *module = ChunkBuilder::makeModule();
+    auto function = ChunkBuilder::makeFunction({
+        {0x85, 0xff},                               // test %edi, %edi
+        {0x74, 0x00}}, 0x1000);                     // je cold
+    auto jump = function->getChildren()->getIterable()->getLast()
+        ->getChildren()->getIterable()->getLast();
+    ChunkBuilder::append(ChunkBuilder::appendBlock(function),
+        {0xc3});                                    // retq
+    auto coldBlock = ChunkBuilder::appendBlock(function);
+    auto coldEntry = ChunkBuilder::append(coldBlock,
+        {0xb8, 0x01, 0, 0, 0});                     // mov $1, %eax
+    ChunkBuilder::append(coldBlock, {0xc3});        // retq
+    jump->getSemantic()->setLink(
+        new NormalLink(coldEntry, Link::SCOPE_INTERNAL_JUMP));
+    ChunkBuilder::add(module, function);
+
+    std::map<Function *, HotColdSplitPass::BlockCounts> profile;
+    profile[function] = {{0x1000, 5}, {0x1004, 5}, {0x1005, 0}};
+    HotColdSplitPass hotColdSplit(profile, 1);
+    module->accept(&hotColdSplit);
+
+    REQUIRE(hotColdSplit.getColdFunctions().size() == 1);
+    auto coldFunction = hotColdSplit.getColdFunctions().front();
+    CHECK(coldEntry->getParent()->getParent() == coldFunction);
+
+    auto v = dynamic_cast<ControlFlowInstruction *>(jump->getSemantic());
+    REQUIRE(v);
+    CHECK(v->getLink()->isExternalJump());
+    CHECK(v->getDisplacementSize() == 4);
+
+    // relaxing jumps must not shrink it while the parts are adjacent
+    PromoteJumpsPass promoteJumps;
+    module->accept(&promoteJumps);
+    CHECK(v->getDisplacementSize() == 4);
+
+    ChunkMutator(coldFunction).setPosition(0x400000);
+    REQUIRE(coldEntry->getAddress() == 0x400000);
+
+    std::string data;
+    InstrWriterCppString writer(data);
+    v->accept(&writer);
+    REQUIRE(data.size() == 6);
+    CHECK(static_cast<unsigned char>(data[0]) == 0x0f);
+    CHECK(static_cast<unsigned char>(data[1]) == 0x84);
+    int32_t disp;
+    std::memcpy(&disp, data.data() + 2, sizeof(disp));
+    CHECK(jump->getAddress() + jump->getSize() + disp
+        == coldEntry->getAddress());
+}
+#endif
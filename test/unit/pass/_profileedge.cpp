@@ -0,0 +1,47 @@
+#include "framework/include.h"
+#include "pass/profileedge.h"
+
+static ProfileEdgePass::Edge edge(int source, int target, long weight) {
+    ProfileEdgePass::Edge e;
+    e.source = source;
+    e.target = target;
+    e.kind = ProfileEdgePass::EDGE_JUMP;
+    e.offset = 0;
+    e.placement = ProfileEdgePass::PLACE_TARGET;
+    e.weight = weight;
+    e.onTree = false;
+    e.counter = ProfileEdgePass::COUNTER_UNKNOWN;
+    return e;
+}
+
+TEST_CASE("edge profiling spanning tree", "[pass][fast]") {
+    SECTION("diamond with exit") {
+        // 0 -> 1, 0 -> 2, 1 -> 3, 2 -> 3, 3 -> exit(4), exit -> 0
+        std::vector<ProfileEdgePass::Edge> edges = {
+            edge(0, 1, 2), edge(0, 2, 2), edge(1, 3, 2), edge(2, 3, 2),
+            edge(3, 4, 1), edge(4, 0, 1L << 40)
+        };
+        // E - (N - 1) edges need counters
+        CHECK(ProfileEdgePass::chooseSpanningTree(5, edges) == 2);
+        CHECK(edges[5].onTree);
+        CHECK(!edges[4].onTree);
+    }
+
+    SECTION("loop back edge stays on the tree") {
+        // 0 -> 1, 1 -> 1 (self loop), 1 -> 2, 2 -> 1 (back edge), 2 -> exit
+        std::vector<ProfileEdgePass::Edge> edges = {
+            edge(0, 1, 2), edge(1, 1, 2), edge(1, 2, 2),
+            edge(2, 1, 1L << 20), edge(2, 3, 1), edge(3, 0, 1L << 40)
+        };
+        CHECK(ProfileEdgePass::chooseSpanningTree(4, edges) == 3);
+        CHECK(!edges[1].onTree);
+        CHECK(edges[3].onTree);
+        CHECK(edges[5].onTree);
+
+        size_t treeEdges = 0;
+        for(const auto &e : edges) {
+            if(e.onTree) treeEdges ++;
+        }
+        CHECK(treeEdges == 3);
+    }
+}
@@ -1,6 +1,9 @@
 #include <climits>
 #include "framework/include.h"
 #include "pass/promotejumps.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "unit/framework/chunkbuilder.h"
 
 TEST_CASE("jump displacement fits-in range test", "[pass][fast][x86_64]") {
 #ifdef ARCH_X86_64
@@ -25,3 +28,106 @@ TEST_CASE("jump displacement fits-in range test", "[pass][fast][x86_64]") {
     CHECK(PromoteJumpsPass::fitsIn<signed long>(ULONG_MAX));
 #endif
 }
+
+#ifdef ARCH_X86_64
+/** A rel32 jmp over padding nops to a retq. */
+static Function *makeJumpOver(size_t padding, Instruction **jump) {
+    Function *function = ChunkBuilder::makeFunction();
+    *jump = ChunkBuilder::append(function, {0xe9, 0, 0, 0, 0});
+    auto nops = ChunkBuilder::appendBlock(function);
+    for(size_t i = 0; i < padding; i ++) ChunkBuilder::append(nops, {0x90});
+    auto ret = ChunkBuilder::append(
+        ChunkBuilder::appendBlock(function), {0xc3});
+
+    (*jump)->getSemantic()->setLink(
+        new NormalLink(ret, Link::SCOPE_INTERNAL_JUMP));
+    return function;
+}
+
+TEST_CASE("jumps in reach are shrunk", "[pass][fast][x86_64]") {
+    Instruction *jump;
+    auto function = makeJumpOver(100, &jump);
+
+    PromoteJumpsPass promoteJumps;
+    function->accept(&promoteJumps);
+    CHECK(jump->getSize() == 2);
+    CHECK(promoteJumps.getSavedBytes() == 3);
+    CHECK(function->getSize() == 2 + 100 + 1);
+    delete function;
+}
+
+TEST_CASE("jumps out of reach stay wide", "[pass][fast][x86_64]") {
+    Instruction *jump;
+    auto function = makeJumpOver(200, &jump);
+
+    PromoteJumpsPass promoteJumps;
+    function->accept(&promoteJumps);
+    CHECK(jump->getSize() == 5);
+    CHECK(promoteJumps.getSavedBytes() == 0);
+    delete function;
+}
+
+TEST_CASE("jrcxz out of reach gets a trampoline in its own blocks",
+    "[pass][fast][x86_64]") {
+
+    Function *function = ChunkBuilder::makeFunction();
+    auto jrcxz = ChunkBuilder::append(function, {0xe3, 0x00});
+    auto next = ChunkBuilder::append(function, {0x90});
+    auto nops = ChunkBuilder::appendBlock(function);
+    for(size_t i = 0; i < 200; i ++) ChunkBuilder::append(nops, {0x90});
+    auto ret = ChunkBuilder::append(
+        ChunkBuilder::appendBlock(function), {0xc3});
+    jrcxz->getSemantic()->setLink(
+        new NormalLink(ret, Link::SCOPE_INTERNAL_JUMP));
+
+    PromoteJumpsPass promoteJumps;
+    function->accept(&promoteJumps);
+
+    // jrcxz | jmp next | jmp ret | nop | nops... | ret
+    auto blockList = function->getChildren()->getIterable();
+    REQUIRE(blockList->getCount() == 6);
+    for(size_t i = 0; i < 3; i ++) {
+        auto block = blockList->get(i);
+        CHECK(dynamic_cast<ControlFlowInstruction *>(block->getChildren()
+            ->getIterable()->getLast()->getSemantic()));
+    }
+    CHECK(blockList->get(0)->getChildren()->getIterable()->getCount() == 1);
+    CHECK(next->getParent() == blockList->get(3));
+
+    auto skip = blockList->get(1)->getChildren()->getIterable()->get(0);
+    auto far = blockList->get(2)->getChildren()->getIterable()->get(0);
+    CHECK(jrcxz->getSize() == 2);
+    CHECK(skip->getSize() == 2);
+    CHECK(far->getSize() == 5);
+    CHECK(jrcxz->getSemantic()->getLink()->getTarget() == far);
+    CHECK(skip->getSemantic()->getLink()->getTarget() == next);
+    CHECK(far->getSemantic()->getLink()->getTarget() == ret);
+
+    CHECK(next->getAddress() == function->getAddress() + 2 + 2 + 5);
+    CHECK(function->getSize() == 2 + 2 + 5 + 1 + 200 + 1);
+    CHECK(promoteJumps.getSavedBytes() == -7);
+    delete function;
+}
+
+TEST_CASE("jumps to other functions stay wide", "[pass][fast][x86_64]") {
+    auto module = ChunkBuilder::makeModule();
+    auto caller = ChunkBuilder::makeFunction(0x1000);
+    auto jump = ChunkBuilder::append(caller, {0xe9, 0, 0, 0, 0});
+    auto callee = ChunkBuilder::makeFunction({{0xc3}}, 0x1005);
+    ChunkBuilder::add(module, caller);
+    ChunkBuilder::add(module, callee);
+    jump->getSemantic()->setLink(
+        new NormalLink(callee, Link::SCOPE_EXTERNAL_JUMP));
+
+    // in reach now, but the generator may place callee elsewhere
+    PromoteJumpsPass promoteJumps;
+    module->accept(&promoteJumps);
+    CHECK(jump->getSize() == 5);
+    CHECK(promoteJumps.getSavedBytes() == 0);
+
+    delete callee;
+    delete caller;
+    delete module->getFunctionList();
+    delete module;
+}
+#endif
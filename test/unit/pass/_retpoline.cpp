@@ -0,0 +1,132 @@
+#include <string>
+#include "framework/include.h"
+#include "pass/retpoline.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "disasm/disassemble.h"
+#include "disasm/handle.h"
+#include "transform/generator.h"
+#include "transform/sandbox.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+static Instruction *getInstruction(Function *function, size_t index) {
+    auto block = function->getChildren()->getIterable()->get(0);
+    return block->getChildren()->getIterable()->get(index);
+}
+
+static std::string getBytes(Instruction *instr) {
+    auto assembly = instr->getSemantic()->getAssembly();
+    return assembly ? std::string(assembly->getBytes(), assembly->getSize())
+        : std::string();
+}
+
+static Function *getTarget(Instruction *instr) {
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(instr->getSemantic());
+    if(!cfi || !cfi->getLink()) return nullptr;
+    return dynamic_cast<Function *>(cfi->getLink()->getTarget());
+}
+
+TEST_CASE("shared retpolines load memory operands at the call site",
+    "[pass][fast][x86_64]") {
+
+    auto module = ChunkBuilder::makeModule();
+    auto function = ChunkBuilder::makeFunction({
+        {0xff, 0x50, 0x08},         // callq *0x8(%rax)
+        {0xff, 0x54, 0x24, 0x10},   // callq *0x10(%rsp)
+        {0xff, 0xd3},               // callq *%rbx
+        {0xc3}});                   // retq
+    ChunkBuilder::add(module, function);
+
+    RetpolinePass retpoline(RetpolinePass::MODE_SHARED);
+    module->accept(&retpoline);
+    CHECK(retpoline.getThunkCount() == 2);
+
+    // movq 0x8(%rax), %r11
+    CHECK(getBytes(getInstruction(function, 0))
+        == std::string("\x4c\x8b\x98\x08\x00\x00\x00", 7));
+    auto r11 = getTarget(getInstruction(function, 1));
+    REQUIRE(r11);
+    CHECK(r11->getName() == "__x86_indirect_thunk_r11");
+    CHECK(r11->getAlignment() == RetpolinePass::THUNK_ALIGNMENT);
+
+    // movq 0x10(%rsp), %r11, with %rsp as it was at the call
+    CHECK(getBytes(getInstruction(function, 2))
+        == std::string("\x4c\x8b\x9c\x24\x10\x00\x00\x00", 8));
+    CHECK(getTarget(getInstruction(function, 3)) == r11);
+
+    auto rbx = getTarget(getInstruction(function, 4));
+    REQUIRE(rbx);
+    CHECK(rbx->getName() == "__x86_indirect_thunk_rbx");
+}
+
+TEST_CASE("registers loaded with a function address are branched to directly",
+    "[pass][fast][x86_64]") {
+
+    auto module = ChunkBuilder::makeModule();
+    auto target = ChunkBuilder::makeFunction({
+        {0xc3}}, 0x2000);           // retq
+    ChunkBuilder::add(module, target);
+
+    auto function = ChunkBuilder::makeFunction(0x1000);
+    auto block = function->getChildren()->getIterable()->get(0);
+
+    // lea target(%rip), %rax
+    static DisasmHandle handle(true);
+    auto lea = new Instruction();
+    auto leaSem = new LinkedInstruction(lea);
+    leaSem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
+        std::vector<unsigned char>{0x48, 0x8d, 0x05, 0, 0, 0, 0}));
+    leaSem->setLink(new NormalLink(target, Link::SCOPE_WITHIN_MODULE));
+    leaSem->setIndex(0);
+    lea->setSemantic(leaSem);
+    ChunkBuilder::append(block, lea);
+
+    auto call = ChunkBuilder::append(block, {0xff, 0xd0});  // callq *%rax
+    auto jump = ChunkBuilder::append(block, {0xff, 0xe1});  // jmpq *%rcx
+    ChunkBuilder::add(module, function);
+
+    RetpolinePass retpoline(RetpolinePass::MODE_SHARED);
+    retpoline.setMakeDirect(true);
+    module->accept(&retpoline);
+
+    CHECK(retpoline.getDirectCount() == 1);
+    CHECK(getTarget(call) == target);
+
+    // nothing in the block says where %rcx points
+    auto thunk = getTarget(jump);
+    REQUIRE(thunk);
+    CHECK(thunk->getName() == "__x86_indirect_thunk_rcx");
+}
+
+TEST_CASE("retpoline thunks are placed on cache line boundaries",
+    "[pass][fast][x86_64]") {
+
+    auto module = ChunkBuilder::makeModule();
+    auto first = ChunkBuilder::makeFunction({
+        {0xc3}}, 0x10);             // retq
+    auto function = ChunkBuilder::makeFunction({
+        {0xff, 0xd3},               // callq *%rbx
+        {0xc3}}, 0x1000);           // retq
+    ChunkBuilder::add(module, first);
+    ChunkBuilder::add(module, function);
+
+    // the thunk is laid out between the two functions
+    RetpolinePass retpoline(RetpolinePass::MODE_SHARED);
+    module->accept(&retpoline);
+    auto thunk = getTarget(getInstruction(function, 0));
+    REQUIRE(thunk);
+    REQUIRE(thunk->getAddress() > first->getAddress());
+    REQUIRE(thunk->getAddress() < function->getAddress());
+
+    const address_t base = 0x40000000;
+    SandboxImpl<MemoryBufferBacking, WatermarkAllocator<MemoryBufferBacking>>
+        sandbox(MemoryBufferBacking(base, 0x1000));
+    Generator(&sandbox).assignAddresses(module);
+
+    const size_t alignment = RetpolinePass::THUNK_ALIGNMENT;
+    CHECK(first->getAssignedPosition()->get() == base);
+    CHECK(thunk->getAssignedPosition()->get() == base + alignment);
+    CHECK(function->getAssignedPosition()->get() == base + 2 * alignment);
+}
+#endif
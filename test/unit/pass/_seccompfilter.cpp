@@ -0,0 +1,97 @@
+#include <cstddef>
+#include <linux/seccomp.h>
+#include <sys/syscall.h>
+#include "framework/include.h"
+#include "pass/seccompfilter.h"
+
+#ifdef ARCH_X86_64
+#include <linux/audit.h>
+
+// runs a filter over seccomp_data the way the kernel would
+static uint32_t run(const std::vector<sock_filter> &code,
+    const seccomp_data &data) {
+
+    uint32_t a = 0;
+    for(size_t pc = 0; pc < code.size(); pc ++) {
+        const auto &ins = code[pc];
+        switch(ins.code) {
+        case BPF_LD | BPF_W | BPF_ABS:
+            a = *reinterpret_cast<const uint32_t *>(
+                reinterpret_cast<const char *>(&data) + ins.k);
+            break;
+        case BPF_JMP | BPF_JA:
+            pc += ins.k;
+            break;
+        case BPF_JMP | BPF_JEQ | BPF_K:
+            pc += (a == ins.k ? ins.jt : ins.jf);
+            break;
+        case BPF_JMP | BPF_JGE | BPF_K:
+            pc += (a >= ins.k ? ins.jt : ins.jf);
+            break;
+        case BPF_RET | BPF_K:
+            return ins.k;
+        default:
+            FAIL("unexpected instruction");
+        }
+    }
+    FAIL("fell off the end of the filter");
+    return 0;
+}
+
+static uint32_t run(const std::vector<sock_filter> &code, int nr,
+    std::vector<uint64_t> args = {}) {
+
+    seccomp_data data = {};
+    data.nr = nr;
+    data.arch = AUDIT_ARCH_X86_64;
+    for(size_t i = 0; i < args.size(); i ++) data.args[i] = args[i];
+    return run(code, data);
+}
+
+TEST_CASE("seccomp filter allows exactly the allowlist", "[pass][fast][x86_64]") {
+    SeccompFilter filter;
+    for(unsigned long nr = 0; nr < 400; nr += 3) filter.allow(nr);
+    filter.allow(1);
+    filter.allow(2);
+    // open with two known flag values
+    filter.allow(257, {{}, {}, {0, 0x80000}});
+    filter.allow(257, {{}, {}, {0x241}});
+    // exit with any argument after a constrained call site
+    filter.allow(60, {{1}});
+    filter.allow(60, {{}});
+
+    auto code = filter.compile();
+    CHECK(code.size() <= static_cast<size_t>(BPF_MAXINSNS));
+
+    for(int nr = 0; nr < 500; nr ++) {
+        CAPTURE(nr);
+        bool allowed = (nr < 400 && nr % 3 == 0) || nr == 1 || nr == 2
+            || nr == 60 || nr == 257 || nr == SYS_restart_syscall;
+        if(nr == 257) continue;
+        CHECK((run(code, nr, {7, 7, 7}) == SECCOMP_RET_ALLOW) == allowed);
+    }
+
+    CHECK(run(code, 257, {5, 6, 0x80000}) == SECCOMP_RET_ALLOW);
+    CHECK(run(code, 257, {5, 6, 0x241}) == SECCOMP_RET_ALLOW);
+    CHECK(run(code, 257, {5, 6, 0x1}) == SECCOMP_RET_KILL_PROCESS);
+    CHECK(run(code, 0x40000000 | 1) == SECCOMP_RET_KILL_PROCESS);
+
+    seccomp_data data = {};
+    data.nr = 1;
+    data.arch = AUDIT_ARCH_I386;
+    CHECK(run(code, data) == SECCOMP_RET_KILL_PROCESS);
+}
+
+TEST_CASE("seccomp filter lets the kernel restart syscalls",
+    "[pass][fast][x86_64]") {
+
+    SeccompFilter filter;
+    filter.allow(SYS_nanosleep);
+    CHECK(!filter.isAllowed(SYS_restart_syscall));
+
+    auto code = filter.compile();
+    CHECK(run(code, SYS_restart_syscall) == SECCOMP_RET_ALLOW);
+    CHECK(run(code, SYS_restart_syscall - 1) == SECCOMP_RET_KILL_PROCESS);
+    CHECK(run(code, SYS_restart_syscall + 1) == SECCOMP_RET_KILL_PROCESS);
+}
+#endif
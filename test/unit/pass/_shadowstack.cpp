@@ -0,0 +1,52 @@
+#include "framework/include.h"
+#include "pass/shadowstack.h"
+#include "chunk/concrete.h"
+#include "unit/framework/chunkbuilder.h"
+
+#ifdef ARCH_X86_64
+TEST_CASE("leaf functions without a frame need no shadow stack",
+    "[pass][fast][x86_64]") {
+
+    auto leaf = ChunkBuilder::makeFunction({
+        {0x53},                 // push %rbx
+        {0x48, 0x8b, 0x1e},     // mov (%rsi), %rbx
+        {0x48, 0x89, 0x1d, 0x10, 0, 0, 0},  // mov %rbx, 0x10(%rip)
+        {0x0f, 0x1f, 0x40, 0},  // nopl 0x0(%rax)
+        {0x5b},                 // pop %rbx
+        {0xc3}});               // retq
+    CHECK(ShadowStackPass::isReturnAddressSafe(leaf));
+    delete leaf;
+
+    // %rsi may point into the caller's frame, next to the return address
+    auto store = ChunkBuilder::makeFunction({
+        {0x48, 0x89, 0x3e},     // mov %rdi, (%rsi)
+        {0xc3}});               // retq
+    CHECK(!ShadowStackPass::isReturnAddressSafe(store));
+    delete store;
+
+    auto string = ChunkBuilder::makeFunction({
+        {0xf3, 0x48, 0xab},     // rep stos %rax, %es:(%rdi)
+        {0xc3}});               // retq
+    CHECK(!ShadowStackPass::isReturnAddressSafe(string));
+    delete string;
+
+    auto frame = ChunkBuilder::makeFunction({
+        {0x48, 0x83, 0xec, 0x18},           // sub $0x18, %rsp
+        {0x48, 0x89, 0x7c, 0x24, 0x08},     // mov %rdi, 0x8(%rsp)
+        {0x48, 0x83, 0xc4, 0x18},           // add $0x18, %rsp
+        {0xc3}});                           // retq
+    CHECK(!ShadowStackPass::isReturnAddressSafe(frame));
+    delete frame;
+
+    auto syscall = ChunkBuilder::makeFunction({
+        {0x0f, 0x05},           // syscall
+        {0xc3}});               // retq
+    CHECK(!ShadowStackPass::isReturnAddressSafe(syscall));
+    delete syscall;
+
+    auto indirect = ChunkBuilder::makeFunction({
+        {0xff, 0xe0}});         // jmpq *%rax
+    CHECK(!ShadowStackPass::isReturnAddressSafe(indirect));
+    delete indirect;
+}
+#endif
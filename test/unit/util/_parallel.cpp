@@ -0,0 +1,42 @@
+#include <atomic>
+#include <vector>
+#include "framework/include.h"
+#include "util/parallel.h"
+
+TEST_CASE("parallelFor visits every item once", "[util][fast]") {
+    for(size_t workers : {1, 2, 8}) {
+        std::vector<std::atomic<int>> seen(1000);
+        for(auto &s : seen) s = 0;
+
+        parallelFor(seen.size(), workers, [&seen] (size_t i) { seen[i] ++; });
+
+        bool allOnce = true;
+        for(auto &s : seen) {
+            if(s != 1) allOnce = false;
+        }
+        CHECK(allOnce);
+    }
+}
+
+TEST_CASE("parallelFor rethrows worker exceptions", "[util][fast]") {
+    CHECK_THROWS_AS(parallelFor(100, 4, [] (size_t i) {
+        if(i == 42) throw "bad item";
+    }), const char *);
+}
+
+TEST_CASE("parallelAnalyze merges in order", "[util][fast]") {
+    for(size_t workers : {1, 2, 8}) {
+        std::vector<size_t> merged;
+        parallelAnalyze<size_t>(500, workers,
+            [] (size_t i, size_t &result) { result = i * i; },
+            [&merged] (size_t i, size_t result) {
+                merged.push_back(result);
+            });
+
+        bool inOrder = (merged.size() == 500);
+        for(size_t i = 0; i < merged.size(); i ++) {
+            if(merged[i] != i * i) inOrder = false;
+        }
+        CHECK(inOrder);
+    }
+}